@@ -37,6 +37,8 @@ TextIOHandler cli;
 
 void TextIOHandler::init() {
 	bool have_stderr;
+	// not wxTheApp, when exporting without a display this is a console application
+	wxAppConsole* app = wxAppConsole::GetInstance();
 	#if defined(__WXMSW__)
 		have_console = false;
 		escapes = false;
@@ -45,8 +47,8 @@ void TextIOHandler::init() {
 		have_stderr  = StdHandleOk(STD_ERROR_HANDLE);
 		// Detect the --color flag, indicating we should allow escapes
 		if (have_console) {
-			for (int i = 1 ; i < wxTheApp->argc ; ++i) {
-				if (String(wxTheApp->argv[i]) == _("--color")) {
+			for (int i = 1 ; i < app->argc ; ++i) {
+				if (String(app->argv[i]) == _("--color")) {
 					escapes = true;
 					break;
 				}
@@ -58,9 +60,9 @@ void TextIOHandler::init() {
 		have_stderr = false;
 		// Use console mode if one of the cli flags is passed
 		static const Char* redirect_flags[] = {_("-?"),_("--help"),_("-v"),_("--version"),_("--cli"),_("-c"),_("--export"),_("--export-images"),_("--create-installer")};
-		for (int i = 1 ; i < wxTheApp->argc ; ++i) {
+		for (int i = 1 ; i < app->argc ; ++i) {
 			for (size_t j = 0 ; j < sizeof(redirect_flags)/sizeof(redirect_flags[0]) ; ++j) {
-				if (String(wxTheApp->argv[i]) == redirect_flags[j]) {
+				if (String(app->argv[i]) == redirect_flags[j]) {
 					have_console = true;
 					have_stderr = true;
 					break;
@@ -39,6 +39,7 @@ Field::Field()
 	, card_list_align  (ALIGN_LEFT)
 	, default_name     (_("Default"))
 	, initial          (script_default_nil)
+	, update_order     (0)
 {}
 
 Field::~Field() {}
@@ -355,13 +356,13 @@ void Writer::handle(ScriptValueP const& value) {
 IMPLEMENT_DYNAMIC_ARG(Value*, value_being_updated, nullptr);
 
 Value::Value(const FieldP& field)
-	: fieldP(field), value(field->initial)
+	: fieldP(field), value(field->initial), collation_key_valid(false)
 {
 	assert(value);
 }
 
 Value::Value(const FieldP& field, const ScriptValueP& value)
-	: fieldP(field), value(value)
+	: fieldP(field), value(value), collation_key_valid(false)
 {
 	assert(value);
 }
@@ -402,6 +403,15 @@ bool Value::update(Context& ctx, const Action* act) {
 
 void Value::updateSortValue(Context& ctx) {
 	sort_value = fieldP->sort_script.invoke(ctx)->toString();
+	collation_key_valid = false;
+}
+
+const CollationKey& Value::getCollationKey() const {
+	if (!collation_key_valid) {
+		collation_key = ::collation_key(getSortKey());
+		collation_key_valid = true;
+	}
+	return collation_key;
 }
 
 
@@ -64,6 +64,7 @@ class Field : public IntrusivePtrVirtualBase {
 	String          default_name;      ///< Name of the 'default' choice
 	ScriptValueP    initial;           ///< Initial value of a new value
 	Dependencies    dependent_scripts; ///< Scripts that depend on values of this field
+	int             update_order;      ///< Values of fields with a lower update_order are updated first, see SetScriptManager
 	
 	/// Creates a new Value corresponding to this Field
 	virtual ValueP newValue() = 0;
@@ -256,6 +257,9 @@ class Value : public IntrusivePtrVirtualBase {
 	inline String getSortKey() const {
 		return fieldP->sort_script ? sort_value : toFriendlyString();
 	}
+	/// Get the collation_key of the sort key, this is cached until the value is updated
+	/** Should only be used from the main thread! */
+	const CollationKey& getCollationKey() const;
 	
   protected:
 	/// update() split into two functions;.
@@ -263,6 +267,8 @@ class Value : public IntrusivePtrVirtualBase {
 	void updateSortValue(Context& ctx);
 	
   private:
+	mutable CollationKey collation_key;       ///< Cached collation key of getSortKey()
+	mutable bool         collation_key_valid; ///< Is the collation_key up to date?
 	DECLARE_REFLECTION_VIRTUAL();
 };
 
@@ -36,9 +36,14 @@ class Filter : public IntrusivePtrVirtualBase {
 
 // ----------------------------------------------------------------------------- : Quick search
 
-/// Does the given object match the quick search query?
-template <typename T>
-bool match_quicksearch_query(String const& query, T const& object) {
+/// A component of a quick search query
+struct QuickSearchTerm {
+	String text;    ///< Text to search for
+	bool   negated; ///< Match only if the text is not found?
+};
+
+/// Split a quick search query into its components
+inline void parse_quicksearch_query(String const& query, vector<QuickSearchTerm>& out) {
 	bool need_match = true;
 	// iterate over the components of the query
 	for (size_t i = 0 ; i < query.size() ; ) {
@@ -60,14 +65,24 @@ bool match_quicksearch_query(String const& query, T const& object) {
 				// single word
 				next = end = query.find_first_of(_(' '),i);
 			}
-			bool match = object.contains(query.substr(i,end-i));
-			if (match != need_match) {
-				return false;
-			}
+			QuickSearchTerm term = { query.substr(i,end-i), !need_match };
+			out.push_back(term);
 			need_match = true; // next word is no longer negated
 			i = next;
 		}
 	}
+}
+
+/// Does the given object match the quick search query?
+template <typename T>
+bool match_quicksearch_query(String const& query, T const& object) {
+	vector<QuickSearchTerm> terms;
+	parse_quicksearch_query(query, terms);
+	for(const auto& term : terms) {
+		if (object.contains(term.text) == term.negated) {
+			return false;
+		}
+	}
 	return true;
 }
 
@@ -80,7 +95,7 @@ class QuickFilter : public Filter<T> {
 	virtual bool keep(T const& x) const {
 		return match_quicksearch_query(query, x);
 	}
-  private:
+  protected:
 	String query;
 };
 
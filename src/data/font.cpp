@@ -8,6 +8,7 @@
 
 #include <util/prec.hpp>
 #include <data/font.hpp>
+#include <gfx/headless_dc.hpp>
 
 // ----------------------------------------------------------------------------- : Font
 
@@ -76,6 +77,13 @@ FontP Font::make(int add_flags, AColor* other_color, double* other_size) const {
 	return f;
 }
 
+/// The default font of the system
+/** Without a display wxNORMAL_FONT is not available, then use a font of the usual size. */
+wxFont normal_font() {
+	if (headless_rendering()) return wxFont(10, wxFONTFAMILY_SWISS, wxFONTSTYLE_NORMAL, wxFONTWEIGHT_NORMAL);
+	return *wxNORMAL_FONT;
+}
+
 wxFont Font::toWxFont(double scale) const {
 	int size_i = to_int(scale * size);
 	int weight_i = flags & FONT_BOLD   ? wxFONTWEIGHT_BOLD  : wxFONTWEIGHT_NORMAL;
@@ -84,12 +92,12 @@ wxFont Font::toWxFont(double scale) const {
 	wxFont font;
 	if (flags & FONT_CODE) {
 		if (size_i < 2) {
-			return wxFont(wxNORMAL_FONT->GetPointSize(), wxFONTFAMILY_TELETYPE, wxFONTSTYLE_NORMAL, weight_i, underline(), _("Courier New"));
+			return wxFont(normal_font().GetPointSize(), wxFONTFAMILY_TELETYPE, wxFONTSTYLE_NORMAL, weight_i, underline(), _("Courier New"));
 		} else {
 			font = wxFont(size_i, wxFONTFAMILY_TELETYPE, wxFONTSTYLE_NORMAL, weight_i, underline(), _("Courier New"));
 		}
 	} else if (name().empty()) {
-		font = *wxNORMAL_FONT;
+		font = normal_font();
 		font.SetPointSize(size > 1 ? size_i : int(scale * font.GetPointSize()));
 		return font;
 	} else if (flags & FONT_ITALIC && !italic_name().empty()) {
@@ -92,8 +92,12 @@ FileFormatP mtg_editor_file_format();
 void export_images(Window* parent, const SetP& set);
 
 /// Export the image for each card in a list of cards
+/** If jobs > 1, the images are encoded and written by that many threads.
+ *  Filenames are still determined in card order, so the output is the same.
+ */
 void export_images(const SetP& set, const vector<CardP>& cards,
-                   const String& path, const String& filename_template, FilenameConflicts conflicts);
+                   const String& path, const String& filename_template, FilenameConflicts conflicts,
+                   int jobs = 1);
 
 /// Export the image of a single card
 void export_image(const SetP& set, const CardP& card, const String& filename);
@@ -101,6 +105,10 @@ void export_image(const SetP& set, const CardP& card, const String& filename);
 /// Generate a bitmap image of a card
 Bitmap export_bitmap(const SetP& set, const CardP& card);
 
+/// Generate an image of a card
+/** Unlike export_bitmap this also works without a display, see headless_rendering() */
+Image export_card_image(const SetP& set, const CardP& card);
+
 /// Export a set to Magic Workstation format
 void export_mws(Window* parent, const SetP& set);
 
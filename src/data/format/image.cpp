@@ -14,22 +14,33 @@
 #include <data/stylesheet.hpp>
 #include <data/settings.hpp>
 #include <render/card/viewer.hpp>
+#include <gfx/headless_dc.hpp>
 #include <wx/filename.h>
+#include <wx/thread.h>
+#include <deque>
+
+using std::make_pair;
+using std::pair;
+using std::max;
 
 
 // ----------------------------------------------------------------------------- : Single card export
 
 void export_image(const SetP& set, const CardP& card, const String& filename) {
-	Image img = export_bitmap(set, card).ConvertToImage();
+	Image img = export_card_image(set, card);
 	img.SaveFile(filename);	// can't use Bitmap::saveFile, it wants to know the file type
 							// but image.saveFile determines it automagicly
 }
 
+/// A viewer for a single card, for exporting
 class UnzoomedDataViewer : public DataViewer {
   public:
-	UnzoomedDataViewer(bool use_zoom_settings)
-		: use_zoom_settings(use_zoom_settings)
-	{}
+	UnzoomedDataViewer(const SetP& set, const CardP& card)
+		: use_zoom_settings(!settings.stylesheetSettingsFor(set->stylesheetFor(card)).card_normal_export())
+	{
+		setSet(set);
+		setCard(card);
+	}
 	virtual Rotation getRotation() const;
   private:
 	bool use_zoom_settings;
@@ -46,9 +57,7 @@ Rotation UnzoomedDataViewer::getRotation() const {
 Bitmap export_bitmap(const SetP& set, const CardP& card) {
 	if (!set) throw Error(_("no set"));
 	// create viewer
-	UnzoomedDataViewer viewer(!settings.stylesheetSettingsFor(set->stylesheetFor(card)).card_normal_export());
-	viewer.setSet(set);
-	viewer.setCard(card);
+	UnzoomedDataViewer viewer(set, card);
 	// size of cards
 	RealSize size = viewer.getRotation().getExternalSize();
 	// create bitmap & dc
@@ -62,31 +71,150 @@ Bitmap export_bitmap(const SetP& set, const CardP& card) {
 	return bitmap;
 }
 
+Image export_card_image(const SetP& set, const CardP& card) {
+	if (!headless_rendering()) {
+		return export_bitmap(set, card).ConvertToImage();
+	}
+	if (!set) throw Error(_("no set"));
+	// without a display, draw directly into an image
+	UnzoomedDataViewer viewer(set, card);
+	RealSize size = viewer.getRotation().getExternalSize();
+	HeadlessDC dc((int) size.width, (int) size.height);
+	if (!dc.IsOk()) throw InternalError(_("Unable to create image"));
+	viewer.draw(dc);
+	return dc.getImage();
+}
+
 // ----------------------------------------------------------------------------- : Multiple card export
 
+/// Queue of rendered card images that still have to be written to disk
+/** Cards are rendered on the main thread:
+ *   - There is one script context per set, and Set::getContext only works on the main thread.
+ *   - Drawing a card runs the stylesheet scripts (SetScriptManager::updateStyles),
+ *     and the results are stored in the Style objects, which are shared by all cards of a stylesheet.
+ *     Drawing two cards at the same time would need a copy of the stylesheet and script manager per thread.
+ *   - With a display, wxMemoryDC and wxBitmap can only be used from the main thread.
+ *  Encoding and writing the image files is done by a pool of ImageSaveWorkers.
+ */
+class ImageSaveQueue {
+  public:
+	ImageSaveQueue(size_t capacity)
+		: not_empty(mutex), not_full(mutex)
+		, capacity(capacity), finished(false)
+	{}
+	
+	/// Move an image to the queue, blocks while the queue is full
+	/** img is cleared while the lock is held, because the reference count of wxImage is not atomic */
+	void push(Image& img, const String& filename) {
+		wxMutexLocker lock(mutex);
+		while (images.size() >= capacity) not_full.Wait();
+		images.push_back(make_pair(img, filename));
+		img = Image();
+		not_empty.Signal();
+	}
+	/// Take an image from the queue, blocks while the queue is empty
+	/** Returns false if there are no more images */
+	bool pop(Image& img, String& filename) {
+		wxMutexLocker lock(mutex);
+		while (images.empty() && !finished) not_empty.Wait();
+		if (images.empty()) return false;
+		img      = images.front().first;
+		filename = images.front().second;
+		images.pop_front();
+		not_full.Signal();
+		return true;
+	}
+	/// No more images will be added
+	void finish() {
+		wxMutexLocker lock(mutex);
+		finished = true;
+		not_empty.Broadcast();
+	}
+	
+  private:
+	wxMutex     mutex;
+	wxCondition not_empty; ///< Signaled when an image is added, or when finished
+	wxCondition not_full;  ///< Signaled when an image is removed
+	std::deque<pair<Image,String> > images;
+	size_t capacity;
+	bool   finished;
+};
+
+/// Worker thread that saves images from an ImageSaveQueue
+class ImageSaveWorker : public wxThread {
+  public:
+	ImageSaveWorker(ImageSaveQueue& queue)
+		: wxThread(wxTHREAD_JOINABLE)
+		, queue(queue)
+	{}
+	
+	virtual ExitCode Entry() {
+		Image img;
+		String filename;
+		while (queue.pop(img, filename)) {
+			try {
+				img.SaveFile(filename);
+			} CATCH_ALL_ERRORS(false);
+			img.Destroy();
+		}
+		return 0;
+	}
+  private:
+	ImageSaveQueue& queue;
+};
 
 void export_images(const SetP& set, const vector<CardP>& cards,
-                   const String& path, const String& filename_template, FilenameConflicts conflicts)
+                   const String& path, const String& filename_template, FilenameConflicts conflicts,
+                   int jobs)
 {
 	wxBusyCursor busy;
 	// Script
 	ScriptP filename_script = parse(filename_template, nullptr, true);
 	// Path
 	wxFileName fn(path);
+	// Workers, for jobs <= 1 everything is done on this thread
+	ImageSaveQueue queue(2 * max(1, jobs));
+	vector<ImageSaveWorker*> workers;
+	for (int i = 0 ; i < jobs && jobs > 1 ; ++i) {
+		ImageSaveWorker* worker = new ImageSaveWorker(queue);
+		if (worker->Create() != wxTHREAD_NO_ERROR || worker->Run() != wxTHREAD_NO_ERROR) {
+			delete worker;
+			break;
+		}
+		workers.push_back(worker);
+	}
+	auto wait_for_workers = [&]() {
+		queue.finish();
+		for(auto& worker : workers) {
+			worker->Wait();
+			delete worker;
+		}
+	};
 	// Export
-	std::set<String> used; // for CONFLICT_NUMBER_OVERWRITE
-	for(const auto& card : cards) {
-		// filename for this card
-		Context& ctx = set->getContext(card);
-		String filename = clean_filename(untag(ctx.eval(*filename_script)->toString()));
-		if (!filename) continue; // no filename -> no saving
-		// full path
-		fn.SetFullName(filename);
-		// does the file exist?
-		if (!resolve_filename_conflicts(fn, conflicts, used)) continue;
-		// write image
-		filename = fn.GetFullPath();
-		used.insert(filename);
-		export_image(set, card, filename);
+	std::set<String> used; // for CONFLICT_NUMBER_OVERWRITE, and for files still in the queue
+	try {
+		for(const auto& card : cards) {
+			// filename for this card
+			Context& ctx = set->getContext(card);
+			String filename = clean_filename(untag(ctx.eval(*filename_script)->toString()));
+			if (!filename) continue; // no filename -> no saving
+			// full path
+			fn.SetFullName(filename);
+			// does the file exist?
+			if (!resolve_filename_conflicts(fn, conflicts, used)) continue;
+			// write image
+			filename = fn.GetFullPath();
+			used.insert(filename);
+			if (workers.empty()) {
+				export_image(set, card, filename);
+			} else {
+				Image img = export_card_image(set, card);
+				queue.push(img, filename);
+			}
+		}
+	} catch (...) {
+		wait_for_workers();
+		throw;
 	}
+	wait_for_workers();
 }
@@ -9,16 +9,23 @@
 #include <util/prec.hpp>
 #include <data/keyword.hpp>
 #include <util/tagged_string.hpp>
+#include <util/hash.hpp>
+#include <script/to_value.hpp>
 
 using std::make_pair;
+using std::max;
 
-class KeywordTrie;
 DECLARE_POINTER_TYPE(KeywordParamValue);
 class Value;
 DECLARE_DYNAMIC_ARG(Value*, value_being_updated);
 
 #define USE_CASE_INSENSITIVE_KEYWORDS 1
 
+/// Maximum number of results of KeywordDatabase::expand to remember
+const size_t MAX_MEMOS = 1000;
+/// Maximum number of scripts to remember the context use of
+const size_t MAX_CONTEXT_USES = 10000;
+
 // ----------------------------------------------------------------------------- : Reflection
 
 KeywordParam::KeywordParam()
@@ -244,72 +251,133 @@ void Keyword::prepare(const vector<KeywordParamP>& param_types, bool force) {
 	valid = !match_re.matches(_(""));
 }
 
-// ----------------------------------------------------------------------------- : KeywordTrie
+// ----------------------------------------------------------------------------- : KeywordMatcher
 
-/// A node in a trie to match keywords
-class KeywordTrie {
+/// Finds all occurrences of a set of strings, using the Aho-Corasick algorithm
+/** The strings are put in a trie, and each node gets a link to the node for its longest proper suffix.
+ *  The text is read one character at a time, following the suffix links when there is no child for a character,
+ *  so the current node is always the longest suffix of the text so far that is in the trie.
+ *
+ *  The nodes are stored in flat arrays, with the children of a node sorted by character.
+ */
+class KeywordMatcher {
   public:
-	KeywordTrie();
-	~KeywordTrie();
+	typedef UInt Node;
+	static const Node START = 0;
+	static const Node NONE  = (Node)-1;
+	
+	/// Build a matcher for the given strings, an empty string matches after any character
+	KeywordMatcher(const vector<String>& texts);
+	
+	/// The node after reading a character
+	Node next(Node node, Char c) const;
 	
-	map<Char, KeywordTrie*> children;    ///< children after a given character (owned)
-	KeywordTrie*            on_any_star; ///< children on /.*/ (owned or this)
-	vector<const Keyword*>  finished;    ///< keywordss that end in this node
+	/// The first node that is a suffix of node, and where strings end, or NONE
+	/** The longest strings come first, the empty string comes last. */
+	inline Node firstMatch(Node node) const { return nodes[node].match; }
+	/// The next node after firstMatch with strings that end there, or NONE
+	inline Node nextMatch(Node node) const {
+		Node fail = nodes[node].fail;
+		return fail == NONE ? NONE : nodes[fail].match;
+	}
+	/// The indices of the strings that end at a node
+	inline const UInt* textsBegin(Node node) const { return texts.data() + nodes[node].texts_begin; }
+	inline const UInt* textsEnd  (Node node) const { return texts.data() + nodes[node].texts_end;   }
+	
+  private:
+	struct NodeInfo {
+		UInt edges_begin, edges_end; ///< Children of this node
+		UInt texts_begin, texts_end; ///< Strings that end here
+		Node fail;  ///< Node for the longest proper suffix, NONE for the start
+		Node match; ///< First node in the chain of suffixes with strings that end there
+	};
+	vector<NodeInfo>          nodes;
+	vector<pair<Char,Node> >  edges; ///< Children of all nodes, sorted by character per node
+	vector<UInt>              texts; ///< Strings that end at each node
 	
-	/// Insert nodes representing the given character
-	/** return the node where the evaluation will be after matching the character */
-	KeywordTrie* insert(Char match);
-	/// Insert nodes representing the given string
-	/** return the node where the evaluation will be after matching the string */
-	KeywordTrie* insert(const String& match);
-
-	/// Insert nodes representing the regex /.*/
-	/** return the node where the evaluation will be after matching that regex */
-	KeywordTrie* insertAnyStar();
+	/// The child of a node, or NONE
+	Node child(Node node, Char c) const;
 };
 
-
-KeywordTrie::KeywordTrie()
-	: on_any_star(nullptr)
-	, finished()
-{}
-
-KeywordTrie::~KeywordTrie() {
-	for(auto& c : children) {
-		delete c.second;
+const KeywordMatcher::Node KeywordMatcher::START;
+const KeywordMatcher::Node KeywordMatcher::NONE;
+
+KeywordMatcher::KeywordMatcher(const vector<String>& input) {
+	// build a trie
+	vector<map<Char,Node> > children(1);
+	vector<vector<UInt> >   ends(1);
+	for (size_t i = 0 ; i < input.size() ; ++i) {
+		Node node = START;
+		for(const auto& ch : input[i]) {
+			Char c = static_cast<Char>(ch);
+			#if USE_CASE_INSENSITIVE_KEYWORDS
+				c = toLower(c); // case insensitive matching
+			#endif
+			map<Char,Node>::const_iterator it = children[node].find(c);
+			if (it != children[node].end()) {
+				node = it->second;
+			} else {
+				Node new_node = (Node)children.size();
+				children[node][c] = new_node;
+				children.push_back(map<Char,Node>());
+				ends.push_back(vector<UInt>());
+				node = new_node;
+			}
+		}
+		ends[node].push_back((UInt)i);
 	}
-	if (on_any_star != this) delete on_any_star;
-}
-
-KeywordTrie* KeywordTrie::insert(Char c) {
-	#if USE_CASE_INSENSITIVE_KEYWORDS
-		c = toLower(c); // case insensitive matching
-	#endif
-	KeywordTrie*& child = children[c];
-	if (!child) child = new KeywordTrie;
-	return child;
-}
-KeywordTrie* KeywordTrie::insert(const String& match) {
-	KeywordTrie* cur = this;
-	for(const auto& c : match) {
-		cur = cur->insert(static_cast<Char>(c));
+	// flatten
+	nodes.resize(children.size());
+	for (Node n = 0 ; n < nodes.size() ; ++n) {
+		nodes[n].edges_begin = (UInt)edges.size();
+		edges.insert(edges.end(), children[n].begin(), children[n].end());
+		nodes[n].edges_end   = (UInt)edges.size();
+		nodes[n].texts_begin = (UInt)texts.size();
+		texts.insert(texts.end(), ends[n].begin(), ends[n].end());
+		nodes[n].texts_end   = (UInt)texts.size();
+	}
+	// suffix links, breadth first so the links of shorter strings are known
+	nodes[START].fail  = NONE;
+	nodes[START].match = ends[START].empty() ? NONE : START;
+	vector<Node> queue(1, START);
+	for (size_t q = 0 ; q < queue.size() ; ++q) {
+		Node parent = queue[q];
+		for (UInt e = nodes[parent].edges_begin ; e < nodes[parent].edges_end ; ++e) {
+			Char c = edges[e].first;
+			Node n = edges[e].second;
+			Node fail = nodes[parent].fail;
+			while (fail != NONE && child(fail, c) == NONE) {
+				fail = nodes[fail].fail;
+			}
+			nodes[n].fail  = fail == NONE ? START : child(fail, c);
+			nodes[n].match = ends[n].empty() ? nodes[nodes[n].fail].match : n;
+			queue.push_back(n);
+		}
 	}
-	return cur;
 }
 
-KeywordTrie* KeywordTrie::insertAnyStar() {
-	if (!on_any_star) on_any_star = new KeywordTrie;
-	on_any_star->on_any_star = on_any_star; // circular reference to itself
-	return on_any_star;
+KeywordMatcher::Node KeywordMatcher::child(Node node, Char c) const {
+	const pair<Char,Node>* begin = edges.data() + nodes[node].edges_begin;
+	const pair<Char,Node>* end   = edges.data() + nodes[node].edges_end;
+	const pair<Char,Node>* it    = std::lower_bound(begin, end, make_pair(c, (Node)0));
+	return it != end && it->first == c ? it->second : NONE;
 }
 
+KeywordMatcher::Node KeywordMatcher::next(Node node, Char c) const {
+	while (true) {
+		Node n = child(node, c);
+		if (n != NONE)     return n;
+		if (node == START) return START;
+		node = nodes[node].fail;
+	}
+}
 
 // ----------------------------------------------------------------------------- : KeywordDatabase
 
 IMPLEMENT_DYNAMIC_ARG(KeywordUsageStatistics*, keyword_usage_statistics, nullptr);
 
 KeywordDatabase::KeywordDatabase()
-	: root(nullptr)
+	: matcher(nullptr)
 {}
 
 KeywordDatabase::~KeywordDatabase() {
@@ -317,8 +385,10 @@ KeywordDatabase::~KeywordDatabase() {
 }
 
 void KeywordDatabase::clear() {
-	delete root;
-	root = nullptr;
+	patterns.clear();
+	delete matcher;
+	matcher = nullptr;
+	clearMemos();
 }
 
 void KeywordDatabase::add(const vector<KeywordP>& kws) {
@@ -329,14 +399,11 @@ void KeywordDatabase::add(const vector<KeywordP>& kws) {
 
 void KeywordDatabase::add(const Keyword& kw) {
 	if (kw.match.empty() || !kw.valid) return; // can't handle empty keywords
-	// Create root
-	if (!root) {
-		root = new KeywordTrie;
-		root->on_any_star = root;
-	}
-	KeywordTrie* cur = root->insertAnyStar();
-	// Add to trie
-	String text; // normal text
+	Pattern pattern;
+	pattern.keyword   = &kw;
+	pattern.any_after = false;
+	// Find the text to match
+	String& text = pattern.text; // normal text
 	size_t param = 0;
 	bool only_star = true;
 	for (size_t i = 0 ; i < kw.match.size() ;) {
@@ -350,15 +417,12 @@ void KeywordDatabase::add(const Keyword& kw) {
 			}
 			++param;
 			// match anything
-			cur = cur->insert(text);
-			text.clear();
-			cur = cur->insertAnyStar();
-			// enough?
 			if (!only_star) {
 				// If we have matched anything specific, this is a good time to stop
-				// it doesn't really matter how long we go on, since the trie is only used
+				// it doesn't really matter how long we go on, since the matcher is only used
 				// as an optimization to not have to match lots of regexes.
 				// As an added bonus, we get a better behaviour of matching earlier keywords first.
+				pattern.any_after = !text.empty();
 				break;
 			}
 		} else {
@@ -367,9 +431,22 @@ void KeywordDatabase::add(const Keyword& kw) {
 			only_star = false;
 		}
 	}
-	cur = cur->insert(text);
-	// now cur is the trie after matching the keyword anywhere in the input text
-	cur->finished.push_back(&kw);
+	patterns.push_back(pattern);
+	// the matcher must be built again
+	delete matcher;
+	matcher = nullptr;
+	clearMemos();
+}
+
+const KeywordMatcher& KeywordDatabase::getMatcher() const {
+	if (!matcher) {
+		vector<String> texts;
+		for(const auto& p : patterns) {
+			texts.push_back(p.text);
+		}
+		matcher = new KeywordMatcher(texts);
+	}
+	return *matcher;
 }
 
 void KeywordDatabase::prepare_parameters(const vector<KeywordParamP>& ps, const vector<KeywordP>& kws) {
@@ -380,28 +457,6 @@ void KeywordDatabase::prepare_parameters(const vector<KeywordParamP>& ps, const
 
 // ----------------------------------------------------------------------------- : KeywordDatabase : matching
 
-// transitive closure of a state, follow all on_any_star links
-void closure(vector<KeywordTrie*>& state) {
-	for (size_t j = 0 ; j < state.size() ; ++j) {
-		if (state[j]->on_any_star && state[j]->on_any_star != state[j]) {
-			state.push_back(state[j]->on_any_star);
-		}
-	}
-}
-
-#ifdef _DEBUG
-void dump(int i, KeywordTrie* t) {
-	for(auto& c : t->children) {
-		wxLogDebug(String(i,_(' ')) + c.first + _("     ") + String::Format(_("%p"),c.second));
-		dump(i+2, c.second);
-	}
-	if (t->on_any_star) {
-		wxLogDebug(String(i,_(' ')) + _(".*") + _("     ") + String::Format(_("%p"),t->on_any_star));
-		if (t->on_any_star != t) dump(i+2, t->on_any_star);
-	}
-}
-#endif
-
 String KeywordDatabase::expand(const String& text,
                                const ScriptValueP& match_condition,
                                const ScriptValueP& expand_default,
@@ -421,6 +476,27 @@ String KeywordDatabase::expand(const String& text,
 		}
 	}
 	
+	// Have we seen this text before?
+	size_t key = hash_value(text);
+	hash_combine(key, match_condition.get());
+	hash_combine(key, expand_default.get());
+	hash_combine(key, combine_script.get());
+	hash_combine(key, &ctx);
+	auto range = memo_index.equal_range(key);
+	for (auto it = range.first ; it != range.second ; ++it) {
+		Memo& memo = *it->second;
+		if (memo.text == text && memo.context == &ctx && memo.match_condition == match_condition && memo.expand_default == expand_default
+		    && memo.combine_script == combine_script && (!memo.uses_set || memo.set_age == set_age)) {
+			memos.splice(memos.begin(), memos, it->second);
+			if (stat && stat_key) {
+				for (const Keyword* kw : memo.expanded) {
+					stat->push_back(make_pair(stat_key, kw));
+				}
+			}
+			return memo.result;
+		}
+	}
+	
 	// Remove all old reminder texts
 	String tagged = remove_tag_contents(text, _("<atom-reminder"));
 	tagged = remove_tag_contents(tagged, _("<atom-keyword")); // OLD, TODO: REMOVEME
@@ -429,17 +505,25 @@ String KeywordDatabase::expand(const String& text,
 	tagged = remove_tag(tagged, _("<param-"));
 	String untagged = untag_no_escape(tagged);
 	
-	if (!root) return tagged;
+	if (patterns.empty()) return tagged;
+	const KeywordMatcher& finder = getMatcher();
 	
 	String result;
+	vector<bool> used; // keywords already investigated
+	vector<const Keyword*> expanded; // keywords in the result
+	// can the result be remembered?
+	if (context_uses.size() > MAX_CONTEXT_USES) {
+		context_uses.clear(); // scripts constructed on the fly, such as closures
+	}
+	ContextUse use = USES_NOTHING;
+	if (match_condition) use = max(use, contextUse(match_condition, ctx));
+	if (expand_default)  use = max(use, contextUse(expand_default, ctx));
+	use = max(use, contextUse(combine_script, ctx));
 	
 	// Find keywords
 	while (!tagged.empty()) {
-		vector<KeywordTrie*> current; // current location(s) in the trie
-		vector<KeywordTrie*> next;    // location(s) after this step
-		set<const Keyword*>  used;    // keywords already investigated
-		current.push_back(root);
-		closure(current);
+		KeywordMatcher::Node current = KeywordMatcher::START; // current location in the matcher
+		used.assign(patterns.size(), false);
 		// is the keyword expanded? From <kw-?> tag
 		// Possible values are:
 		//  - '0' = reminder text explicitly hidden
@@ -471,40 +555,31 @@ String KeywordDatabase::expand(const String& text,
 				#endif
 				++i;
 			}
-			// find 'next' trie node set matching c
-			for(auto& kt : current) {
-				map<Char,KeywordTrie*>::const_iterator it = kt->children.find(c);
-				if (it != kt->children.end()) {
-					next.push_back(it->second);
-				}
-				// TODO: on any star first or last?
-				if (kt->on_any_star) {
-					next.push_back(kt->on_any_star);
-				}
-			}
-			// next becomes current
-			swap(current, next);
-			// in the MSVC stl clear frees memory, that is a waste, because we need it again in the next iteration
-			//next.clear();
-			next.resize(0);
-			closure(current);
+			// find the next node matching c
+			current = finder.next(current, c);
 			// are we done?
 			for (int set_or_game = 0 ; set_or_game <= 1 ; ++set_or_game) {
-				for(auto& n : current) {
-					for(auto& kw : n->finished) {
-						if (kw->fixed != (bool)set_or_game) {
-							continue; // first try set keywords, try game keywords in the second round
-						}
-						if (!used.insert(kw).second) {
-							continue; // already seen this keyword
-						}
-						// we have found a possible match, for a keyword which we have not seen before
-						if (tryExpand(*kw, i, tagged, untagged, result, expand_type,
-						              match_condition, expand_default, combine_script, ctx,
-						              stat, stat_key))
-						{
-							// it matches
-							goto matched_keyword;
+				// keywords that end at this point first, then the ones with a parameter after the text
+				for (int any_after = 0 ; any_after <= 1 ; ++any_after) {
+					for (KeywordMatcher::Node n = finder.firstMatch(current) ; n != KeywordMatcher::NONE ; n = finder.nextMatch(n)) {
+						for (const UInt* it = finder.textsBegin(n) ; it != finder.textsEnd(n) ; ++it) {
+							const Pattern& p = patterns[*it];
+							if (p.keyword->fixed != (bool)set_or_game) {
+								continue; // first try set keywords, try game keywords in the second round
+							}
+							if (p.any_after != (bool)any_after || used[*it]) {
+								continue; // already seen this keyword
+							}
+							used[*it] = true;
+							// we have found a possible match, for a keyword which we have not seen before
+							use = max(use, contextUse(*p.keyword, ctx));
+							if (tryExpand(*p.keyword, i, tagged, untagged, result, expand_type,
+							              match_condition, expand_default, combine_script, ctx))
+							{
+								// it matches
+								expanded.push_back(p.keyword);
+								goto matched_keyword;
+							}
 						}
 					}
 				}
@@ -518,6 +593,42 @@ String KeywordDatabase::expand(const String& text,
 	}
 	
 	assert_tagged(result);
+	
+	// Add to usage statistics
+	if (stat && stat_key) {
+		for (const Keyword* kw : expanded) {
+			stat->push_back(make_pair(stat_key, kw));
+		}
+	}
+	
+	// Remember the result
+	if (use != USES_ANYTHING) {
+		Memo memo;
+		memo.key             = key;
+		memo.text            = text;
+		memo.context         = &ctx;
+		memo.match_condition = match_condition;
+		memo.expand_default  = expand_default;
+		memo.combine_script  = combine_script;
+		memo.uses_set        = use == USES_SET;
+		memo.set_age         = set_age;
+		memo.result          = result;
+		swap(memo.expanded, expanded);
+		memos.push_front(memo);
+		memo_index.insert(make_pair(key, memos.begin()));
+		// forget the least recently used result
+		if (memos.size() > MAX_MEMOS) {
+			Memos::iterator last = --memos.end();
+			auto last_range = memo_index.equal_range(last->key);
+			for (auto it = last_range.first ; it != last_range.second ; ++it) {
+				if (it->second == last) {
+					memo_index.erase(it);
+					break;
+				}
+			}
+			memos.erase(last);
+		}
+	}
 	return result;
 }
 
@@ -530,9 +641,7 @@ bool KeywordDatabase::tryExpand(const Keyword& kw,
                                 const ScriptValueP& match_condition,
                                 const ScriptValueP& expand_default,
                                 const ScriptValueP& combine_script,
-                                Context& ctx,
-                                KeywordUsageStatistics* stat,
-                                Value* stat_key) const
+                                Context& ctx) const
 {
 	// try to match regex against the *untagged* string
 	assert(!kw.match_re.empty());
@@ -705,11 +814,6 @@ bool KeywordDatabase::tryExpand(const Keyword& kw,
 	result += combine_script->eval(ctx)->toString();
 	result += _("</kw-"); result += expand_type; result += _(">");
 	
-	// Add to usage statistics
-	if (stat && stat_key) {
-		stat->push_back(make_pair(stat_key, &kw));
-	}
-	
 	// After keyword
 	tagged   = tagged.substr(end);
 	untagged = untagged.substr(start_u + len_u);
@@ -717,6 +821,106 @@ bool KeywordDatabase::tryExpand(const Keyword& kw,
 	return true;
 }
 
+// ----------------------------------------------------------------------------- : KeywordDatabase : remembering results
+
+void KeywordDatabase::clearMemos() {
+	memos.clear();
+	memo_index.clear();
+	context_uses.clear();
+}
+
+KeywordDatabase::ContextUse KeywordDatabase::contextUse(const ScriptValueP& value, Context& ctx) const {
+	if (!value) return USES_NOTHING;
+	ContextUseKey key(&ctx, value.get());
+	auto known = context_uses.find(key);
+	if (known != context_uses.end()) return known->second.second;
+	// assume the worst while we look, that way recursive functions are never remembered
+	context_uses[key] = make_pair(value, USES_ANYTHING);
+	ContextUse use = USES_NOTHING;
+	if (Script* script = dynamic_cast<Script*>(value.get())) {
+		// variables assigned by the script itself
+		vector<Variable> locals;
+		for (const Instruction& i : script->getInstructions()) {
+			if (i.instr == I_SET_VAR) locals.push_back((Variable)i.data);
+		}
+		// look at the variables the script reads, and at the functions defined inside it
+		vector<ScriptValueP>& constants = script->getConstants();
+		for (const Instruction& i : script->getInstructions()) {
+			if (i.instr == I_GET_VAR) {
+				use = max(use, contextUse((Variable)i.data, locals, ctx));
+			} else if (i.instr == I_GET_VAR_MEMBER_C) {
+				Variable var = (Variable)i.dataLow(SUPER_VAR_BITS);
+				if (var == SCRIPT_VAR_set && constants[i.dataHigh(SUPER_VAR_BITS)]->toString() != _("cards")) {
+					use = max(use, USES_SET); // set.some_field
+				} else {
+					use = max(use, contextUse(var, locals, ctx));
+				}
+			}
+		}
+		for (const ScriptValueP& c : constants) {
+			if (c->type() == SCRIPT_FUNCTION) use = max(use, contextUse(c, ctx));
+		}
+	} else if (ScriptClosure* closure = dynamic_cast<ScriptClosure*>(value.get())) {
+		use = contextUse(closure->fun, ctx);
+		for (const auto& b : closure->bindings) {
+			use = max(use, contextUse(b.second, ctx));
+		}
+	}
+	// other values, such as built in functions, only look at their arguments,
+	// except for the ones that are caught in contextUse(Variable)
+	context_uses[key].second = use;
+	return use;
+}
+
+KeywordDatabase::ContextUse KeywordDatabase::contextUse(Variable var, const vector<Variable>& locals, Context& ctx) const {
+	// the card and the whole set, and functions that look at them or at other changing things
+	static const Variable vars[] = {
+		SCRIPT_VAR_set, SCRIPT_VAR_card, SCRIPT_VAR_card_style, SCRIPT_VAR_stylesheet, SCRIPT_VAR_styling,
+		SCRIPT_VAR_value, SCRIPT_VAR_language,
+		string_to_variable(_("extra_card")),     string_to_variable(_("extra_card_style")),
+		string_to_variable(_("expand_keywords")), string_to_variable(_("expand_keywords_rule")),
+		string_to_variable(_("keyword_usage")),  string_to_variable(_("combined_editor")),
+		string_to_variable(_("check_spelling")), string_to_variable(_("symbol_variation")),
+		string_to_variable(_("random_real")),    string_to_variable(_("random_int")),
+		string_to_variable(_("random_boolean")), string_to_variable(_("random_shuffle")),
+		string_to_variable(_("random_select")),  string_to_variable(_("random_select_many")),
+	};
+	for (Variable v : vars) {
+		if (v == var) return USES_ANYTHING;
+	}
+	// the variables that expand sets for the keyword scripts, they only depend on the text and the keyword
+	static const Variable keyword_vars[] = {
+		SCRIPT_VAR_input,
+		string_to_variable(_("mode")),     string_to_variable(_("correct_case")), string_to_variable(_("used_placeholders")),
+		string_to_variable(_("keyword")),  string_to_variable(_("reminder")),     string_to_variable(_("expand")),
+	};
+	for (Variable v : keyword_vars) {
+		if (v == var) return USES_NOTHING;
+	}
+	if (variable_to_string(var).StartsWith(_("param"))) return USES_NOTHING; // param1, param2, ...
+	// variables assigned by the script itself, their values are determined by the instructions that we look at anyway
+	if (find(locals.begin(), locals.end(), var) != locals.end()) return USES_NOTHING;
+	// variables set by the init scripts of the game and stylesheet are the same for all cards.
+	// Scripts are dynamically scoped, so variables set in any other scope can come from the caller, and depend on anything
+	if (!ctx.isGlobalVariable(var)) return USES_ANYTHING;
+	ScriptValueP value = ctx.getVariableOpt(var);
+	if (value->type() == SCRIPT_FUNCTION) {
+		return contextUse(value, ctx); // functions defined by the game
+	} else {
+		return USES_NOTHING;
+	}
+}
+
+KeywordDatabase::ContextUse KeywordDatabase::contextUse(const Keyword& kw, Context& ctx) const {
+	ContextUse use = contextUse(kw.reminder.getScriptP(), ctx);
+	for (const KeywordParamP& kwp : kw.parameters) {
+		use = max(use, contextUse(kwp->script.getScriptP(), ctx));
+		use = max(use, contextUse(kwp->reminder_script.getScriptP(), ctx));
+		use = max(use, contextUse(kwp->separator_script.getScriptP(), ctx));
+	}
+	return use;
+}
+
 // ----------------------------------------------------------------------------- : KeywordParamValue
 
 ScriptType KeywordParamValue::type() const { return SCRIPT_STRING; }
@@ -13,12 +13,16 @@
 #include <script/scriptable.hpp>
 #include <util/dynamic_arg.hpp>
 #include <util/regex.hpp>
+#include <util/age.hpp>
+#include <util/hash.hpp>
+#include <list>
+#include <unordered_map>
 
 DECLARE_POINTER_TYPE(KeywordParam);
 DECLARE_POINTER_TYPE(KeywordMode);
 DECLARE_POINTER_TYPE(Keyword);
 DECLARE_POINTER_TYPE(ParamReferenceType);
-class KeywordTrie;
+class KeywordMatcher;
 class Value;
 
 // ----------------------------------------------------------------------------- : Keyword parameters
@@ -138,6 +142,11 @@ DECLARE_DYNAMIC_ARG(KeywordUsageStatistics*, keyword_usage_statistics);
 /// A database of keywords to allow for fast matching
 /** NOTE: keywords may not be altered after they are added to the database,
  *  The database should be rebuild.
+ *
+ *  The results of expand are remembered, since the same text is often expanded again,
+ *  for example for reprints, or after undoing a change to the text.
+ *  A result is only remembered if the scripts used to compute it look at nothing but
+ *  their arguments, the game, and the data of the set.
  */
 class KeywordDatabase {
   public:
@@ -155,18 +164,32 @@ class KeywordDatabase {
 	/// Clear the database
 	void clear();
 	/// Is the database empty?
-	inline bool empty() const { return !root; }
+	inline bool empty() const { return patterns.empty(); }
 	
 	/// Expand/update all keywords in the given string.
 	/** @param expand_default script function indicating whether reminder text should be shown by default
 	 *  @param combine_script script function to combine keyword and reminder text in some way
 	 *  @param case_sensitive case sensitive matching of keywords?
 	 *  @param ctx            context for evaluation of scripts
+	 *  @param set_age        when the data of the set was last modified
 	 */
-	String expand(const String& text, const ScriptValueP& match_condition, const ScriptValueP& expand_default, const ScriptValueP& combine_script, Context& ctx) const;
+	String expand(const String& text, const ScriptValueP& match_condition, const ScriptValueP& expand_default, const ScriptValueP& combine_script, Context& ctx, Age set_age) const;
 	
   private:
-	KeywordTrie* root;	///< Data structure for finding keywords
+	/// When can a keyword match?
+	/** The text before the first parameter (or between the first two if it starts with a parameter)
+	 *  must be present in the input, only then the keyword's regex is tried.
+	 */
+	struct Pattern {
+		const Keyword* keyword;
+		String         text;      ///< Text that must be found
+		bool           any_after; ///< Is text followed by a parameter?
+	};
+	vector<Pattern> patterns;	///< All keywords, in the order they were added
+	mutable KeywordMatcher* matcher;	///< Data structure for finding patterns, built on first use
+	
+	/// Get the matcher, build it if needed
+	const KeywordMatcher& getMatcher() const;
 	
 	/// (try to) expand a single keyword
 	/** If the keyword matches:
@@ -175,8 +198,43 @@ class KeywordDatabase {
 	 *    - return true
 	 */
 	bool tryExpand(const Keyword& kw, size_t pos, String& tagged, String& untagged, String& out, char expand_type,
-	               const ScriptValueP& match_condition, const ScriptValueP& expand_default, const ScriptValueP& combine_script, Context& ctx,
-	               KeywordUsageStatistics* stat, Value* stat_key) const;
+	               const ScriptValueP& match_condition, const ScriptValueP& expand_default, const ScriptValueP& combine_script, Context& ctx) const;
+	
+	/// What can the result of a script depend on?
+	enum ContextUse
+	{	USES_NOTHING	///< only the arguments and the game
+	,	USES_SET		///< also the data of the set
+	,	USES_ANYTHING	///< also other things, such as the card, the result can not be remembered
+	};
+	/// What the result of a script value can depend on
+	ContextUse contextUse(const ScriptValueP& value, Context& ctx) const;
+	/// What the result of a script value found in a variable can depend on
+	/** locals are the variables that are assigned by the script that reads var */
+	ContextUse contextUse(Variable var, const vector<Variable>& locals, Context& ctx) const;
+	/// What the scripts of a keyword can depend on
+	ContextUse contextUse(const Keyword& kw, Context& ctx) const;
+	
+	/// A remembered result of expand
+	struct Memo {
+		size_t       key;
+		String       text;
+		const Context* context; ///< Functions are looked up in the context, that can be different for each stylesheet
+		ScriptValueP match_condition, expand_default, combine_script;
+		bool         uses_set; ///< Does the result depend on the data of the set?
+		Age          set_age;  ///< Age of the set data the result was computed with
+		String       result;
+		vector<const Keyword*> expanded; ///< Keywords in the result, for the usage statistics
+	};
+	typedef std::list<Memo> Memos;
+	mutable Memos memos; ///< Most recently used first
+	mutable std::unordered_multimap<size_t, Memos::iterator> memo_index;
+	/// What scripts depend on, for each context
+	/** The script values are kept alive, so their addresses are not reused while they are in the map */
+	typedef std::pair<const Context*, const ScriptValue*> ContextUseKey;
+	mutable std::unordered_map<ContextUseKey, std::pair<ScriptValueP,ContextUse>, boost::hash<ContextUseKey> > context_uses;
+	
+	/// Forget all remembered results
+	void clearMemos();
 };
 
 // ----------------------------------------------------------------------------- : Processing parameters
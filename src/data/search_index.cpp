@@ -0,0 +1,216 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) 2001 - 2012 Twan van Laarhoven and Sean Hunt             |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <data/search_index.hpp>
+#include <data/set.hpp>
+#include <data/card.hpp>
+#include <data/field.hpp>
+#include <data/action/set.hpp>
+#include <data/action/value.hpp>
+
+// ----------------------------------------------------------------------------- : CardSearchIndex
+
+CardSearchIndex::CardSearchIndex(Set& set)
+	: set(set)
+{
+	set.actions.addListener(this);
+}
+
+CardSearchIndex::~CardSearchIndex() {
+	set.actions.removeListener(this);
+}
+
+void CardSearchIndex::onAction(const Action& action, bool undone) {
+	TYPE_CASE(action, ValueAction) {
+		if (action.card) markDirty(action.card);
+	}
+	TYPE_CASE(action, ScriptValueEvent) {
+		if (action.card) markDirty(action.card);
+	}
+	TYPE_CASE(action, AddCardAction) {
+		for(const auto& step : action.action.steps) {
+			markDirty(step.item.get());
+		}
+	}
+}
+
+void CardSearchIndex::markDirty(const Card* card) {
+	auto it = card_entries.find(card);
+	if (it != card_entries.end()) {
+		entries[it->second].dirty = true;
+	}
+}
+
+// ----------------------------------------------------------------------------- : Indexing
+
+void CardSearchIndex::update() {
+	for(auto& e : entries) e.seen = false;
+	// index new and changed cards
+	for(const auto& card : set.cards) {
+		auto it = card_entries.find(card.get());
+		if (it == card_entries.end()) {
+			EntryId id;
+			if (free_entries.empty()) {
+				id = (EntryId)entries.size();
+				entries.push_back(Entry());
+			} else {
+				id = free_entries.back();
+				free_entries.pop_back();
+			}
+			entries[id].card = card;
+			card_entries[card.get()] = id;
+			index(id);
+		} else {
+			Entry& e = entries[it->second];
+			e.seen = true;
+			if (e.dirty || e.notes != card->notes || e.modified < latestModification(*card)) {
+				unindex(it->second);
+				index(it->second);
+			}
+		}
+	}
+	// remove cards no longer in the set
+	for (EntryId id = 0 ; id < entries.size() ; ++id) {
+		Entry& e = entries[id];
+		if (e.card && !e.seen) {
+			unindex(id);
+			card_entries.erase(e.card.get());
+			e.card = CardP();
+			e.text.clear();
+			e.notes.clear();
+			free_entries.push_back(id);
+		}
+	}
+}
+
+void CardSearchIndex::index(EntryId id) {
+	Entry& e = entries[id];
+	const Card& card = *e.card;
+	// the same text that Card::contains searches in
+	e.text.clear();
+	for(const auto& v : card.data) {
+		e.text += v->toFriendlyString();
+		e.text += _('\n');
+	}
+	e.text    += card.notes;
+	e.notes    = card.notes;
+	e.modified = latestModification(card);
+	e.dirty    = false;
+	e.seen     = true;
+	for (size_t i = 0 ; i < e.text.size() ; ++i) {
+		e.text[i] = toLower(e.text[i]);
+	}
+	// add to postings
+	e.trigrams.clear();
+	trigramsOf(e.text, e.trigrams);
+	for(Trigram t : e.trigrams) {
+		vector<EntryId>& ids = postings[t];
+		ids.insert(lower_bound(ids.begin(), ids.end(), id), id);
+	}
+}
+
+void CardSearchIndex::unindex(EntryId id) {
+	Entry& e = entries[id];
+	for(Trigram t : e.trigrams) {
+		auto it = postings.find(t);
+		if (it == postings.end()) continue;
+		vector<EntryId>& ids = it->second;
+		auto pos = lower_bound(ids.begin(), ids.end(), id);
+		if (pos != ids.end() && *pos == id) ids.erase(pos);
+		if (ids.empty()) postings.erase(it);
+	}
+	e.trigrams.clear();
+}
+
+void CardSearchIndex::trigramsOf(const String& text, vector<Trigram>& out) {
+	size_t start = out.size();
+	for (size_t i = 0 ; i + 3 <= text.size() ; ++i) {
+		out.push_back( ((Trigram)(wxUint32)text[i]   << 42)
+		             | ((Trigram)(wxUint32)text[i+1] << 21)
+		             |  (Trigram)(wxUint32)text[i+2] );
+	}
+	sort(out.begin() + start, out.end());
+	out.erase(unique(out.begin() + start, out.end()), out.end());
+}
+
+Age CardSearchIndex::latestModification(const Card& card) {
+	Age age;
+	for(const auto& v : card.data) {
+		if (age < v->last_modified) age = v->last_modified;
+	}
+	return age;
+}
+
+// ----------------------------------------------------------------------------- : Searching
+
+void CardSearchIndex::find(const String& query, vector<VoidP>& out) {
+	update();
+	vector<QuickSearchTerm> terms;
+	parse_quicksearch_query(query, terms);
+	for(auto& term : terms) {
+		for (size_t i = 0 ; i < term.text.size() ; ++i) {
+			term.text[i] = toLower(term.text[i]);
+		}
+	}
+	// candidates: entries containing all trigrams of the words that must be present
+	vector<Trigram> trigrams;
+	for(const auto& term : terms) {
+		if (!term.negated) trigramsOf(term.text, trigrams);
+	}
+	vector<bool> candidate;
+	if (!trigrams.empty()) {
+		// intersect postings, starting with the shortest list
+		vector<const vector<EntryId>*> lists;
+		for(Trigram t : trigrams) {
+			auto it = postings.find(t);
+			if (it == postings.end()) return; // no card contains this trigram
+			lists.push_back(&it->second);
+		}
+		sort(lists.begin(), lists.end(), [](const vector<EntryId>* a, const vector<EntryId>* b) {
+			return a->size() < b->size();
+		});
+		vector<EntryId> ids = *lists.front(), next;
+		for (size_t i = 1 ; i < lists.size() && !ids.empty() ; ++i) {
+			next.clear();
+			set_intersection(ids.begin(), ids.end(), lists[i]->begin(), lists[i]->end(), back_inserter(next));
+			swap(ids, next);
+		}
+		candidate.resize(entries.size(), false);
+		for(EntryId id : ids) candidate[id] = true;
+	}
+	// check the candidates, in the order of the set
+	for(const auto& card : set.cards) {
+		EntryId id = card_entries[card.get()];
+		if (!candidate.empty() && !candidate[id]) continue;
+		const String& text = entries[id].text;
+		bool match = true;
+		for(const auto& term : terms) {
+			if ((text.find(term.text) != String::npos) == term.negated) {
+				match = false;
+				break;
+			}
+		}
+		if (match) out.push_back(card);
+	}
+}
+
+// ----------------------------------------------------------------------------- : CardQuickFilter
+
+CardQuickFilter::CardQuickFilter(const SetP& set, String const& query)
+	: QuickFilter<Card>(query)
+	, set(set)
+{}
+
+void CardQuickFilter::getItems(vector<CardP> const& in, vector<VoidP>& out) const {
+	if (set && &in == &set->cards) {
+		set->searchIndex().find(query, out);
+	} else {
+		QuickFilter<Card>::getItems(in, out);
+	}
+}
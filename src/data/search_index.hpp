@@ -0,0 +1,93 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) 2001 - 2012 Twan van Laarhoven and Sean Hunt             |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+#ifndef HEADER_DATA_SEARCH_INDEX
+#define HEADER_DATA_SEARCH_INDEX
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <util/age.hpp>
+#include <util/action_stack.hpp>
+#include <data/filter.hpp>
+#include <unordered_map>
+
+DECLARE_POINTER_TYPE(Card);
+DECLARE_POINTER_TYPE(Set);
+
+// ----------------------------------------------------------------------------- : CardSearchIndex
+
+/// An index of the text on the cards of a set, for answering quick search queries
+/** For each card the text of all values and the notes is stored in lower case,
+ *  and the index maps every sequence of three characters (trigram) to the cards containing it.
+ *  A query is answered by only looking at the cards that contain all trigrams of the words that must be present,
+ *  and checking those words against the stored text, so the result is the same as for Card::contains.
+ *
+ *  Cards are reindexed when a ValueAction or ScriptValueEvent says they have changed,
+ *  or when the age of one of their values or the notes changed (e.g. by delayed scripts).
+ *  The index is brought up to date when a query is answered, not when the action is performed.
+ */
+class CardSearchIndex : public ActionListener {
+  public:
+	CardSearchIndex(Set& set);
+	~CardSearchIndex();
+
+	/// Find the cards matching a quick search query, in the order they have in the set
+	void find(const String& query, vector<VoidP>& out);
+
+  protected:
+	virtual void onAction(const Action&, bool undone);
+
+  private:
+	typedef wxUint64 Trigram;
+	typedef UInt     EntryId;
+
+	/// Index data for a single card
+	struct Entry {
+		CardP           card;
+		String          text;     ///< Lower case text of all values and the notes
+		String          notes;    ///< The notes at the time of indexing
+		Age             modified; ///< Latest age of the values at the time of indexing
+		vector<Trigram> trigrams; ///< Trigrams in the text, sorted, without duplicates
+		bool            dirty;    ///< Must the card be reindexed?
+		bool            seen;     ///< Still in the set? used in update()
+	};
+
+	Set&                                             set;
+	vector<Entry>                                    entries;
+	vector<EntryId>                                  free_entries; ///< Unused entries, can be reused
+	std::unordered_map<const Card*, EntryId>         card_entries;
+	std::unordered_map<Trigram, vector<EntryId>>     postings;     ///< Entries containing each trigram, sorted
+
+	/// Bring the index up to date with the cards in the set
+	void update();
+	/// Mark the entry for a card as dirty
+	void markDirty(const Card* card);
+	/// (Re)index an entry
+	void index(EntryId id);
+	/// Remove the trigrams of an entry from the postings
+	void unindex(EntryId id);
+
+	/// Add the trigrams of a (lower case) string
+	static void trigramsOf(const String& text, vector<Trigram>& out);
+	/// Latest age of the values of a card
+	static Age latestModification(const Card& card);
+};
+
+// ----------------------------------------------------------------------------- : CardQuickFilter
+
+/// A quick search filter for cards that uses the CardSearchIndex of the set
+/** Falls back to QuickFilter for lists of cards other than those of the set */
+class CardQuickFilter : public QuickFilter<Card> {
+  public:
+	CardQuickFilter(const SetP& set, String const& query);
+	virtual void getItems(vector<CardP> const& in, vector<VoidP>& out) const;
+  private:
+	SetP set;
+};
+
+// ----------------------------------------------------------------------------- : EOF
+#endif
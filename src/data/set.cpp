@@ -13,6 +13,7 @@
 #include <data/card.hpp>
 #include <data/keyword.hpp>
 #include <data/pack.hpp>
+#include <data/search_index.hpp>
 #include <data/field.hpp>
 #include <data/field/text.hpp>    // for 0.2.7 fix
 #include <data/field/information.hpp>
@@ -30,12 +31,16 @@ using std::make_pair;
 Set::Set()
 	: vcs (intrusive(new VCS()))
 	, script_manager(new SetScriptManager(*this))
+	, order_clock(0)
+	, cards_changed(0)
 {}
 
 Set::Set(const GameP& game)
 	: game(game)
 	, vcs (intrusive(new VCS()))
 	, script_manager(new SetScriptManager(*this))
+	, order_clock(0)
+	, cards_changed(0)
 {
 	data.init(game->set_fields);
 }
@@ -45,6 +50,8 @@ Set::Set(const StyleSheetP& stylesheet)
 	, stylesheet(stylesheet)
 	, vcs (intrusive(new VCS()))
 	, script_manager(new SetScriptManager(*this))
+	, order_clock(0)
+	, cards_changed(0)
 {
 	data.init(game->set_fields);
 }
@@ -246,47 +253,69 @@ void reflect_set_info_get_member(GetMember& reflector, const IndexMap<FieldP, Va
 	REFLECT_NAMELESS(data);
 }
 
-int Set::positionOfCard(const CardP& card, const ScriptValueP& order_by, const ScriptValueP& filter) {
-	// TODO : Lock the map?
-	assert(order_by);
+/// Maximum number of order caches, more are only needed when order_by scripts are constructed on the fly
+const size_t MAX_ORDER_CACHES = 64;
+
+OrderCache<CardP>& Set::orderCache(const ScriptValueP& order_by, const ScriptValueP& filter) {
+	if (order_cache.size() >= MAX_ORDER_CACHES && order_cache.find(make_pair(order_by,filter)) == order_cache.end()) {
+		clearOrderCache();
+	}
 	OrderCacheP& order = order_cache[make_pair(order_by,filter)];
 	if (!order) {
-		// 1. make a list of the order value for each card
-		vector<String> values; values.reserve(cards.size());
-		vector<int>    keep;   if(filter) keep.reserve(cards.size());
-		for(const auto& c : cards) {
-			Context& ctx = getContext(c);
-			values.push_back(order_by->eval(ctx)->toString());
-			if (filter) {
-				keep.push_back(filter->eval(ctx)->toBool());
-			}
+		order = intrusive(new OrderCache<CardP>());
+	} else if (order->checked == order_clock) {
+		return *order; // nothing changed
+	}
+	#if USE_SCRIPT_PROFILING
+		Timer t;
+		Profiler prof(t, order_by ? order_by.get() : filter.get(), _("update order cache"));
+	#endif
+	// remove deleted cards, and update the position of moved cards, which is used for cards with the same order value
+	if (order->checked < cards_changed) {
+		order->reindex(cards);
+	}
+	// evaluate the order value of new cards, and of cards that changed since they were last evaluated
+	for (size_t i = 0 ; i < cards.size() ; ++i) {
+		const CardP& c = cards[i];
+		UInt stamp;
+		if (order->contains(c, stamp)) {
+			auto changed = card_changed.find(c.get());
+			if (changed == card_changed.end() || changed->second <= stamp) continue;
 		}
-		#if USE_SCRIPT_PROFILING
-			Timer t;
-			Profiler prof(t, order_by.get(), _("init order cache"));
-		#endif
-		// 3. initialize order cache
-		order = intrusive(new OrderCache<CardP>(cards, values, filter ? &keep : nullptr));
+		Context& ctx = getContext(c);
+		String value = order_by ? order_by->eval(ctx)->toString() : String();
+		bool   keep  = !filter  || filter->eval(ctx)->toBool();
+		order->insert(c, value, i, keep, order_clock);
 	}
-	return order->find(card);
+	order->checked = order_clock;
+	return *order;
+}
+
+int Set::positionOfCard(const CardP& card, const ScriptValueP& order_by, const ScriptValueP& filter) {
+	assert(order_by);
+	return orderCache(order_by, filter).find(card);
 }
 int Set::numberOfCards(const ScriptValueP& filter) {
 	if (!filter) return (int)cards.size();
-	map<ScriptValueP,int>::const_iterator it = filter_cache.find(filter);
-	if (it !=filter_cache.end()) {
-		return it->second;
+	return orderCache(ScriptValueP(), filter).count();
+}
+void Set::cardChanged(const Card* card) {
+	++order_clock;
+	if (card) {
+		card_changed[card] = order_clock;
 	} else {
-		int n = 0;
-		for(const auto& c : cards) {
-			if (filter->eval(getContext(c))->toBool()) ++n;
-		}
-		filter_cache.insert(make_pair(filter,n));
-		return n;
+		cards_changed = order_clock;
 	}
 }
 void Set::clearOrderCache() {
 	order_cache.clear();
-	filter_cache.clear();
+	card_changed.clear();
+}
+
+CardSearchIndex& Set::searchIndex() {
+	assert(wxThread::IsMain());
+	if (!search_index) search_index.reset(new CardSearchIndex(*this));
+	return *search_index;
 }
 
 // ----------------------------------------------------------------------------- : SetView
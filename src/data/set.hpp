@@ -16,6 +16,7 @@
 #include <data/field.hpp> // for Set::value
 #include <data/keyword.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <unordered_map>
 
 DECLARE_POINTER_TYPE(Card);
 DECLARE_POINTER_TYPE(Set);
@@ -29,6 +30,7 @@ DECLARE_POINTER_TYPE(PackType);
 DECLARE_POINTER_TYPE(ScriptValue);
 class SetScriptManager;
 class SetScriptContext;
+class CardSearchIndex;
 class Context;
 class Dependency;
 template <typename> class OrderCache;
@@ -104,8 +106,14 @@ class Set : public Packaged {
 	int positionOfCard(const CardP& card, const ScriptValueP& order_by, const ScriptValueP& filter);
 	/// Find the number of cards that match the given filter
 	int numberOfCards(const ScriptValueP& filter);
+	/// Tell the caches used by positionOfCard and numberOfCards that the values of a card have changed
+	/** If card is null, the list of cards has changed */
+	void cardChanged(const Card* card);
 	/// Clear the order_cache used by positionOfCard
 	void clearOrderCache();
+	/// Index of the text on the cards, for quick search
+	/** Should only be used from the main thread! */
+	CardSearchIndex& searchIndex();
 	
 	virtual String typeName() const;
 	Version fileVersion() const;
@@ -126,9 +134,18 @@ class Set : public Packaged {
 	scoped_ptr<SetScriptManager> script_manager;
 	/// Object for executing scripts from the thumbnail thread
 	scoped_ptr<SetScriptContext> thumbnail_script_context;
+	/// Index for quick search, created when first needed
+	scoped_ptr<CardSearchIndex>  search_index;
 	/// Cache of cards ordered by some criterion
 	map<std::pair<ScriptValueP,ScriptValueP>,OrderCacheP> order_cache;
-	map<ScriptValueP,int>                            filter_cache;
+	/// Incremented on each change to the cards, used to determine what part of the order_cache is out of date
+	UInt                                             order_clock;
+	/// When were the values of a card last changed, in terms of the order_clock
+	std::unordered_map<const Card*,UInt>            card_changed;
+	/// When did the list of cards last change, in terms of the order_clock
+	UInt                                             cards_changed;
+	/// Order cache for the given criterion, with the changed cards reevaluated
+	OrderCache<CardP>& orderCache(const ScriptValueP& order_by, const ScriptValueP& filter);
 };
 
 inline String type_name(const Set&) {
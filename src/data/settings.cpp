@@ -182,6 +182,10 @@ Settings::Settings()
 	, check_updates_all    (true)
 	, website_url          (_("http://magicseteditor.sourceforge.net/"))
 	, install_type         (INSTALL_DEFAULT)
+	, image_cache_size     (64)
+	, image_cache_on_disk  (false)
+	, image_cache_disk_size(256)
+	, image_resample_filter(RESAMPLE_BOX)
 {}
 
 void Settings::addRecentFile(const String& filename) {
@@ -270,6 +274,10 @@ IMPLEMENT_REFLECTION_NO_SCRIPT(Settings) {
 	REFLECT(check_updates);
 	REFLECT(check_updates_all);
 	REFLECT(install_type);
+	REFLECT(image_cache_size);
+	REFLECT(image_cache_on_disk);
+	REFLECT(image_cache_disk_size);
+	REFLECT(image_resample_filter);
 	REFLECT(website_url);
 	REFLECT(game_settings);
 	REFLECT(stylesheet_settings);
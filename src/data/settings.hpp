@@ -13,6 +13,7 @@
 #include <util/reflect.hpp>
 #include <util/defaultable.hpp>
 #include <util/angle.hpp>
+#include <gfx/gfx.hpp>
 
 class Game;
 class StyleSheet;
@@ -206,6 +207,14 @@ class Settings {
 	// --------------------------------------------------- : Installation settings
 	InstallType install_type;
 	
+	// --------------------------------------------------- : Caching
+	UInt image_cache_size;      ///< Maximum size of the generated image cache, in megabytes
+	bool image_cache_on_disk;   ///< Also store generated images in the user's cache directory?
+	UInt image_cache_disk_size; ///< Maximum size of the generated images in the cache directory, in megabytes
+	
+	// --------------------------------------------------- : Rendering
+	ResampleFilter image_resample_filter; ///< Filter to use for resizing images in image fields
+	
 	// --------------------------------------------------- : The io
 	
 	/// Read the settings file from the standard location
@@ -10,6 +10,9 @@
 #include <data/statistics.hpp>
 #include <data/field.hpp>
 #include <data/field/choice.hpp>
+#include <data/set.hpp>
+#include <data/card.hpp>
+#include <util/tagged_string.hpp>
 
 
 extern ScriptValueP script_primary_choice;
@@ -125,6 +128,68 @@ void StatsCategory::find_dimensions(const vector<StatsDimensionP>& available) {
 	}
 }
 
+// ----------------------------------------------------------------------------- : StatsValueCache
+
+/// Latest age of a list of values
+Age latest_modification(const IndexMap<FieldP,ValueP>& data) {
+	Age age;
+	for(const auto& v : data) {
+		if (age < v->last_modified) age = v->last_modified;
+	}
+	return age;
+}
+
+void StatsValueCache::update(Set& set) {
+	// changes to the set can affect all cards
+	Age set_age = latest_modification(set.data);
+	if (set_modified < set_age) {
+		cards.clear();
+		set_modified = set_age;
+	}
+	// forget changed cards
+	size_t found = 0;
+	for(const auto& card : set.cards) {
+		auto it = cards.find(card.get());
+		if (it == cards.end()) continue;
+		++found;
+		if (it->second.modified < latest_modification(card->data) || it->second.stylesheet != set.stylesheetForP(card)) {
+			cards.erase(it);
+			--found;
+		}
+	}
+	// forget deleted cards
+	if (found < cards.size()) {
+		std::unordered_map<const Card*, CardValues> still_there;
+		for(const auto& card : set.cards) {
+			auto it = cards.find(card.get());
+			if (it != cards.end()) still_there.insert(*it);
+		}
+		swap(cards, still_there);
+	}
+}
+
+void StatsValueCache::clear() {
+	cards.clear();
+	set_modified = Age();
+}
+
+const String& StatsValueCache::value(Set& set, const CardP& card, const StatsDimension& dim) {
+	auto it = cards.find(card.get());
+	if (it == cards.end()) {
+		CardValues& cv = cards[card.get()];
+		cv.card       = card;
+		cv.stylesheet = set.stylesheetForP(card);
+		cv.modified   = latest_modification(card->data);
+		it = cards.find(card.get());
+	}
+	auto v = it->second.values.find(&dim);
+	if (v == it->second.values.end()) {
+		Context& ctx = set.getContext(card);
+		v = it->second.values.insert(make_pair(&dim, untag(dim.script.invoke(ctx)->toString()))).first;
+	}
+	return v->second;
+}
+
 // ----------------------------------------------------------------------------- : GraphType (from graph_type.hpp)
 
 IMPLEMENT_REFLECTION_ENUM(GraphType) {
@@ -11,10 +11,15 @@
 
 #include <util/prec.hpp>
 #include <util/reflect.hpp>
+#include <util/age.hpp>
 #include <data/graph_type.hpp>
 #include <script/scriptable.hpp>
+#include <unordered_map>
 
 class Field;
+class Set;
+DECLARE_POINTER_TYPE(Card);
+DECLARE_POINTER_TYPE(StyleSheet);
 DECLARE_POINTER_TYPE(StatsDimension);
 DECLARE_POINTER_TYPE(StatsCategory);
 
@@ -69,5 +74,38 @@ class StatsCategory : public IntrusivePtrBase<StatsCategory> {
 	DECLARE_REFLECTION();
 };
 
+// ----------------------------------------------------------------------------- : StatsValueCache
+
+/// The values of statistics dimensions for the cards in a set
+/** Evaluating the dimension scripts is the slow part of showing statistics,
+ *  so the values are remembered until the card changes.
+ *  A card has changed if one of its values was modified after the values were determined,
+ *  or if it uses a different stylesheet (dimensions can depend on the stylesheet, for instance stylesheet.short_name).
+ *  All values are determined again when a value of the set is modified.
+ *
+ *  Should only be used from the main thread.
+ */
+class StatsValueCache {
+  public:
+	/// Forget the values of cards that have changed or are no longer in the set
+	/** Must be called before value() for each change to the set */
+	void update(Set& set);
+	/// Forget all values
+	void clear();
+	
+	/// The value of a dimension for a card, without tags
+	const String& value(Set& set, const CardP& card, const StatsDimension& dim);
+	
+  private:
+	struct CardValues {
+		CardP       card;
+		StyleSheetP stylesheet; ///< Stylesheet of the card when the values were determined
+		Age         modified;   ///< Latest age of the values of the card when the values were determined
+		std::unordered_map<const StatsDimension*, String> values;
+	};
+	std::unordered_map<const Card*, CardValues> cards;
+	Age set_modified; ///< Latest age of the values of the set when the values were determined
+};
+
 // ----------------------------------------------------------------------------- : EOF
 #endif
@@ -12,6 +12,7 @@
 #include <util/dynamic_arg.hpp>
 #include <util/io/package_manager.hpp>
 #include <util/rotation.hpp>
+#include <gfx/headless_dc.hpp>
 #include <util/error.hpp>
 #include <util/window_id.hpp>
 #include <render/text/element.hpp> // fot CharInfo
@@ -69,6 +70,8 @@ class SymbolInFont : public IntrusivePtrBase<SymbolInFont> {
 	
 	/// Get a shrunk, zoomed bitmap
 	Bitmap getBitmap(Package& pkg, double size);
+	/// Get a shrunk, zoomed image, cached like getBitmap, for drawing without a display
+	const Image& getCachedImage(Package& pkg, double size);
 	
 	/// Get a bitmap with the given size
 	Bitmap getBitmap(Package& pkg, wxSize size);
@@ -96,6 +99,8 @@ class SymbolInFont : public IntrusivePtrBase<SymbolInFont> {
 	wxSize           actual_size;	///< Actual image size, only known after loading the image
 	/// Cached bitmaps for different sizes
 	map<double, Bitmap> bitmaps;
+	/// *or* cached images, when there is no display (see headless_rendering())
+	map<double, Image>  images;
 	
 	DECLARE_REFLECTION();
 };
@@ -137,6 +142,11 @@ Bitmap SymbolInFont::getBitmap(Package& pkg, double size) {
 	}
 	return bmp;
 }
+const Image& SymbolInFont::getCachedImage(Package& pkg, double size) {
+	Image& img = images[size];
+	if (!img.Ok()) img = getImage(pkg, size);
+	return img;
+}
 Bitmap SymbolInFont::getBitmap(Package& pkg, wxSize size) {
 	// generate new bitmap
 	if (!image.isReady()) {
@@ -148,7 +158,8 @@ Bitmap SymbolInFont::getBitmap(Package& pkg, wxSize size) {
 RealSize SymbolInFont::size(Package& pkg, double size) {
 	if (actual_size.GetWidth() == 0) {
 		// we don't know what size the image will be
-		getBitmap(pkg, size);
+		if (headless_rendering()) getCachedImage(pkg, size);
+		else                      getBitmap(pkg, size);
 	}
 	return wxSize(actual_size * (int) (size) / (int) (img_size));
 }
@@ -157,6 +168,7 @@ void SymbolInFont::update(Context& ctx) {
 	if (image.update(ctx)) {
 		// image has changed, cache is no longer valid
 		bitmaps.clear();
+		images.clear();
 	}
 	enabled.update(ctx);
 	if (text_font)
@@ -287,12 +299,21 @@ void SymbolFont::draw(RotatedDC& dc, RealRect rect, double font_size, const Alig
 
 void SymbolFont::drawSymbol(RotatedDC& dc, RealRect sym_rect, double font_size, const Alignment& align, SymbolInFont& sym, const String& text) {
 	// 1. draw symbol
-	// find bitmap
-	Bitmap bmp = sym.getBitmap(*this, dc.trS(font_size));
-	// draw aligned in the rectangle
-	RealSize  bmp_size = dc.trInvS(RealSize(bmp));
-	RealPoint bmp_pos  = align_in_rect(align, bmp_size, sym_rect);
-	dc.DrawBitmap(bmp, bmp_pos);
+	// find bitmap, or image if there is no display
+	RealSize  bmp_size;
+	RealPoint bmp_pos;
+	if (headless_rendering()) {
+		const Image& img = sym.getCachedImage(*this, dc.trS(font_size));
+		bmp_size = dc.trInvS(RealSize(img));
+		bmp_pos  = align_in_rect(align, bmp_size, sym_rect);
+		dc.DrawImage(img, bmp_pos);
+	} else {
+		Bitmap bmp = sym.getBitmap(*this, dc.trS(font_size));
+		// draw aligned in the rectangle
+		bmp_size = dc.trInvS(RealSize(bmp));
+		bmp_pos  = align_in_rect(align, bmp_size, sym_rect);
+		dc.DrawBitmap(bmp, bmp_pos);
+	}
 	
 	// 2. draw text
 	if (text.empty() || !sym.text_font) return;
@@ -333,11 +354,20 @@ Image SymbolFont::getImage(double font_size, const DrawableSymbol& sym) {
 	if (!sym.symbol) return Image(1,1);
 	if (sym.draw_text.empty() || !sym.symbol->text_font) return sym.symbol->getImage(*this, font_size);
 	// with text
-	Bitmap bmp(sym.symbol->getImage(*this, font_size));
-	// memory dc to work with
-	wxMemoryDC dc;
-	dc.SelectObject(bmp);
-	RealRect sym_rect(0,0,bmp.GetWidth(),bmp.GetHeight());
+	Image img = sym.symbol->getImage(*this, font_size);
+	// memory dc to work with, or a headless one if there is no display
+	scoped_ptr<HeadlessDC> headless;
+	scoped_ptr<wxMemoryDC> mdc;
+	Bitmap bmp;
+	if (headless_rendering()) {
+		headless.reset(new HeadlessDC(img));
+	} else {
+		bmp = Bitmap(img);
+		mdc.reset(new wxMemoryDC);
+		mdc->SelectObject(bmp);
+	}
+	DC& dc = headless ? static_cast<DC&>(*headless) : *mdc;
+	RealRect sym_rect(0,0,img.GetWidth(),img.GetHeight());
 	RotatedDC rdc(dc, 0, sym_rect, 1, QUALITY_AA);
 	// subtract margins from size
 	sym_rect.x      += font_size * sym.symbol->text_margin_left;
@@ -369,7 +399,8 @@ Image SymbolFont::getImage(double font_size, const DrawableSymbol& sym) {
 	// draw text
 	rdc.DrawTextWithShadow(sym.draw_text, *sym.symbol->text_font, text_pos, font_size, stretch);
 	// done
-	dc.SelectObject(wxNullBitmap);
+	if (headless) return headless->getImage();
+	mdc->SelectObject(wxNullBitmap);
 	return bmp.ConvertToImage();
 }
 
@@ -8,6 +8,7 @@
 
 #include <util/prec.hpp>
 #include <gfx/gfx.hpp>
+#include <gfx/pixel_kernels.hpp>
 #include <util/error.hpp>
 
 // ----------------------------------------------------------------------------- : Linear Blend
@@ -43,18 +44,22 @@ void linear_blend(Image& img1, const Image& img2, double x1,double y1, double x2
 	int d  = to_int( - (x1 * width * xm + y1 * height * ym) );
 	
 	Byte *data1 = img1.GetData(), *data2 = img2.GetData();
-	// blend pixels
+	const PixelKernels* simd = pixel_kernels_simd();
+	// blend pixels, a row at a time
+	size_t row = (size_t)width * 3;
+	vector<int> mults(row); // multiplier for each byte in the row, the kernel divides by fixed
 	for (int y = 0 ; y < height ; ++y) {
 		for (int x = 0 ; x < width ; ++x) {
 			int mult = x * xm + y * ym + d;
 			if (mult < 0)      mult = 0;
 			if (mult > fixed)  mult = fixed;
-			data1[0] = data1[0] + mult * (data2[0] - data1[0]) / fixed;
-			data1[1] = data1[1] + mult * (data2[1] - data1[1]) / fixed;
-			data1[2] = data1[2] + mult * (data2[2] - data1[2]) / fixed;
-			data1 += 3;
-			data2 += 3;
+			mults[3 * x] = mults[3 * x + 1] = mults[3 * x + 2] = mult;
 		}
+		size_t done = 0;
+		if (simd) done = simd->lerp(data1, data2, mults.data(), row);
+		pixel_kernels_plain.lerp(data1 + done, data2 + done, mults.data() + done, row - done);
+		data1 += row;
+		data2 += row;
 	}
 }
 
@@ -66,12 +71,11 @@ void mask_blend(Image& img1, const Image& img2, const Image& mask) {
 		throw Error(_("Images used for blending must have the same size"));
 	}
 	
-	UInt size = img1.GetWidth() * img1.GetHeight() * 3;
+	size_t size = img1.GetWidth() * img1.GetHeight() * 3;
 	Byte *data1 = img1.GetData(), *data2 = img2.GetData(), *dataM = mask.GetData();
-	// for each subpixel...
-	for (UInt i = 0 ; i < size ; ++i) {
-		data1[i] = (data1[i] * dataM[i] + data2[i] * (255 - dataM[i])) / 255;
-	}
+	size_t done = 0;
+	if (const PixelKernels* simd = pixel_kernels_simd()) done = simd->mask_blend(data1, data2, dataM, size);
+	pixel_kernels_plain.mask_blend(data1 + done, data2 + done, dataM + done, size - done);
 }
 
 // ----------------------------------------------------------------------------- : Alpha
@@ -98,9 +102,7 @@ void set_alpha(Image& img, Byte* al, const wxSize& alpha_size) {
 		// merge
 		Byte *im = img.GetAlpha();
 		size_t size = img.GetWidth() * img.GetHeight();
-		for (size_t i = 0 ; i < size ; ++i) {
-			im[i] = (im[i] * al[i]) / 255;
-		}
+		combine_bytes(&PixelKernels::multiply, im, al, size);
 	}
 }
 
@@ -112,8 +114,8 @@ void set_alpha(Image& img, double alpha) {
 	} else {
 		Byte *im = img.GetAlpha();
 		size_t size = img.GetWidth() * img.GetHeight();
-		for (size_t i = 0 ; i < size ; ++i) {
-			im[i] = (im[i] * b_alpha) / 255;
-		}
+		size_t done = 0;
+		if (const PixelKernels* simd = pixel_kernels_simd()) done = simd->scale(im, b_alpha, size);
+		pixel_kernels_plain.scale(im + done, b_alpha, size - done);
 	}
 }
@@ -8,6 +8,8 @@
 
 #include <util/prec.hpp>
 #include <gfx/gfx.hpp>
+#include <gfx/headless_dc.hpp>
+#include <gfx/pixel_kernels.hpp>
 #include <util/reflect.hpp>
 #include <algorithm>
 
@@ -42,63 +44,8 @@ IMPLEMENT_REFLECTION_ENUM(ImageCombine) {
 	VALUE_N("symmetric overlay",COMBINE_SYMMETRIC_OVERLAY);
 }
 
-// ----------------------------------------------------------------------------- : Combining functions
-
-// Functor for combining functions for a given combining type
-template <ImageCombine combine> struct Combine {
-	static inline int f(int a, int b);
-};
-
-// Give a combining function for enum value 'combine'
-#define COMBINE_FUN(combine,fun)	\
-	template <> int Combine<combine>::f(int a, int b) { return fun; }
-
-// Based on
-//  http://www.pegtop.net/delphi/articles/blendmodes/
-
-COMBINE_FUN(COMBINE_NORMAL,		b													)
-COMBINE_FUN(COMBINE_ADD,		top(a + b)											)
-COMBINE_FUN(COMBINE_SUBTRACT,	bot(a - b)											)
-COMBINE_FUN(COMBINE_STAMP,		col(a - 2 * b + 256)								)
-COMBINE_FUN(COMBINE_DIFFERENCE,	abs(a - b)											)
-COMBINE_FUN(COMBINE_NEGATION,	255 - abs(255 - a - b)								)
-COMBINE_FUN(COMBINE_MULTIPLY,	(a * b) / 255										)
-COMBINE_FUN(COMBINE_DARKEN,		min(a, b)											)
-COMBINE_FUN(COMBINE_LIGHTEN,	max(a, b)											)
-COMBINE_FUN(COMBINE_COLOR_DODGE,b == 255 ? 255 : top(a * 255 / (255 - b))			)
-COMBINE_FUN(COMBINE_COLOR_BURN,	b == 0   ? 0   : bot(255 - (255-a) * 255 / b)		)
-COMBINE_FUN(COMBINE_SCREEN,		255 - (((255 - a) * (255 - b)) / 255)				)
-COMBINE_FUN(COMBINE_OVERLAY,	a < 128
-									? (a * b) >> 7
-									: 255 - (((255 - a) * (255 - b)) >> 7)			)
-COMBINE_FUN(COMBINE_HARD_LIGHT,	b < 128
-									? (a * b) >> 7
-									: 255 - (((255 - a) * (255 - b)) >> 7)			)
-COMBINE_FUN(COMBINE_SOFT_LIGHT,	b)
-COMBINE_FUN(COMBINE_REFLECT,	b == 255 ? 255 : top(a * a / (255 - b))				)
-COMBINE_FUN(COMBINE_GLOW,		a == 255 ? 255 : top(b * b / (255 - a))				)
-COMBINE_FUN(COMBINE_FREEZE,		b == 0 ? 0 : bot(255 - (255 - a) * (255 - a) / b)	)
-COMBINE_FUN(COMBINE_HEAT,		a == 0 ? 0 : bot(255 - (255 - b) * (255 - b) / a)	)
-COMBINE_FUN(COMBINE_AND,		a & b												)
-COMBINE_FUN(COMBINE_OR,			a | b												)
-COMBINE_FUN(COMBINE_XOR,		a ^ b												)
-COMBINE_FUN(COMBINE_SHADOW,		(b * a * a) / (255 * 255)							)
-COMBINE_FUN(COMBINE_SYMMETRIC_OVERLAY,	(Combine<COMBINE_OVERLAY>::f(a,b) + Combine<COMBINE_OVERLAY>::f(b,a)) / 2 )
-
 // ----------------------------------------------------------------------------- : Combining
 
-/// Combine image b onto image a using some combining mode.
-/// The results are stored in the image A.
-template <ImageCombine combine>
-void combine_image_do(Image& a, Image b) {
-	UInt size = a.GetWidth() * a.GetHeight() * 3;
-	Byte *dataA = a.GetData(), *dataB = b.GetData();
-	// for each pixel: apply function
-	for (UInt i = 0 ; i < size ; ++i) {
-		dataA[i] = Combine<combine>::f(dataA[i], dataB[i]);
-	}
-}
-
 void combine_image(Image& a, const Image& b, ImageCombine combine) {
 	// Images must have same size
 	assert(a.GetWidth()  == b.GetWidth());
@@ -108,39 +55,52 @@ void combine_image(Image& a, const Image& b, ImageCombine combine) {
 		if (!a.HasAlpha()) a.InitAlpha();
 		memcpy(a.GetAlpha(), b.GetAlpha(), a.GetWidth() * a.GetHeight());
 	}
-	// Combine image data, by dispatching to combineImageDo
+	// Combine image data, by dispatching to the kernel for the combine mode
+	size_t size = a.GetWidth() * a.GetHeight() * 3;
+	Byte *dataA = a.GetData(), *dataB = b.GetData();
 	switch(combine) {
-		#define DISPATCH(comb) case comb: combine_image_do<comb>(a,b); return
+		#define DISPATCH(comb,kernel) case comb: combine_bytes(&PixelKernels::kernel, dataA, dataB, size); return
 		case COMBINE_DEFAULT:
 		case COMBINE_NORMAL: a = b; return; // no need to do a per pixel operation
-		DISPATCH(COMBINE_ADD);
-		DISPATCH(COMBINE_SUBTRACT);
-		DISPATCH(COMBINE_STAMP);
-		DISPATCH(COMBINE_DIFFERENCE);
-		DISPATCH(COMBINE_NEGATION);
-		DISPATCH(COMBINE_MULTIPLY);
-		DISPATCH(COMBINE_DARKEN);
-		DISPATCH(COMBINE_LIGHTEN);
-		DISPATCH(COMBINE_COLOR_DODGE);
-		DISPATCH(COMBINE_COLOR_BURN);
-		DISPATCH(COMBINE_SCREEN);
-		DISPATCH(COMBINE_OVERLAY);
-		DISPATCH(COMBINE_HARD_LIGHT);
-		DISPATCH(COMBINE_SOFT_LIGHT);
-		DISPATCH(COMBINE_REFLECT);
-		DISPATCH(COMBINE_GLOW);
-		DISPATCH(COMBINE_FREEZE);
-		DISPATCH(COMBINE_HEAT);
-		DISPATCH(COMBINE_AND);
-		DISPATCH(COMBINE_OR);
-		DISPATCH(COMBINE_XOR);
-		DISPATCH(COMBINE_SHADOW);
-		DISPATCH(COMBINE_SYMMETRIC_OVERLAY);
+		DISPATCH(COMBINE_ADD,				add);
+		DISPATCH(COMBINE_SUBTRACT,			subtract);
+		DISPATCH(COMBINE_STAMP,				stamp);
+		DISPATCH(COMBINE_DIFFERENCE,		difference);
+		DISPATCH(COMBINE_NEGATION,			negation);
+		DISPATCH(COMBINE_MULTIPLY,			multiply);
+		DISPATCH(COMBINE_DARKEN,			darken);
+		DISPATCH(COMBINE_LIGHTEN,			lighten);
+		DISPATCH(COMBINE_COLOR_DODGE,		color_dodge);
+		DISPATCH(COMBINE_COLOR_BURN,		color_burn);
+		DISPATCH(COMBINE_SCREEN,			screen);
+		DISPATCH(COMBINE_OVERLAY,			overlay);
+		DISPATCH(COMBINE_HARD_LIGHT,		hard_light);
+		DISPATCH(COMBINE_SOFT_LIGHT,		soft_light);
+		DISPATCH(COMBINE_REFLECT,			reflect);
+		DISPATCH(COMBINE_GLOW,				glow);
+		DISPATCH(COMBINE_FREEZE,			freeze);
+		DISPATCH(COMBINE_HEAT,				heat);
+		DISPATCH(COMBINE_AND,				bit_and);
+		DISPATCH(COMBINE_OR,				bit_or);
+		DISPATCH(COMBINE_XOR,				bit_xor);
+		DISPATCH(COMBINE_SHADOW,			shadow);
+		DISPATCH(COMBINE_SYMMETRIC_OVERLAY,	symmetric_overlay);
 	}
 }
 
 void draw_combine_image(DC& dc, UInt x, UInt y, const Image& img, ImageCombine combine) {
-	if (combine <= COMBINE_NORMAL) {
+	if (HeadlessDC* headless = dynamic_cast<HeadlessDC*>(&dc)) {
+		// the pixels can be read directly, and there is no need to go through a Bitmap
+		int dx = dc.LogicalToDeviceX(x), dy = dc.LogicalToDeviceY(y);
+		if (combine <= COMBINE_NORMAL) {
+			headless->DrawImage(img, dx, dy);
+		} else {
+			Image source = headless->getSubImage(wxRect(dx, dy, img.GetWidth(), img.GetHeight()));
+			if (source.HasAlpha() && !img.HasAlpha()) source.ClearAlpha(); // like the Blit below, the result is opaque
+			combine_image(source, img, combine);
+			headless->DrawImage(source, dx, dy);
+		}
+	} else if (combine <= COMBINE_NORMAL) {
 		dc.DrawBitmap(img, x, y);
 	} else {
 		// Capture the current image in the target rectangle
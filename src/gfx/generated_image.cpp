@@ -14,7 +14,11 @@
 #include <data/field/symbol.hpp>
 #include <render/symbol/filter.hpp>
 #include <gui/util.hpp> // load_resource_image
+#include <wx/thread.h>
+#include <typeinfo>
+#include <unordered_map>
 
+using std::make_pair;
 using std::max;
 using std::min;
 
@@ -27,6 +31,18 @@ GeneratedImageP GeneratedImage::toImage() const {
 	return intrusive_from_existing(const_cast<GeneratedImage*>(this));
 }
 
+size_t GeneratedImage::hash() const {
+	size_t seed = cached_hash.load(std::memory_order_relaxed);
+	if (seed) return seed;
+	// two different kinds of images can have the same parameters, so include the type
+	seed = computeHash();
+	const char* type_name = typeid(*this).name();
+	boost::hash_range(seed, type_name, type_name + strlen(type_name));
+	if (seed == 0) seed = 1; // 0 means 'not known'
+	cached_hash.store(seed, std::memory_order_relaxed);
+	return seed;
+}
+
 Image GeneratedImage::generateConform(const Options& options) const {
 	return conform_image(generate(options),options);
 }
@@ -38,18 +54,18 @@ Image conform_image(const Image& img, const GeneratedImage::Options& options) {
 	if ((iw == options.width && ih == options.height) || (options.width == 0 && options.height == 0)) {
 		// zoom?
 		if (options.zoom != 1.0) {
-			image = resample(image, int(iw * options.zoom), int(ih * options.zoom));
+			image = resample(image, int(iw * options.zoom), int(ih * options.zoom), options.filter);
 		} else {
 			// already the right size
 		}
 	} else if (options.height == 0) {
 		// width is given, determine height
 		int h = options.width * ih / iw;
-		image = resample(image, options.width, h);
+		image = resample(image, options.width, h, options.filter);
 	} else if (options.width == 0) {
 		// height is given, determine width
 		int w = options.height * iw / ih;
-		image = resample(image, w, options.height);
+		image = resample(image, w, options.height, options.filter);
 	} else if (options.preserve_aspect == ASPECT_FIT) {
 		// determine actual size of resulting image
 		int w, h;
@@ -60,13 +76,13 @@ Image conform_image(const Image& img, const GeneratedImage::Options& options) {
 			w = options.height * iw / ih;
 			h = options.height;
 		}
-		image = resample(image, w, h);
+		image = resample(image, w, h, options.filter);
 	} else {
 		if (options.preserve_aspect == ASPECT_BORDER && (options.width < options.height * 3) && (options.height < options.width * 3)) {
 			// preserve the aspect ratio if there is not too much difference
-			image = resample_preserve_aspect(image, options.width, options.height);
+			image = resample_preserve_aspect(image, options.width, options.height, options.filter);
 		} else {
-			image = resample(image, options.width, options.height);
+			image = resample(image, options.width, options.height, options.filter);
 		}
 	}
 	// saturate?
@@ -82,6 +98,50 @@ Image conform_image(const Image& img, const GeneratedImage::Options& options) {
 	return image;
 }
 
+// ----------------------------------------------------------------------------- : Interning
+
+/// The interned images, by hash
+/** The table holds references, so images are never deleted while they are interned.
+ *  To keep the table from growing forever it is cleared when it becomes too large,
+ *  the images themselves are small, the pixels are not part of them.
+ *  Every time the table is cleared a new generation starts, images from older generations
+ *  may be equal to the ones that are interned again.
+ */
+static std::unordered_multimap<size_t, GeneratedImageP> interned_images;
+static wxMutex interned_images_mutex;
+static UInt interned_images_generation = 1;
+static const size_t max_interned_images = 10000;
+
+GeneratedImageP intern_image(const GeneratedImageP& image) {
+	if (!image || image->usesLocal()) return image;
+	size_t key = image->hash();
+	wxMutexLocker lock(interned_images_mutex);
+	auto range = interned_images.equal_range(key);
+	for (auto it = range.first ; it != range.second ; ++it) {
+		if (equal_images(*it->second, *image)) return it->second;
+	}
+	if (interned_images.size() >= max_interned_images) {
+		interned_images.clear();
+		++interned_images_generation;
+	}
+	interned_images.insert(make_pair(key, image));
+	image->interned_in.store(interned_images_generation, std::memory_order_release);
+	return image;
+}
+
+void clear_interned_images() {
+	wxMutexLocker lock(interned_images_mutex);
+	interned_images.clear();
+	++interned_images_generation;
+}
+
+bool equal_images(const GeneratedImage& a, const GeneratedImage& b) {
+	if (&a == &b) return true;
+	UInt generation = a.interned_in.load(std::memory_order_acquire);
+	if (generation != 0 && generation == b.interned_in.load(std::memory_order_acquire)) return false;
+	return a == b;
+}
+
 // ----------------------------------------------------------------------------- : BlankImage
 
 Image BlankImage::generate(const Options& opt) const {
@@ -96,6 +156,9 @@ bool BlankImage::operator == (const GeneratedImage& that) const {
 	const BlankImage* that2 = dynamic_cast<const BlankImage*>(&that);
 	return that2;
 }
+size_t BlankImage::computeHash() const {
+	return 0;
+}
 
 // ----------------------------------------------------------------------------- : LinearBlendImage
 
@@ -109,11 +172,18 @@ ImageCombine LinearBlendImage::combine() const {
 }
 bool LinearBlendImage::operator == (const GeneratedImage& that) const {
 	const LinearBlendImage* that2 = dynamic_cast<const LinearBlendImage*>(&that);
-	return that2 && *image1 == *that2->image1
-	             && *image2 == *that2->image2
+	return that2 && equal_images(*image1, *that2->image1)
+	             && equal_images(*image2, *that2->image2)
 	             && x1 == that2->x1 && y1 == that2->y1
 	             && x2 == that2->x2 && y2 == that2->y2;
 }
+size_t LinearBlendImage::computeHash() const {
+	size_t seed = image1->hash();
+	hash_combine(seed, image2->hash());
+	hash_combine(seed, x1); hash_combine(seed, y1);
+	hash_combine(seed, x2); hash_combine(seed, y2);
+	return seed;
+}
 
 // ----------------------------------------------------------------------------- : MaskedBlendImage
 
@@ -127,9 +197,15 @@ ImageCombine MaskedBlendImage::combine() const {
 }
 bool MaskedBlendImage::operator == (const GeneratedImage& that) const {
 	const MaskedBlendImage* that2 = dynamic_cast<const MaskedBlendImage*>(&that);
-	return that2 && *light == *that2->light
-	             && *dark  == *that2->dark
-	             && *mask  == *that2->mask;
+	return that2 && equal_images(*light, *that2->light)
+	             && equal_images(*dark, *that2->dark)
+	             && equal_images(*mask, *that2->mask);
+}
+size_t MaskedBlendImage::computeHash() const {
+	size_t seed = light->hash();
+	hash_combine(seed, dark->hash());
+	hash_combine(seed, mask->hash());
+	return seed;
 }
 
 // ----------------------------------------------------------------------------- : CombineBlendImage
@@ -144,10 +220,16 @@ ImageCombine CombineBlendImage::combine() const {
 }
 bool CombineBlendImage::operator == (const GeneratedImage& that) const {
 	const CombineBlendImage* that2 = dynamic_cast<const CombineBlendImage*>(&that);
-	return that2 && *image1 == *that2->image1
-	             && *image2 == *that2->image2
+	return that2 && equal_images(*image1, *that2->image1)
+	             && equal_images(*image2, *that2->image2)
 	             && image_combine == that2->image_combine;
 }
+size_t CombineBlendImage::computeHash() const {
+	size_t seed = image1->hash();
+	hash_combine(seed, image2->hash());
+	hash_combine(seed, (int)image_combine);
+	return seed;
+}
 
 // ----------------------------------------------------------------------------- : SetMaskImage
 
@@ -158,8 +240,13 @@ Image SetMaskImage::generate(const Options& opt) const {
 }
 bool SetMaskImage::operator == (const GeneratedImage& that) const {
 	const SetMaskImage* that2 = dynamic_cast<const SetMaskImage*>(&that);
-	return that2 && *image == *that2->image
-	             && *mask  == *that2->mask;
+	return that2 && equal_images(*image, *that2->image)
+	             && equal_images(*mask, *that2->mask);
+}
+size_t SetMaskImage::computeHash() const {
+	size_t seed = image->hash();
+	hash_combine(seed, mask->hash());
+	return seed;
 }
 
 Image SetAlphaImage::generate(const Options& opt) const {
@@ -169,9 +256,14 @@ Image SetAlphaImage::generate(const Options& opt) const {
 }
 bool SetAlphaImage::operator == (const GeneratedImage& that) const {
 	const SetAlphaImage* that2 = dynamic_cast<const SetAlphaImage*>(&that);
-	return that2 && *image == *that2->image
+	return that2 && equal_images(*image, *that2->image)
 	             && alpha  == that2->alpha;
 }
+size_t SetAlphaImage::computeHash() const {
+	size_t seed = image->hash();
+	hash_combine(seed, alpha);
+	return seed;
+}
 
 // ----------------------------------------------------------------------------- : SetCombineImage
 
@@ -183,9 +275,14 @@ ImageCombine SetCombineImage::combine() const {
 }
 bool SetCombineImage::operator == (const GeneratedImage& that) const {
 	const SetCombineImage* that2 = dynamic_cast<const SetCombineImage*>(&that);
-	return that2 && *image == *that2->image
+	return that2 && equal_images(*image, *that2->image)
 	             && image_combine == that2->image_combine;
 }
+size_t SetCombineImage::computeHash() const {
+	size_t seed = image->hash();
+	hash_combine(seed, (int)image_combine);
+	return seed;
+}
 
 // ----------------------------------------------------------------------------- : SaturateImage
 
@@ -196,9 +293,14 @@ Image SaturateImage::generate(const Options& opt) const {
 }
 bool SaturateImage::operator == (const GeneratedImage& that) const {
 	const SaturateImage* that2 = dynamic_cast<const SaturateImage*>(&that);
-	return that2 && *image == *that2->image
+	return that2 && equal_images(*image, *that2->image)
 	             && amount == that2->amount;
 }
+size_t SaturateImage::computeHash() const {
+	size_t seed = image->hash();
+	hash_combine(seed, amount);
+	return seed;
+}
 
 // ----------------------------------------------------------------------------- : InvertImage
 
@@ -209,7 +311,10 @@ Image InvertImage::generate(const Options& opt) const {
 }
 bool InvertImage::operator == (const GeneratedImage& that) const {
 	const InvertImage* that2 = dynamic_cast<const InvertImage*>(&that);
-	return that2 && *image == *that2->image;
+	return that2 && equal_images(*image, *that2->image);
+}
+size_t InvertImage::computeHash() const {
+	return image->hash();
 }
 
 // ----------------------------------------------------------------------------- : RecolorImage
@@ -221,9 +326,14 @@ Image RecolorImage::generate(const Options& opt) const {
 }
 bool RecolorImage::operator == (const GeneratedImage& that) const {
 	const RecolorImage* that2 = dynamic_cast<const RecolorImage*>(&that);
-	return that2 && *image == *that2->image
+	return that2 && equal_images(*image, *that2->image)
 	             && color == that2->color;
 }
+size_t RecolorImage::computeHash() const {
+	size_t seed = image->hash();
+	hash_combine(seed, color);
+	return seed;
+}
 
 Image RecolorImage2::generate(const Options& opt) const {
 	Image img = image->generate(opt);
@@ -232,12 +342,20 @@ Image RecolorImage2::generate(const Options& opt) const {
 }
 bool RecolorImage2::operator == (const GeneratedImage& that) const {
 	const RecolorImage2* that2 = dynamic_cast<const RecolorImage2*>(&that);
-	return that2 && *image == *that2->image
+	return that2 && equal_images(*image, *that2->image)
 	             && red == that2->red
 	             && green == that2->green
 	             && blue == that2->blue
 	             && white == that2->white;
 }
+size_t RecolorImage2::computeHash() const {
+	size_t seed = image->hash();
+	hash_combine(seed, red);
+	hash_combine(seed, green);
+	hash_combine(seed, blue);
+	hash_combine(seed, white);
+	return seed;
+}
 
 // ----------------------------------------------------------------------------- : FlipImage
 
@@ -247,7 +365,10 @@ Image FlipImageHorizontal::generate(const Options& opt) const {
 }
 bool FlipImageHorizontal::operator == (const GeneratedImage& that) const {
 	const FlipImageHorizontal* that2 = dynamic_cast<const FlipImageHorizontal*>(&that);
-	return that2 && *image == *that2->image;
+	return that2 && equal_images(*image, *that2->image);
+}
+size_t FlipImageHorizontal::computeHash() const {
+	return image->hash();
 }
 
 Image FlipImageVertical::generate(const Options& opt) const {
@@ -256,7 +377,10 @@ Image FlipImageVertical::generate(const Options& opt) const {
 }
 bool FlipImageVertical::operator == (const GeneratedImage& that) const {
 	const FlipImageVertical* that2 = dynamic_cast<const FlipImageVertical*>(&that);
-	return that2 && *image == *that2->image;
+	return that2 && equal_images(*image, *that2->image);
+}
+size_t FlipImageVertical::computeHash() const {
+	return image->hash();
 }
 
 Image RotateImage::generate(const Options& opt) const {
@@ -265,9 +389,14 @@ Image RotateImage::generate(const Options& opt) const {
 }
 bool RotateImage::operator == (const GeneratedImage& that) const {
 	const RotateImage* that2 = dynamic_cast<const RotateImage*>(&that);
-	return that2 && *image == *that2->image
+	return that2 && equal_images(*image, *that2->image)
 	             && angle == that2->angle;
 }
+size_t RotateImage::computeHash() const {
+	size_t seed = image->hash();
+	hash_combine(seed, angle);
+	return seed;
+}
 
 // ----------------------------------------------------------------------------- : EnlargeImage
 
@@ -303,9 +432,14 @@ Image EnlargeImage::generate(const Options& opt) const {
 }
 bool EnlargeImage::operator == (const GeneratedImage& that) const {
 	const EnlargeImage* that2 = dynamic_cast<const EnlargeImage*>(&that);
-	return that2 && *image      == *that2->image
+	return that2 && equal_images(*image, *that2->image)
 	             && border_size == that2->border_size;
 }
+size_t EnlargeImage::computeHash() const {
+	size_t seed = image->hash();
+	hash_combine(seed, border_size);
+	return seed;
+}
 
 // ----------------------------------------------------------------------------- : CropImage
 
@@ -314,10 +448,16 @@ Image CropImage::generate(const Options& opt) const {
 }
 bool CropImage::operator == (const GeneratedImage& that) const {
 	const CropImage* that2 = dynamic_cast<const CropImage*>(&that);
-	return that2 && *image      == *that2->image
+	return that2 && equal_images(*image, *that2->image)
 	             && width    == that2->width    && height   == that2->height
 	             && offset_x == that2->offset_x && offset_y == that2->offset_y;
 }
+size_t CropImage::computeHash() const {
+	size_t seed = image->hash();
+	hash_combine(seed, width);    hash_combine(seed, height);
+	hash_combine(seed, offset_x); hash_combine(seed, offset_y);
+	return seed;
+}
 
 // ----------------------------------------------------------------------------- : DropShadowImage
 
@@ -409,11 +549,18 @@ Image DropShadowImage::generate(const Options& opt) const {
 }
 bool DropShadowImage::operator == (const GeneratedImage& that) const {
 	const DropShadowImage* that2 = dynamic_cast<const DropShadowImage*>(&that);
-	return that2 && *image   == *that2->image
+	return that2 && equal_images(*image, *that2->image)
 	             && offset_x == that2->offset_x && offset_y == that2->offset_y
 	             && shadow_alpha == that2->shadow_alpha && shadow_blur_radius == that2->shadow_blur_radius
 	             && shadow_color == that2->shadow_color;
 }
+size_t DropShadowImage::computeHash() const {
+	size_t seed = image->hash();
+	hash_combine(seed, offset_x);     hash_combine(seed, offset_y);
+	hash_combine(seed, shadow_alpha); hash_combine(seed, shadow_blur_radius);
+	hash_combine(seed, shadow_color);
+	return seed;
+}
 
 // ----------------------------------------------------------------------------- : PackagedImage
 
@@ -434,6 +581,9 @@ bool PackagedImage::operator == (const GeneratedImage& that) const {
 	const PackagedImage* that2 = dynamic_cast<const PackagedImage*>(&that);
 	return that2 && filename == that2->filename;
 }
+size_t PackagedImage::computeHash() const {
+	return hash_value(filename);
+}
 
 // ----------------------------------------------------------------------------- : BuiltInImage
 
@@ -449,6 +599,9 @@ bool BuiltInImage::operator == (const GeneratedImage& that) const {
 	const BuiltInImage* that2 = dynamic_cast<const BuiltInImage*>(&that);
 	return that2 && name == that2->name;
 }
+size_t BuiltInImage::computeHash() const {
+	return hash_value(name);
+}
 
 // ----------------------------------------------------------------------------- : SymbolToImage
 
@@ -488,6 +641,15 @@ bool SymbolToImage::operator == (const GeneratedImage& that) const {
 	                 *variation == *that2->variation // custom variation
 	                );
 }
+size_t SymbolToImage::computeHash() const {
+	// custom variations with the same name and border are equal if their filters are,
+	// so the filter doesn't have to be hashed
+	size_t seed = hash_value(filename);
+	hash_combine(seed, is_local);
+	hash_combine(seed, variation->name);
+	hash_combine(seed, variation->border_radius);
+	return seed;
+}
 
 
 // ----------------------------------------------------------------------------- : ImageValueToImage
@@ -518,6 +680,9 @@ bool ImageValueToImage::operator == (const GeneratedImage& that) const {
 	const ImageValueToImage* that2 = dynamic_cast<const ImageValueToImage*>(&that);
 	return that2 && filename == that2->filename;
 }
+size_t ImageValueToImage::computeHash() const {
+	return hash_value(filename);
+}
 
 String quote_string(String const& str);
 String ImageValueToImage::toCode() const {
@@ -11,6 +11,7 @@
 
 #include <util/prec.hpp>
 #include <util/age.hpp>
+#include <util/hash.hpp>
 #include <util/io/package.hpp>
 #include <gfx/gfx.hpp>
 #include <script/value.hpp>
@@ -26,11 +27,13 @@ class Package;
  */
 class GeneratedImage : public ScriptValue {
   public:
+	GeneratedImage() : cached_hash(0), interned_in(0) {}
+	
 	/// Options for generating the image
 	struct Options {
 		Options(int width = 0, int height = 0, Package* package = nullptr, Package* local_package = nullptr, PreserveAspect preserve_aspect = ASPECT_STRETCH, bool saturate = false)
 			: width(width), height(height), zoom(1.0), angle(0)
-			, preserve_aspect(preserve_aspect), saturate(saturate)
+			, preserve_aspect(preserve_aspect), saturate(saturate), filter(RESAMPLE_BOX)
 			, package(package), local_package(local_package)
 		{}
 		
@@ -40,6 +43,7 @@ class GeneratedImage : public ScriptValue {
 		Radians        angle;           ///< Angle to rotate image by afterwards
 		PreserveAspect preserve_aspect;
 		bool           saturate;
+		ResampleFilter filter;          ///< Filter to use when resizing the image
 		Package* package;       ///< Package to load images from
 		Package* local_package; ///< Package to load symbols and ImageValue images from
 	};
@@ -53,11 +57,16 @@ class GeneratedImage : public ScriptValue {
 	/// Equality should mean that every pixel in the generated images is the same if the same options are used
 	virtual bool operator == (const GeneratedImage& that) const = 0;
 	inline  bool operator != (const GeneratedImage& that) const { return !(*this == that); }
+	/// Hash of the structure of this image, equal images have the same hash
+	/** Images don't change after they are constructed, so the hash is only computed once */
+	size_t hash() const;
 	
 	/// Can this image be generated safely from another thread?
 	virtual bool threadSafe() const { return true; }
 	/// Is this image specific to the set (the local_package)?
 	virtual bool local() const { return false; }
+	/// Does this image or any part of it use the set (the local_package)?
+	virtual bool usesLocal() const { return local(); }
 	/// Is this image blank?
 	virtual bool isBlank() const { return false; }
 	
@@ -65,8 +74,36 @@ class GeneratedImage : public ScriptValue {
 	virtual String typeName() const;
 	virtual GeneratedImageP toImage() const;
 	virtual String toFriendlyString() const;
+	
+  protected:
+	/// Hash of the parameters and sub images, should agree with operator ==
+	virtual size_t computeHash() const = 0;
+  private:
+	mutable std::atomic<size_t> cached_hash; ///< Result of hash(), or 0 if it is not known yet
+	mutable std::atomic<UInt>   interned_in; ///< Generation of the intern table this image was added to, or 0
+	
+	friend GeneratedImageP intern_image(const GeneratedImageP& image);
+	friend bool equal_images(const GeneratedImage& a, const GeneratedImage& b);
 };
 
+/// Find an image equal to the given one that was interned before, or intern this one
+/** Script functions use this, so that the same expression gives the same shared image each time.
+ *  Comparing two interned images is then usually just a pointer comparison.
+ *  Images that use the set are not interned, the returned image is the argument in that case.
+ */
+GeneratedImageP intern_image(const GeneratedImageP& image);
+
+/// Are two images equal?
+/** Each interned image is different from all others interned in the same generation of the table,
+ *  so for those only the pointers are compared. Other images are compared with operator ==.
+ *  Composite images use this for their sub images, so a deep comparison stops at interned images.
+ */
+bool equal_images(const GeneratedImage& a, const GeneratedImage& b);
+
+/// Forget all interned images
+/** *must* be called at application exit */
+void clear_interned_images();
+
 /// Resize an image to conform to the options
 Image conform_image(const Image&, const GeneratedImage::Options&);
 
@@ -80,6 +117,7 @@ class SimpleFilterImage : public GeneratedImage {
 	{}
 	virtual ImageCombine combine() const { return image->combine(); }
 	virtual bool local() const { return image->local(); }
+	virtual bool usesLocal() const { return image->usesLocal(); }
   protected:
 	GeneratedImageP image;
 };
@@ -91,6 +129,7 @@ class BlankImage : public GeneratedImage {
   public:
 	virtual Image generate(const Options&) const;
 	virtual bool operator == (const GeneratedImage& that) const;
+	virtual size_t computeHash() const;
 	virtual bool isBlank() const { return true; }
 	
 	// Why is this not thread safe? What is GTK smoking?
@@ -110,7 +149,9 @@ class LinearBlendImage : public GeneratedImage {
 	virtual Image generate(const Options& opt) const;
 	virtual ImageCombine combine() const;
 	virtual bool operator == (const GeneratedImage& that) const;
+	virtual size_t computeHash() const;
 	virtual bool local() const { return image1->local() && image2->local(); }
+	virtual bool usesLocal() const { return image1->usesLocal() || image2->usesLocal(); }
   private:
 	GeneratedImageP image1, image2;
 	double x1, y1, x2, y2;
@@ -127,7 +168,9 @@ class MaskedBlendImage : public GeneratedImage {
 	virtual Image generate(const Options& opt) const;
 	virtual ImageCombine combine() const;
 	virtual bool operator == (const GeneratedImage& that) const;
+	virtual size_t computeHash() const;
 	virtual bool local() const { return light->local() && dark->local() && mask->local(); }
+	virtual bool usesLocal() const { return light->usesLocal() || dark->usesLocal() || mask->usesLocal(); }
   private:
 	GeneratedImageP light, dark, mask;
 };
@@ -143,7 +186,9 @@ class CombineBlendImage : public GeneratedImage {
 	virtual Image generate(const Options& opt) const;
 	virtual ImageCombine combine() const;
 	virtual bool operator == (const GeneratedImage& that) const;
+	virtual size_t computeHash() const;
 	virtual bool local() const { return image1->local() && image2->local(); }
+	virtual bool usesLocal() const { return image1->usesLocal() || image2->usesLocal(); }
   private:
 	GeneratedImageP image1, image2;
 	ImageCombine image_combine;
@@ -159,6 +204,8 @@ class SetMaskImage : public SimpleFilterImage {
 	{}
 	virtual Image generate(const Options& opt) const;
 	virtual bool operator == (const GeneratedImage& that) const;
+	virtual size_t computeHash() const;
+	virtual bool usesLocal() const { return image->usesLocal() || mask->usesLocal(); }
   private:
 	GeneratedImageP mask;
 };
@@ -171,6 +218,7 @@ class SetAlphaImage : public SimpleFilterImage {
 	{}
 	virtual Image generate(const Options& opt) const;
 	virtual bool operator == (const GeneratedImage& that) const;
+	virtual size_t computeHash() const;
   private:
 	double alpha;
 };
@@ -186,6 +234,7 @@ class SetCombineImage : public SimpleFilterImage {
 	virtual Image generate(const Options& opt) const;
 	virtual ImageCombine combine() const;
 	virtual bool operator == (const GeneratedImage& that) const;
+	virtual size_t computeHash() const;
   private:
 	ImageCombine image_combine;
 };
@@ -200,6 +249,7 @@ class SaturateImage : public SimpleFilterImage {
 	{}
 	virtual Image generate(const Options& opt) const;
 	virtual bool operator == (const GeneratedImage& that) const;
+	virtual size_t computeHash() const;
   private:
 	double amount;
 };
@@ -214,6 +264,7 @@ class InvertImage : public SimpleFilterImage {
 	{}
 	virtual Image generate(const Options& opt) const;
 	virtual bool operator == (const GeneratedImage& that) const;
+	virtual size_t computeHash() const;
 };
 
 // ----------------------------------------------------------------------------- : RecolorImage
@@ -226,6 +277,7 @@ class RecolorImage : public SimpleFilterImage {
 	{}
 	virtual Image generate(const Options& opt) const;
 	virtual bool operator == (const GeneratedImage& that) const;
+	virtual size_t computeHash() const;
   private:
 	Color color;
 };
@@ -237,6 +289,7 @@ class RecolorImage2 : public SimpleFilterImage {
 	{}
 	virtual Image generate(const Options& opt) const;
 	virtual bool operator == (const GeneratedImage& that) const;
+	virtual size_t computeHash() const;
   private:
 	Color red,green,blue,white;
 };
@@ -251,6 +304,7 @@ class FlipImageHorizontal : public SimpleFilterImage {
 	{}
 	virtual Image generate(const Options& opt) const;
 	virtual bool operator == (const GeneratedImage& that) const;
+	virtual size_t computeHash() const;
 };
 
 /// Flip an image vertically
@@ -261,6 +315,7 @@ class FlipImageVertical : public SimpleFilterImage {
 	{}
 	virtual Image generate(const Options& opt) const;
 	virtual bool operator == (const GeneratedImage& that) const;
+	virtual size_t computeHash() const;
 };
 
 /// Rotate an image
@@ -271,6 +326,7 @@ class RotateImage : public SimpleFilterImage {
 	{}
 	virtual Image generate(const Options& opt) const;
 	virtual bool operator == (const GeneratedImage& that) const;
+	virtual size_t computeHash() const;
   private:
 	Radians angle;
 };
@@ -285,6 +341,7 @@ class EnlargeImage : public SimpleFilterImage {
 	{}
 	virtual Image generate(const Options& opt) const;
 	virtual bool operator == (const GeneratedImage& that) const;
+	virtual size_t computeHash() const;
   private:
 	double border_size;
 };
@@ -299,6 +356,7 @@ class CropImage : public SimpleFilterImage {
 	{}
 	virtual Image generate(const Options& opt) const;
 	virtual bool operator == (const GeneratedImage& that) const;
+	virtual size_t computeHash() const;
   private:
 	double width, height;
 	double offset_x, offset_y;
@@ -315,6 +373,7 @@ class DropShadowImage : public SimpleFilterImage {
 	{}
 	virtual Image generate(const Options& opt) const;
 	virtual bool operator == (const GeneratedImage& that) const;
+	virtual size_t computeHash() const;
   private:
 	double offset_x, offset_y;
 	double shadow_alpha;
@@ -332,6 +391,7 @@ class PackagedImage : public GeneratedImage {
 	{}
 	virtual Image generate(const Options& opt) const;
 	virtual bool operator == (const GeneratedImage& that) const;
+	virtual size_t computeHash() const;
   private:
 	String filename;
 };
@@ -346,6 +406,7 @@ class BuiltInImage : public GeneratedImage {
 	{}
 	virtual Image generate(const Options& opt) const;
 	virtual bool operator == (const GeneratedImage& that) const;
+	virtual size_t computeHash() const;
   private:
 	String name;
 };
@@ -359,6 +420,7 @@ class SymbolToImage : public GeneratedImage {
 	~SymbolToImage();
 	virtual Image generate(const Options& opt) const;
 	virtual bool operator == (const GeneratedImage& that) const;
+	virtual size_t computeHash() const;
 	virtual bool local() const { return is_local; }
 	
 	#ifdef __WXGTK__
@@ -383,6 +445,7 @@ class ImageValueToImage : public GeneratedImage {
 	~ImageValueToImage();
 	virtual Image generate(const Options& opt) const;
 	virtual bool operator == (const GeneratedImage& that) const;
+	virtual size_t computeHash() const;
 	virtual bool local() const { return true; }
 	
 	virtual String toCode() const;
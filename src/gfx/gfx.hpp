@@ -21,9 +21,17 @@
 
 // ----------------------------------------------------------------------------- : Resampling
 
-/// Resample (resize) an image, uses bilenear filtering
-void resample(const Image& img_in, Image& img_out);
-Image resample(const Image& img_in, int width, int height);
+/// Filter to use for resampling
+enum ResampleFilter
+{	RESAMPLE_BOX		///< average of the covered input pixels
+,	RESAMPLE_BILINEAR	///< linear interpolation between pixels, a wider tent filter when downsampling
+,	RESAMPLE_LANCZOS3	///< windowed sinc filter, sharpest, but slower
+};
+
+/// Resample (resize) an image
+/** Large images are resampled using multiple threads */
+void resample(const Image& img_in, Image& img_out, ResampleFilter filter = RESAMPLE_BOX);
+Image resample(const Image& img_in, int width, int height, ResampleFilter filter = RESAMPLE_BOX);
 
 /// Resamples an image, first clips the input image to a specified rectangle
 /** The selected rectangle is resampled into the entire output image */
@@ -37,8 +45,8 @@ enum PreserveAspect
 };
 
 /// Resample an image, but preserve the aspect ratio by adding a transparent border around the output if needed.
-void resample_preserve_aspect(const Image& img_in, Image& img_out);
-Image resample_preserve_aspect(const Image& img_in, int width, int height);
+void resample_preserve_aspect(const Image& img_in, Image& img_out, ResampleFilter filter = RESAMPLE_BOX);
+Image resample_preserve_aspect(const Image& img_in, int width, int height, ResampleFilter filter = RESAMPLE_BOX);
 
 /// Resample an image to create a sharp result by applying a sharpening filter
 /** Amount must be between 0 and 100 */
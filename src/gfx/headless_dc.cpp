@@ -0,0 +1,898 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) 2001 - 2012 Twan van Laarhoven and Sean Hunt             |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <util/real_point.hpp>
+#include <gfx/headless_dc.hpp>
+#include <wx/dc.h>
+#include <wx/dcmemory.h>
+#include <wx/graphics.h>
+#include <wx/app.h>
+#include <algorithm>
+
+using std::min;
+using std::max;
+using std::pair;
+using std::make_pair;
+
+// ----------------------------------------------------------------------------- : Polygon coverage
+
+/// Number of sample lines per row of pixels, for anti-aliasing in the vertical direction
+/** In the horizontal direction the coverage is exact. */
+const int subsamples = 8;
+
+/// Edge of a polygon, in device coordinates
+struct PolygonEdge {
+	double x0, y0, x1, y1;
+};
+
+/// How much of each pixel is covered by a set of polygons
+class PolygonCoverage {
+  public:
+	PolygonCoverage()
+		: min_x(1e300), min_y(1e300), max_x(-1e300), max_y(-1e300)
+	{}
+
+	/// Add a closed polygon
+	void addPolygon(const vector<RealPoint>& points) {
+		for (size_t i = 0 ; i < points.size() ; ++i) {
+			addEdge(points[i], points[(i + 1) % points.size()]);
+		}
+	}
+
+	/// Call f(y, x_begin, x_end, cover) for each row of pixels that is (partially) covered
+	/** cover[x - x_begin] is the coverage of pixel x, between 0 and 1.
+	 *  Only pixels inside [0,width)*[0,height) are considered.
+	 */
+	template <typename F> void forEachRow(wxPolygonFillMode rule, int width, int height, F f) const {
+		int y_begin = max(0,      (int)floor(min_y));
+		int y_end   = min(height, (int)ceil (max_y));
+		int x_begin = max(0,      (int)floor(min_x));
+		int x_end   = min(width,  (int)ceil (max_x));
+		if (x_begin >= x_end || y_begin >= y_end) return;
+		vector<double> cover(x_end - x_begin);
+		vector<const PolygonEdge*> active;
+		vector<pair<double,int> > crossings;
+		for (int y = y_begin ; y < y_end ; ++y) {
+			// edges that cross this row
+			active.clear();
+			for (const PolygonEdge& e : edges) {
+				if (max(e.y0, e.y1) > y && min(e.y0, e.y1) < y + 1) active.push_back(&e);
+			}
+			if (active.empty()) continue;
+			fill(cover.begin(), cover.end(), 0.0);
+			for (int s = 0 ; s < subsamples ; ++s) {
+				double sy = y + (s + 0.5) / subsamples;
+				crossings.clear();
+				for (const PolygonEdge* e : active) {
+					if ((e->y0 <= sy && sy < e->y1) || (e->y1 <= sy && sy < e->y0)) {
+						double x = e->x0 + (sy - e->y0) * (e->x1 - e->x0) / (e->y1 - e->y0);
+						crossings.push_back(make_pair(x, e->y1 > e->y0 ? 1 : -1));
+					}
+				}
+				sort(crossings.begin(), crossings.end());
+				// spans that are inside according to the fill rule
+				int winding = 0;
+				double span_start = 0;
+				for (auto& c : crossings) {
+					bool was_inside = rule == wxWINDING_RULE ? winding != 0 : (winding & 1) != 0;
+					winding += rule == wxWINDING_RULE ? c.second : 1;
+					bool is_inside  = rule == wxWINDING_RULE ? winding != 0 : (winding & 1) != 0;
+					if (!was_inside && is_inside) {
+						span_start = c.first;
+					} else if (was_inside && !is_inside) {
+						addSpan(cover, x_begin, x_end, span_start, c.first);
+					}
+				}
+			}
+			f(y, x_begin, x_end, &cover[0]);
+		}
+	}
+
+  private:
+	vector<PolygonEdge> edges;
+	double min_x, min_y, max_x, max_y; ///< Bounding box of the edges
+
+	void addEdge(const RealPoint& a, const RealPoint& b) {
+		if (a.y == b.y) return; // horizontal edges don't cross any sample lines
+		PolygonEdge e = {a.x, a.y, b.x, b.y};
+		edges.push_back(e);
+		min_x = min(min_x, min(a.x, b.x));
+		max_x = max(max_x, max(a.x, b.x));
+		min_y = min(min_y, min(a.y, b.y));
+		max_y = max(max_y, max(a.y, b.y));
+	}
+
+	/// Add the coverage of [a,b) on one sample line
+	static void addSpan(vector<double>& cover, int x_begin, int x_end, double a, double b) {
+		const double weight = 1.0 / subsamples;
+		a = max(a, (double)x_begin);
+		b = min(b, (double)x_end);
+		if (b <= a) return;
+		int ia = (int)floor(a), ib = (int)floor(b);
+		if (ia == ib) {
+			cover[ia - x_begin] += (b - a) * weight;
+			return;
+		}
+		cover[ia - x_begin] += (ia + 1 - a) * weight;
+		for (int i = ia + 1 ; i < ib ; ++i) {
+			cover[i - x_begin] += weight;
+		}
+		if (ib < x_end) cover[ib - x_begin] += (b - ib) * weight;
+	}
+};
+
+// ----------------------------------------------------------------------------- : Paths
+
+/// Add points on an elliptic arc, angles in radians, counterclockwise like wxDC::DrawEllipticArc
+void add_arc_points(vector<RealPoint>& points, double cx, double cy, double rx, double ry, double start, double end) {
+	int segments = (int)ceil(fabs(end - start) * max(1.0, max(rx, ry)) / 2); // segments of about 2 pixels
+	segments = max(4, min(1024, segments));
+	for (int i = 0 ; i <= segments ; ++i) {
+		double t = start + (end - start) * i / segments;
+		points.push_back(RealPoint(cx + rx * cos(t), cy - ry * sin(t)));
+	}
+}
+
+/// Add the corners of a rectangle with rounded corners of radius r
+void add_rounded_rectangle_points(vector<RealPoint>& points, double x, double y, double w, double h, double r) {
+	if (r <= 0) {
+		points.push_back(RealPoint(x,     y));
+		points.push_back(RealPoint(x + w, y));
+		points.push_back(RealPoint(x + w, y + h));
+		points.push_back(RealPoint(x,     y + h));
+		return;
+	}
+	add_arc_points(points, x + w - r, y + r,     r, r, 0,          M_PI * 0.5);
+	add_arc_points(points, x + r,     y + r,     r, r, M_PI * 0.5, M_PI);
+	add_arc_points(points, x + r,     y + h - r, r, r, M_PI,       M_PI * 1.5);
+	add_arc_points(points, x + w - r, y + h - r, r, r, M_PI * 1.5, M_PI * 2);
+}
+
+/// How the ends of a stroked path look
+enum StrokeEnds
+{	ENDS_LINE	///< Like wxDC::DrawLine: the line starts at the first point, and stops just before the last point
+,	ENDS_SQUARE	///< Extend the lines by half the pen width, so the corners of closed paths are covered
+,	ENDS_BUTT	///< The lines stop exactly at the first and last point, for the dashes of a dashed pen
+};
+
+/// Add the outline of a path as polygons, all with the same orientation, so they should be filled with wxWINDING_RULE
+void add_stroke(PolygonCoverage& coverage, const vector<RealPoint>& points, bool closed, double width, StrokeEnds ends) {
+	size_t n = points.size();
+	if (n == 0) return;
+	double half = width / 2;
+	vector<RealPoint> quad(4);
+	size_t segments = closed ? n : n - 1;
+	if (segments == 0) segments = 1; // a single point becomes a square
+	for (size_t i = 0 ; i < segments ; ++i) {
+		RealPoint a = points[i], b = points[(i + 1) % n];
+		RealPoint d = b - a;
+		double length = sqrt(d.x * d.x + d.y * d.y);
+		RealPoint u = length > 1e-9 ? d / length : RealPoint(1, 0);
+		if (ends == ENDS_LINE) {
+			a = a - u * 0.5;
+			b = b - u * 0.5;
+		} else if (ends == ENDS_SQUARE) {
+			a = a - u * half;
+			b = b + u * half;
+		} else if (length <= 1e-9) {
+			continue; // an empty dash
+		}
+		if (length <= 1e-9 && ends == ENDS_LINE) b = a + u;
+		RealPoint normal(-u.y * half, u.x * half);
+		quad[0] = a + normal;
+		quad[1] = b + normal;
+		quad[2] = b - normal;
+		quad[3] = a - normal;
+		coverage.addPolygon(quad);
+	}
+}
+
+// ----------------------------------------------------------------------------- : Dashes
+
+/// Lengths of the dashes and gaps of a pen, in device pixels
+/** The same lengths as the cairo graphics context of wxWidgets, in multiples of the pen width.
+ *  Returns an empty pattern for solid pens.
+ */
+vector<double> dash_pattern(const wxPen& pen, double width) {
+	vector<double> pattern;
+	switch (pen.GetStyle()) {
+		case wxPENSTYLE_DOT:        pattern = {1, 3};        break;
+		case wxPENSTYLE_LONG_DASH:  pattern = {19, 9};       break;
+		case wxPENSTYLE_SHORT_DASH: pattern = {9, 6};        break;
+		case wxPENSTYLE_DOT_DASH:   pattern = {9, 6, 3, 3};  break;
+		case wxPENSTYLE_USER_DASH: {
+			wxDash* dashes = nullptr;
+			int count = pen.GetDashes(&dashes);
+			for (int i = 0 ; i < count && dashes ; ++i) {
+				pattern.push_back(max(0, (int)dashes[i]));
+			}
+			break;
+		}
+		default: break;
+	}
+	// an odd number of lengths is repeated, so dashes and gaps alternate
+	if (pattern.size() % 2 == 1) pattern.insert(pattern.end(), pattern.begin(), pattern.end());
+	double total = 0;
+	for (double& length : pattern) {
+		length *= width;
+		total  += length;
+	}
+	if (total <= 1e-9) pattern.clear(); // would never end, draw solid instead
+	return pattern;
+}
+
+/// Split a path into the dashes of a dash pattern
+/** Even entries of the pattern are the lengths of dashes, odd entries the lengths of the gaps between them. */
+void split_dashes(const vector<RealPoint>& points, bool closed, const vector<double>& pattern, vector<vector<RealPoint> >& dashes) {
+	size_t n = points.size();
+	if (n < 2 || pattern.empty()) return;
+	size_t entry = 0;          // position in the pattern
+	double left  = pattern[0]; // length left of that entry
+	vector<RealPoint> dash(1, points[0]);
+	size_t segments = closed ? n : n - 1;
+	for (size_t i = 0 ; i < segments ; ++i) {
+		RealPoint a = points[i], b = points[(i + 1) % n];
+		RealPoint d = b - a;
+		double length = sqrt(d.x * d.x + d.y * d.y);
+		double pos = 0;
+		while (length - pos > left) {
+			// the current dash or gap ends on this segment
+			pos += left;
+			dash.push_back(a + d * (pos / length)); // end of this dash, or start of the next one
+			if (entry % 2 == 0) {
+				dashes.push_back(dash);
+				dash.clear();
+			}
+			entry = (entry + 1) % pattern.size();
+			left  = pattern[entry];
+		}
+		left -= length - pos;
+		if (entry % 2 == 0) dash.push_back(b);
+	}
+	if (entry % 2 == 0 && dash.size() >= 2) dashes.push_back(dash);
+}
+
+// ----------------------------------------------------------------------------- : Logical functions
+
+/// Apply a raster operation to a single color component
+inline int apply_logical_function(wxRasterOperationMode function, int src, int dst) {
+	switch (function) {
+		case wxCLEAR:       return 0;
+		case wxXOR:         return src ^ dst;
+		case wxINVERT:      return 255 - dst;
+		case wxOR_REVERSE:  return src | (255 - dst);
+		case wxAND_REVERSE: return src & (255 - dst);
+		case wxAND:         return src & dst;
+		case wxAND_INVERT:  return (255 - src) & dst;
+		case wxNO_OP:       return dst;
+		case wxNOR:         return 255 - (src | dst);
+		case wxEQUIV:       return 255 - (src ^ dst);
+		case wxSRC_INVERT:  return 255 - src;
+		case wxOR_INVERT:   return (255 - src) | dst;
+		case wxNAND:        return 255 - (src & dst);
+		case wxOR:          return src | dst;
+		case wxSET:         return 255;
+		default:            return src; // wxCOPY
+	}
+}
+
+// ----------------------------------------------------------------------------- : HeadlessDCImpl
+
+/// The implementation of HeadlessDC, all drawing functions of wxDC end up here
+class HeadlessDCImpl : public wxDCImpl {
+  public:
+	HeadlessDCImpl(HeadlessDC* owner, const Image& image)
+		: wxDCImpl(owner)
+		, image(image)
+	{
+		m_ok = image.Ok();
+	}
+
+	Image image; ///< The pixels
+
+	/// Draw an image at device coordinates
+	/** Uses the alpha channel and the mask of the image if requested, otherwise pixels are copied. */
+	void drawImage(const Image& img, int dx, int dy, bool use_alpha, bool use_mask);
+
+	// --------------------------------------------------- : wxDCImpl
+
+	virtual bool CanDrawBitmap() const    { return true; }
+	virtual bool CanGetTextExtent() const { return true; }
+	virtual void DoGetSize(int* width, int* height) const {
+		if (width)  *width  = image.GetWidth();
+		if (height) *height = image.GetHeight();
+	}
+	virtual int    GetDepth() const { return image.HasAlpha() ? 32 : 24; }
+	virtual wxSize GetPPI()   const { return wxSize(96, 96); }
+
+	virtual void SetFont(const wxFont& font)                  { m_font = font; }
+	virtual void SetPen(const wxPen& pen)                     { m_pen = pen; }
+	virtual void SetBrush(const wxBrush& brush)               { m_brush = brush; }
+	virtual void SetBackground(const wxBrush& brush)          { m_backgroundBrush = brush; }
+	virtual void SetBackgroundMode(int mode)                  { m_backgroundMode = mode; }
+	virtual void SetLogicalFunction(wxRasterOperationMode f)  { m_logicalFunction = f; }
+	#if wxUSE_PALETTE
+		virtual void SetPalette(const wxPalette&)             {}
+	#endif
+
+	virtual wxCoord GetCharHeight() const;
+	virtual wxCoord GetCharWidth() const;
+	virtual void DoGetTextExtent(const wxString& string, wxCoord* x, wxCoord* y, wxCoord* descent = nullptr,
+	                             wxCoord* externalLeading = nullptr, const wxFont* theFont = nullptr) const;
+
+	virtual void Clear();
+
+	virtual void DoSetClippingRegion(wxCoord x, wxCoord y, wxCoord width, wxCoord height);
+	virtual void DoSetDeviceClippingRegion(const wxRegion& region);
+	virtual void DestroyClippingRegion();
+
+	virtual bool DoFloodFill(wxCoord x, wxCoord y, const wxColour& col, wxFloodFillStyle style = wxFLOOD_SURFACE);
+	virtual bool DoGetPixel(wxCoord x, wxCoord y, wxColour* col) const;
+
+	virtual void DoDrawPoint(wxCoord x, wxCoord y);
+	virtual void DoDrawLine(wxCoord x1, wxCoord y1, wxCoord x2, wxCoord y2);
+	virtual void DoDrawArc(wxCoord x1, wxCoord y1, wxCoord x2, wxCoord y2, wxCoord xc, wxCoord yc);
+	virtual void DoDrawEllipticArc(wxCoord x, wxCoord y, wxCoord w, wxCoord h, double sa, double ea);
+	virtual void DoDrawRectangle(wxCoord x, wxCoord y, wxCoord width, wxCoord height);
+	virtual void DoDrawRoundedRectangle(wxCoord x, wxCoord y, wxCoord width, wxCoord height, double radius);
+	virtual void DoDrawEllipse(wxCoord x, wxCoord y, wxCoord width, wxCoord height);
+	virtual void DoCrossHair(wxCoord x, wxCoord y);
+	virtual void DoDrawLines(int n, const wxPoint points[], wxCoord xoffset, wxCoord yoffset);
+	virtual void DoDrawPolygon(int n, const wxPoint points[], wxCoord xoffset, wxCoord yoffset,
+	                           wxPolygonFillMode fillStyle = wxODDEVEN_RULE);
+	virtual void DoDrawPolyPolygon(int n, const int count[], const wxPoint points[], wxCoord xoffset, wxCoord yoffset,
+	                               wxPolygonFillMode fillStyle);
+
+	virtual void DoDrawIcon(const wxIcon& icon, wxCoord x, wxCoord y);
+	virtual void DoDrawBitmap(const wxBitmap& bmp, wxCoord x, wxCoord y, bool useMask = false);
+	virtual void DoDrawText(const wxString& text, wxCoord x, wxCoord y);
+	virtual void DoDrawRotatedText(const wxString& text, wxCoord x, wxCoord y, double angle);
+
+	virtual bool DoBlit(wxCoord xdest, wxCoord ydest, wxCoord width, wxCoord height,
+	                    wxDC* source, wxCoord xsrc, wxCoord ysrc,
+	                    wxRasterOperationMode rop = wxCOPY, bool useMask = false,
+	                    wxCoord xsrcMask = wxDefaultCoord, wxCoord ysrcMask = wxDefaultCoord);
+
+  private:
+	vector<wxRect> clip_rects;  ///< The clipping region in device coordinates, only used if m_clipping
+	wxRegion       clip_region;
+	mutable Image  measure_image; ///< Image for measure_gc
+	mutable scoped_ptr<wxGraphicsContext> measure_gc; ///< Graphics context for measuring text
+
+	// --------------------------------------------------- : Helpers
+
+	inline bool hasPen()   const { return m_pen.IsOk()   && !m_pen.IsTransparent(); }
+	inline bool hasBrush() const { return m_brush.IsOk() && !m_brush.IsTransparent(); }
+	/// Width of the pen in device pixels
+	inline double penWidth() const { return max(1.0, m_pen.GetWidth() * fabs(m_scaleX)); }
+	/// Center of a pixel, in device coordinates
+	inline RealPoint pixelCenter(wxCoord x, wxCoord y) const {
+		return RealPoint(LogicalToDeviceX(x) + 0.5, LogicalToDeviceY(y) + 0.5);
+	}
+	/// Rectangle in device coordinates, with a non-negative size
+	wxRect deviceRect(wxCoord x, wxCoord y, wxCoord width, wxCoord height) const;
+
+	/// Call f(x_begin, x_end) for the parts of a row of pixels that are inside the clipping region and the image
+	template <typename F> void forClippedSpans(int y, int x_begin, int x_end, F f) const {
+		if (y < 0 || y >= image.GetHeight()) return;
+		if (m_clipping) {
+			for (const wxRect& r : clip_rects) {
+				if (y < r.y || y >= r.y + r.height) continue;
+				int a = max(x_begin, r.x), b = min(x_end, r.x + r.width);
+				if (a < b) f(a, b);
+			}
+		} else {
+			int a = max(x_begin, 0), b = min(x_end, image.GetWidth());
+			if (a < b) f(a, b);
+		}
+	}
+
+	/// Blend a color into pixel (x,y) with the given opacity, using the logical function
+	inline void blendPixel(int x, int y, const Byte* color, int opacity) {
+		int i = y * image.GetWidth() + x;
+		Byte* p = image.GetData() + 3 * i;
+		Byte* a = image.GetAlpha();
+		wxRasterOperationMode function = (wxRasterOperationMode)m_logicalFunction;
+		if (a && function == wxCOPY) {
+			// 'over' for images with alpha
+			int alpha_out = opacity * 255 + a[i] * (255 - opacity);
+			if (alpha_out == 0) return;
+			for (int c = 0 ; c < 3 ; ++c) {
+				p[c] = (Byte)((color[c] * opacity * 255 + p[c] * a[i] * (255 - opacity) + alpha_out / 2) / alpha_out);
+			}
+			a[i] = (Byte)((alpha_out + 127) / 255);
+		} else if (opacity == 255 && function == wxCOPY) {
+			p[0] = color[0]; p[1] = color[1]; p[2] = color[2];
+		} else {
+			for (int c = 0 ; c < 3 ; ++c) {
+				int result = apply_logical_function(function, color[c], p[c]);
+				p[c] = (Byte)((p[c] * (255 - opacity) + result * opacity + 127) / 255);
+			}
+		}
+	}
+
+	/// Fill the area covered by polygons with a color
+	void fillCoverage(const PolygonCoverage& coverage, wxPolygonFillMode rule, const wxColour& colour);
+	/// Fill a polygon (device coordinates) with the brush
+	void fillPolygon(const vector<RealPoint>& points, wxPolygonFillMode rule = wxODDEVEN_RULE);
+	/// Draw a path (device coordinates) with the pen
+	void strokePath(const vector<RealPoint>& points, bool closed, StrokeEnds ends = ENDS_SQUARE);
+	/// Draw an elliptic arc or a pie, in device coordinates, angles in radians
+	void drawArc(double cx, double cy, double rx, double ry, double start, double end);
+
+	/// Make sure measure_gc exists, and uses the given font
+	wxGraphicsContext& measureContext(const wxFont& font) const;
+};
+
+// ----------------------------------------------------------------------------- : HeadlessDCImpl : Shapes
+
+wxRect HeadlessDCImpl::deviceRect(wxCoord x, wxCoord y, wxCoord width, wxCoord height) const {
+	int x1 = LogicalToDeviceX(x), x2 = LogicalToDeviceX(x + width);
+	int y1 = LogicalToDeviceY(y), y2 = LogicalToDeviceY(y + height);
+	if (x2 < x1) std::swap(x1, x2);
+	if (y2 < y1) std::swap(y1, y2);
+	return wxRect(x1, y1, x2 - x1, y2 - y1);
+}
+
+void HeadlessDCImpl::fillCoverage(const PolygonCoverage& coverage, wxPolygonFillMode rule, const wxColour& colour) {
+	if (!colour.IsOk()) return;
+	Byte color[3] = {colour.Red(), colour.Green(), colour.Blue()};
+	int alpha = colour.Alpha();
+	coverage.forEachRow(rule, image.GetWidth(), image.GetHeight(), [&](int y, int x_begin, int x_end, const double* cover) {
+		forClippedSpans(y, x_begin, x_end, [&](int a, int b) {
+			for (int x = a ; x < b ; ++x) {
+				int opacity = (int)(min(1.0, cover[x - x_begin]) * alpha + 0.5);
+				if (opacity > 0) blendPixel(x, y, color, opacity);
+			}
+		});
+	});
+}
+
+void HeadlessDCImpl::fillPolygon(const vector<RealPoint>& points, wxPolygonFillMode rule) {
+	if (!hasBrush() || points.size() < 3) return;
+	PolygonCoverage coverage;
+	coverage.addPolygon(points);
+	fillCoverage(coverage, rule, m_brush.GetColour());
+}
+
+void HeadlessDCImpl::strokePath(const vector<RealPoint>& points, bool closed, StrokeEnds ends) {
+	if (!hasPen()) return;
+	PolygonCoverage coverage;
+	vector<double> pattern = dash_pattern(m_pen, penWidth());
+	if (pattern.empty()) {
+		add_stroke(coverage, points, closed, penWidth(), ends);
+	} else {
+		vector<vector<RealPoint> > dashes;
+		split_dashes(points, closed, pattern, dashes);
+		for (auto& dash : dashes) {
+			add_stroke(coverage, dash, false, penWidth(), ENDS_BUTT);
+		}
+	}
+	fillCoverage(coverage, wxWINDING_RULE, m_pen.GetColour());
+}
+
+void HeadlessDCImpl::drawArc(double cx, double cy, double rx, double ry, double start, double end) {
+	bool full = fabs(end - start) < 1e-9;
+	if (full) {
+		end = start + 2 * M_PI;
+	} else {
+		while (end < start) end += 2 * M_PI;
+	}
+	// fill the pie, the arc goes through pixel centers
+	vector<RealPoint> points;
+	if (!full) points.push_back(RealPoint(cx, cy));
+	add_arc_points(points, cx, cy, rx + 0.5, ry + 0.5, start, end);
+	fillPolygon(points);
+	// outline, like wxGCDC: the edges of the pie are only drawn if it is filled
+	points.clear();
+	bool pie = !full && hasBrush();
+	if (pie) points.push_back(RealPoint(cx, cy));
+	add_arc_points(points, cx, cy, rx, ry, start, end);
+	strokePath(points, full || pie);
+}
+
+void HeadlessDCImpl::DoDrawPoint(wxCoord x, wxCoord y) {
+	if (!hasPen()) return;
+	wxColour colour = m_pen.GetColour();
+	Byte color[3] = {colour.Red(), colour.Green(), colour.Blue()};
+	int dx = LogicalToDeviceX(x), dy = LogicalToDeviceY(y);
+	forClippedSpans(dy, dx, dx + 1, [&](int a, int) {
+		blendPixel(a, dy, color, colour.Alpha());
+	});
+}
+
+void HeadlessDCImpl::DoDrawLine(wxCoord x1, wxCoord y1, wxCoord x2, wxCoord y2) {
+	vector<RealPoint> points;
+	points.push_back(pixelCenter(x1, y1));
+	points.push_back(pixelCenter(x2, y2));
+	strokePath(points, false, ENDS_LINE);
+}
+
+void HeadlessDCImpl::DoDrawLines(int n, const wxPoint points[], wxCoord xoffset, wxCoord yoffset) {
+	vector<RealPoint> path;
+	for (int i = 0 ; i < n ; ++i) {
+		path.push_back(pixelCenter(points[i].x + xoffset, points[i].y + yoffset));
+	}
+	strokePath(path, false, ENDS_LINE);
+}
+
+void HeadlessDCImpl::DoDrawPolygon(int n, const wxPoint points[], wxCoord xoffset, wxCoord yoffset, wxPolygonFillMode fillStyle) {
+	vector<RealPoint> path;
+	for (int i = 0 ; i < n ; ++i) {
+		path.push_back(pixelCenter(points[i].x + xoffset, points[i].y + yoffset));
+	}
+	fillPolygon(path, fillStyle);
+	strokePath(path, true);
+}
+
+void HeadlessDCImpl::DoDrawPolyPolygon(int n, const int count[], const wxPoint points[], wxCoord xoffset, wxCoord yoffset, wxPolygonFillMode fillStyle) {
+	// fill all polygons at once, so the fill rule applies to the combination
+	vector<vector<RealPoint> > paths(n);
+	PolygonCoverage coverage;
+	for (int i = 0, k = 0 ; i < n ; ++i) {
+		for (int j = 0 ; j < count[i] ; ++j, ++k) {
+			paths[i].push_back(pixelCenter(points[k].x + xoffset, points[k].y + yoffset));
+		}
+		coverage.addPolygon(paths[i]);
+	}
+	if (hasBrush()) fillCoverage(coverage, fillStyle, m_brush.GetColour());
+	for (auto& path : paths) {
+		strokePath(path, true);
+	}
+}
+
+void HeadlessDCImpl::DoDrawRectangle(wxCoord x, wxCoord y, wxCoord width, wxCoord height) {
+	DoDrawRoundedRectangle(x, y, width, height, 0);
+}
+
+void HeadlessDCImpl::DoDrawRoundedRectangle(wxCoord x, wxCoord y, wxCoord width, wxCoord height, double radius) {
+	wxRect r = deviceRect(x, y, width, height);
+	if (r.width <= 0 || r.height <= 0) return;
+	// a negative radius is a proportion of the smallest side
+	double rad = radius < 0 ? -radius * min(r.width, r.height) : radius * fabs(m_scaleX);
+	rad = min(rad, min(r.width, r.height) * 0.5);
+	// the fill covers all pixels, the outline goes through the centers of the outer pixels
+	vector<RealPoint> points;
+	add_rounded_rectangle_points(points, r.x, r.y, r.width, r.height, rad);
+	fillPolygon(points);
+	points.clear();
+	add_rounded_rectangle_points(points, r.x + 0.5, r.y + 0.5, r.width - 1, r.height - 1, max(0.0, rad - 0.5));
+	strokePath(points, true);
+}
+
+void HeadlessDCImpl::DoDrawEllipse(wxCoord x, wxCoord y, wxCoord width, wxCoord height) {
+	DoDrawEllipticArc(x, y, width, height, 0, 0);
+}
+
+void HeadlessDCImpl::DoDrawEllipticArc(wxCoord x, wxCoord y, wxCoord w, wxCoord h, double sa, double ea) {
+	wxRect r = deviceRect(x, y, w, h);
+	if (r.width <= 0 || r.height <= 0) return;
+	drawArc(r.x + r.width * 0.5, r.y + r.height * 0.5, (r.width - 1) * 0.5, (r.height - 1) * 0.5,
+	        sa * M_PI / 180, ea * M_PI / 180);
+}
+
+void HeadlessDCImpl::DoDrawArc(wxCoord x1, wxCoord y1, wxCoord x2, wxCoord y2, wxCoord xc, wxCoord yc) {
+	RealPoint p1 = pixelCenter(x1, y1), p2 = pixelCenter(x2, y2), c = pixelCenter(xc, yc);
+	double radius = sqrt((p1.x - c.x) * (p1.x - c.x) + (p1.y - c.y) * (p1.y - c.y));
+	double start = atan2(c.y - p1.y, p1.x - c.x);
+	double end   = atan2(c.y - p2.y, p2.x - c.x);
+	if (x1 == x2 && y1 == y2) end = start; // full circle
+	drawArc(c.x, c.y, radius, radius, start, end);
+}
+
+void HeadlessDCImpl::DoCrossHair(wxCoord x, wxCoord y) {
+	RealPoint c = pixelCenter(x, y);
+	vector<RealPoint> points(2);
+	points[0] = RealPoint(0, c.y);
+	points[1] = RealPoint(image.GetWidth(), c.y);
+	strokePath(points, false);
+	points[0] = RealPoint(c.x, 0);
+	points[1] = RealPoint(c.x, image.GetHeight());
+	strokePath(points, false);
+}
+
+bool HeadlessDCImpl::DoFloodFill(wxCoord x, wxCoord y, const wxColour& col, wxFloodFillStyle style) {
+	int w = image.GetWidth(), h = image.GetHeight();
+	int dx = LogicalToDeviceX(x), dy = LogicalToDeviceY(y);
+	if (!hasBrush() || dx < 0 || dy < 0 || dx >= w || dy >= h) return false;
+	// find the area first, filling it changes the colors that are compared
+	enum { UNKNOWN, FILL, BLOCKED };
+	vector<Byte> state(w * h, m_clipping ? BLOCKED : UNKNOWN);
+	for (const wxRect& r : clip_rects) {
+		for (int py = r.y ; py < r.y + r.height ; ++py) {
+			memset(&state[py * w + r.x], UNKNOWN, r.width);
+		}
+	}
+	const Byte* data = image.GetData();
+	Byte red = col.Red(), green = col.Green(), blue = col.Blue();
+	auto fillable = [&](int px, int py) -> bool {
+		int i = py * w + px;
+		if (state[i] != UNKNOWN) return false;
+		bool same = data[3*i] == red && data[3*i+1] == green && data[3*i+2] == blue;
+		// like wxDC: fill the area of color col, or the area bounded by col
+		return style == wxFLOOD_SURFACE ? same : !same;
+	};
+	if (!fillable(dx, dy)) return false;
+	// scanline fill
+	vector<wxPoint> todo(1, wxPoint(dx, dy));
+	while (!todo.empty()) {
+		wxPoint p = todo.back();
+		todo.pop_back();
+		if (!fillable(p.x, p.y)) continue;
+		int a = p.x, b = p.x + 1;
+		while (a > 0 && fillable(a - 1, p.y)) --a;
+		while (b < w && fillable(b, p.y))     ++b;
+		memset(&state[p.y * w + a], FILL, b - a);
+		// continue with the rows above and below, once for each run of fillable pixels
+		for (int ny = p.y - 1 ; ny <= p.y + 1 ; ny += 2) {
+			if (ny < 0 || ny >= h) continue;
+			for (int px = a ; px < b ; ++px) {
+				if (fillable(px, ny) && (px == a || !fillable(px - 1, ny))) todo.push_back(wxPoint(px, ny));
+			}
+		}
+	}
+	// fill it with the brush
+	wxColour colour = m_brush.GetColour();
+	Byte color[3] = {colour.Red(), colour.Green(), colour.Blue()};
+	for (int py = 0 ; py < h ; ++py) {
+		for (int px = 0 ; px < w ; ++px) {
+			if (state[py * w + px] == FILL) blendPixel(px, py, color, colour.Alpha());
+		}
+	}
+	return true;
+}
+
+bool HeadlessDCImpl::DoGetPixel(wxCoord x, wxCoord y, wxColour* col) const {
+	int dx = LogicalToDeviceX(x), dy = LogicalToDeviceY(y);
+	if (dx < 0 || dy < 0 || dx >= image.GetWidth() || dy >= image.GetHeight()) return false;
+	const Byte* p = image.GetData() + 3 * (dy * image.GetWidth() + dx);
+	col->Set(p[0], p[1], p[2], image.HasAlpha() ? image.GetAlpha()[dy * image.GetWidth() + dx] : 255);
+	return true;
+}
+
+void HeadlessDCImpl::Clear() {
+	wxColour colour = m_backgroundBrush.IsOk() ? m_backgroundBrush.GetColour() : *wxWHITE;
+	int n = image.GetWidth() * image.GetHeight();
+	Byte* p = image.GetData();
+	for (int i = 0 ; i < n ; ++i) {
+		p[3*i+0] = colour.Red();
+		p[3*i+1] = colour.Green();
+		p[3*i+2] = colour.Blue();
+	}
+	if (image.HasAlpha()) memset(image.GetAlpha(), colour.Alpha(), n);
+}
+
+// ----------------------------------------------------------------------------- : HeadlessDCImpl : Clipping
+
+void HeadlessDCImpl::DoSetClippingRegion(wxCoord x, wxCoord y, wxCoord width, wxCoord height) {
+	DoSetDeviceClippingRegion(wxRegion(deviceRect(x, y, width, height)));
+}
+
+void HeadlessDCImpl::DoSetDeviceClippingRegion(const wxRegion& region) {
+	// like other DCs, a new clipping region is intersected with the current one
+	wxRegion clip = region;
+	if (m_clipping) clip.Intersect(clip_region);
+	clip.Intersect(wxRect(0, 0, image.GetWidth(), image.GetHeight()));
+	clip_region = clip;
+	clip_rects.clear();
+	for (wxRegionIterator it(clip) ; it ; ++it) {
+		clip_rects.push_back(it.GetRect());
+	}
+	wxRect box = clip.GetBox();
+	m_clipping = true;
+	m_clipX1 = DeviceToLogicalX(box.x);
+	m_clipY1 = DeviceToLogicalY(box.y);
+	m_clipX2 = DeviceToLogicalX(box.x + box.width);
+	m_clipY2 = DeviceToLogicalY(box.y + box.height);
+}
+
+void HeadlessDCImpl::DestroyClippingRegion() {
+	clip_rects.clear();
+	clip_region.Clear();
+	ResetClipping();
+}
+
+// ----------------------------------------------------------------------------- : HeadlessDCImpl : Text
+
+wxGraphicsContext& HeadlessDCImpl::measureContext(const wxFont& font) const {
+	if (!measure_gc) {
+		measure_image = Image(1, 1);
+		measure_gc.reset(wxGraphicsContext::Create(measure_image));
+		if (!measure_gc) throw InternalError(_("Unable to create a graphics context for measuring text"));
+	}
+	measure_gc->SetFont(font, *wxBLACK);
+	return *measure_gc;
+}
+
+void HeadlessDCImpl::DoGetTextExtent(const wxString& string, wxCoord* x, wxCoord* y, wxCoord* descent, wxCoord* externalLeading, const wxFont* theFont) const {
+	const wxFont& font = theFont ? *theFont : m_font;
+	double w = 0, h = 0, d = 0, l = 0;
+	if (font.IsOk() && !string.empty()) {
+		measureContext(font).GetTextExtent(string, &w, &h, &d, &l);
+	}
+	if (x)               *x               = (wxCoord)ceil(w);
+	if (y)               *y               = (wxCoord)ceil(h);
+	if (descent)         *descent         = (wxCoord)ceil(d);
+	if (externalLeading) *externalLeading = (wxCoord)ceil(l);
+}
+
+wxCoord HeadlessDCImpl::GetCharHeight() const {
+	wxCoord h;
+	DoGetTextExtent(_("H"), nullptr, &h);
+	return h;
+}
+wxCoord HeadlessDCImpl::GetCharWidth() const {
+	wxCoord w;
+	DoGetTextExtent(_("x"), &w, nullptr);
+	return w;
+}
+
+void HeadlessDCImpl::DoDrawText(const wxString& text, wxCoord x, wxCoord y) {
+	DoDrawRotatedText(text, x, y, 0);
+}
+
+void HeadlessDCImpl::DoDrawRotatedText(const wxString& text, wxCoord x, wxCoord y, double angle) {
+	if (text.empty() || !m_font.IsOk()) return;
+	double w = 0, h = 0;
+	measureContext(m_font).GetTextExtent(text, &w, &h);
+	// size in device pixels, and the bounding box after rotating around the top left corner
+	double scale_x = fabs(m_scaleX), scale_y = fabs(m_scaleY);
+	double rad = angle * M_PI / 180, ca = cos(rad), sa = sin(rad);
+	double dw = w * scale_x, dh = h * scale_y;
+	RealPoint corners[4] = {RealPoint(0, 0), RealPoint(dw * ca, -dw * sa), RealPoint(dw * ca + dh * sa, dh * ca - dw * sa), RealPoint(dh * sa, dh * ca)};
+	double min_x = 0, min_y = 0, max_x = 0, max_y = 0;
+	for (const RealPoint& c : corners) {
+		min_x = min(min_x, c.x); max_x = max(max_x, c.x);
+		min_y = min(min_y, c.y); max_y = max(max_y, c.y);
+	}
+	int left  = (int)floor(min_x) - 1, top    = (int)floor(min_y) - 1;
+	int right = (int)ceil (max_x) + 1, bottom = (int)ceil (max_y) + 1;
+	int dx = LogicalToDeviceX(x), dy = LogicalToDeviceY(y);
+	// background
+	if (m_backgroundMode == wxSOLID && m_textBackgroundColour.IsOk()) {
+		PolygonCoverage coverage;
+		vector<RealPoint> points;
+		for (const RealPoint& c : corners) points.push_back(RealPoint(dx + c.x, dy + c.y));
+		coverage.addPolygon(points);
+		fillCoverage(coverage, wxODDEVEN_RULE, m_textBackgroundColour);
+	}
+	// draw white text on black, the red channel is then the coverage
+	Image buffer(right - left, bottom - top);
+	{
+		scoped_ptr<wxGraphicsContext> gc(wxGraphicsContext::Create(buffer));
+		if (!gc) throw InternalError(_("Unable to create a graphics context for drawing text"));
+		gc->Scale(scale_x, scale_y);
+		gc->SetFont(m_font, *wxWHITE);
+		gc->DrawText(text, -left / scale_x, -top / scale_y, rad);
+	} // the buffer is updated when the context is destroyed
+	const wxColour& colour = m_textForegroundColour;
+	Byte color[3] = {colour.Red(), colour.Green(), colour.Blue()};
+	int alpha = colour.Alpha();
+	int bw = buffer.GetWidth();
+	const Byte* coverage = buffer.GetData();
+	for (int by = 0 ; by < buffer.GetHeight() ; ++by) {
+		int ty = dy + top + by;
+		forClippedSpans(ty, dx + left, dx + left + bw, [&](int a, int b) {
+			for (int tx = a ; tx < b ; ++tx) {
+				int opacity = (coverage[3 * (by * bw + tx - dx - left)] * alpha + 127) / 255;
+				if (opacity > 0) blendPixel(tx, ty, color, opacity);
+			}
+		});
+	}
+}
+
+// ----------------------------------------------------------------------------- : HeadlessDCImpl : Bitmaps
+
+void HeadlessDCImpl::drawImage(const Image& img, int dx, int dy, bool use_alpha, bool use_mask) {
+	if (!img.Ok()) return;
+	int w = img.GetWidth();
+	const Byte* data  = img.GetData();
+	const Byte* alpha = use_alpha && img.HasAlpha() ? img.GetAlpha() : nullptr;
+	bool mask = use_mask && img.HasMask();
+	Byte mask_r = img.GetMaskRed(), mask_g = img.GetMaskGreen(), mask_b = img.GetMaskBlue();
+	for (int y = 0 ; y < img.GetHeight() ; ++y) {
+		int ty = dy + y;
+		forClippedSpans(ty, dx, dx + w, [&](int a, int b) {
+			for (int tx = a ; tx < b ; ++tx) {
+				int i = y * w + tx - dx;
+				const Byte* color = data + 3 * i;
+				int opacity = alpha ? alpha[i] : 255;
+				if (mask && color[0] == mask_r && color[1] == mask_g && color[2] == mask_b) opacity = 0;
+				if (opacity > 0) blendPixel(tx, ty, color, opacity);
+			}
+		});
+	}
+}
+
+void HeadlessDCImpl::DoDrawBitmap(const wxBitmap& bmp, wxCoord x, wxCoord y, bool useMask) {
+	if (!bmp.IsOk()) return;
+	drawImage(bmp.ConvertToImage(), LogicalToDeviceX(x), LogicalToDeviceY(y), true, useMask);
+}
+
+void HeadlessDCImpl::DoDrawIcon(const wxIcon& icon, wxCoord x, wxCoord y) {
+	wxBitmap bmp;
+	bmp.CopyFromIcon(icon);
+	DoDrawBitmap(bmp, x, y, true);
+}
+
+bool HeadlessDCImpl::DoBlit(wxCoord xdest, wxCoord ydest, wxCoord width, wxCoord height,
+                            wxDC* source, wxCoord xsrc, wxCoord ysrc,
+                            wxRasterOperationMode rop, bool useMask, wxCoord, wxCoord) {
+	if (!source) return false;
+	wxRect src_rect(source->LogicalToDeviceX(xsrc), source->LogicalToDeviceY(ysrc),
+	                abs(LogicalToDeviceXRel(width)), abs(LogicalToDeviceYRel(height)));
+	// get the source pixels
+	Image src;
+	if (HeadlessDC* headless = dynamic_cast<HeadlessDC*>(source)) {
+		src = headless->getSubImage(src_rect);
+	} else if (wxMemoryDC* memory = dynamic_cast<wxMemoryDC*>(source)) {
+		const wxBitmap& bmp = memory->GetSelectedBitmap();
+		if (!bmp.IsOk()) return false;
+		HeadlessDC copy(bmp.ConvertToImage());
+		src = copy.getSubImage(src_rect);
+	} else {
+		return false; // can't read pixels from other kinds of DCs
+	}
+	if (!src.Ok()) return true;
+	// draw with the raster operation
+	wxRasterOperationMode old_function = (wxRasterOperationMode)m_logicalFunction;
+	m_logicalFunction = rop;
+	drawImage(src, LogicalToDeviceX(xdest), LogicalToDeviceY(ydest), useMask, useMask);
+	m_logicalFunction = old_function;
+	return true;
+}
+
+// ----------------------------------------------------------------------------- : HeadlessDC
+
+HeadlessDC::HeadlessDC(int width, int height)
+	: wxDC(new HeadlessDCImpl(this, Image(width, height)))
+{}
+
+HeadlessDC::HeadlessDC(const Image& image)
+	: wxDC(new HeadlessDCImpl(this, image.Copy()))
+{}
+
+HeadlessDCImpl& HeadlessDC::impl() const {
+	return *static_cast<HeadlessDCImpl*>(m_pimpl);
+}
+
+Image& HeadlessDC::getImage() {
+	return impl().image;
+}
+
+Image HeadlessDC::getSubImage(const wxRect& rect) const {
+	if (rect.width <= 0 || rect.height <= 0) return Image();
+	const Image& img = impl().image;
+	Image sub(rect.width, rect.height); // black
+	if (img.HasAlpha()) {
+		sub.InitAlpha();
+		memset(sub.GetAlpha(), 0, rect.width * rect.height);
+	}
+	// the part that is inside the image
+	int x1 = max(rect.x, 0), x2 = min(rect.x + rect.width,  img.GetWidth());
+	int y1 = max(rect.y, 0), y2 = min(rect.y + rect.height, img.GetHeight());
+	for (int y = y1 ; y < y2 ; ++y) {
+		if (x1 >= x2) break;
+		int from = y * img.GetWidth() + x1, to = (y - rect.y) * rect.width + x1 - rect.x;
+		memcpy(sub.GetData() + 3 * to, img.GetData() + 3 * from, 3 * (x2 - x1));
+		if (img.HasAlpha()) memcpy(sub.GetAlpha() + to, img.GetAlpha() + from, x2 - x1);
+	}
+	return sub;
+}
+
+void HeadlessDC::DrawImage(const Image& image, int x, int y) {
+	impl().drawImage(image, x, y, true, true);
+}
+
+// ----------------------------------------------------------------------------- : Headless rendering
+
+bool headless_rendering() {
+	wxAppConsole* app = wxAppConsole::GetInstance();
+	return !app || !app->IsGUI();
+}
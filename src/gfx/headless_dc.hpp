@@ -0,0 +1,60 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) 2001 - 2012 Twan van Laarhoven and Sean Hunt             |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+#ifndef HEADER_GFX_HEADLESS_DC
+#define HEADER_GFX_HEADLESS_DC
+
+/** @file gfx/headless_dc.hpp
+ *
+ *  @brief A DC that draws into the pixels of an image, without the GUI toolkit.
+ *
+ *  Card images can be exported from the command line on a machine without a display.
+ *  In that case the GUI toolkit is not initialized, so wxMemoryDC can not be used,
+ *  everything is drawn on a HeadlessDC instead (see headless_rendering()).
+ */
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+
+class HeadlessDCImpl;
+
+// ----------------------------------------------------------------------------- : HeadlessDC
+
+/// A DC that draws into an image
+/** Shapes are filled and outlined anti-aliased, with solid brushes and solid or dashed pens.
+ *  Text is drawn with a wxGraphicsContext on an image, which doesn't need a display either.
+ *  Unlike a wxMemoryDC the pixels can be read back at any time, with getImage().
+ *
+ *  Blit accepts another HeadlessDC or a wxMemoryDC as the source.
+ */
+class HeadlessDC : public wxDC {
+  public:
+	/// Draw on a new black image
+	HeadlessDC(int width, int height);
+	/// Draw on a copy of an image
+	/** If the image has an alpha channel, that is drawn on as well. */
+	HeadlessDC(const Image& image);
+
+	/// The image that is drawn on
+	/** This is not a copy, later drawing changes it. */
+	Image& getImage();
+	/// Copy of a part of the image, parts outside the image are black
+	Image getSubImage(const wxRect& rect) const;
+	/// Draw an image at the given device coordinates, using its alpha channel or mask
+	/** Unlike DrawBitmap this doesn't go through a Bitmap. */
+	void DrawImage(const Image& image, int x, int y);
+
+  private:
+	HeadlessDCImpl& impl() const;
+};
+
+/// Should offscreen drawing use a HeadlessDC instead of a wxMemoryDC?
+/** This is the case when the GUI toolkit is not initialized, when exporting from the command line without a display. */
+bool headless_rendering();
+
+// ----------------------------------------------------------------------------- : EOF
+#endif
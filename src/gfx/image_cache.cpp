@@ -0,0 +1,303 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) 2001 - 2012 Twan van Laarhoven and Sean Hunt             |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <gfx/image_cache.hpp>
+#include <util/io/package.hpp>
+#include <util/version.hpp>
+#include <data/settings.hpp>
+#include <wx/dir.h>
+#include <wx/filename.h>
+#include <wx/wfstream.h>
+
+using std::make_pair;
+
+String user_settings_dir();
+
+// ----------------------------------------------------------------------------- : GeneratedImageCache : entries
+
+bool GeneratedImageCache::Entry::matches(const GeneratedImage& that, const GeneratedImage::Options& options, const String& that_package) const {
+	return width           == options.width
+	    && height          == options.height
+	    && zoom            == options.zoom
+	    && angle           == options.angle
+	    && preserve_aspect == options.preserve_aspect
+	    && saturate        == options.saturate
+	    && filter          == options.filter
+	    && package         == that_package
+	    && equal_images(*image, that);
+}
+
+size_t GeneratedImageCache::Entry::bytes() const {
+	size_t pixels = (size_t)result.GetWidth() * result.GetHeight();
+	return pixels * (result.HasAlpha() ? 4 : 3);
+}
+
+// ----------------------------------------------------------------------------- : GeneratedImageCache
+
+GeneratedImageCache generated_image_cache;
+
+GeneratedImageCache::GeneratedImageCache()
+	: total_bytes(0)
+	, disk_bytes(-1)
+{}
+
+size_t GeneratedImageCache::keyFor(const GeneratedImage& image, const GeneratedImage::Options& options, const String& package) {
+	size_t seed = image.hash();
+	hash_combine(seed, options.width);
+	hash_combine(seed, options.height);
+	hash_combine(seed, options.zoom);
+	hash_combine(seed, options.angle);
+	hash_combine(seed, (int)options.preserve_aspect);
+	hash_combine(seed, options.saturate);
+	hash_combine(seed, (int)options.filter);
+	hash_combine(seed, package);
+	return seed;
+}
+
+Image GeneratedImageCache::generate(const GeneratedImageP& image, const GeneratedImage::Options& options) {
+	if (image->usesLocal() || !options.package) {
+		// the image depends on the set, the key would not be good enough
+		return conform_image(image->generate(options), options);
+	}
+	String package = options.package->absoluteFilename();
+	size_t key = keyFor(*image, options, package);
+	// in memory?
+	{
+		wxMutexLocker lock(mutex);
+		Entries::iterator it = find(key, *image, options, package);
+		if (it != entries.end()) {
+			options.width  = it->result_width;
+			options.height = it->result_height;
+			return it->result.Copy();
+		}
+	}
+	Entry entry;
+	entry.key             = key;
+	entry.image           = image;
+	entry.width           = options.width;
+	entry.height          = options.height;
+	entry.zoom            = options.zoom;
+	entry.angle           = options.angle;
+	entry.preserve_aspect = options.preserve_aspect;
+	entry.saturate        = options.saturate;
+	entry.filter          = options.filter;
+	entry.package         = package;
+	// on disk? only unrotated images are stored, then the size before rotating is the image size
+	bool use_disk = settings.image_cache_on_disk && options.angle == 0;
+	String disk_key  = use_disk ? diskKey(*image, options, package) : String();
+	String disk_file = use_disk ? diskFilename(disk_key) : String();
+	if (use_disk && loadFromDisk(disk_file, disk_key, options, entry.result)) {
+		options.width  = entry.result.GetWidth();
+		options.height = entry.result.GetHeight();
+	}
+	// generate
+	if (!entry.result.Ok()) {
+		entry.result = conform_image(image->generate(options), options);
+		if (use_disk) storeOnDisk(disk_file, disk_key, entry.result);
+	}
+	entry.result_width  = options.width;
+	entry.result_height = options.height;
+	// the caller may modify the image in place, so it can not share the one in the cache
+	Image result = entry.result;
+	entry.result = entry.result.Copy();
+	{
+		wxMutexLocker lock(mutex);
+		if (find(key, *image, options, package) == entries.end()) {
+			insert(entry);
+			shrink();
+		}
+	}
+	return result;
+}
+
+void GeneratedImageCache::clear() {
+	wxMutexLocker lock(mutex);
+	index.clear();
+	entries.clear();
+	total_bytes = 0;
+}
+
+GeneratedImageCache::Entries::iterator GeneratedImageCache::find(size_t key, const GeneratedImage& image, const GeneratedImage::Options& options, const String& package) {
+	auto range = index.equal_range(key);
+	for (auto it = range.first ; it != range.second ; ++it) {
+		if (it->second->matches(image, options, package)) {
+			// most recently used
+			entries.splice(entries.begin(), entries, it->second);
+			return it->second;
+		}
+	}
+	return entries.end();
+}
+
+void GeneratedImageCache::insert(Entry& entry) {
+	entries.push_front(entry);
+	index.insert(make_pair(entry.key, entries.begin()));
+	total_bytes += entry.bytes();
+	// release our reference while the lock is held, the reference count of wxImage is not atomic
+	entry.result = Image();
+}
+
+void GeneratedImageCache::shrink() {
+	size_t max_bytes = (size_t)settings.image_cache_size * 1024 * 1024;
+	while (total_bytes > max_bytes && !entries.empty()) {
+		Entries::iterator last = --entries.end();
+		auto range = index.equal_range(last->key);
+		for (auto it = range.first ; it != range.second ; ++it) {
+			if (it->second == last) {
+				index.erase(it);
+				break;
+			}
+		}
+		total_bytes -= last->bytes();
+		entries.erase(last);
+	}
+}
+
+// ----------------------------------------------------------------------------- : GeneratedImageCache : disk
+
+/// Version of the disk cache file layout, files with another version are regenerated
+const wxUint32 IMAGE_CACHE_FORMAT = 1;
+const char IMAGE_CACHE_MAGIC[16] = "MSE image cache";
+
+/// Start of a file in the disk cache, followed by the key and the image in PNG format
+struct ImageCacheHeader {
+	char     magic[16];
+	wxUint32 format;
+	wxUint32 key_size;      ///< Size of the key in bytes, in UTF-8
+	wxUint32 width, height; ///< Size of the image
+};
+
+String GeneratedImageCache::diskKey(const GeneratedImage& image, const GeneratedImage::Options& options, const String& package) {
+	// images are regenerated when the package or the program changes
+	return String::Format(_("image %s %s\nsize %d %d\nzoom %.17g\naspect %d\nsaturate %d\nfilter %d\npackage %s\nmodified %s\nversion %s\n"),
+		wxULongLong((wxULongLong_t)image.hash()).ToString().c_str(), String(typeid(image).name(), wxConvLibc).c_str(),
+		options.width, options.height, options.zoom, (int)options.preserve_aspect, (int)options.saturate, (int)options.filter,
+		package.c_str(), options.package->lastModified().GetTicks().ToString().c_str(), app_version.toString().c_str());
+}
+
+String GeneratedImageCache::diskDirectory() {
+	String dir = user_settings_dir() + _("cache");
+	if (!wxDirExists(dir)) wxMkdir(dir);
+	dir += _("/render");
+	if (!wxDirExists(dir)) wxMkdir(dir);
+	return dir + _("/");
+}
+
+String GeneratedImageCache::diskFilename(const String& disk_key) {
+	size_t hash = 0;
+	hash_combine(hash, disk_key);
+	return diskDirectory() + wxULongLong((wxULongLong_t)hash).ToString() + _(".cache");
+}
+
+bool GeneratedImageCache::loadFromDisk(const String& filename, const String& disk_key, const GeneratedImage::Options& options, Image& image) {
+	if (!wxFileExists(filename)) return false;
+	wxLogNull noLog;
+	bool ok = false;
+	{
+		wxFileInputStream in(filename);
+		ok = in.IsOk() && readDiskFile(in, disk_key, options, image);
+	}
+	if (ok) {
+		wxFileName(filename).Touch(); // most recently used
+	} else {
+		// from an older version, or a different image with the same hash
+		image = Image();
+		wxRemoveFile(filename);
+	}
+	return ok;
+}
+
+bool GeneratedImageCache::readDiskFile(wxInputStream& in, const String& disk_key, const GeneratedImage::Options& options, Image& image) {
+	ImageCacheHeader header;
+	if (in.Read(&header, sizeof(header)).LastRead() != sizeof(header)) return false;
+	if (memcmp(header.magic, IMAGE_CACHE_MAGIC, sizeof(header.magic)) != 0 || header.format != IMAGE_CACHE_FORMAT) return false;
+	// the whole key must match, not just the hash in the filename
+	wxCharBuffer utf8 = disk_key.utf8_str();
+	size_t key_size = strlen(utf8);
+	if (header.key_size != key_size) return false;
+	vector<char> key(key_size);
+	if (key_size > 0 && in.Read(&key[0], key_size).LastRead() != key_size) return false;
+	if (memcmp(&key[0], utf8, key_size) != 0) return false;
+	// unless the aspect ratio is kept, images get exactly the requested size
+	if (options.preserve_aspect != ASPECT_FIT && options.width > 0 && options.height > 0
+	    && ((int)header.width != options.width || (int)header.height != options.height)) return false;
+	if (!image.LoadFile(in, wxBITMAP_TYPE_PNG)) return false;
+	if (image.GetWidth() != (int)header.width || image.GetHeight() != (int)header.height) return false;
+	if (image.HasMask()) image.InitAlpha(); // we can't handle masks
+	return true;
+}
+
+void GeneratedImageCache::storeOnDisk(const String& filename, const String& disk_key, const Image& image) {
+	wxLogNull noLog;
+	ImageCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, IMAGE_CACHE_MAGIC, sizeof(header.magic));
+	wxCharBuffer utf8 = disk_key.utf8_str();
+	header.format   = IMAGE_CACHE_FORMAT;
+	header.key_size = (wxUint32)strlen(utf8);
+	header.width    = image.GetWidth();
+	header.height   = image.GetHeight();
+	// write to a temporary file first, other threads or instances may be reading the same image
+	String temp_file = wxFileName::CreateTempFileName(diskDirectory() + _("new"));
+	if (temp_file.empty()) return;
+	bool ok;
+	{
+		wxFileOutputStream out(temp_file);
+		ok = out.IsOk()
+		  && out.Write(&header, sizeof(header)).LastWrite() == sizeof(header)
+		  && out.Write(utf8, header.key_size).LastWrite() == header.key_size
+		  && image.SaveFile(out, wxBITMAP_TYPE_PNG)
+		  && out.Close();
+	}
+	if (!ok || !wxRenameFile(temp_file, filename, true)) {
+		wxRemoveFile(temp_file);
+		return;
+	}
+	wxULongLong size = wxFileName::GetSize(filename);
+	if (size == wxInvalidSize) return;
+	wxMutexLocker lock(disk_mutex);
+	if (disk_bytes < 0) {
+		// count the files from earlier sessions, this includes the new file
+		shrinkDisk();
+	} else {
+		disk_bytes += size.GetValue();
+		if (disk_bytes > (wxInt64)settings.image_cache_disk_size * 1024 * 1024) shrinkDisk();
+	}
+}
+
+void GeneratedImageCache::shrinkDisk() {
+	struct File {
+		String     name;
+		wxDateTime modified;
+		wxInt64    size;
+		bool operator < (const File& that) const { return modified < that.modified; }
+	};
+	String dir = diskDirectory();
+	wxDir d(dir);
+	disk_bytes = 0;
+	if (!d.IsOpened()) return;
+	vector<File> files;
+	String name;
+	for (bool ok = d.GetFirst(&name, _("*.cache"), wxDIR_FILES) ; ok ; ok = d.GetNext(&name)) {
+		File file;
+		file.name = dir + name;
+		wxULongLong size = wxFileName::GetSize(file.name);
+		if (size == wxInvalidSize || !wxFileName(file.name).GetTimes(0, &file.modified, 0)) continue;
+		file.size = size.GetValue();
+		disk_bytes += file.size;
+		files.push_back(file);
+	}
+	// remove least recently used files, leave some room so we don't have to do this for every new image
+	wxInt64 max_bytes = (wxInt64)settings.image_cache_disk_size * 1024 * 1024;
+	if (disk_bytes <= max_bytes) return;
+	sort(files.begin(), files.end());
+	for (vector<File>::const_iterator it = files.begin() ; it != files.end() && disk_bytes > max_bytes / 4 * 3 ; ++it) {
+		if (wxRemoveFile(it->name)) disk_bytes -= it->size;
+	}
+}
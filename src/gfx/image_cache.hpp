@@ -0,0 +1,105 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) 2001 - 2012 Twan van Laarhoven and Sean Hunt             |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+#ifndef HEADER_GFX_IMAGE_CACHE
+#define HEADER_GFX_IMAGE_CACHE
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <gfx/generated_image.hpp>
+#include <wx/thread.h>
+#include <list>
+#include <unordered_map>
+
+// ----------------------------------------------------------------------------- : GeneratedImageCache
+
+/// A process wide cache of generated images
+/** Many cards use images that are structurally the same, for example the same frame
+ *  blended from the same packaged images. This cache makes sure such an image is only generated once.
+ *
+ *  Entries are keyed on GeneratedImage::hash() and the options, and are compared with operator ==.
+ *  The least recently used images are dropped when the cache grows larger than settings.image_cache_size.
+ *  If settings.image_cache_on_disk is set, images are also stored in the user's cache directory,
+ *  keyed on the modification time of the package, so they survive between sessions.
+ *  Each file starts with the full key, which is checked when the image is loaded.
+ *  The least recently loaded files are removed when they take more than settings.image_cache_disk_size.
+ *
+ *  Images that are local to a set are not cached, they are rarely shared between cards.
+ *
+ *  Can be used from multiple threads.
+ */
+class GeneratedImageCache {
+  public:
+	GeneratedImageCache();
+
+	/// Generate an image, or get it from the cache
+	/** Same as conform_image(image->generate(options), options).
+	 *  Returns a copy that can be modified by the caller.
+	 */
+	Image generate(const GeneratedImageP& image, const GeneratedImage::Options& options);
+
+	/// Remove all images from the (in memory) cache
+	/** *must* be called at application exit, and when packages are reloaded */
+	void clear();
+
+  private:
+	/// An image in the cache
+	struct Entry {
+		size_t          key;
+		GeneratedImageP image;
+		int             width, height; ///< Requested size
+		double          zoom;
+		Radians         angle;
+		PreserveAspect  preserve_aspect;
+		bool            saturate;
+		ResampleFilter  filter;
+		String          package;       ///< Absolute filename of the package to load images from
+		Image           result;
+		int             result_width, result_height; ///< Size of the result before rotating
+
+		bool matches(const GeneratedImage& image, const GeneratedImage::Options& options, const String& package) const;
+		size_t bytes() const;
+	};
+	typedef std::list<Entry> Entries;
+
+	wxMutex mutex;
+	Entries entries; ///< Most recently used first
+	std::unordered_multimap<size_t, Entries::iterator> index;
+	size_t  total_bytes;
+	wxMutex disk_mutex;
+	wxInt64 disk_bytes; ///< Size of the files in the disk cache, -1 if they have not been counted yet
+
+	/// Key of an image with the given options
+	static size_t keyFor(const GeneratedImage& image, const GeneratedImage::Options& options, const String& package);
+	/// Find an entry in the cache, moves it to the front; call with the mutex locked
+	Entries::iterator find(size_t key, const GeneratedImage& image, const GeneratedImage::Options& options, const String& package);
+	/// Move an entry to the front of the cache; call with the mutex locked
+	void insert(Entry& entry);
+	/// Drop old entries until the cache is small enough; call with the mutex locked
+	void shrink();
+
+	/// Key of an image in the disk cache, stored in the file
+	/** The structure of the image is only known by its hash, everything else is stored verbatim */
+	static String diskKey(const GeneratedImage& image, const GeneratedImage::Options& options, const String& package);
+	/// Directory of the disk cache
+	static String diskDirectory();
+	/// Filename of the image in the disk cache
+	static String diskFilename(const String& disk_key);
+	/// Load an image from the disk cache, if it is there and has the right key; removes bad files
+	static bool loadFromDisk(const String& filename, const String& disk_key, const GeneratedImage::Options& options, Image& image);
+	static bool readDiskFile(wxInputStream& in, const String& disk_key, const GeneratedImage::Options& options, Image& image);
+	/// Store an image in the disk cache, removes old files if the cache becomes too large
+	void storeOnDisk(const String& filename, const String& disk_key, const Image& image);
+	/// Count the files in the disk cache, remove the least recently used ones if there are too many; call with disk_mutex locked
+	void shrinkDisk();
+};
+
+/// The global generated image cache
+extern GeneratedImageCache generated_image_cache;
+
+// ----------------------------------------------------------------------------- : EOF
+#endif
@@ -8,6 +8,7 @@
 
 #include <util/prec.hpp>
 #include <gfx/gfx.hpp>
+#include <gfx/pixel_kernels.hpp>
 #include <util/error.hpp>
 
 using std::max;
@@ -16,8 +17,6 @@ using std::min;
 // ----------------------------------------------------------------------------- : Saturation
 
 void saturate(Image& image, double amount) {
-	Byte* pix = image.GetData();
-	Byte* end = pix + image.GetWidth() * image.GetHeight() * 3;
 	// the formula for saturation is
 	//   rgb' = (rgb - amount * avg) / (1 - amount)
 	// if amount >= 1 then this is some kind of inversion
@@ -26,41 +25,35 @@ void saturate(Image& image, double amount) {
 	//   rgb = rgb' + -amount*avg - -amount*rgb'
 	//       = rgb' * (1 - -amount) + -amount*avg
 	// if amount < -1 then we are left with just the average
+	// each case is of the form  rgb' = col((rgb * mul + (r+g+b) * sum_mul) / div)
 	int factor = int(256 * amount);
+	int mul, sum_mul, div;
 	if (factor == 0) {
 		return; // nothing to do
 	} else if (factor == 256) {
 		// super crazy saturation: division by zero
 		// if we take infty to be 255, then it is a >avg test
-		while (pix != end) {
-			int r = pix[0], g = pix[1], b = pix[2];
-			pix[0] = r+r > g+b ? 255 : 0;
-			pix[1] = g+g > b+r ? 255 : 0;
-			pix[2] = b+b > r+g ? 255 : 0;
-			pix += 3;
-		}
+		//   3*rgb > r+g+b ? 255 : 0
+		mul = 765; sum_mul = -255; div = 1;
 	} else if (factor > 0) {
-		int div = 768 - 3 * factor;
+		mul = 768; sum_mul = -factor; div = 768 - 3 * factor;
 		assert(div > 0);
-		while (pix != end) {
-			int r = pix[0], g = pix[1], b = pix[2];
-			int avg = factor*(r+g+b);
-			pix[0] = col((768*r - avg) / div);
-			pix[1] = col((768*g - avg) / div);
-			pix[2] = col((768*b - avg) / div);
-			pix += 3;
-		}
 	} else {
-		int factor1 = -factor;
-		int factor2 = 768 - 3*factor1;
-		while (pix != end) {
-			int r = pix[0], g = pix[1], b = pix[2];
-			int avg = factor1*(r+g+b);
-			pix[0] = (factor2*r + avg) / 768;
-			pix[1] = (factor2*g + avg) / 768;
-			pix[2] = (factor2*b + avg) / 768;
-			pix += 3;
+		int factor1 = min(-factor, 256);
+		mul = 768 - 3 * factor1; sum_mul = factor1; div = 768;
+	}
+	const PixelKernels* simd = div > 0 ? pixel_kernels_simd() : nullptr;
+	Byte* pix = image.GetData();
+	size_t row = (size_t)image.GetWidth() * 3;
+	vector<int> sums(row); // sum_mul * (r+g+b) for each byte in the row
+	for (int y = 0 ; y < image.GetHeight() ; ++y) {
+		for (size_t x = 0 ; x < row ; x += 3) {
+			sums[x] = sums[x + 1] = sums[x + 2] = sum_mul * (pix[x] + pix[x + 1] + pix[x + 2]);
 		}
+		size_t done = 0;
+		if (simd) done = simd->affine(pix, mul, sums.data(), div, row);
+		pixel_kernels_plain.affine(pix + done, mul, sums.data() + done, div, row - done);
+		pix += row;
 	}
 }
 
@@ -68,10 +61,10 @@ void saturate(Image& image, double amount) {
 
 void invert(Image& img) {
 	Byte* data = img.GetData();
-	int n = 3 * img.GetWidth() * img.GetHeight();
-	for (int i = 0 ; i < n ; ++i) {
-		data[i] = 255 - data[i];
-	}
+	size_t n = 3 * img.GetWidth() * img.GetHeight();
+	size_t done = 0;
+	if (const PixelKernels* simd = pixel_kernels_simd()) done = simd->invert(data, n);
+	pixel_kernels_plain.invert(data + done, n - done);
 }
 
 // ----------------------------------------------------------------------------- : Coloring symbol images
@@ -0,0 +1,142 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) 2001 - 2012 Twan van Laarhoven and Sean Hunt             |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <gfx/gfx.hpp>
+#include <gfx/color.hpp>
+#include <gfx/pixel_kernels.hpp>
+#include <algorithm>
+
+using namespace std;
+
+// ----------------------------------------------------------------------------- : Combining functions
+
+// Functor for combining functions for a given combining type
+template <ImageCombine combine> struct Combine {
+	static inline int f(int a, int b);
+};
+
+// Give a combining function for enum value 'combine'
+#define COMBINE_FUN(combine,fun)	\
+	template <> int Combine<combine>::f(int a, int b) { return fun; }
+
+// Based on
+//  http://www.pegtop.net/delphi/articles/blendmodes/
+
+COMBINE_FUN(COMBINE_NORMAL,		b													)
+COMBINE_FUN(COMBINE_ADD,		top(a + b)											)
+COMBINE_FUN(COMBINE_SUBTRACT,	bot(a - b)											)
+COMBINE_FUN(COMBINE_STAMP,		col(a - 2 * b + 256)								)
+COMBINE_FUN(COMBINE_DIFFERENCE,	abs(a - b)											)
+COMBINE_FUN(COMBINE_NEGATION,	255 - abs(255 - a - b)								)
+COMBINE_FUN(COMBINE_MULTIPLY,	(a * b) / 255										)
+COMBINE_FUN(COMBINE_DARKEN,		min(a, b)											)
+COMBINE_FUN(COMBINE_LIGHTEN,	max(a, b)											)
+COMBINE_FUN(COMBINE_COLOR_DODGE,b == 255 ? 255 : top(a * 255 / (255 - b))			)
+COMBINE_FUN(COMBINE_COLOR_BURN,	b == 0   ? 0   : bot(255 - (255-a) * 255 / b)		)
+COMBINE_FUN(COMBINE_SCREEN,		255 - (((255 - a) * (255 - b)) / 255)				)
+COMBINE_FUN(COMBINE_OVERLAY,	a < 128
+									? (a * b) >> 7
+									: 255 - (((255 - a) * (255 - b)) >> 7)			)
+COMBINE_FUN(COMBINE_HARD_LIGHT,	b < 128
+									? (a * b) >> 7
+									: 255 - (((255 - a) * (255 - b)) >> 7)			)
+COMBINE_FUN(COMBINE_SOFT_LIGHT,	b)
+COMBINE_FUN(COMBINE_REFLECT,	b == 255 ? 255 : top(a * a / (255 - b))				)
+COMBINE_FUN(COMBINE_GLOW,		a == 255 ? 255 : top(b * b / (255 - a))				)
+COMBINE_FUN(COMBINE_FREEZE,		b == 0 ? 0 : bot(255 - (255 - a) * (255 - a) / b)	)
+COMBINE_FUN(COMBINE_HEAT,		a == 0 ? 0 : bot(255 - (255 - b) * (255 - b) / a)	)
+COMBINE_FUN(COMBINE_AND,		a & b												)
+COMBINE_FUN(COMBINE_OR,			a | b												)
+COMBINE_FUN(COMBINE_XOR,		a ^ b												)
+COMBINE_FUN(COMBINE_SHADOW,		(b * a * a) / (255 * 255)							)
+COMBINE_FUN(COMBINE_SYMMETRIC_OVERLAY,	(Combine<COMBINE_OVERLAY>::f(a,b) + Combine<COMBINE_OVERLAY>::f(b,a)) / 2 )
+
+// ----------------------------------------------------------------------------- : Plain kernels
+
+template <ImageCombine combine>
+size_t combine_plain(Byte* a, const Byte* b, size_t n) {
+	for (size_t i = 0 ; i < n ; ++i) {
+		a[i] = Combine<combine>::f(a[i], b[i]);
+	}
+	return n;
+}
+
+size_t mask_blend_plain(Byte* a, const Byte* b, const Byte* mask, size_t n) {
+	for (size_t i = 0 ; i < n ; ++i) {
+		a[i] = (a[i] * mask[i] + b[i] * (255 - mask[i])) / 255;
+	}
+	return n;
+}
+
+size_t scale_plain(Byte* a, Byte factor, size_t n) {
+	for (size_t i = 0 ; i < n ; ++i) {
+		a[i] = (a[i] * factor) / 255;
+	}
+	return n;
+}
+
+size_t invert_plain(Byte* a, size_t n) {
+	for (size_t i = 0 ; i < n ; ++i) {
+		a[i] = 255 - a[i];
+	}
+	return n;
+}
+
+size_t lerp_plain(Byte* a, const Byte* b, const int* t, size_t n) {
+	for (size_t i = 0 ; i < n ; ++i) {
+		a[i] = a[i] + t[i] * (b[i] - a[i]) / 65536;
+	}
+	return n;
+}
+
+size_t affine_plain(Byte* a, int mul, const int* add, int div, size_t n) {
+	for (size_t i = 0 ; i < n ; ++i) {
+		a[i] = col((a[i] * mul + add[i]) / div);
+	}
+	return n;
+}
+
+const PixelKernels pixel_kernels_plain = {
+	combine_plain<COMBINE_ADD>,
+	combine_plain<COMBINE_SUBTRACT>,
+	combine_plain<COMBINE_STAMP>,
+	combine_plain<COMBINE_DIFFERENCE>,
+	combine_plain<COMBINE_NEGATION>,
+	combine_plain<COMBINE_MULTIPLY>,
+	combine_plain<COMBINE_DARKEN>,
+	combine_plain<COMBINE_LIGHTEN>,
+	combine_plain<COMBINE_COLOR_DODGE>,
+	combine_plain<COMBINE_COLOR_BURN>,
+	combine_plain<COMBINE_SCREEN>,
+	combine_plain<COMBINE_OVERLAY>,
+	combine_plain<COMBINE_HARD_LIGHT>,
+	combine_plain<COMBINE_SOFT_LIGHT>,
+	combine_plain<COMBINE_REFLECT>,
+	combine_plain<COMBINE_GLOW>,
+	combine_plain<COMBINE_FREEZE>,
+	combine_plain<COMBINE_HEAT>,
+	combine_plain<COMBINE_AND>,
+	combine_plain<COMBINE_OR>,
+	combine_plain<COMBINE_XOR>,
+	combine_plain<COMBINE_SHADOW>,
+	combine_plain<COMBINE_SYMMETRIC_OVERLAY>,
+	mask_blend_plain,
+	scale_plain,
+	invert_plain,
+	lerp_plain,
+	affine_plain,
+};
+
+// ----------------------------------------------------------------------------- : Dispatch
+
+void combine_bytes(PixelKernels::Combine PixelKernels::* kernel, Byte* a, const Byte* b, size_t n) {
+	size_t done = 0;
+	if (const PixelKernels* simd = pixel_kernels_simd()) done = (simd->*kernel)(a, b, n);
+	(pixel_kernels_plain.*kernel)(a + done, b + done, n - done);
+}
@@ -0,0 +1,74 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) 2001 - 2012 Twan van Laarhoven and Sean Hunt             |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+#ifndef HEADER_GFX_PIXEL_KERNELS
+#define HEADER_GFX_PIXEL_KERNELS
+
+/** @file gfx/pixel_kernels.hpp
+ *
+ *  @brief Loops over raw image data, for combining and blending images.
+ *
+ *  There is a plain version of each loop, and versions that use SSE2 or AVX2.
+ *  The SIMD versions are in their own source files, which are compiled with those instruction sets enabled,
+ *  and they are only used if the processor supports them (see simd_level()).
+ *  All versions give exactly the same results.
+ *
+ *  The SIMD source files only include this header and the intrinsics, no wxWidgets or other headers with inline functions,
+ *  otherwise the linker could pick a copy of such a function that was compiled with instructions the processor doesn't have.
+ */
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <stddef.h>
+
+// ----------------------------------------------------------------------------- : PixelKernels
+
+/// A set of loops over raw image data
+/** The plain kernels process all n bytes.
+ *  The SIMD kernels process a multiple of the vector size (or of a quarter of it, for lerp and affine),
+ *  and return how many bytes they have processed, the remaining bytes should be processed with the plain kernel.
+ */
+struct PixelKernels {
+	/// a[i] = combine(a[i], b[i]), returns the number of bytes processed
+	typedef size_t (*Combine)(unsigned char* a, const unsigned char* b, size_t n);
+
+	Combine add, subtract, stamp, difference, negation, multiply, darken, lighten;
+	Combine color_dodge, color_burn, screen, overlay, hard_light, soft_light, reflect, glow, freeze, heat;
+	Combine bit_and, bit_or, bit_xor, shadow, symmetric_overlay;
+
+	/// a[i] = (a[i] * mask[i] + b[i] * (255 - mask[i])) / 255
+	size_t (*mask_blend)(unsigned char* a, const unsigned char* b, const unsigned char* mask, size_t n);
+	/// a[i] = a[i] * factor / 255
+	size_t (*scale)(unsigned char* a, unsigned char factor, size_t n);
+	/// a[i] = 255 - a[i]
+	size_t (*invert)(unsigned char* a, size_t n);
+	/// a[i] = a[i] + t[i] * (b[i] - a[i]) / 65536, for 0 <= t[i] <= 65536
+	size_t (*lerp)(unsigned char* a, const unsigned char* b, const int* t, size_t n);
+	/// a[i] = col((a[i] * mul + add[i]) / div)
+	/** The SIMD versions require div >= 1 and |a[i] * mul + add[i]| + div < 2^24 */
+	size_t (*affine)(unsigned char* a, int mul, const int* add, int div, size_t n);
+};
+
+/// Plain kernels, these process all bytes
+extern const PixelKernels pixel_kernels_plain;
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+	#define HAVE_X86_PIXEL_KERNELS 1
+	/// Kernels using SSE2, only use these if simd_level() >= SIMD_SSE2
+	extern const PixelKernels pixel_kernels_sse2;
+	/// Kernels using AVX2, only use these if simd_level() >= SIMD_AVX2
+	extern const PixelKernels pixel_kernels_avx2;
+#else
+	#define HAVE_X86_PIXEL_KERNELS 0
+#endif
+
+/// The fastest kernels that can be used on this processor, or nullptr if there are only plain ones
+const PixelKernels* pixel_kernels_simd();
+
+/// Combine a and b with the given kernel, using SIMD instructions if possible
+void combine_bytes(PixelKernels::Combine PixelKernels::* kernel, unsigned char* a, const unsigned char* b, size_t n);
+
+// ----------------------------------------------------------------------------- : EOF
+#endif
@@ -0,0 +1,81 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) 2001 - 2012 Twan van Laarhoven and Sean Hunt             |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// ----------------------------------------------------------------------------- : Includes
+
+// Compiled with AVX2 enabled (see CMakeLists.txt), so this file must not include util/prec.hpp,
+// see gfx/pixel_kernels.hpp.
+#include <gfx/pixel_kernels.hpp>
+
+#if HAVE_X86_PIXEL_KERNELS
+#include <immintrin.h>
+
+// ----------------------------------------------------------------------------- : Vector type
+
+/// Vectors of 32 bytes, for pixel_kernels_simd.hpp
+struct VecAVX2 {
+	typedef __m256i I;
+	typedef __m256  F;
+	static const size_t size = 32;
+
+	static inline I    loadu(const unsigned char* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+	static inline void storeu(unsigned char* p, I x) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), x); }
+	static inline I setzero()           { return _mm256_setzero_si256(); }
+	static inline I set1_epi8(char x)   { return _mm256_set1_epi8(x); }
+	static inline I set1_epi16(short x) { return _mm256_set1_epi16(x); }
+	static inline F set1_ps(float x)    { return _mm256_set1_ps(x); }
+	// bitwise
+	static inline I and_  (I a, I b) { return _mm256_and_si256(a, b); }
+	static inline I or_   (I a, I b) { return _mm256_or_si256(a, b); }
+	static inline I xor_  (I a, I b) { return _mm256_xor_si256(a, b); }
+	static inline I andnot(I a, I b) { return _mm256_andnot_si256(a, b); }
+	// bytes
+	static inline I adds_epu8(I a, I b) { return _mm256_adds_epu8(a, b); }
+	static inline I subs_epu8(I a, I b) { return _mm256_subs_epu8(a, b); }
+	static inline I min_epu8 (I a, I b) { return _mm256_min_epu8(a, b); }
+	static inline I max_epu8 (I a, I b) { return _mm256_max_epu8(a, b); }
+	static inline I unpacklo_epu8(I a)  { return _mm256_unpacklo_epi8(a, _mm256_setzero_si256()); }
+	static inline I unpackhi_epu8(I a)  { return _mm256_unpackhi_epi8(a, _mm256_setzero_si256()); }
+	// 16 bit numbers
+	static inline I packus_epi16(I a, I b) { return _mm256_packus_epi16(a, b); }
+	static inline I add_epi16   (I a, I b) { return _mm256_add_epi16(a, b); }
+	static inline I sub_epi16   (I a, I b) { return _mm256_sub_epi16(a, b); }
+	static inline I mullo_epi16 (I a, I b) { return _mm256_mullo_epi16(a, b); }
+	static inline I mulhi_epu16 (I a, I b) { return _mm256_mulhi_epu16(a, b); }
+	static inline I min_epi16   (I a, I b) { return _mm256_min_epi16(a, b); }
+	static inline I cmpeq_epi16 (I a, I b) { return _mm256_cmpeq_epi16(a, b); }
+	static inline I cmplt_epi16 (I a, I b) { return _mm256_cmpgt_epi16(b, a); }
+	template <int n> static inline I srli_epi16(I a) { return _mm256_srli_epi16(a, n); }
+	static inline I unpacklo_epu16(I a) { return _mm256_unpacklo_epi16(a, _mm256_setzero_si256()); }
+	static inline I unpackhi_epu16(I a) { return _mm256_unpackhi_epi16(a, _mm256_setzero_si256()); }
+	// 32 bit numbers and floats
+	static inline I loadu_epi32(const int* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+	static inline I loadu_epu8_epi32(const unsigned char* p) {
+		return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+	}
+	static inline void storeu_epi32_epu8(unsigned char* p, I x) {
+		// the 256 bit pack works within 128 bit lanes, so pack the two halves instead
+		__m128i y = _mm_packs_epi32(_mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1));
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_packus_epi16(y, y));
+	}
+	static inline I packs_epi32(I a, I b) { return _mm256_packs_epi32(a, b); }
+	static inline F cvtepi32_ps(I a)      { return _mm256_cvtepi32_ps(a); }
+	static inline I cvttps_epi32(F a)     { return _mm256_cvttps_epi32(a); }
+	static inline F add_ps  (F a, F b) { return _mm256_add_ps(a, b); }
+	static inline F mul_ps  (F a, F b) { return _mm256_mul_ps(a, b); }
+	static inline F div_ps  (F a, F b) { return _mm256_div_ps(a, b); }
+	static inline F sub_ps  (F a, F b) { return _mm256_sub_ps(a, b); }
+	static inline F and_ps  (F a, F b) { return _mm256_and_ps(a, b); }
+	static inline F cmpgt_ps(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+};
+
+// ----------------------------------------------------------------------------- : Kernels
+
+#include <gfx/pixel_kernels_simd.hpp>
+
+const PixelKernels pixel_kernels_avx2 = PIXEL_KERNELS_SIMD(VecAVX2);
+
+#endif
@@ -0,0 +1,278 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) 2001 - 2012 Twan van Laarhoven and Sean Hunt             |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+#ifndef HEADER_GFX_PIXEL_KERNELS_SIMD
+#define HEADER_GFX_PIXEL_KERNELS_SIMD
+
+/** @file gfx/pixel_kernels_simd.hpp
+ *
+ *  @brief The kernels of gfx/pixel_kernels.hpp, for any vector type.
+ *
+ *  Only included by the source files for a single instruction set, which define a vector type V with:
+ *   - V::size: the number of bytes in a vector
+ *   - V::I, V::F: vectors of integers and of 32 bit floats
+ *   - operations on bytes, on 16 bit and 32 bit numbers and on floats, named after the SSE2 intrinsics.
+ *   - loadu_epu8_epi32 and storeu_epi32_epu8: convert between V::size/4 bytes and a vector of 32 bit numbers,
+ *     in the same order. Storing clamps the numbers to [0..255].
+ *  For vectors wider than 128 bits, the unpack and pack operations work within each 128 bit lane,
+ *  since unpacking and then packing again gives the original order, that doesn't matter here.
+ *
+ *  Everything is in an anonymous namespace, so each instruction set gets its own copy.
+ */
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <gfx/pixel_kernels.hpp>
+
+namespace {
+
+// ----------------------------------------------------------------------------- : Arithmetic
+
+/// Divide each 16 bit number by 255, rounding down
+/** Only correct for 0 <= x <= 255*255, which is all that is needed for multiplying bytes. */
+template <typename V> inline typename V::I div255_epu16(typename V::I x) {
+	// x / 255 == (x * 0x8081) >> 23  in this range
+	return V::template srli_epi16<7>(V::mulhi_epu16(x, V::set1_epi16((short)0x8081)));
+}
+
+/// 255 - x for each byte
+template <typename V> inline typename V::I invert_epu8(typename V::I x) {
+	return V::xor_(x, V::set1_epi8((char)0xFF));
+}
+
+/// floor(x / y) for whole numbers with 0 <= x and 1 <= y, and x + y < 2^24
+/** Floats represent these numbers exactly, and the division is correctly rounded,
+ *  so the truncated quotient is either the right answer or one too large.
+ */
+template <typename V> inline typename V::F div_floor_ps(typename V::F x, typename V::F y) {
+	typename V::F q = V::cvtepi32_ps(V::cvttps_epi32(V::div_ps(x, y)));
+	return V::sub_ps(q, V::and_ps(V::cmpgt_ps(V::mul_ps(q, y), x), V::set1_ps(1.0f)));
+}
+
+/// floor(x / y) for each unsigned 16 bit number, y must be at least 1
+/** Results above 32767 become 32767. */
+template <typename V> inline typename V::I div_epu16(typename V::I x, typename V::I y) {
+	typename V::F lo = div_floor_ps<V>(V::cvtepi32_ps(V::unpacklo_epu16(x)), V::cvtepi32_ps(V::unpacklo_epu16(y)));
+	typename V::F hi = div_floor_ps<V>(V::cvtepi32_ps(V::unpackhi_epu16(x)), V::cvtepi32_ps(V::unpackhi_epu16(y)));
+	return V::packs_epi32(V::cvttps_epi32(lo), V::cvttps_epi32(hi));
+}
+
+/// select ? a : b, for each bit
+template <typename V> inline typename V::I select_bits(typename V::I select, typename V::I a, typename V::I b) {
+	return V::or_(V::and_(select, a), V::andnot(select, b));
+}
+
+// ----------------------------------------------------------------------------- : Combining functions
+
+// Functor for combining a vector of bytes, gives the same results as Combine<combine>::f
+template <typename V, typename Op> struct CombineBytes {
+	static inline typename V::I f(typename V::I a, typename V::I b) { return Op::f(a, b); }
+};
+// Functor for combining a vector of bytes, using a function on 16 bit numbers
+template <typename V, typename Op> struct CombineWords {
+	static inline typename V::I f(typename V::I a, typename V::I b) {
+		return V::packus_epi16(Op::f(V::unpacklo_epu8(a), V::unpacklo_epu8(b)),
+		                       Op::f(V::unpackhi_epu8(a), V::unpackhi_epu8(b)));
+	}
+};
+
+// Give a combining function, a and b are vectors of bytes
+#define COMBINE_SIMD_FUN(name,fun)	\
+	template <typename V> struct name##_op {	\
+		typedef typename V::I I;	\
+		static inline I f(I a, I b) { return fun; }	\
+	};	\
+	template <typename V> struct name : CombineBytes<V, name##_op<V> > {};
+// Give a combining function, a and b are vectors of 16 bit numbers in the range [0..255]
+// Results outside [0..255] are clamped
+#define COMBINE_SIMD_FUN16(name,fun)	\
+	template <typename V> struct name##_op {	\
+		typedef typename V::I I;	\
+		static inline I f(I a, I b) { return fun; }	\
+	};	\
+	template <typename V> struct name : CombineWords<V, name##_op<V> > {};
+
+template <typename V> inline typename V::I overlay_epu16(typename V::I a, typename V::I b) {
+	// a < 128 ? (a * b) >> 7 : 255 - (((255 - a) * (255 - b)) >> 7)
+	typename V::I c255 = V::set1_epi16(255);
+	typename V::I lo = V::template srli_epi16<7>(V::mullo_epi16(a, b));
+	typename V::I hi = V::sub_epi16(c255, V::template srli_epi16<7>(V::mullo_epi16(V::sub_epi16(c255,a), V::sub_epi16(c255,b))));
+	return select_bits<V>(V::cmplt_epi16(a, V::set1_epi16(128)), lo, hi);
+}
+template <typename V> inline typename V::I multiply_epu16(typename V::I a, typename V::I b) {
+	return div255_epu16<V>(V::mullo_epi16(a, b));
+}
+// b == 255 ? 255 : top(x / (255 - b))
+template <typename V> inline typename V::I dodge_epu16(typename V::I x, typename V::I b) {
+	typename V::I c255 = V::set1_epi16(255);
+	typename V::I is_255 = V::cmpeq_epi16(b, c255);
+	typename V::I y = V::sub_epi16(c255, V::andnot(is_255, b)); // avoid dividing by 0
+	return select_bits<V>(is_255, c255, div_epu16<V>(x, y)); // results above 255 are clamped when packing
+}
+// b == 0 ? 0 : bot(255 - x / b)
+template <typename V> inline typename V::I burn_epu16(typename V::I x, typename V::I b) {
+	typename V::I is_0 = V::cmpeq_epi16(b, V::setzero());
+	typename V::I y = V::sub_epi16(b, is_0); // avoid dividing by 0, is_0 is -1
+	return V::andnot(is_0, V::sub_epi16(V::set1_epi16(255), div_epu16<V>(x, y)));
+}
+template <typename V> inline typename V::I reflect_epu16(typename V::I a, typename V::I b) {
+	return dodge_epu16<V>(V::mullo_epi16(a, a), b);
+}
+template <typename V> inline typename V::I freeze_epu16(typename V::I a, typename V::I b) {
+	typename V::I na = V::sub_epi16(V::set1_epi16(255), a);
+	return burn_epu16<V>(V::mullo_epi16(na, na), b);
+}
+// (b * a * a) / (255 * 255), b * a * a doesn't fit in 16 bits
+template <typename V> inline typename V::I shadow_epu16(typename V::I a, typename V::I b) {
+	typename V::I aa = V::mullo_epi16(a, a);
+	typename V::F d  = V::set1_ps(255.0f * 255.0f);
+	typename V::F lo = div_floor_ps<V>(V::mul_ps(V::cvtepi32_ps(V::unpacklo_epu16(aa)), V::cvtepi32_ps(V::unpacklo_epu16(b))), d);
+	typename V::F hi = div_floor_ps<V>(V::mul_ps(V::cvtepi32_ps(V::unpackhi_epu16(aa)), V::cvtepi32_ps(V::unpackhi_epu16(b))), d);
+	return V::packs_epi32(V::cvttps_epi32(lo), V::cvttps_epi32(hi));
+}
+
+COMBINE_SIMD_FUN  (CombineAdd,			V::adds_epu8(a, b)											)
+COMBINE_SIMD_FUN  (CombineSubtract,		V::subs_epu8(a, b)											)
+COMBINE_SIMD_FUN16(CombineStamp,		V::sub_epi16(V::add_epi16(a, V::set1_epi16(256)), V::add_epi16(b, b)))
+COMBINE_SIMD_FUN  (CombineDifference,	V::or_(V::subs_epu8(a, b), V::subs_epu8(b, a))				)
+COMBINE_SIMD_FUN16(CombineNegation,		V::min_epi16(V::add_epi16(a, b), V::sub_epi16(V::set1_epi16(510), V::add_epi16(a, b))))
+COMBINE_SIMD_FUN16(CombineMultiply,		multiply_epu16<V>(a, b)										)
+COMBINE_SIMD_FUN  (CombineDarken,		V::min_epu8(a, b)											)
+COMBINE_SIMD_FUN  (CombineLighten,		V::max_epu8(a, b)											)
+COMBINE_SIMD_FUN16(CombineColorDodge,	dodge_epu16<V>(V::mullo_epi16(a, V::set1_epi16(255)), b)	)
+COMBINE_SIMD_FUN16(CombineColorBurn,	burn_epu16<V>(V::mullo_epi16(V::sub_epi16(V::set1_epi16(255), a), V::set1_epi16(255)), b))
+COMBINE_SIMD_FUN  (CombineScreen,		invert_epu8<V>(CombineMultiply<V>::f(invert_epu8<V>(a), invert_epu8<V>(b))))
+COMBINE_SIMD_FUN16(CombineOverlay,		overlay_epu16<V>(a, b)										)
+COMBINE_SIMD_FUN16(CombineHardLight,	overlay_epu16<V>(b, a)										)
+COMBINE_SIMD_FUN  (CombineSoftLight,	b															)
+COMBINE_SIMD_FUN16(CombineReflect,		reflect_epu16<V>(a, b)										)
+COMBINE_SIMD_FUN16(CombineGlow,			reflect_epu16<V>(b, a)										)
+COMBINE_SIMD_FUN16(CombineFreeze,		freeze_epu16<V>(a, b)										)
+COMBINE_SIMD_FUN16(CombineHeat,			freeze_epu16<V>(b, a)										)
+COMBINE_SIMD_FUN  (CombineAnd,			V::and_(a, b)												)
+COMBINE_SIMD_FUN  (CombineOr,			V::or_(a, b)												)
+COMBINE_SIMD_FUN  (CombineXor,			V::xor_(a, b)												)
+COMBINE_SIMD_FUN16(CombineShadow,		shadow_epu16<V>(a, b)										)
+COMBINE_SIMD_FUN16(CombineSymmetricOverlay, V::template srli_epi16<1>(V::add_epi16(overlay_epu16<V>(a, b), overlay_epu16<V>(b, a))))
+
+// ----------------------------------------------------------------------------- : Kernels
+
+template <typename V, typename Combine>
+size_t combine_simd(unsigned char* a, const unsigned char* b, size_t n) {
+	size_t i = 0;
+	for ( ; i + V::size <= n ; i += V::size) {
+		V::storeu(a + i, Combine::f(V::loadu(a + i), V::loadu(b + i)));
+	}
+	return i;
+}
+
+template <typename V>
+size_t mask_blend_simd(unsigned char* a, const unsigned char* b, const unsigned char* mask, size_t n) {
+	size_t i = 0;
+	for ( ; i + V::size <= n ; i += V::size) {
+		typename V::I x = V::loadu(a + i), y = V::loadu(b + i);
+		typename V::I m = V::loadu(mask + i), nm = invert_epu8<V>(m);
+		typename V::I lo = V::add_epi16(V::mullo_epi16(V::unpacklo_epu8(x), V::unpacklo_epu8(m)),
+		                                V::mullo_epi16(V::unpacklo_epu8(y), V::unpacklo_epu8(nm)));
+		typename V::I hi = V::add_epi16(V::mullo_epi16(V::unpackhi_epu8(x), V::unpackhi_epu8(m)),
+		                                V::mullo_epi16(V::unpackhi_epu8(y), V::unpackhi_epu8(nm)));
+		V::storeu(a + i, V::packus_epi16(div255_epu16<V>(lo), div255_epu16<V>(hi)));
+	}
+	return i;
+}
+
+template <typename V>
+size_t scale_simd(unsigned char* a, unsigned char factor, size_t n) {
+	typename V::I factor16 = V::set1_epi16(factor);
+	size_t i = 0;
+	for ( ; i + V::size <= n ; i += V::size) {
+		typename V::I x = V::loadu(a + i);
+		V::storeu(a + i, V::packus_epi16(multiply_epu16<V>(V::unpacklo_epu8(x), factor16),
+		                                 multiply_epu16<V>(V::unpackhi_epu8(x), factor16)));
+	}
+	return i;
+}
+
+template <typename V>
+size_t invert_simd(unsigned char* a, size_t n) {
+	size_t i = 0;
+	for ( ; i + V::size <= n ; i += V::size) {
+		V::storeu(a + i, invert_epu8<V>(V::loadu(a + i)));
+	}
+	return i;
+}
+
+// The factors of these kernels are 32 bit numbers, so they work on V::size/4 bytes at a time, using floats.
+// All intermediate results are whole numbers below 2^24, so they are exact.
+
+template <typename V>
+size_t lerp_simd(unsigned char* a, const unsigned char* b, const int* t, size_t n) {
+	typedef typename V::F F;
+	F scale = V::set1_ps(1.0f / 65536);
+	size_t i = 0;
+	for ( ; i + V::size / 4 <= n ; i += V::size / 4) {
+		F x = V::cvtepi32_ps(V::loadu_epu8_epi32(a + i));
+		F y = V::cvtepi32_ps(V::loadu_epu8_epi32(b + i));
+		F w = V::cvtepi32_ps(V::loadu_epi32(t + i));
+		// dividing by a power of two is exact, truncating rounds towards zero like integer division
+		F d = V::cvtepi32_ps(V::cvttps_epi32(V::mul_ps(V::mul_ps(w, V::sub_ps(y, x)), scale)));
+		V::storeu_epi32_epu8(a + i, V::cvttps_epi32(V::add_ps(x, d)));
+	}
+	return i;
+}
+
+template <typename V>
+size_t affine_simd(unsigned char* a, int mul, const int* add, int div, size_t n) {
+	typedef typename V::F F;
+	F mul_f = V::set1_ps((float)mul), div_f = V::set1_ps((float)div);
+	size_t i = 0;
+	for ( ; i + V::size / 4 <= n ; i += V::size / 4) {
+		F x = V::add_ps(V::mul_ps(V::cvtepi32_ps(V::loadu_epu8_epi32(a + i)), mul_f), V::cvtepi32_ps(V::loadu_epi32(add + i)));
+		// for x < 0 this doesn't round like integer division, but the result is <= 0 either way, and clamped to 0
+		V::storeu_epi32_epu8(a + i, V::cvttps_epi32(div_floor_ps<V>(x, div_f)));
+	}
+	return i;
+}
+
+} // namespace
+
+/// All kernels for vector type V, as an initializer for a PixelKernels
+/** This is not a function, so the kernels are initialized statically,
+ *  without running any code that was compiled for an instruction set that the processor might not have.
+ */
+#define PIXEL_KERNELS_SIMD(V)	{	\
+		combine_simd<V, CombineAdd<V> >,	\
+		combine_simd<V, CombineSubtract<V> >,	\
+		combine_simd<V, CombineStamp<V> >,	\
+		combine_simd<V, CombineDifference<V> >,	\
+		combine_simd<V, CombineNegation<V> >,	\
+		combine_simd<V, CombineMultiply<V> >,	\
+		combine_simd<V, CombineDarken<V> >,	\
+		combine_simd<V, CombineLighten<V> >,	\
+		combine_simd<V, CombineColorDodge<V> >,	\
+		combine_simd<V, CombineColorBurn<V> >,	\
+		combine_simd<V, CombineScreen<V> >,	\
+		combine_simd<V, CombineOverlay<V> >,	\
+		combine_simd<V, CombineHardLight<V> >,	\
+		combine_simd<V, CombineSoftLight<V> >,	\
+		combine_simd<V, CombineReflect<V> >,	\
+		combine_simd<V, CombineGlow<V> >,	\
+		combine_simd<V, CombineFreeze<V> >,	\
+		combine_simd<V, CombineHeat<V> >,	\
+		combine_simd<V, CombineAnd<V> >,	\
+		combine_simd<V, CombineOr<V> >,	\
+		combine_simd<V, CombineXor<V> >,	\
+		combine_simd<V, CombineShadow<V> >,	\
+		combine_simd<V, CombineSymmetricOverlay<V> >,	\
+		mask_blend_simd<V>,	\
+		scale_simd<V>,	\
+		invert_simd<V>,	\
+		lerp_simd<V>,	\
+		affine_simd<V>,	\
+	}
+
+// ----------------------------------------------------------------------------- : EOF
+#endif
@@ -0,0 +1,82 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) 2001 - 2012 Twan van Laarhoven and Sean Hunt             |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// ----------------------------------------------------------------------------- : Includes
+
+// Compiled with SSE2 enabled (see CMakeLists.txt), so this file must not include util/prec.hpp,
+// see gfx/pixel_kernels.hpp.
+#include <gfx/pixel_kernels.hpp>
+
+#if HAVE_X86_PIXEL_KERNELS
+#include <emmintrin.h>
+
+// ----------------------------------------------------------------------------- : Vector type
+
+/// Vectors of 16 bytes, for pixel_kernels_simd.hpp
+struct VecSSE2 {
+	typedef __m128i I;
+	typedef __m128  F;
+	static const size_t size = 16;
+
+	static inline I    loadu(const unsigned char* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+	static inline void storeu(unsigned char* p, I x) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), x); }
+	static inline I setzero()           { return _mm_setzero_si128(); }
+	static inline I set1_epi8(char x)   { return _mm_set1_epi8(x); }
+	static inline I set1_epi16(short x) { return _mm_set1_epi16(x); }
+	static inline F set1_ps(float x)    { return _mm_set1_ps(x); }
+	// bitwise
+	static inline I and_  (I a, I b) { return _mm_and_si128(a, b); }
+	static inline I or_   (I a, I b) { return _mm_or_si128(a, b); }
+	static inline I xor_  (I a, I b) { return _mm_xor_si128(a, b); }
+	static inline I andnot(I a, I b) { return _mm_andnot_si128(a, b); }
+	// bytes
+	static inline I adds_epu8(I a, I b) { return _mm_adds_epu8(a, b); }
+	static inline I subs_epu8(I a, I b) { return _mm_subs_epu8(a, b); }
+	static inline I min_epu8 (I a, I b) { return _mm_min_epu8(a, b); }
+	static inline I max_epu8 (I a, I b) { return _mm_max_epu8(a, b); }
+	static inline I unpacklo_epu8(I a)  { return _mm_unpacklo_epi8(a, _mm_setzero_si128()); }
+	static inline I unpackhi_epu8(I a)  { return _mm_unpackhi_epi8(a, _mm_setzero_si128()); }
+	// 16 bit numbers
+	static inline I packus_epi16(I a, I b) { return _mm_packus_epi16(a, b); }
+	static inline I add_epi16   (I a, I b) { return _mm_add_epi16(a, b); }
+	static inline I sub_epi16   (I a, I b) { return _mm_sub_epi16(a, b); }
+	static inline I mullo_epi16 (I a, I b) { return _mm_mullo_epi16(a, b); }
+	static inline I mulhi_epu16 (I a, I b) { return _mm_mulhi_epu16(a, b); }
+	static inline I min_epi16   (I a, I b) { return _mm_min_epi16(a, b); }
+	static inline I cmpeq_epi16 (I a, I b) { return _mm_cmpeq_epi16(a, b); }
+	static inline I cmplt_epi16 (I a, I b) { return _mm_cmplt_epi16(a, b); }
+	template <int n> static inline I srli_epi16(I a) { return _mm_srli_epi16(a, n); }
+	static inline I unpacklo_epu16(I a) { return _mm_unpacklo_epi16(a, _mm_setzero_si128()); }
+	static inline I unpackhi_epu16(I a) { return _mm_unpackhi_epi16(a, _mm_setzero_si128()); }
+	// 32 bit numbers and floats
+	static inline I loadu_epi32(const int* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+	static inline I loadu_epu8_epi32(const unsigned char* p) {
+		I x = _mm_cvtsi32_si128((int)(p[0] | p[1] << 8 | p[2] << 16 | (unsigned)p[3] << 24));
+		return _mm_unpacklo_epi16(_mm_unpacklo_epi8(x, _mm_setzero_si128()), _mm_setzero_si128());
+	}
+	static inline void storeu_epi32_epu8(unsigned char* p, I x) {
+		int y = _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packs_epi32(x, x), x));
+		p[0] = (unsigned char)y;         p[1] = (unsigned char)(y >> 8);
+		p[2] = (unsigned char)(y >> 16); p[3] = (unsigned char)(y >> 24);
+	}
+	static inline I packs_epi32(I a, I b) { return _mm_packs_epi32(a, b); }
+	static inline F cvtepi32_ps(I a)      { return _mm_cvtepi32_ps(a); }
+	static inline I cvttps_epi32(F a)     { return _mm_cvttps_epi32(a); }
+	static inline F add_ps  (F a, F b) { return _mm_add_ps(a, b); }
+	static inline F mul_ps  (F a, F b) { return _mm_mul_ps(a, b); }
+	static inline F div_ps  (F a, F b) { return _mm_div_ps(a, b); }
+	static inline F sub_ps  (F a, F b) { return _mm_sub_ps(a, b); }
+	static inline F and_ps  (F a, F b) { return _mm_and_ps(a, b); }
+	static inline F cmpgt_ps(F a, F b) { return _mm_cmpgt_ps(a, b); }
+};
+
+// ----------------------------------------------------------------------------- : Kernels
+
+#include <gfx/pixel_kernels_simd.hpp>
+
+const PixelKernels pixel_kernels_sse2 = PIXEL_KERNELS_SIMD(VecSSE2);
+
+#endif
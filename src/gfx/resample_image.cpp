@@ -8,9 +8,16 @@
 
 #include <util/prec.hpp>
 #include <gfx/gfx.hpp>
+#include <gfx/simd.hpp>
 #include <util/error.hpp>
+#include <util/reflect.hpp>
+#include <util/parallel.hpp>
+#include <wx/thread.h>
+#include <map>
 
 using std::min;
+using std::max;
+using std::vector;
 
 // ----------------------------------------------------------------------------- : Resample passes
 
@@ -28,16 +35,17 @@ const int shift = 32-10-8; // => max size = 1024, max alpha = 255
  *  line_delta = number of elements between the the first pixel of two lines
  *  1 element = 3 bytes in data, 1 byte in alpha
  */
-void resample_pass(const Image& img_in, Image& img_out, int offset_in, int offset_out,
-                   int length_in, int delta_in, int length_out, int delta_out,
-                   int lines, int line_delta_in, int line_delta_out)
+/* Only lines [line_begin..line_end) are done, so the lines can be split over threads.
+ */
+void resample_pass_lines(const Image& img_in, Image& img_out, int offset_in, int offset_out,
+                         int length_in, int delta_in, int length_out, int delta_out,
+                         int line_begin, int line_end, int line_delta_in, int line_delta_out)
 {
 	bool alpha = img_in.HasAlpha();
-	if (alpha && !img_out.HasAlpha()) img_out.InitAlpha();
 	int out_fact = (length_out << shift) / length_in; // how much to output for 256 input = 1 pixel
 	int out_rest = (length_out << shift) % length_in;
 	// for each line
-	for (int l = 0 ; l < lines ; ++l) {
+	for (int l = line_begin ; l < line_end ; ++l) {
 		Byte* in  = img_in .GetData() + 3 * (offset_in  + l * line_delta_in);
 		Byte* out = img_out.GetData() + 3 * (offset_out + l * line_delta_out);
 		UInt in_rem = out_fact + out_rest; // remaining to input from the current input pixel
@@ -110,6 +118,251 @@ void resample_pass(const Image& img_in, Image& img_out, int offset_in, int offse
 	}
 }
 
+/// Amount of input pixels that make it worthwile to start another thread
+const int min_pixels_per_thread = 256 * 1024;
+
+// Resample an image only in a single direction, large images are split over multiple threads
+void resample_pass(const Image& img_in, Image& img_out, int offset_in, int offset_out,
+                   int length_in, int delta_in, int length_out, int delta_out,
+                   int lines, int line_delta_in, int line_delta_out)
+{
+	if (img_in.HasAlpha() && !img_out.HasAlpha()) img_out.InitAlpha();
+	parallel_for_ranges(lines, max(16, min_pixels_per_thread / max(1,length_in)), [&](int begin, int end) {
+		resample_pass_lines(img_in, img_out, offset_in, offset_out, length_in, delta_in, length_out, delta_out,
+		                    begin, end, line_delta_in, line_delta_out);
+	});
+}
+
+// ----------------------------------------------------------------------------- : Filtered resampling
+
+IMPLEMENT_REFLECTION_ENUM(ResampleFilter) {
+	VALUE_N("box",      RESAMPLE_BOX);
+	VALUE_N("bilinear", RESAMPLE_BILINEAR);
+	VALUE_N("lanczos3", RESAMPLE_LANCZOS3);
+}
+
+// bits after the point in the fixed point filter weights
+const int weight_shift = 14;
+
+/// Filter weights for resampling lines of length_in pixels to length_out pixels
+/** Output pixel i is sum_k weights[i*taps+k] * input[start[i]+k], for 0 <= k < taps.
+ *  The weights of an output pixel add up to 1 << weight_shift.
+ */
+DECLARE_POINTER_TYPE(ResampleWeights);
+class ResampleWeights : public IntrusivePtrBase<ResampleWeights> {
+  public:
+	ResampleWeights(int length_in, int length_out, ResampleFilter filter);
+	
+	int           taps;
+	vector<int>   start;
+	vector<short> weights;
+};
+
+// support radius of a filter
+double filter_radius(ResampleFilter filter) {
+	return filter == RESAMPLE_LANCZOS3 ? 3.0 : 1.0;
+}
+// value of a filter at distance x from the center
+double filter_value(ResampleFilter filter, double x) {
+	x = fabs(x);
+	if (filter == RESAMPLE_LANCZOS3) {
+		if (x < 1e-8) return 1.0;
+		if (x >= 3.0) return 0.0;
+		double px = M_PI * x;
+		return 3.0 * sin(px) * sin(px / 3.0) / (px * px);
+	} else {
+		return x < 1.0 ? 1.0 - x : 0.0;
+	}
+}
+
+ResampleWeights::ResampleWeights(int length_in, int length_out, ResampleFilter filter) {
+	double scale   = (double)length_out / length_in;
+	double stretch = max(1.0, 1.0 / scale); // when downsampling the filter covers more input pixels
+	double radius  = filter_radius(filter) * stretch;
+	taps = min(length_in, (int)ceil(2 * radius) + 1);
+	start.resize(length_out);
+	weights.resize(length_out * taps);
+	vector<double> w(taps);
+	for (int i = 0 ; i < length_out ; ++i) {
+		// center of the output pixel in input coordinates
+		double center = (i + 0.5) / scale;
+		int first = (int)floor(center - radius + 0.5);
+		first = max(0, min(length_in - taps, first));
+		start[i] = first;
+		// filter
+		double total = 0;
+		for (int k = 0 ; k < taps ; ++k) {
+			w[k] = filter_value(filter, (first + k + 0.5 - center) / stretch);
+			total += w[k];
+		}
+		// to fixed point, give the rounding error to the largest weight
+		int sum = 0, largest = 0;
+		for (int k = 0 ; k < taps ; ++k) {
+			int wk = total > 0 ? (int)floor(w[k] / total * (1 << weight_shift) + 0.5) : 0;
+			weights[i*taps+k] = (short)wk;
+			sum += wk;
+			if (wk > weights[i*taps+largest]) largest = k;
+		}
+		weights[i*taps+largest] += (short)((1 << weight_shift) - sum);
+	}
+}
+
+/// Get the (cached) weights for resampling
+/** The same sizes are used over and over again, for example for all cards in a set */
+ResampleWeightsP resample_weights(int length_in, int length_out, ResampleFilter filter) {
+	static wxMutex mutex;
+	static std::map<std::pair<std::pair<int,int>,int>, ResampleWeightsP> cache;
+	wxMutexLocker lock(mutex);
+	std::pair<std::pair<int,int>,int> key(std::make_pair(length_in, length_out), (int)filter);
+	auto it = cache.find(key);
+	if (it != cache.end()) return it->second;
+	if (cache.size() >= 64) cache.clear(); // don't grow forever
+	ResampleWeightsP weights = intrusive(new ResampleWeights(length_in, length_out, filter));
+	cache.insert(std::make_pair(key, weights));
+	return weights;
+}
+
+// The filter passes work on 16 bit samples, with wide_shift bits after the point.
+// This keeps the precision of premultiplied colors with a low alpha, and of the result of the first pass.
+// The samples are at most 255<<7, so they fit in a signed 16 bit number, as needed for _mm_madd_epi16.
+typedef unsigned short Wide;
+const int wide_shift = 7;
+const int wide_max   = 255 << wide_shift;
+
+// fixed point weighted sum to a sample
+inline Wide weighted_to_wide(int sum) {
+	return (Wide)max(0, min(wide_max, (sum + (1 << (weight_shift - 1))) >> weight_shift));
+}
+// sample to a byte
+inline Byte wide_to_byte(int x) {
+	return (Byte)((x + (1 << (wide_shift - 1))) >> wide_shift);
+}
+
+/// Resample the lines [line_begin..line_end) horizontally
+/** in and out have 'channels' samples per pixel. */
+void filter_rows(const Wide* in, Wide* out, int width_in, int width_out, int channels,
+                 const ResampleWeights& weights, int line_begin, int line_end) {
+	for (int y = line_begin ; y < line_end ; ++y) {
+		const Wide* in_line = in + y * width_in * channels;
+		Wide* out_p = out + y * width_out * channels;
+		for (int x = 0 ; x < width_out ; ++x) {
+			const Wide*  in_p = in_line + weights.start[x] * channels;
+			const short* w    = &weights.weights[x * weights.taps];
+			for (int c = 0 ; c < channels ; ++c) {
+				int sum = 0;
+				for (int k = 0 ; k < weights.taps ; ++k) {
+					sum += w[k] * in_p[k * channels + c];
+				}
+				*out_p++ = weighted_to_wide(sum);
+			}
+		}
+	}
+}
+
+/// Resample the lines [line_begin..line_end) of the output vertically
+/** A line consists of line_size samples, all samples are treated the same. */
+void filter_columns(const Wide* in, Wide* out, int line_size,
+                    const ResampleWeights& weights, int line_begin, int line_end) {
+	#if USE_SSE2
+		bool sse2 = simd_level() >= SIMD_SSE2;
+	#endif
+	for (int y = line_begin ; y < line_end ; ++y) {
+		const Wide*  in_p = in + weights.start[y] * line_size;
+		const short* w    = &weights.weights[y * weights.taps];
+		Wide* out_p = out + y * line_size;
+		int i = 0;
+		#if USE_SSE2
+			// 8 samples at a time, combine two input lines with a single multiply-add
+			for ( ; sse2 && i + 8 <= line_size ; i += 8) {
+				__m128i sum_lo = _mm_set1_epi32(1 << (weight_shift - 1));
+				__m128i sum_hi = sum_lo;
+				for (int k = 0 ; k < weights.taps ; k += 2) {
+					__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in_p + k * line_size + i));
+					__m128i b = _mm_setzero_si128();
+					int     wb = 0;
+					if (k + 1 < weights.taps) {
+						b  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in_p + (k+1) * line_size + i));
+						wb = w[k+1];
+					}
+					__m128i wab = _mm_set1_epi32((int)(((UInt)(unsigned short)wb << 16) | (unsigned short)w[k]));
+					sum_lo = _mm_add_epi32(sum_lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), wab));
+					sum_hi = _mm_add_epi32(sum_hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), wab));
+				}
+				__m128i result = _mm_packs_epi32(_mm_srai_epi32(sum_lo, weight_shift), _mm_srai_epi32(sum_hi, weight_shift));
+				result = _mm_min_epi16(_mm_max_epi16(result, _mm_setzero_si128()), _mm_set1_epi16(wide_max));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out_p + i), result);
+			}
+		#endif
+		for ( ; i < line_size ; ++i) {
+			int sum = 0;
+			for (int k = 0 ; k < weights.taps ; ++k) {
+				sum += w[k] * in_p[k * line_size + i];
+			}
+			out_p[i] = weighted_to_wide(sum);
+		}
+	}
+}
+
+/// Resample using the weights of a filter, first horizontally then vertically
+/** Images with alpha are resampled with premultiplied alpha, so transparent pixels don't bleed. */
+void resample_filtered(const Image& img_in, Image& img_out, ResampleFilter filter) {
+	int width_in  = img_in .GetWidth(), height_in  = img_in .GetHeight();
+	int width_out = img_out.GetWidth(), height_out = img_out.GetHeight();
+	bool alpha = img_in.HasAlpha();
+	int channels = alpha ? 4 : 3;
+	ResampleWeightsP weights_x = resample_weights(width_in,  width_out,  filter);
+	ResampleWeightsP weights_y = resample_weights(height_in, height_out, filter);
+	// to samples, premultiplied
+	vector<Wide> in(width_in * height_in * channels);
+	const Byte* rgb_in = img_in.GetData();
+	if (alpha) {
+		const Byte* a = img_in.GetAlpha();
+		for (int i = 0 ; i < width_in * height_in ; ++i) {
+			in[4*i+0] = (Wide)((rgb_in[3*i+0] * a[i] << wide_shift) / 255);
+			in[4*i+1] = (Wide)((rgb_in[3*i+1] * a[i] << wide_shift) / 255);
+			in[4*i+2] = (Wide)((rgb_in[3*i+2] * a[i] << wide_shift) / 255);
+			in[4*i+3] = (Wide)(a[i] << wide_shift);
+		}
+	} else {
+		for (int i = 0 ; i < width_in * height_in * 3 ; ++i) {
+			in[i] = (Wide)(rgb_in[i] << wide_shift);
+		}
+	}
+	// horizontally
+	vector<Wide> temp(width_out * height_in * channels);
+	int min_lines = max(4, min_pixels_per_thread / max(1, width_in * weights_x->taps / 2));
+	parallel_for_ranges(height_in, min_lines, [&](int begin, int end) {
+		filter_rows(&in[0], &temp[0], width_in, width_out, channels, *weights_x, begin, end);
+	});
+	// vertically
+	vector<Wide> result(width_out * height_out * channels);
+	min_lines = max(4, min_pixels_per_thread / max(1, width_out * weights_y->taps / 2));
+	parallel_for_ranges(height_out, min_lines, [&](int begin, int end) {
+		filter_columns(&temp[0], &result[0], width_out * channels, *weights_y, begin, end);
+	});
+	// to bytes, un-premultiply
+	Byte* rgb = img_out.GetData();
+	if (alpha) {
+		if (!img_out.HasAlpha()) img_out.InitAlpha();
+		Byte* a = img_out.GetAlpha();
+		for (int i = 0 ; i < width_out * height_out ; ++i) {
+			int al = result[4*i+3];
+			a[i] = wide_to_byte(al);
+			if (a[i]) {
+				rgb[3*i+0] = (Byte)min(255, (result[4*i+0] * 255 + al / 2) / al);
+				rgb[3*i+1] = (Byte)min(255, (result[4*i+1] * 255 + al / 2) / al);
+				rgb[3*i+2] = (Byte)min(255, (result[4*i+2] * 255 + al / 2) / al);
+			} else {
+				rgb[3*i+0] = rgb[3*i+1] = rgb[3*i+2] = 0;
+			}
+		}
+	} else {
+		for (int i = 0 ; i < width_out * height_out * 3 ; ++i) {
+			rgb[i] = wide_to_byte(result[i]);
+		}
+	}
+}
+
 // ----------------------------------------------------------------------------- : Resample
 
 /* The algorithm first resizes in horizontally, then vertically,
@@ -124,15 +377,23 @@ void resample_pass(const Image& img_in, Image& img_out, int offset_in, int offse
  *
  * Uses fixed point numbers
  */
-void resample(const Image& img_in, Image& img_out) {
-	resample_and_clip(img_in, img_out, wxRect(0, 0, img_in.GetWidth(), img_in.GetHeight()));
+void resample(const Image& img_in, Image& img_out, ResampleFilter filter) {
+	if (filter == RESAMPLE_BOX) {
+		resample_and_clip(img_in, img_out, wxRect(0, 0, img_in.GetWidth(), img_in.GetHeight()));
+	} else {
+		// mask to alpha
+		if (img_in.HasMask() && !img_in.HasAlpha()) {
+			const_cast<Image&>(img_in).InitAlpha();
+		}
+		resample_filtered(img_in, img_out, filter);
+	}
 }
-Image resample(const Image& img_in, int width, int height) {
+Image resample(const Image& img_in, int width, int height, ResampleFilter filter) {
 	if (img_in.GetWidth() == width && img_in.GetHeight() == height) {
 		return img_in; // already the right size
 	} else {
 		Image img_out(width,height,false);
-		resample(img_in, img_out);
+		resample(img_in, img_out, filter);
 		return img_out;
 	}
 }
@@ -163,7 +424,7 @@ void fill_transparent(Image& img) {
 	memset(img.GetAlpha(), 0, img.GetWidth() * img.GetHeight());
 }
 
-void resample_preserve_aspect(const Image& img_in, Image& img_out) {
+void resample_preserve_aspect(const Image& img_in, Image& img_out, ResampleFilter filter) {
 	int rheight = img_in.GetHeight() * img_out.GetWidth()  / img_in.GetWidth();
 	int rwidth  = img_in.GetWidth()  * img_out.GetHeight() / img_in.GetHeight();
 	// actual size of output
@@ -174,6 +435,16 @@ void resample_preserve_aspect(const Image& img_in, Image& img_out) {
 	int dy = (img_out.GetHeight() - rheight) / 2;
 	// transparent background
 	fill_transparent(img_out);
+	if (filter != RESAMPLE_BOX) {
+		// resample, then copy into the middle
+		Image img_temp = resample(img_in, rwidth, rheight, filter);
+		if (!img_temp.HasAlpha()) img_temp.InitAlpha();
+		for (int y = 0 ; y < rheight ; ++y) {
+			memcpy(img_out.GetData()  + 3 * (dx + img_out.GetWidth() * (y + dy)), img_temp.GetData()  + 3 * rwidth * y, 3 * rwidth);
+			memcpy(img_out.GetAlpha() +     (dx + img_out.GetWidth() * (y + dy)), img_temp.GetAlpha() +     rwidth * y,     rwidth);
+		}
+		return;
+	}
 	// resample
 	int offset_out = dx + img_out.GetWidth() * dy;
 	Image img_temp(rwidth, img_in.GetHeight(), false);
@@ -182,12 +453,12 @@ void resample_preserve_aspect(const Image& img_in, Image& img_out) {
 	resample_pass(img_temp, img_out,  0, offset_out, img_in.GetHeight(), img_temp.GetWidth(), rheight, img_out.GetWidth(), rwidth,             1,                 1);
 }
 
-Image resample_preserve_aspect(const Image& img_in, int width, int height) {
+Image resample_preserve_aspect(const Image& img_in, int width, int height, ResampleFilter filter) {
 	if (img_in.GetWidth() == width && img_in.GetHeight() == height) {
 		return img_in; // already the right size
 	} else {
 		Image img_out(width,height,false);
-		resample_preserve_aspect(img_in, img_out);
+		resample_preserve_aspect(img_in, img_out, filter);
 		return img_out;
 	}
 }
@@ -8,6 +8,7 @@
 
 #include <util/prec.hpp>
 #include <gfx/gfx.hpp>
+#include <gfx/headless_dc.hpp>
 #include <util/error.hpp>
 #include <gui/util.hpp> // clearDC_black
 #if defined(__WXMSW__) && wxUSE_WXDIB
@@ -23,25 +24,16 @@ void blur_image(const Image& img_in, Image& img_out);
 // scaling factor to use when drawing resampled text
 const int text_scaling = 4;
 
-// Downsamples the red channel of the input image to the alpha channel of the output image
-// img_in must be text_scaling times as large as img_out
-void downsample_to_alpha(Bitmap& bmp_in, Image& img_out) {
+// Downsamples the red channel of the input pixels to the alpha channel of the output image
+// the input must be text_scaling times as large as img_out, it is overwritten
+// upside_down indicates that the input rows are stored bottom to top
+void downsample_to_alpha(Byte* in, int in_width, int in_height, bool upside_down, Image& img_out) {
 	Byte* temp = nullptr;
-	#if defined(__WXMSW__) && wxUSE_WXDIB
-		wxDIB img_in(bmp_in);
-		if (!img_in.IsOk()) return;
-		// if text_scaling = 4, then the line always is dword aligned, so we need no adjusting
-		// we created a bitmap with depth 24, so that is what we should have here
-		if (img_in.GetDepth() != 24) throw InternalError(_("DIB has wrong bit depth"));
-	#else
-		Image img_in = bmp_in.ConvertToImage();
-	#endif
-	Byte* in  = img_in.GetData();
-	Byte* out = img_in.GetData();
+	Byte* out = in;
 	// scale in the x direction, this overwrites parts of the input image
-	if (img_in.GetWidth() == img_out.GetWidth() * text_scaling) {
+	if (in_width == img_out.GetWidth() * text_scaling) {
 		// no stretching
-		int count = img_out.GetWidth() * img_in.GetHeight();
+		int count = img_out.GetWidth() * in_height;
 		for (int i = 0 ; i < count ; ++i) {
 			int total = 0;
 			for (int j = 0 ; j < text_scaling ; ++j) {
@@ -51,11 +43,11 @@ void downsample_to_alpha(Bitmap& bmp_in, Image& img_out) {
 		}
 	} else {
 		// resample to buffer
-		temp = new Byte[img_out.GetWidth() * img_in.GetHeight()];
+		temp = new Byte[img_out.GetWidth() * in_height];
 		out = temp;
 		// custom stretch, see resample_image.cpp
 		const int shift = 32-12-8; // => max size = 4096, max alpha = 255
-		int w1 = img_in.GetWidth(), w2 = img_out.GetWidth(), h = img_in.GetHeight();
+		int w1 = in_width, w2 = img_out.GetWidth(), h = in_height;
 		int out_fact = (w2 << shift) / w1; // how much to output for 256 input = 1 pixel
 		int out_rest = (w2 << shift) % w1;
 		// make the image 'bolder' to compensate for compressing it
@@ -88,16 +80,10 @@ void downsample_to_alpha(Bitmap& bmp_in, Image& img_out) {
 	// now scale in the y direction, and write to the output alpha
 	img_out.InitAlpha();
 	int line_size_in = img_out.GetWidth();
-	#if defined(__WXMSW__) && wxUSE_WXDIB
-		// DIBs are upside down
-		out = img_out.GetAlpha() + (img_out.GetHeight() - 1) * line_size_in;
-		int line_size_out = -line_size_in;
-	#else
-		out = img_out.GetAlpha();
-		int line_size_out = line_size_in;
-	#endif
+	int line_size_out = upside_down ? -line_size_in : line_size_in;
+	out = img_out.GetAlpha() + (upside_down ? (img_out.GetHeight() - 1) * line_size_in : 0);
 	int h = img_out.GetHeight();
-	if (img_in.GetHeight() == h * text_scaling) {
+	if (in_height == h * text_scaling) {
 		// no stretching
 		for (int y = 0 ; y < h ; ++y) {
 			for (int x = 0 ; x < line_size_in ; ++x) {
@@ -110,7 +96,7 @@ void downsample_to_alpha(Bitmap& bmp_in, Image& img_out) {
 		}
 	} else {
 		const int shift = 32-12-8; // => max size = 4096, max alpha = 255
-		int h1 = img_in.GetHeight(), w = img_out.GetWidth();
+		int h1 = in_height, w = img_out.GetWidth();
 		int out_fact = (h << shift) / h1; // how much to output for 256 input = 1 pixel
 		int out_rest = (h << shift) % h1;
 		int mul = 128 + min(256, 128*h1/(text_scaling*h));
@@ -143,6 +129,25 @@ void downsample_to_alpha(Bitmap& bmp_in, Image& img_out) {
 	delete[] temp;
 }
 
+void downsample_to_alpha(Image& img_in, Image& img_out) {
+	downsample_to_alpha(img_in.GetData(), img_in.GetWidth(), img_in.GetHeight(), false, img_out);
+}
+
+void downsample_to_alpha(Bitmap& bmp_in, Image& img_out) {
+	#if defined(__WXMSW__) && wxUSE_WXDIB
+		wxDIB img_in(bmp_in);
+		if (!img_in.IsOk()) return;
+		// if text_scaling = 4, then the line always is dword aligned, so we need no adjusting
+		// we created a bitmap with depth 24, so that is what we should have here
+		if (img_in.GetDepth() != 24) throw InternalError(_("DIB has wrong bit depth"));
+		// DIBs are upside down
+		downsample_to_alpha(img_in.GetData(), img_in.GetWidth(), img_in.GetHeight(), true, img_out);
+	#else
+		Image img_in = bmp_in.ConvertToImage();
+		downsample_to_alpha(img_in, img_out);
+	#endif
+}
+
 // simple blur
 int blur_alpha_pixel(Byte* in, int x, int y, int width, int height) {
 	return (2 * (                      in[0])      + // center
@@ -178,23 +183,38 @@ void draw_resampled_text(DC& dc, const RealPoint& pos, const RealRect& rect, dou
 	int xsub = static_cast<int>(text_scaling * (pos.x - xi)),
 	    ysub = static_cast<int>(text_scaling * (pos.y - yi));
 	// draw text
-	Bitmap buffer(w * text_scaling, h * text_scaling, 24); // should be initialized to black
-	wxMemoryDC mdc;
-	mdc.SelectObject(buffer);
-	clearDC_black(mdc);
-	// now draw the text
-	mdc.SetFont(dc.GetFont());
-	mdc.SetTextForeground(*wxWHITE);
-	mdc.DrawRotatedText(text, xsub, ysub, rad_to_deg(angle));
-	// get image
-	mdc.SelectObject(wxNullBitmap);
+	HeadlessDC* headless = dynamic_cast<HeadlessDC*>(&dc);
+	Bitmap buffer;
+	scoped_ptr<HeadlessDC> headless_buffer;
+	if (headless) {
+		// no wxMemoryDC without a display
+		headless_buffer.reset(new HeadlessDC(w * text_scaling, h * text_scaling)); // black
+		headless_buffer->SetFont(dc.GetFont());
+		headless_buffer->SetTextForeground(*wxWHITE);
+		headless_buffer->DrawRotatedText(text, xsub, ysub, rad_to_deg(angle));
+	} else {
+		buffer = Bitmap(w * text_scaling, h * text_scaling, 24); // should be initialized to black
+		wxMemoryDC mdc;
+		mdc.SelectObject(buffer);
+		clearDC_black(mdc);
+		// now draw the text
+		mdc.SetFont(dc.GetFont());
+		mdc.SetTextForeground(*wxWHITE);
+		mdc.DrawRotatedText(text, xsub, ysub, rad_to_deg(angle));
+		// get image
+		mdc.SelectObject(wxNullBitmap);
+	}
 	// step 2. sample down
 	double ca = fabs(cos(angle)), sa = fabs(sin(angle));
 	w += int(w * (stretch - 1) * ca); // GCC makes annoying conversion warnings if *= is used here.
 	h += int(h * (stretch - 1) * sa);
 	Image img_small(w, h, false);
 	fill_image(img_small, color);
-	downsample_to_alpha(buffer, img_small);
+	if (headless) {
+		downsample_to_alpha(headless_buffer->getImage(), img_small);
+	} else {
+		downsample_to_alpha(buffer, img_small);
+	}
 	// multiply alpha
 	if (color.alpha != 255) {
 		set_alpha(img_small, color.alpha / 255.);
@@ -205,7 +225,11 @@ void draw_resampled_text(DC& dc, const RealPoint& pos, const RealRect& rect, dou
 	}
 	// step 3. draw to dc
 	for (int i = 0 ; i < repeat ; ++i) {
-		dc.DrawBitmap(img_small, xi, yi);
+		if (headless) {
+			headless->DrawImage(img_small, dc.LogicalToDeviceX(xi), dc.LogicalToDeviceY(yi));
+		} else {
+			dc.DrawBitmap(img_small, xi, yi);
+		}
 	}
 }
 
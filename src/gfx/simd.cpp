@@ -0,0 +1,69 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) 2001 - 2012 Twan van Laarhoven and Sean Hunt             |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <gfx/simd.hpp>
+#include <gfx/pixel_kernels.hpp>
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+	#include <intrin.h>
+	#include <immintrin.h>
+#endif
+
+// ----------------------------------------------------------------------------- : Runtime detection
+
+/// Ask the processor which instruction sets it supports
+SimdLevel detect_simd_level() {
+	#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+		int info[4];
+		__cpuid(info, 0);
+		int max_leaf = info[0];
+		__cpuid(info, 1);
+		bool sse2    = (info[3] & (1 << 26)) != 0;
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx     = (info[2] & (1 << 28)) != 0;
+		if (!sse2) return SIMD_NONE;
+		// AVX2 also needs the operating system to save the ymm registers
+		if (max_leaf >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6) {
+			__cpuidex(info, 7, 0);
+			if (info[1] & (1 << 5)) return SIMD_AVX2;
+		}
+		return SIMD_SSE2;
+	#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__i386__) || defined(__x86_64__))
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2")) return SIMD_AVX2;
+		if (__builtin_cpu_supports("sse2")) return SIMD_SSE2;
+		return SIMD_NONE;
+	#else
+		return SIMD_NONE;
+	#endif
+}
+
+static volatile int simd_level_limit = SIMD_AVX2;
+
+SimdLevel simd_level() {
+	static const SimdLevel detected = detect_simd_level();
+	return (SimdLevel)std::min((int)detected, (int)simd_level_limit);
+}
+
+void limit_simd_level(SimdLevel level) {
+	simd_level_limit = level;
+}
+
+// ----------------------------------------------------------------------------- : Kernels
+
+const PixelKernels* pixel_kernels_simd() {
+	#if HAVE_X86_PIXEL_KERNELS
+		switch (simd_level()) {
+			case SIMD_AVX2: return &pixel_kernels_avx2;
+			case SIMD_SSE2: return &pixel_kernels_sse2;
+			default:        return nullptr;
+		}
+	#else
+		return nullptr;
+	#endif
+}
@@ -0,0 +1,72 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) 2001 - 2012 Twan van Laarhoven and Sean Hunt             |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+#ifndef HEADER_GFX_SIMD
+#define HEADER_GFX_SIMD
+
+/** @file gfx/simd.hpp
+ *
+ *  @brief Choosing SIMD instructions at runtime, and helpers for processing image data 16 bytes at a time with SSE2.
+ *
+ *  The SSE2 helpers can be used when the compiler targets SSE2 (USE_SSE2), which all x86-64 compilers do.
+ *  Code using them should still check simd_level() at runtime, and have a plain loop as well,
+ *  for other platforms and for the bytes at the end of an image.
+ *  The SSE2 versions must give exactly the same results as the plain loops.
+ *
+ *  For instruction sets that are not part of the compiler's target, such as AVX2,
+ *  see gfx/pixel_kernels.hpp.
+ */
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define USE_SSE2 1
+	#include <emmintrin.h>
+#else
+	#define USE_SSE2 0
+#endif
+
+// ----------------------------------------------------------------------------- : Runtime detection
+
+/// Instruction sets that can be used, each level includes the ones before it
+enum SimdLevel
+{	SIMD_NONE
+,	SIMD_SSE2
+,	SIMD_AVX2
+};
+
+/// The best instruction set supported by this processor, limited by limit_simd_level
+SimdLevel simd_level();
+
+/// Don't use instruction sets above the given level, for testing and comparing the plain code
+void limit_simd_level(SimdLevel level);
+
+#if USE_SSE2
+
+// ----------------------------------------------------------------------------- : Loading and storing
+
+inline __m128i load_16_bytes(const Byte* data) {
+	return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+}
+inline void store_16_bytes(Byte* data, __m128i x) {
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(data), x);
+}
+
+/// The low 8 bytes of x, as 16 bit numbers
+inline __m128i unpack_lo_epu8(__m128i x) {
+	return _mm_unpacklo_epi8(x, _mm_setzero_si128());
+}
+/// The high 8 bytes of x, as 16 bit numbers
+inline __m128i unpack_hi_epu8(__m128i x) {
+	return _mm_unpackhi_epi8(x, _mm_setzero_si128());
+}
+
+#endif // USE_SSE2
+
+// ----------------------------------------------------------------------------- : EOF
+#endif
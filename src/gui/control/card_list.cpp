@@ -196,14 +196,14 @@ bool CardListBase::compareItems(void* a, void* b) const {
 	ValueP va = reinterpret_cast<Card*>(a)->data[sort_field];
 	ValueP vb = reinterpret_cast<Card*>(b)->data[sort_field];
 	assert(va && vb);
-	// compare sort keys
-	int cmp = smart_compare( va->getSortKey(), vb->getSortKey() );
+	// compare sort keys, the collation keys give the same order as smart_compare
+	int cmp = va->getCollationKey().compare(vb->getCollationKey());
 	if (cmp != 0) return cmp < 0;
 	// equal values, compare alternate sort key
 	if (alternate_sort_field) {
 		ValueP va = reinterpret_cast<Card*>(a)->data[alternate_sort_field];
 		ValueP vb = reinterpret_cast<Card*>(b)->data[alternate_sort_field];
-		int cmp = smart_compare( va->getSortKey(), vb->getSortKey() );
+		int cmp = va->getCollationKey().compare(vb->getCollationKey());
 		if (cmp != 0) return cmp < 0;
 	}
 	return false;
@@ -165,6 +165,14 @@ GraphData::GraphData(const GraphDataPre& d)
 		}
 		++i;
 	}
+	// index of the first group with each name, for each axis
+	vector<map<String,int> > group_nrs(axes.size());
+	for (size_t i = 0 ; i < axes.size() ; ++i) {
+		int j = 0;
+		for(auto& g : axes[i]->groups) {
+			group_nrs[i].insert(make_pair(g.name, j++)); // insert keeps the first
+		}
+	}
 	// count elements in each position
 	values.reserve(d.elements.size());
 	size_t de_size = sizeof(GraphDataElement) + sizeof(int) * (axes.size() - 1);
@@ -183,13 +191,9 @@ GraphData::GraphData(const GraphDataPre& d)
 				de->group_nrs[i] = bin_to_group(d, a->bin_size);
 			} else {
 				// find group that contains v
-				int j = 0;
-				for(auto& g : a->groups) {
-					if (v == g.name) {
-						de->group_nrs[i] = j;
-						break;
-					}
-					++j;
+				map<String,int>::const_iterator it = group_nrs[i].find(v);
+				if (it != group_nrs[i].end()) {
+					de->group_nrs[i] = it->second;
 				}
 			}
 			++i;
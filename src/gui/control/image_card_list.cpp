@@ -23,6 +23,7 @@ using std::make_pair;
 
 ImageCardList::ImageCardList(Window* parent, int id, long additional_style)
 	: CardListBase(parent, id, additional_style)
+	, top_item(-1)
 {}
 
 ImageCardList::~ImageCardList() {
@@ -117,6 +118,14 @@ int ImageCardList::OnGetItemImage(long pos) const {
 
 void ImageCardList::onIdle(wxIdleEvent&) {
 	thumbnail_thread.done(this);
+	// after scrolling, thumbnails for rows that are no longer visible are not needed,
+	// the rows that are visible request them again when they are drawn
+	long top = GetTopItem();
+	if (top != top_item) {
+		top_item = top;
+		thumbnail_thread.cancel(this);
+		Refresh(false);
+	}
 }
 
 
@@ -34,6 +34,7 @@ class ImageCardList : public CardListBase {
 	
 	ImageFieldP image_field;			///< Field to use for card images
 	mutable map<String,int> thumbnails;	///< image thumbnails, based on image_field
+	long top_item;						///< First visible item, for noticing scrolling
 	
 	ImageFieldP findImageField();
 	
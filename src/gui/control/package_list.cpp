@@ -34,6 +34,7 @@ void PackageList::drawItem(DC& dc, int x, int y, size_t item) {
 	RealPoint pos;
 	int w, h;
 	// draw image
+	d.loadImage();
 	if (d.image.Ok()) {
 		dc.DrawBitmap(d.image, x + int(align_delta_x(ALIGN_CENTER, item_size.x, d.image.GetWidth())), y + 3, true);
 	}
@@ -69,17 +70,10 @@ void PackageList::showData(const String& pattern) {
 		PROFILER(_("find matching packages"));
 		package_manager.findMatching(pattern, matching);
 	}
+	// the images are loaded when the items are first drawn,
+	// so packages that are scrolled out of view don't need them
 	for(auto& p : matching) {
-		// open image
-		PROFILER(_("load package image"));
-		InputStreamP stream = p->openIconFile();
-		Image img;
-		Bitmap bmp;
-		if (stream && img.LoadFile(*stream)) {
-			bmp = Bitmap(img);
-		}
-		// add to list
-		packages.push_back(PackageData(p, bmp));
+		packages.push_back(PackageData(p));
 	}
 	// sort list
 	sort(packages.begin(), packages.end(), ComparePackagePosHint());
@@ -87,6 +81,21 @@ void PackageList::showData(const String& pattern) {
 	update();
 }
 
+void PackageList::PackageData::loadImage() {
+	if (image_loaded) return;
+	image_loaded = true;
+	PROFILER(_("load package image"));
+	try {
+		InputStreamP stream = package->openIconFile();
+		Image img;
+		if (stream && img.LoadFile(*stream)) {
+			image = Bitmap(img);
+		}
+	} catch (const Error& e) {
+		handle_error(e);
+	}
+}
+
 void PackageList::clear() {
 	packages.clear();
 	update();
@@ -64,10 +64,14 @@ class PackageList : public GalleryList {
 	
 	// Information about a package
 	struct PackageData {
-		PackageData() {}
-		PackageData(const PackagedP& package, const Bitmap& image) : package(package), image(image) {}
+		PackageData() : image_loaded(false) {}
+		PackageData(const PackagedP& package) : package(package), image_loaded(false) {}
 		PackagedP package;
 		Bitmap    image;
+		bool      image_loaded; ///< Has the icon been loaded? This is only done once the item is drawn
+		
+		/// Load the icon of the package, if that hasn't been done yet
+		void loadImage();
 	};
 	struct ComparePackagePosHint;
 	/// The displayed packages
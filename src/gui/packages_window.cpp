@@ -15,6 +15,7 @@
 #include <data/installer.hpp>
 #include <data/settings.hpp>
 #include <gfx/gfx.hpp>
+#include <gfx/image_cache.hpp>
 #include <wx/wfstream.h>
 #include <wx/html/htmlwin.h>
 #include <wx/dialup.h>
@@ -336,6 +337,7 @@ void PackagesWindow::onOk(wxCommandEvent& ev) {
 		);
 	// Clear package list
 	package_manager.reset();
+	generated_image_cache.clear();
 	// Download installers
 	int package_pos = 0, step = 0;
 	for(auto& ip : installable_packages) {
@@ -137,7 +137,11 @@ void ProfilerPanel::draw_profiler(wxDC& dc, int x0, int y0) {
 			}
 			// draw line
 			int y = y0 + (++i) * line_height + 6;
-			dc.DrawText(prof->name,                                        pos[0], y);
+			String name = prof->name;
+			if (prof->cache_hits || prof->cache_misses) {
+				name += wxString::Format(_(" (memoized: %d hits, %d misses)"), prof->cache_hits, prof->cache_misses);
+			}
+			dc.DrawText(name,                                              pos[0], y);
 			draw_right(dc,wxString::Format(_("%d"),   prof->calls),        pos[1], y);
 			draw_right(dc,wxString::Format(_("%.2f"), prof->avg_time()),   pos[2], y);
 			draw_right(dc,wxString::Format(_("%.2f"), prof->total_time()), pos[3], y);
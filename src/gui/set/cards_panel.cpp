@@ -21,6 +21,7 @@
 #include <data/card.hpp>
 #include <data/add_cards_script.hpp>
 #include <data/action/set.hpp>
+#include <data/search_index.hpp>
 #include <data/settings.hpp>
 #include <util/find_replace.hpp>
 #include <util/tagged_string.hpp>
@@ -368,7 +369,11 @@ void CardsPanel::onCommand(int id) {
 		}
 		case ID_CARD_FILTER: {
 			// card filter has changed, update the card list
-			card_list->setFilter(filter->getFilter<Card>());
+			if (filter->hasFilter()) {
+				card_list->setFilter(intrusive(new CardQuickFilter(set, filter->getFilterString())));
+			} else {
+				card_list->setFilter(CardListFilterP());
+			}
 			break;
 		}
 		default: {
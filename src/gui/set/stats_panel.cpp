@@ -15,6 +15,7 @@
 #include <gui/util.hpp>
 #include <data/game.hpp>
 #include <data/statistics.hpp>
+#include <data/set.hpp>
 #include <data/action/value.hpp>
 #include <util/window_id.hpp>
 #include <util/alignment.hpp>
@@ -281,6 +282,7 @@ StatsPanel::StatsPanel(Window* parent, int id)
 	: SetWindowPanel(parent, id)
 	, menuGraph(nullptr)
 	, up_to_date(true), active(false)
+	, values(new StatsValueCache)
 {
 	// delayed initialization by initControls()
 }
@@ -335,6 +337,7 @@ StatsPanel::~StatsPanel() {
 }
 
 void StatsPanel::onChangeSet() {
+	values->clear();
 	if (!isInitialized()) return;
 	card_list->setSet(set);
 	#if USE_SEPARATE_DIMENSION_LISTS
@@ -482,13 +485,13 @@ void StatsPanel::showCategory(const GraphType* prefer_layout) {
 			)
 		));
 	}
-	// find values for each card
+	// find values for each card, only cards that changed since the last time need their scripts evaluated
+	values->update(*set);
 	for (size_t i = 0 ; i < set->cards.size() ; ++i) {
-		Context& ctx = set->getContext(set->cards[i]);
 		GraphElementP e(new GraphElement(i));
 		bool show = true;
 		for(auto& dim : dims) {
-			String value = untag(dim->script.invoke(ctx)->toString());
+			const String& value = values->value(*set, set->cards[i], *dim);
 			e->values.push_back(value);
 			if (value.empty() && !dim->show_empty) {
 				// don't show this element
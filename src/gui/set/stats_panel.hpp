@@ -12,12 +12,14 @@
 #include <util/prec.hpp>
 #include <gui/set/panel.hpp>
 #include <data/graph_type.hpp>
+#include <boost/scoped_ptr.hpp>
 
 class StatCategoryList;
 class StatDimensionList;
 class GraphControl;
 class FilteredCardList;
 class IconMenu;
+class StatsValueCache;
 
 // Pick the style here:
 #define USE_DIMENSION_LISTS 1
@@ -63,6 +65,7 @@ class StatsPanel : public SetWindowPanel {
 	CardP card;      ///< Selected card
 	bool up_to_date; ///< Are the graph and card list up to date?
 	bool active;     ///< Is this panel selected?
+	scoped_ptr<StatsValueCache> values; ///< Values of the dimensions for the cards
 	
 	void initControls();
 	
@@ -31,6 +31,7 @@
 #include <gui/icon_menu.hpp>
 #include <gui/util.hpp>
 #include <util/io/package_manager.hpp>
+#include <gfx/image_cache.hpp>
 #include <util/window_id.hpp>
 #include <data/game.hpp>
 #include <data/set.hpp>
@@ -697,6 +698,7 @@ void SetWindow::onFileReload(wxCommandEvent&) {
 		if (card_it != set->cards.end()) card_pos = card_it - set->cards.begin();
 	}
 	package_manager.reset(); // unload all packages
+	generated_image_cache.clear(); // images may come from the old packages
 	settings.read();         // reload settings
 	setSet(import_set(filename));
 	// reselect card
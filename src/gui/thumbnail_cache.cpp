@@ -0,0 +1,300 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) 2001 - 2012 Twan van Laarhoven and Sean Hunt             |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <gui/thumbnail_cache.hpp>
+#include <wx/dir.h>
+#include <wx/filename.h>
+#ifdef __WXMSW__
+	#include <wx/msw/wrapwin.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <sys/file.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <errno.h>
+#endif
+
+using std::min;
+
+String image_cache_dir();
+
+// ----------------------------------------------------------------------------- : File layout
+
+/// Version of the file layout, the file is cleared if it has another version
+const wxUint32 THUMBNAIL_CACHE_FORMAT = 1;
+/// Number of slots a name can be stored in
+const size_t THUMBNAIL_CACHE_WAYS = 16;
+/// Number of groups of slots
+const size_t THUMBNAIL_CACHE_SETS = 256;
+/// Number of bytes of the name that are stored
+const size_t THUMBNAIL_CACHE_NAME_SIZE = 224;
+/// Number of bytes for the pixels of a thumbnail, enough for 32x32 with alpha
+const size_t THUMBNAIL_CACHE_PIXEL_SIZE = 32 * 32 * 4;
+
+/// Start of the cache file
+struct ThumbnailCacheHeader {
+	char     magic[16];
+	wxUint32 format;
+	wxUint32 slot_count;
+	wxUint32 slot_size;
+	wxUint32 padding;
+	wxUint64 clock;      ///< Incremented every time a slot is used
+	Byte     reserved[24];
+};
+
+/// A thumbnail in the cache file
+struct ThumbnailCacheSlot {
+	wxUint64 name_hash;  ///< Hash of the name, 0 for unused slots
+	wxInt64  modified;   ///< Modification time of the thumbnail, in wxDateTime ticks
+	wxUint64 last_used;  ///< Value of the clock when the slot was last used
+	wxUint16 width, height;
+	wxUint16 name_size;  ///< Size of the whole name, only the first THUMBNAIL_CACHE_NAME_SIZE bytes are stored
+	wxUint8  has_alpha;
+	wxUint8  padding;
+	char     name[THUMBNAIL_CACHE_NAME_SIZE];
+	Byte     pixels[THUMBNAIL_CACHE_PIXEL_SIZE];
+};
+
+const char THUMBNAIL_CACHE_MAGIC[16] = "MSE thumbnails";
+const size_t THUMBNAIL_CACHE_SLOTS = THUMBNAIL_CACHE_SETS * THUMBNAIL_CACHE_WAYS;
+const size_t THUMBNAIL_CACHE_FILE_SIZE = sizeof(ThumbnailCacheHeader) + THUMBNAIL_CACHE_SLOTS * sizeof(ThumbnailCacheSlot);
+
+/// FNV-1a hash of a name, never 0
+wxUint64 thumbnail_name_hash(const char* name, size_t size) {
+	wxUint64 hash = wxULL(14695981039346656037);
+	for (size_t i = 0 ; i < size ; ++i) {
+		hash ^= (Byte)name[i];
+		hash *= wxULL(1099511628211);
+	}
+	return hash ? hash : 1;
+}
+
+// ----------------------------------------------------------------------------- : ThumbnailCache
+
+ThumbnailCache thumbnail_cache;
+
+ThumbnailCache::ThumbnailCache()
+	: opened(false)
+	, data(nullptr)
+	#ifdef __WXMSW__
+		, file(INVALID_HANDLE_VALUE)
+		, mapping(nullptr)
+	#else
+		, file(-1)
+	#endif
+{}
+
+ThumbnailCache::~ThumbnailCache() {
+	unmap();
+}
+
+class ThumbnailCache::FileLocker {
+  public:
+	inline FileLocker(ThumbnailCache& cache) : cache(cache) { cache.lockFile(); }
+	inline ~FileLocker() { cache.unlockFile(); }
+  private:
+	ThumbnailCache& cache;
+};
+
+ThumbnailCacheHeader& ThumbnailCache::header() {
+	return *reinterpret_cast<ThumbnailCacheHeader*>(data);
+}
+
+Image ThumbnailCache::find(const String& name, const wxDateTime& modified) {
+	wxMutexLocker lock(mutex);
+	if (!opened) open();
+	if (!data) return Image();
+	FileLocker file_lock(*this); // other instances of the program could be writing to the slot
+	ThumbnailCacheSlot* slot = findSlot(name, false);
+	if (!slot || slot->modified < modified.GetValue().GetValue()) return Image();
+	size_t pixels = (size_t)slot->width * slot->height;
+	if (pixels == 0 || pixels * (slot->has_alpha ? 4 : 3) > THUMBNAIL_CACHE_PIXEL_SIZE) return Image(); // damaged
+	slot->last_used = ++header().clock;
+	// copy the pixels straight out of the file
+	Image img(slot->width, slot->height, false);
+	memcpy(img.GetData(), slot->pixels, pixels * 3);
+	if (slot->has_alpha) {
+		img.InitAlpha();
+		memcpy(img.GetAlpha(), slot->pixels + pixels * 3, pixels);
+	}
+	return img;
+}
+
+bool ThumbnailCache::store(const String& name, const wxDateTime& modified, const Image& image) {
+	wxMutexLocker lock(mutex);
+	if (!opened) open();
+	if (!data) return false;
+	FileLocker file_lock(*this);
+	return storeLocked(name, modified, image);
+}
+
+bool ThumbnailCache::storeLocked(const String& name, const wxDateTime& modified, const Image& image) {
+	if (!data || !image.Ok() || image.HasMask()) return false;
+	size_t pixels = (size_t)image.GetWidth() * image.GetHeight();
+	if (pixels * (image.HasAlpha() ? 4 : 3) > THUMBNAIL_CACHE_PIXEL_SIZE) return false;
+	ThumbnailCacheSlot* slot = findSlot(name, true);
+	// mark the slot as unused while writing to it
+	wxCharBuffer utf8 = name.utf8_str();
+	size_t name_size = strlen(utf8.data());
+	slot->name_hash = 0;
+	slot->modified  = modified.GetValue().GetValue();
+	slot->last_used = ++header().clock;
+	slot->width     = (wxUint16)image.GetWidth();
+	slot->height    = (wxUint16)image.GetHeight();
+	slot->name_size = (wxUint16)min(name_size, (size_t)0xFFFF);
+	slot->has_alpha = image.HasAlpha();
+	memcpy(slot->name, utf8.data(), min(name_size, THUMBNAIL_CACHE_NAME_SIZE));
+	memcpy(slot->pixels, image.GetData(), pixels * 3);
+	if (image.HasAlpha()) {
+		memcpy(slot->pixels + pixels * 3, image.GetAlpha(), pixels);
+	}
+	slot->name_hash = thumbnail_name_hash(utf8.data(), name_size);
+	return true;
+}
+
+ThumbnailCacheSlot* ThumbnailCache::findSlot(const String& name, bool create) {
+	wxCharBuffer utf8 = name.utf8_str();
+	size_t name_size = strlen(utf8.data());
+	wxUint64 hash = thumbnail_name_hash(utf8.data(), name_size);
+	ThumbnailCacheSlot* slots  = reinterpret_cast<ThumbnailCacheSlot*>(data + sizeof(ThumbnailCacheHeader));
+	ThumbnailCacheSlot* set    = slots + (size_t)(hash % THUMBNAIL_CACHE_SETS) * THUMBNAIL_CACHE_WAYS;
+	ThumbnailCacheSlot* oldest = set;
+	for (size_t i = 0 ; i < THUMBNAIL_CACHE_WAYS ; ++i) {
+		ThumbnailCacheSlot* slot = set + i;
+		if (slot->name_hash == hash && slot->name_size == min(name_size, (size_t)0xFFFF)
+		    && memcmp(slot->name, utf8.data(), min(name_size, THUMBNAIL_CACHE_NAME_SIZE)) == 0) {
+			return slot;
+		}
+		if (oldest->name_hash != 0 && (slot->name_hash == 0 || slot->last_used < oldest->last_used)) {
+			oldest = slot;
+		}
+	}
+	// not found, replace an unused or the least recently used slot
+	return create ? oldest : nullptr;
+}
+
+// ----------------------------------------------------------------------------- : ThumbnailCache : file
+
+void ThumbnailCache::open() {
+	opened = true;
+	String filename = image_cache_dir() + _("thumbnails.bin");
+	bool created = map(filename, THUMBNAIL_CACHE_FILE_SIZE);
+	if (!data) return;
+	FileLocker file_lock(*this); // only one instance of the program should initialize the file
+	ThumbnailCacheHeader& h = header();
+	if (created || memcmp(h.magic, THUMBNAIL_CACHE_MAGIC, sizeof(h.magic)) != 0 || h.format != THUMBNAIL_CACHE_FORMAT
+	            || h.slot_count != THUMBNAIL_CACHE_SLOTS || h.slot_size != sizeof(ThumbnailCacheSlot)) {
+		// a new file, or from another version
+		memset(data, 0, THUMBNAIL_CACHE_FILE_SIZE);
+		memcpy(h.magic, THUMBNAIL_CACHE_MAGIC, sizeof(h.magic));
+		h.format     = THUMBNAIL_CACHE_FORMAT;
+		h.slot_count = THUMBNAIL_CACHE_SLOTS;
+		h.slot_size  = sizeof(ThumbnailCacheSlot);
+		migrate();
+	}
+}
+
+void ThumbnailCache::migrate() {
+	String dir = image_cache_dir();
+	wxDir d(dir);
+	if (!d.IsOpened()) return;
+	vector<String> files;
+	String file;
+	for (bool ok = d.GetFirst(&file, _("*.png"), wxDIR_FILES) ; ok ; ok = d.GetNext(&file)) {
+		files.push_back(file);
+	}
+	wxLogNull no_log; // broken images are just dropped
+	for(const auto& f : files) {
+		wxFileName fn(dir + f);
+		wxDateTime modified;
+		Image img;
+		if (fn.GetTimes(0, &modified, 0) && img.LoadFile(fn.GetFullPath(), wxBITMAP_TYPE_PNG)) {
+			if (!storeLocked(fn.GetName(), modified, img)) continue; // too large, keep the file
+		}
+		wxRemoveFile(fn.GetFullPath());
+	}
+}
+
+#ifdef __WXMSW__
+
+bool ThumbnailCache::map(const String& filename, size_t size) {
+	bool created = !wxFileExists(filename);
+	file = CreateFileW(filename.wc_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+	                   nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size) || (size_t)file_size.QuadPart != size) created = true;
+	// the mapping grows the file if needed
+	mapping = CreateFileMappingW(file, nullptr, PAGE_READWRITE, 0, (DWORD)size, nullptr);
+	if (mapping) {
+		data = (Byte*)MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	}
+	if (!data) unmap();
+	return created;
+}
+
+void ThumbnailCache::unmap() {
+	if (data)    UnmapViewOfFile(data);
+	if (mapping) CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+	data    = nullptr;
+	mapping = nullptr;
+	file    = INVALID_HANDLE_VALUE;
+}
+
+void ThumbnailCache::lockFile() {
+	OVERLAPPED overlapped = {};
+	LockFileEx(file, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &overlapped);
+}
+
+void ThumbnailCache::unlockFile() {
+	OVERLAPPED overlapped = {};
+	UnlockFileEx(file, 0, MAXDWORD, MAXDWORD, &overlapped);
+}
+
+#else
+
+bool ThumbnailCache::map(const String& filename, size_t size) {
+	bool created = false;
+	file = ::open(filename.fn_str(), O_RDWR | O_CREAT, 0644);
+	if (file < 0) return false;
+	struct stat st;
+	if (fstat(file, &st) != 0 || (size_t)st.st_size != size) {
+		created = true;
+		if (ftruncate(file, (off_t)size) != 0) {
+			unmap();
+			return false;
+		}
+	}
+	void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+	if (p == MAP_FAILED) {
+		unmap();
+		return false;
+	}
+	data = (Byte*)p;
+	return created;
+}
+
+void ThumbnailCache::unmap() {
+	if (data) munmap(data, THUMBNAIL_CACHE_FILE_SIZE);
+	if (file >= 0) ::close(file);
+	data = nullptr;
+	file = -1;
+}
+
+void ThumbnailCache::lockFile() {
+	while (flock(file, LOCK_EX) != 0 && errno == EINTR) {}
+}
+
+void ThumbnailCache::unlockFile() {
+	flock(file, LOCK_UN);
+}
+
+#endif
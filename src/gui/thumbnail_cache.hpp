@@ -0,0 +1,78 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) 2001 - 2012 Twan van Laarhoven and Sean Hunt             |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+#ifndef HEADER_GUI_THUMBNAIL_CACHE
+#define HEADER_GUI_THUMBNAIL_CACHE
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <wx/datetime.h>
+#include <wx/thread.h>
+
+struct ThumbnailCacheHeader;
+struct ThumbnailCacheSlot;
+
+// ----------------------------------------------------------------------------- : ThumbnailCache
+
+/// The thumbnails generated by the ThumbnailThread, stored in a single memory mapped file
+/** The file is a hash table with a fixed number of slots, each slot holds a single small thumbnail
+ *  in the same layout as a wxImage (RGB data followed by alpha), so loading a thumbnail needs no decoding.
+ *  A name can only be stored in one of a small set of slots, when they are all used the least recently used one is replaced.
+ *
+ *  Thumbnails that are too large for a slot are not stored, the ThumbnailThread keeps those in separate png files.
+ *  When the file is created, the thumbnails stored as separate png files by older versions are moved into it.
+ *
+ *  Can be used from multiple threads. The file is shared between all running instances of the program,
+ *  they take a lock on the whole file while using it.
+ */
+class ThumbnailCache {
+  public:
+	ThumbnailCache();
+	~ThumbnailCache();
+
+	/// Find a thumbnail that was stored at or after the given modification time
+	/** Returns an invalid image if there is no such thumbnail */
+	Image find(const String& name, const wxDateTime& modified);
+	/// Store a thumbnail, returns false if it can not be stored
+	bool store(const String& name, const wxDateTime& modified, const Image& image);
+
+  private:
+	wxMutex mutex;
+	bool    opened; ///< Has the file been opened (or have we tried)?
+	Byte*   data;   ///< The mapped file, or nullptr if it could not be mapped
+	#ifdef __WXMSW__
+		void* file;
+		void* mapping;
+	#else
+		int   file;
+	#endif
+
+	/// Open and map the file; call with the mutex locked
+	void open();
+	/// Map the file, returns true if it was just created
+	bool map(const String& filename, size_t size);
+	/// Unmap and close the file
+	void unmap();
+	/// Lock the file for use by this process, for the lifetime of the object
+	class FileLocker;
+	void lockFile();
+	void unlockFile();
+	/// Move png thumbnails from older versions into the cache; call with the mutex locked
+	void migrate();
+
+	ThumbnailCacheHeader& header();
+	/// Find the slot used for a name, or an unused slot for it if create is set
+	ThumbnailCacheSlot* findSlot(const String& name, bool create);
+	/// Store a thumbnail; call with the mutex locked
+	bool storeLocked(const String& name, const wxDateTime& modified, const Image& image);
+};
+
+/// The global thumbnail cache
+extern ThumbnailCache thumbnail_cache;
+
+// ----------------------------------------------------------------------------- : EOF
+#endif
@@ -8,8 +8,10 @@
 
 #include <util/prec.hpp>
 #include <gui/thumbnail_thread.hpp>
+#include <gui/thumbnail_cache.hpp>
 #include <util/platform.hpp>
 #include <util/error.hpp>
+#include <util/parallel.hpp>
 #include <wx/thread.h>
 
 using std::make_pair;
@@ -39,6 +41,28 @@ String safe_filename(const String& str) {
 	return ret;
 }
 
+/// Generate the thumbnail for a request, and store it in the image cache
+Image generate_thumbnail(ThumbnailRequest& request) {
+	Image img;
+	try {
+		img = request.generate();
+	} catch (const Error& e) {
+		handle_error(e);
+	} catch (...) {
+	}
+	// store in cache
+	String name = safe_filename(request.cache_name);
+	if (img.Ok() && !thumbnail_cache.store(name, request.modified, img)) {
+		// too large for the cache
+		String filename = image_cache_dir() + name + _(".png");
+		img.SaveFile(filename, wxBITMAP_TYPE_PNG);
+		// set modification time
+		wxFileName fn(filename);
+		fn.SetTimes(0, &request.modified, 0);
+	}
+	return img;
+}
+
 // ----------------------------------------------------------------------------- : ThumbnailThreadWorker
 
 class ThumbnailThreadWorker : public wxThread {
@@ -47,55 +71,46 @@ class ThumbnailThreadWorker : public wxThread {
 	
 	virtual ExitCode Entry();
 	
-	ThumbnailRequestP current; ///< Request we are working on
 	ThumbnailThread*  parent;
-	bool              stop; ///< Suspend computation
 };
 
 ThumbnailThreadWorker::ThumbnailThreadWorker(ThumbnailThread* parent)
-	: parent(parent)
-	, stop(false)
+	: wxThread(wxTHREAD_JOINABLE)
+	, parent(parent)
 {}
 
 wxThread::ExitCode ThumbnailThreadWorker::Entry() {
+	ThumbnailThread& t = *parent;
+	t.mutex.Lock();
 	while (true) {
-		do {
-			Sleep(1);
-		} while (stop);
-		// get a request
-		{
-			wxMutexLocker lock(parent->mutex);
-			if (parent->open_requests.empty()) {
-				parent->worker = nullptr;
-				return 0; // No more requests
-			}
-			current = parent->open_requests.front();
-			parent->open_requests.pop_front();
+		// wait for a job
+		while (!t.stop && t.queue.empty()) {
+			t.idle_workers++;
+			t.work_available.Wait();
+			t.idle_workers--;
 		}
+		if (t.stop) break;
+		ThumbnailThread::JobP job = *t.queue.begin();
+		t.queue.erase(t.queue.begin());
+		job->generating = job->requests.front();
 		// perform request
-		Image img;
-		try {
-			img = current->generate();
-		} catch (const Error& e) {
-			handle_error(e);
-		} catch (...) {
+		ThumbnailRequestP request = job->generating;
+		t.mutex.Unlock();
+		Image img = generate_thumbnail(*request);
+		t.mutex.Lock();
+		// store result in closed request list, for all requests that still want it
+		for (const auto& r : job->requests) {
+			t.closed_requests.push_back(make_pair(r,img));
 		}
-		// store in cache
-		if (img.Ok()) {
-			String filename = image_cache_dir() + safe_filename(current->cache_name) + _(".png");
-			img.SaveFile(filename, wxBITMAP_TYPE_PNG);
-			// set modification time
-			wxFileName fn(filename);
-			fn.SetTimes(0, &current->modified, 0);
-		}
-		// store result in closed request list
-		{
-			wxMutexLocker lock(parent->mutex);
-			parent->closed_requests.push_back(make_pair(current,img));
-			current = ThumbnailRequestP();
-			parent->completed.Signal();
+		job->generating = ThumbnailRequestP();
+		map<String,ThumbnailThread::JobP>::iterator it = t.jobs.find(request->cache_name);
+		if (it != t.jobs.end() && it->second == job) {
+			t.jobs.erase(it);
 		}
+		t.completed.Broadcast();
 	}
+	t.mutex.Unlock();
+	return 0;
 }
 
 bool operator < (const ThumbnailRequestP& a, const ThumbnailRequestP& b) {
@@ -109,18 +124,41 @@ bool operator < (const ThumbnailRequestP& a, const ThumbnailRequestP& b) {
 ThumbnailThread thumbnail_thread;
 
 ThumbnailThread::ThumbnailThread()
-	: completed(mutex)
-	, worker(nullptr)
+	: work_available(mutex)
+	, completed(mutex)
+	, next_order(0)
+	, idle_workers(0)
+	, stop(false)
 {}
 
+bool ThumbnailThread::JobOrder::operator () (const JobP& a, const JobP& b) const {
+	if (a->priority != b->priority) return a->priority > b->priority;
+	return a->order < b->order;
+}
+
 void ThumbnailThread::request(const ThumbnailRequestP& request) {
 	assert(wxThread::IsMain());
 	// Is the request in progress?
 	if (request_names.find(request) != request_names.end()) {
+		// then make sure it is done soon enough
+		wxMutexLocker lock(mutex);
+		map<String,JobP>::iterator it = jobs.find(request->cache_name);
+		if (it != jobs.end() && !it->second->generating && it->second->priority < request->priority) {
+			JobP job = it->second;
+			queue.erase(job);
+			job->priority = request->priority;
+			queue.insert(job);
+		}
 		return;
 	}
 	// Is the image in the cache?
-	String filename = image_cache_dir() + safe_filename(request->cache_name) + _(".png");
+	String name = safe_filename(request->cache_name);
+	Image cached = thumbnail_cache.find(name, request->modified);
+	if (cached.Ok()) {
+		request->store(cached);
+		return;
+	}
+	String filename = image_cache_dir() + name + _(".png");
 	wxFileName fn(filename);
 	if (fn.FileExists()) {
 		wxDateTime modified;
@@ -134,41 +172,69 @@ void ThumbnailThread::request(const ThumbnailRequestP& request) {
 	if (request->threadSafe()) {
 		request_names.insert(request);
 		// request generation
+		wxMutexLocker lock(mutex);
+		queueRequest(request);
+	}
+	else {
+		Image img = generate_thumbnail(*request);
 		{
 			wxMutexLocker lock(mutex);
-			open_requests.push_back(request);
-		}
-		// is there a worker?
-		if (!worker) {
-			worker = new ThumbnailThreadWorker(this);
-			worker->Create();
-			worker->Run();
+			closed_requests.push_back(make_pair(request,img));
+			completed.Broadcast();
 		}
 	}
-	else {
-		Image img;
-		try {
-			img = request->generate();
-		} catch (const Error& e) {
-			handle_error(e);
-		} catch (...) {
+}
+
+void ThumbnailThread::queueRequest(const ThumbnailRequestP& request) {
+	// is the same thumbnail already requested by someone else?
+	map<String,JobP>::iterator it = jobs.find(request->cache_name);
+	if (it != jobs.end()) {
+		JobP job = it->second;
+		job->requests.push_back(request);
+		if (!job->generating && job->priority < request->priority) {
+			queue.erase(job);
+			job->priority = request->priority;
+			queue.insert(job);
 		}
-		// store in cache
-		if (img.Ok()) {
-			String filename = image_cache_dir() + safe_filename(request->cache_name) + _(".png");
-			img.SaveFile(filename, wxBITMAP_TYPE_PNG);
-			// set modification time
-			wxFileName fn(filename);
-			fn.SetTimes(0, &request->modified, 0);
+		return;
+	}
+	// a new job
+	JobP job(new Job);
+	job->requests.push_back(request);
+	job->priority = request->priority;
+	job->order    = next_order++;
+	jobs.insert(make_pair(request->cache_name, job));
+	queue.insert(job);
+	// is there a worker for it?
+	if (queue.size() > idle_workers && workers.size() < (size_t)parallel_thread_count()) {
+		ThumbnailThreadWorker* worker = new ThumbnailThreadWorker(this);
+		if (worker->Create() == wxTHREAD_NO_ERROR && worker->Run() == wxTHREAD_NO_ERROR) {
+			workers.push_back(worker);
+		} else {
+			delete worker;
 		}
-		{
-			wxMutexLocker lock(mutex);
-			closed_requests.push_back(make_pair(request,img));
-			completed.Signal();
+	}
+	work_available.Signal();
+}
+
+void ThumbnailThread::removeRequests(Job& job, void* owner) {
+	for (size_t i = 0 ; i < job.requests.size() ; ) {
+		if (job.requests[i]->owner == owner) {
+			request_names.erase(job.requests[i]);
+			job.requests.erase(job.requests.begin() + i);
+		} else {
+			++i;
 		}
 	}
 }
 
+bool ThumbnailThread::isGenerating(void* owner) const {
+	for(const auto& j : jobs) {
+		if (j.second->generating && j.second->generating->owner == owner) return true;
+	}
+	return false;
+}
+
 bool ThumbnailThread::done(void* owner) {
 	assert(wxThread::IsMain());
 	// find finished requests
@@ -195,26 +261,41 @@ bool ThumbnailThread::done(void* owner) {
 	return !finished.empty();
 }
 
-void ThumbnailThread::abort(void* owner) {
+void ThumbnailThread::cancel(void* owner) {
 	assert(wxThread::IsMain());
-	mutex.Lock();
-	if (worker && worker->current && worker->current->owner == owner) {
-		// a request for this owner is in progress, wait until it is done
-		worker->stop = true;
-		completed.Wait();
-		mutex.Lock();
-		worker->stop = false;
+	wxMutexLocker lock(mutex);
+	for (map<String,JobP>::iterator it = jobs.begin() ; it != jobs.end() ; ) {
+		JobP job = it->second;
+		if (!job->generating) {
+			removeRequests(*job, owner);
+			if (job->requests.empty()) {
+				queue.erase(job);
+				jobs.erase(it++);
+				continue;
+			}
+		}
+		++it;
 	}
+}
+
+void ThumbnailThread::abort(void* owner) {
+	assert(wxThread::IsMain());
+	wxMutexLocker lock(mutex);
 	// remove open requests for this owner
-	for (size_t i = 0 ; i < open_requests.size() ; ) {
-		if (open_requests[i]->owner == owner) {
-			// remove
-			request_names.erase(open_requests[i]);
-			open_requests.erase(open_requests.begin() + i, open_requests.begin() + i + 1);
+	for (map<String,JobP>::iterator it = jobs.begin() ; it != jobs.end() ; ) {
+		JobP job = it->second;
+		removeRequests(*job, owner);
+		if (job->requests.empty() && !job->generating) {
+			queue.erase(job);
+			jobs.erase(it++);
 		} else {
-			++i;
+			++it;
 		}
 	}
+	// a request for this owner is in progress, wait until it is done
+	while (isGenerating(owner)) {
+		completed.Wait();
+	}
 	// remove closed requests for this owner
 	for (size_t i = 0 ; i < closed_requests.size() ; ) {
 		if (closed_requests[i].first->owner == owner) {
@@ -225,23 +306,27 @@ void ThumbnailThread::abort(void* owner) {
 			++i;
 		}
 	}
-	mutex.Unlock();
 }
 
 void ThumbnailThread::abortAll() {
 	assert(wxThread::IsMain());
-	mutex.Lock();
-	open_requests.clear();
-	closed_requests.clear();
-	request_names.clear();
-	// end worker
-	if (worker && worker->current) {
-		completed.Wait();
-	} else {
-		mutex.Unlock();
+	{
+		wxMutexLocker lock(mutex);
+		queue.clear();
+		for(auto& j : jobs) {
+			j.second->requests.clear();
+		}
+		closed_requests.clear();
+		request_names.clear();
+		// end workers, they finish the request they are working on first
+		stop = true;
+		work_available.Broadcast();
+	}
+	for(auto& w : workers) {
+		w->Wait();
+		delete w;
 	}
-	// There may still be a worker, but if there is, it has no current object, so it is
-	// in, before or after the stop loop. It can do nothing but end.
-	// An unfortunate side effect is that we might leak some memory (of the worker object),
-	// when the thread gets Kill()ed by wx.
+	workers.clear();
+	jobs.clear();
+	stop = false;
 }
@@ -12,7 +12,6 @@
 #include <util/prec.hpp>
 #include <wx/datetime.h>
 #include <wx/filename.h>
-#include <queue>
 
 DECLARE_POINTER_TYPE(ThumbnailRequest);
 class ThumbnailThreadWorker;
@@ -22,8 +21,8 @@ class ThumbnailThreadWorker;
 /// A request for some kind of thumbnail
 class ThumbnailRequest : public IntrusivePtrVirtualBase {
   public:
-	ThumbnailRequest(void* owner, const String& cache_name, const wxDateTime& modified)
-		: owner(owner), cache_name(cache_name), modified(modified) {}
+	ThumbnailRequest(void* owner, const String& cache_name, const wxDateTime& modified, int priority = 0)
+		: owner(owner), cache_name(cache_name), modified(modified), priority(priority) {}
 
 	virtual ~ThumbnailRequest() {}
 
@@ -41,25 +40,34 @@ class ThumbnailRequest : public IntrusivePtrVirtualBase {
 	String cache_name;
 	/// Modification time for the object of which the thumnail is generated
 	wxDateTime modified;
+	/// Requests with a higher priority are generated first, for example because they are visible
+	int priority;
 };
 
 // ----------------------------------------------------------------------------- : ThumbnailThread
 
-/// A (generic) class that generates thumbnails in another thread
+/// A (generic) class that generates thumbnails in other threads
 /** All requests have an 'owner', the object that requested the thumbnail.
  *  This object should regularly call "done(this)".
  *  Multiple requests can be open at the same time.
  *  Thumbnails are cached, and need not be generated in a thread
+ *
+ *  Requests are handled by a pool of worker threads, highest priority first, and otherwise in order.
+ *  Requests with the same cache_name are only generated once, the result goes to all of them.
  */
 class ThumbnailThread {
   public:
 	ThumbnailThread();
 
 	/// Request a thumbnail, it may be store()d immediatly if the thumbnail is cached
+	/** If the same request is still open, its priority is raised instead */
 	void request(const ThumbnailRequestP& request);
 	/// Is one or more thumbnail for the given owner finished?
 	/** If so, call their store() functions */
 	bool done(void* owner);
+	/// Cancel the requests for the given owner that are not being worked on yet
+	/** Unlike abort, this does not wait, and finished requests are kept */
+	void cancel(void* owner);
 	/// Abort all thumbnail requests for the given owner
 	void abort(void* owner);
 	/// Abort all computations
@@ -67,18 +75,44 @@ class ThumbnailThread {
 	void abortAll();
 
   private:
-	wxMutex     mutex;  ///< Mutex used by the worker when accessing the request lists or the thread pointer
-	wxCondition completed; ///< Event signaled when a request is completed
-
-	/// Requests on which work hasn't finished
-	std::deque<ThumbnailRequestP>           open_requests;
+	/// A thumbnail to generate, for one or more requests with the same cache_name
+	struct Job : public IntrusivePtrBase<Job> {
+		vector<ThumbnailRequestP> requests;  ///< Requests waiting for this thumbnail
+		ThumbnailRequestP         generating; ///< The request whose generate() is running, if any
+		int                       priority;
+		size_t                    order;      ///< Jobs with the same priority are done in order
+	};
+	typedef intrusive_ptr<Job> JobP;
+	/// Order of the jobs in the queue, the first job is done first
+	struct JobOrder {
+		bool operator () (const JobP& a, const JobP& b) const;
+	};
+
+	wxMutex     mutex;          ///< Mutex used by the workers when accessing the request lists
+	wxCondition work_available; ///< Event signaled when a job is queued, or when the workers should stop
+	wxCondition completed;      ///< Event signaled when a job is completed
+
+	/// Jobs on which work hasn't started
+	set<JobP,JobOrder>                      queue;
+	/// Jobs that are queued or being worked on, by cache_name
+	map<String,JobP>                        jobs;
+	size_t                                  next_order;
 	/// Requests for which work is completed
 	vector<std::pair<ThumbnailRequestP,Image> >  closed_requests;
 	/// Requests that haven't been stored yet, to prevent duplicates
 	set<ThumbnailRequestP>                  request_names;
-	/// The worker thread. invariant: no requests ==> worker==nullptr
+	/// The worker threads, started when needed
 	friend class ThumbnailThreadWorker;
-	ThumbnailThreadWorker* worker;
+	vector<ThumbnailThreadWorker*>          workers;
+	size_t                                  idle_workers;
+	bool                                    stop; ///< Should the workers end?
+
+	/// Queue a thread safe request; call with the mutex locked
+	void queueRequest(const ThumbnailRequestP& request);
+	/// Remove the requests for the given owner from a job; call with the mutex locked
+	void removeRequests(Job& job, void* owner);
+	/// Is a job for the given owner being generated?; call with the mutex locked
+	bool isGenerating(void* owner) const;
 };
 
 /// The global thumbnail generator thread
@@ -11,6 +11,7 @@
 #include "util/error.hpp"
 #include "util/rotation.hpp"
 #include "util/paths.hpp"
+#include "gfx/headless_dc.hpp"
 #include <wx/renderer.h>
 
 #if wxUSE_UXTHEME && defined(__WXMSW__)
@@ -311,6 +312,13 @@ void draw_drop_down_arrow(Window* win, DC& dc, const wxRect& rect, bool active)
 		, active ? wxCONTROL_PRESSED : 0);
 }
 
+/// Color for drawing check and radio boxes
+/** When exporting without a display there are no system colors, so use the usual ones. */
+Color checkbox_color(bool enabled) {
+	if (headless_rendering()) return enabled ? *wxBLACK : Color(128,128,128);
+	return wxSystemSettings::GetColour(enabled ? wxSYS_COLOUR_WINDOWTEXT: wxSYS_COLOUR_GRAYTEXT);
+}
+
 void draw_checkbox(Window* win, DC& dc, const wxRect& rect, bool checked, bool enabled) {
 	#if wxUSE_UXTHEME && defined(__WXMSW__)
 		// TODO: Windows version?
@@ -319,7 +327,7 @@ void draw_checkbox(Window* win, DC& dc, const wxRect& rect, bool checked, bool e
 	if (checked) {
 		dc.DrawCheckMark(wxRect(rect.x-1,rect.y-1,rect.width+2,rect.height+2));
 	}
-	dc.SetPen(wxSystemSettings::GetColour(enabled ? wxSYS_COLOUR_WINDOWTEXT: wxSYS_COLOUR_GRAYTEXT));
+	dc.SetPen(checkbox_color(enabled));
 	dc.SetBrush(*wxTRANSPARENT_BRUSH);
 	dc.DrawRectangle(rect.x, rect.y, rect.width, rect.height);
 }
@@ -332,12 +340,12 @@ void draw_radiobox(Window* win, DC& dc, const wxRect& rect, bool checked, bool e
 	#if 1
 		// circle drawing on windows looks absolutely horrible
 		// so use rounded rectangles instead
-		dc.SetPen(wxSystemSettings::GetColour(enabled ? wxSYS_COLOUR_WINDOWTEXT: wxSYS_COLOUR_GRAYTEXT));
+		dc.SetPen(checkbox_color(enabled));
 		dc.SetBrush(*wxTRANSPARENT_BRUSH);
 		//dc.DrawEllipse(rect.x, rect.y, rect.width, rect.height);
 		dc.DrawRoundedRectangle(rect.x, rect.y, rect.width, rect.height, rect.width*0.5-1);
 		if (checked) {
-			dc.SetBrush(wxSystemSettings::GetColour(enabled ? wxSYS_COLOUR_WINDOWTEXT: wxSYS_COLOUR_GRAYTEXT));
+			dc.SetBrush(checkbox_color(enabled));
 			dc.SetPen(*wxTRANSPARENT_PEN);
 			//dc.DrawEllipse(rect.x+2,rect.y+2,rect.width-4,rect.height-4);
 			dc.DrawRoundedRectangle(rect.x+3, rect.y+3, rect.width-6, rect.height-6, rect.width*0.5-4);
@@ -21,7 +21,7 @@ using std::make_pair;
 
 class ChoiceThumbnailRequest : public ThumbnailRequest {
   public:
-	ChoiceThumbnailRequest(ValueViewer* cve, int id, bool from_disk, bool thread_safe);
+	ChoiceThumbnailRequest(ValueViewer* cve, int id, bool from_disk, bool thread_safe, int priority);
 	virtual Image generate();
 	virtual void store(const Image&);
 
@@ -34,12 +34,13 @@ class ChoiceThumbnailRequest : public ThumbnailRequest {
 	inline ValueViewer& viewer() { return *static_cast<ValueViewer*>(owner); }
 };
 
-ChoiceThumbnailRequest::ChoiceThumbnailRequest(ValueViewer* viewer, int id, bool from_disk, bool thread_safe)
+ChoiceThumbnailRequest::ChoiceThumbnailRequest(ValueViewer* viewer, int id, bool from_disk, bool thread_safe, int priority)
 	: ThumbnailRequest(
 		static_cast<void*>(viewer),
 		viewer->getStylePackage().name() + _("/") + viewer->getField()->name + _("/") << id,
 		from_disk ? viewer->getStylePackage().lastModified()
-		          : wxDateTime::Now()
+		          : wxDateTime::Now(),
+		priority
 	)
 	, isThreadSafe(thread_safe)
 	, id(id)
@@ -191,7 +192,11 @@ void DropDownChoiceListBase::generateThumbnailImages() {
 			}
 		}
 	}
-	// request thumbnails
+	// request thumbnails, first the ones that are visible without opening a submenu
+	vector<bool> visible(end, false);
+	for(const auto& c : group->choices) {
+		if (c->first_id >= 0 && c->first_id < end) visible[c->first_id] = true;
+	}
 	style().thumbnails_status.resize(end, THUMB_NOT_MADE);
 	for (int i = 0 ; i < end ; ++i) {
 		ThumbnailStatus& status = style().thumbnails_status[i];
@@ -205,7 +210,7 @@ void DropDownChoiceListBase::generateThumbnailImages() {
 			} else if (img.isReady()) {
 				// request this thumbnail
 				thumbnail_thread.request( intrusive(new ChoiceThumbnailRequest(
-						&cve, i, status == THUMB_NOT_MADE && !img.local(), img.threadSafe()
+						&cve, i, status == THUMB_NOT_MADE && !img.local(), img.threadSafe(), visible[i] ? 1 : 0
 					)));
 			}
 		}
@@ -23,6 +23,8 @@
 #include <gui/set/window.hpp>
 #include <gui/symbol/window.hpp>
 #include <gui/thumbnail_thread.hpp>
+#include <util/parallel.hpp>
+#include <gfx/image_cache.hpp>
 #include <wx/fs_inet.h>
 #include <wx/wfstream.h>
 #include <wx/txtstrm.h>
@@ -59,7 +61,40 @@ class MSE : public wxApp {
 	#endif
 };
 
-IMPLEMENT_APP(MSE)
+#ifndef __WXGTK__
+	IMPLEMENT_APP(MSE)
+#else
+	IMPLEMENT_APP_NO_MAIN(MSE)
+	IMPLEMENT_WX_THEME_SUPPORT
+	
+	/// Application class for exporting from the command line when there is no X or Wayland display
+	/** The GUI toolkit can not be initialized without a display, so this is a console application,
+	 *  and card images are drawn on a HeadlessDC (see headless_rendering()).
+	 *  Only the --export and --export-images commands are supported.
+	 */
+	class HeadlessApp : public wxAppConsole {
+	  public:
+		bool OnInit() { return true; }
+		int OnRun();
+		int OnExit();
+	};
+	
+	/// Can the command line arguments be handled without a display?
+	bool run_headless(int argc, char** argv) {
+		if (argc < 2) return false;
+		String command(argv[1], wxConvLocal);
+		if (command != _("--export") && command != _("--export-images")) return false;
+		return !getenv("DISPLAY") && !getenv("WAYLAND_DISPLAY");
+	}
+	
+	int main(int argc, char** argv) {
+		if (run_headless(argc, argv)) {
+			// wxEntry uses this application object instead of creating an MSE
+			wxApp::SetInstance(new HeadlessApp);
+		}
+		return wxEntry(argc, argv);
+	}
+#endif
 
 // ----------------------------------------------------------------------------- : Checks
 
@@ -79,32 +114,101 @@ void nag_about_ascii_version() {
 
 // ----------------------------------------------------------------------------- : Initialization
 
+/// Initialization for both the GUI and the headless application
+void init_mse(wxAppConsole& app) {
+	#ifdef __WXMSW__
+		app.SetAppName(_("Magic Set Editor"));
+	#else
+		// Platform friendly appname
+		app.SetAppName(_("magicseteditor"));
+	#endif
+	wxInitAllImageHandlers();
+	wxFileSystem::AddHandler(new wxInternetFSHandler); // needed for update checker
+	wxSocketBase::Initialize();
+	init_script_variables();
+	init_file_formats();
+	cli.init();
+	package_manager.init();
+	settings.read();
+	the_locale = Locale::byName(settings.locale);
+}
+
+/// The command line arguments, without the program name
+vector<String> command_line_args(wxAppConsole& app) {
+	vector<String> args;
+	for (int i = 1 ; i < app.argc ; ++i) {
+		args.push_back(app.argv[i]);
+		if (args.back() == _("--color")) args.pop_back(); // ingnore the --color argument, it is handled by cli.init()
+	}
+	return args;
+}
+
+// ----------------------------------------------------------------------------- : Export commands
+
+/// Handle mse --export-images SETFILE [IMAGE] [--jobs N]
+int export_images_command(const vector<String>& args) {
+	vector<String> files;
+	long jobs = 1;
+	for (size_t i = 1 ; i < args.size() ; ++i) {
+		String const& arg = args[i];
+		if ((arg == _("-j") || arg == _("--jobs")) && i+1 < args.size()) {
+			if (!args[i+1].ToLong(&jobs) || jobs < 1) {
+				throw Error(_("Invalid number of jobs: ") + args[i+1]);
+			}
+			++i;
+		} else {
+			files.push_back(arg);
+		}
+	}
+	if (files.empty()) {
+		throw Error(_("No input file specified for --export-images"));
+	}
+	SetP set = import_set(files[0]);
+	// path
+	String out = files.size() >= 2
+			   ? files[1]
+			   : settings.gameSettingsFor(*set->game).images_export_filename;
+	String path = _(".");
+	size_t pos = out.find_last_of(_("/\\"));
+	if (pos != String::npos) {
+		path = out.substr(0, pos);
+		if (!wxDirExists(path)) wxMkdir(path);
+		path += _("/x");
+		out  = out.substr(pos + 1);
+	}
+	// export
+	export_images(set, set->cards, path, out, CONFLICT_NUMBER_OVERWRITE, (int)jobs);
+	return EXIT_SUCCESS;
+}
+
+/// Handle mse --export TEMPLATE SETFILE [OUTFILE]
+int export_command(const vector<String>& args) {
+	if (args.size() < 2) {
+		throw Error(_("No export template specified for --export"));
+	} else if (args.size() < 3) {
+		throw Error(_("No input set file specified for --export"));
+	}
+	String export_template = args[1];
+	ExportTemplateP exp = ExportTemplate::byName(export_template);
+	SetP set = import_set(args[2]);
+	String out = args.size() >= 4 ? args[3] : _("");
+	ScriptValueP result = export_set(set, set->cards, exp, out);
+	if (out.empty()) {
+		cli << result->toString();
+	}
+	return EXIT_SUCCESS;
+}
+
+// ----------------------------------------------------------------------------- : MSE
+
 int MSE::OnRun() {
 	try {
-		#ifdef __WXMSW__
-			SetAppName(_("Magic Set Editor"));
-		#else
-			// Platform friendly appname
-			SetAppName(_("magicseteditor"));
-		#endif
-		wxInitAllImageHandlers();
-		wxFileSystem::AddHandler(new wxInternetFSHandler); // needed for update checker
-		wxSocketBase::Initialize();
-		init_script_variables();
-		init_file_formats();
-		cli.init();
-		package_manager.init();
-		settings.read();
-		the_locale = Locale::byName(settings.locale);
+		init_mse(*this);
 		nag_about_ascii_version();
 		
 		// interpret command line
 		{
-			vector<String> args;
-			for (int i = 1 ; i < argc ; ++i) {
-				args.push_back(argv[i]);
-				if (args.back() == _("--color")) args.pop_back(); // ingnore the --color argument, it is handled by cli.init()
-			}
+			vector<String> args = command_line_args(*this);
 			if (!args.empty()) {
 				// Find the extension
 				wxFileName f(args[0].Mid(0,args[0].find_last_not_of(_("\\/"))+1));
@@ -180,9 +284,11 @@ int MSE::OnRun() {
 					cli << _("\n\n  ") << BRIGHT << _("--export") << NORMAL << PARAM << _(" TEMPLATE SETFILE ") << NORMAL << _(" [") << PARAM << _("OUTFILE") << NORMAL << _("]");
 					cli << _("\n         \tExport a set using an export template.");
 					cli << _("\n         \tIf no output filename is specified, the result is written to stdout.");
-					cli << _("\n\n  ") << BRIGHT << _("--export-images") << NORMAL << PARAM << _(" SETFILE") << NORMAL << _(" [") << PARAM << _("IMAGE") << NORMAL << _("]");
+					cli << _("\n\n  ") << BRIGHT << _("--export-images") << NORMAL << PARAM << _(" SETFILE") << NORMAL << _(" [") << PARAM << _("IMAGE") << NORMAL << _("] [")
+									   << BRIGHT << _("--jobs ") << NORMAL << PARAM << _("N") << NORMAL << _("]");
 					cli << _("\n         \tExport the cards in a set to image files,");
 					cli << _("\n         \tIMAGE is the same format as for 'export all card images'.");
+					cli << _("\n         \tUse ") << BRIGHT << _("-j") << NORMAL << _(" or ") << BRIGHT << _("--jobs") << NORMAL << _(" to write the images using N threads.");
 					cli << _("\n\n  ") << BRIGHT << _("--cli") << NORMAL << _(" [")
 									   << BRIGHT << _("--quiet") << NORMAL << _("] [")
 									   << BRIGHT << _("--raw") << NORMAL << _("] [")
@@ -242,40 +348,9 @@ int MSE::OnRun() {
 					}
 					return EXIT_SUCCESS;
 				} else if (args[0] == _("--export-images")) {
-					if (args.size() < 2) {
-						throw Error(_("No input file specified for --export-images"));
-					}
-					SetP set = import_set(args[1]);
-					// path
-					String out = args.size() >= 3
-							   ? args[2]
-							   : settings.gameSettingsFor(*set->game).images_export_filename;
-					String path = _(".");
-					size_t pos = out.find_last_of(_("/\\"));
-					if (pos != String::npos) {
-						path = out.substr(0, pos);
-						if (!wxDirExists(path)) wxMkdir(path);
-						path += _("/x");
-						out  = out.substr(pos + 1);
-					}
-					// export
-					export_images(set, set->cards, path, out, CONFLICT_NUMBER_OVERWRITE);
-					return EXIT_SUCCESS;
+					return export_images_command(args);
 				} else if (args[0] == _("--export")) {
-					if (args.size() < 2) {
-						throw Error(_("No export template specified for --export"));
-					} else if (args.size() < 3) {
-						throw Error(_("No input set file specified for --export"));
-					}
-					String export_template = args[1];
-					ExportTemplateP exp = ExportTemplate::byName(export_template);
-					SetP set = import_set(args[2]);
-					String out = args.size() >= 4 ? args[3] : _("");
-					ScriptValueP result = export_set(set, set->cards, exp, out);
-					if (out.empty()) {
-						cli << result->toString();
-					}
-					return EXIT_SUCCESS;
+					return export_command(args);
 				} else {
 					throw Error(_("Invalid command line argument: ") + args[0]);
 				}
@@ -298,14 +373,45 @@ int MSE::runGUI() {
 
 // ----------------------------------------------------------------------------- : Exit
 
-int MSE::OnExit() {
+/// Cleanup for both the GUI and the headless application
+void exit_mse() {
 	thumbnail_thread.abortAll();
+	parallel_stop_workers();
 	settings.write();
+	generated_image_cache.clear();
+	clear_interned_images();
 	package_manager.destroy();
 	SpellChecker::destroyAll();
+}
+
+int MSE::OnExit() {
+	exit_mse();
 	return 0;
 }
 
+// ----------------------------------------------------------------------------- : HeadlessApp
+
+#ifdef __WXGTK__
+	int HeadlessApp::OnRun() {
+		try {
+			init_mse(*this);
+			vector<String> args = command_line_args(*this);
+			if (args[0] == _("--export-images")) {
+				return export_images_command(args);
+			} else {
+				return export_command(args);
+			}
+		} CATCH_ALL_ERRORS(true);
+		cli.print_pending_errors();
+		return EXIT_FAILURE;
+	}
+	
+	int HeadlessApp::OnExit() {
+		exit_mse();
+		return 0;
+	}
+#endif
+
 // ----------------------------------------------------------------------------- : Exception handling
 
 void MSE::HandleEvent(wxEvtHandler *handler, wxEventFunction func, wxEvent& event) const {
@@ -10,6 +10,7 @@
 #include <render/symbol/viewer.hpp>
 #include <util/error.hpp> // clearDC_black
 #include <gui/util.hpp> // clearDC_black
+#include <gfx/headless_dc.hpp>
 #include <boost/range/adaptor/reversed.hpp>
 
 
@@ -34,6 +35,12 @@ Image render_symbol(const SymbolP& symbol, double border_radius, int width, int
 		viewer.setOrigin(Vector2D(-(height-width) * 0.5,0));
 		viewer.border_radius *= (double)width / height;
 	}
+	if (headless_rendering()) {
+		HeadlessDC dc(width, height);
+		clearDC(dc, Color(0,128,0));
+		viewer.draw(dc);
+		return dc.getImage();
+	}
 	Bitmap bmp(width, height);
 	wxMemoryDC dc;
 	dc.SelectObject(bmp);
@@ -67,17 +74,20 @@ void SymbolViewer::setOrigin(const Vector2D& origin) {
 
 // ----------------------------------------------------------------------------- : Drawing : Combining
 
-typedef shared_ptr<wxMemoryDC> MemoryDCP;
+typedef shared_ptr<DC> TempDCP;
 
 // Return a temporary DC with the same size as the parameter
-MemoryDCP getTempDC(DC& dc) {
+TempDCP getTempDC(DC& dc) {
 	wxSize s = dc.GetSize();
+	if (dynamic_cast<HeadlessDC*>(&dc)) {
+		return TempDCP(new HeadlessDC(s.GetWidth(), s.GetHeight())); // black
+	}
 	#ifdef __WXMSW__
 		Bitmap buffer(s.GetWidth(), s.GetHeight(), 1);
 	#else
 		Bitmap buffer(s.GetWidth(), s.GetHeight(), 24);
 	#endif
-	MemoryDCP newDC(new wxMemoryDC);
+	shared_ptr<wxMemoryDC> newDC(new wxMemoryDC);
 	newDC->SelectObject(buffer);
 	clearDC(*newDC, *wxBLACK_BRUSH);
 	return newDC;
@@ -95,8 +105,8 @@ void SymbolViewer::draw(DC& dc) {
 	bool buffersFilled    = false;
 	in_symmetry = 0;
 	// Temporary dcs
-	MemoryDCP borderDC;
-	MemoryDCP interiorDC;
+	TempDCP borderDC;
+	TempDCP interiorDC;
 	// Check if we can paint directly to the dc
 	// This will fail if there are parts with combine == intersection
 	for(auto& p : symbol->parts) {
@@ -118,7 +128,7 @@ void SymbolViewer::draw(DC& dc) {
 		drawEditingHints(dc);
 	}
 }
-void SymbolViewer::combineSymbolPart(DC& dc, const SymbolPart& part, bool& paintedSomething, bool& buffersFilled, bool allow_overlap, MemoryDCP& borderDC, MemoryDCP& interiorDC) {
+void SymbolViewer::combineSymbolPart(DC& dc, const SymbolPart& part, bool& paintedSomething, bool& buffersFilled, bool allow_overlap, TempDCP& borderDC, TempDCP& interiorDC) {
 	if (const SymbolShape* s = part.isSymbolShape()) {
 		if (s->combine == SYMBOL_COMBINE_OVERLAP && buffersFilled && allow_overlap) {
 			// We will be overlapping some previous parts, write them to the screen
@@ -231,8 +241,8 @@ void SymbolViewer::combineSymbolShape(const SymbolShape& shape, DC& border, DC&
 			border.SetLogicalFunction(wxCOPY);
 			break;
 		} case SYMBOL_COMBINE_INTERSECTION: {
-			MemoryDCP keepBorder   = getTempDC(border);
-			MemoryDCP keepInterior = getTempDC(interior);
+			TempDCP keepBorder   = getTempDC(border);
+			TempDCP keepInterior = getTempDC(interior);
 			drawSymbolShape(shape, keepBorder.get(), keepInterior.get(), 255, 255, false, false);
 			// combine the temporary dcs with the result using the AND operator
 			wxSize s = border.GetSize();
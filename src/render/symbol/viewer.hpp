@@ -63,12 +63,12 @@ class SymbolViewer : public SymbolView {
 	
 	
   private:
-	typedef shared_ptr<wxMemoryDC> MemoryDCP;
+	typedef shared_ptr<DC> TempDCP;
 	/// Inside a reflection?
 	int in_symmetry;
 	
 	/// Combine a symbol part with the dc
-	void combineSymbolPart(DC& dc, const SymbolPart& part, bool& paintedSomething, bool& buffersFilled, bool allow_overlap, MemoryDCP& borderDC, MemoryDCP& interiorDC);
+	void combineSymbolPart(DC& dc, const SymbolPart& part, bool& paintedSomething, bool& buffersFilled, bool allow_overlap, TempDCP& borderDC, TempDCP& interiorDC);
 	
 	/// Combines a symbol part with what is currently drawn, the border and interior are drawn separatly
 	/** directB/directI are true if the border/interior is the screen dc, false if it
@@ -9,7 +9,9 @@
 #include <util/prec.hpp>
 #include <render/value/image.hpp>
 #include <render/card/viewer.hpp>
+#include <data/settings.hpp>
 #include <gui/util.hpp>
+#include <gfx/headless_dc.hpp>
 
 using std::max;
 
@@ -23,11 +25,12 @@ void ImageValueViewer::draw(RotatedDC& dc) {
 	int w = max(0,(int)dc.trX(style().width)), h = max(0,(int)dc.trY(style().height));
 	Radians a = dc.getAngle();
 	const AlphaMask& alpha_mask = getMask(w,h);
-	if (bitmap.Ok() && (a != angle || size.width != w || size.height != h)) {
+	if ((bitmap.Ok() || image.Ok()) && (a != angle || size.width != w || size.height != h)) {
 		bitmap = Bitmap();
+		image  = Image();
 	}
 	// try to load image
-	if (!bitmap.Ok()) {
+	if (!bitmap.Ok() && !image.Ok()) {
 		angle = a;
 		is_default = false;
 		// load/generate image
@@ -38,8 +41,8 @@ void ImageValueViewer::draw(RotatedDC& dc) {
 		opts.width           = (int)dc.trX(style().width);
 		opts.height          = (int)dc.trY(style().height);
 		opts.preserve_aspect = ASPECT_STRETCH;
+		opts.filter          = settings.image_resample_filter;
 		// TODO: use CachecScriptableImage
-		Image image;
 		try {
 			if (!value().value->isNil()) {
 				image = value().value->toImage()->generateConform(opts);
@@ -50,22 +53,12 @@ void ImageValueViewer::draw(RotatedDC& dc) {
 			image = style().default_image.generate(GeneratedImage::Options(w, h, &getStylePackage(), &getLocalPackage()));
 			is_default = true;
 			if (what & DRAW_EDITING) {
-				bitmap = imagePlaceholder(dc, w, h, image, what & DRAW_EDITING);
-				if (alpha_mask.isLoaded() || !is_rad0(a)) {
-					image = bitmap.ConvertToImage(); // we need to convert back to an image
-				} else {
-					image = Image();
-				}
+				image = imagePlaceholder(dc, w, h, image, what & DRAW_EDITING);
 			}
 		}
 		// checkerboard placeholder
-		if (!image.Ok() && !bitmap.Ok() && style().width > 40) {
-			// placeholder bitmap
-			bitmap = imagePlaceholder(dc, w, h, wxNullImage, what & DRAW_EDITING);
-			if (alpha_mask.isLoaded() || !is_rad0(a)) {
-				// we need to convert back to an image
-				image = bitmap.ConvertToImage();
-			}
+		if (!image.Ok() && style().width > 40) {
+			image = imagePlaceholder(dc, w, h, wxNullImage, what & DRAW_EDITING);
 		}
 		// done
 		if (image.Ok()) {
@@ -73,7 +66,11 @@ void ImageValueViewer::draw(RotatedDC& dc) {
 			alpha_mask.setAlpha(image);
 			size = RealSize(image);
 			image = rotate_image(image, angle);
-			bitmap = Bitmap(image);
+			// bitmaps are faster to draw on the screen, without a display the image is drawn directly
+			if (!headless_rendering()) {
+				bitmap = Bitmap(image);
+				image  = Image();
+			}
 		}
 	}
 	// border
@@ -81,17 +78,21 @@ void ImageValueViewer::draw(RotatedDC& dc) {
 	// draw image, if any
 	if (bitmap.Ok()) {
 		dc.DrawPreRotatedBitmap(bitmap, dc.getInternalRect());
+	} else if (image.Ok()) {
+		dc.DrawPreRotatedImage(image, dc.getInternalRect());
 	}
 }
 
 void ImageValueViewer::onValueChange() {
 	bitmap = Bitmap();
+	image  = Image();
 }
 
 void ImageValueViewer::onStyleChange(int changes) {
 	if ((changes & CHANGE_MASK) ||
 	    ((changes & CHANGE_DEFAULT) && is_default)) {
 		bitmap = Bitmap();
+		image  = Image();
 	}
 	ValueViewer::onStyleChange(changes);
 }
@@ -106,13 +107,20 @@ bool very_light(const Image& image) {
 	return total >= 210 * 3;
 }
 
-Bitmap ImageValueViewer::imagePlaceholder(const Rotation& rot, UInt w, UInt h, const Image& background, bool editing) {
-	// Bitmap and memory dc
-	Bitmap bmp(w, h, 24);
-	wxMemoryDC mdc;
-	mdc.SelectObject(bmp);
+Image ImageValueViewer::imagePlaceholder(const Rotation& rot, UInt w, UInt h, const Image& background, bool editing) {
+	// Bitmap and memory dc, or a headless dc if there is no display
+	scoped_ptr<HeadlessDC> headless;
+	scoped_ptr<wxMemoryDC> mdc;
+	Bitmap bmp;
+	if (headless_rendering()) {
+		headless.reset(new HeadlessDC(w, h));
+	} else {
+		bmp = Bitmap(w, h, 24);
+		mdc.reset(new wxMemoryDC);
+		mdc->SelectObject(bmp);
+	}
 	RealRect rect(0,0,w,h);
-	RotatedDC dc(mdc, 0, rect, 1.0, QUALITY_AA);
+	RotatedDC dc(headless ? static_cast<DC&>(*headless) : *mdc, 0, rect, 1.0, QUALITY_AA);
 	// Draw (checker) background
 	if (!background.Ok() || background.HasAlpha()) {
 		draw_checker(dc, rect);
@@ -139,6 +147,7 @@ Bitmap ImageValueViewer::imagePlaceholder(const Rotation& rot, UInt w, UInt h, c
 		}
 	}
 	// Done
-	mdc.SelectObject(wxNullBitmap);
-	return bmp;
+	if (headless) return headless->getImage();
+	mdc->SelectObject(wxNullBitmap);
+	return bmp.ConvertToImage();
 }
@@ -28,12 +28,13 @@ class ImageValueViewer : public ValueViewer {
 			
   private:
 	Bitmap bitmap; ///< Cached bitmap
+	Image  image;  ///< *or* the cached image, when there is no display (see headless_rendering())
 	RealSize size; ///< Size of cached bitmap
 	Radians angle;  ///< Angle of cached bitmap
 	bool    is_default; ///< Is the default placeholder image used?
 	
 	/// Generate a placeholder image
-	static Bitmap imagePlaceholder(const Rotation& rot, UInt w, UInt h, const Image& background, bool editing);
+	static Image imagePlaceholder(const Rotation& rot, UInt w, UInt h, const Image& background, bool editing);
 };
 
 // ----------------------------------------------------------------------------- : EOF
@@ -9,6 +9,7 @@
 #include <util/prec.hpp>
 #include <render/value/package_choice.hpp>
 #include <util/io/package_manager.hpp>
+#include <gfx/headless_dc.hpp>
 
 
 // ----------------------------------------------------------------------------- : PackageChoiceValueViewer
@@ -36,7 +37,11 @@ void PackageChoiceValueViewer::initItems() {
 		Image image;
 		InputStreamP stream = p->openIconFile();
 		if (stream && image.LoadFile(*stream)) {
-			i.image = Bitmap(resample(image, 16,16));
+			if (headless_rendering()) {
+				i.headless_image = resample(image, 16,16);
+			} else {
+				i.image = Bitmap(resample(image, 16,16));
+			}
 		}
 		items.push_back(i);
 	}
@@ -46,21 +51,23 @@ void PackageChoiceValueViewer::draw(RotatedDC& dc) {
 	drawFieldBorder(dc);
 	// find item
 	String text = value().value->toString();
-	Bitmap image;
+	const Item* item = nullptr;
 	if (text.empty()) {
 		text = field().empty_name;
 	} else {
 		for(auto& i : items) {
 			if (i.package_name == text) {
 				text = i.name;
-				image = i.image;
+				item = &i;
 				break;
 			}
 		}
 	}
 	// draw image
-	if (image.Ok()) {
-		dc.DrawBitmap(image, RealPoint(0,0));
+	if (item && item->image.Ok()) {
+		dc.DrawBitmap(item->image, RealPoint(0,0));
+	} else if (item && item->headless_image.Ok()) {
+		dc.DrawImage(item->headless_image, RealPoint(0,0));
 	}
 	// draw text
 	dc.SetFont(style().font, 1.0);
@@ -26,6 +26,7 @@ class PackageChoiceValueViewer : public ValueViewer {
 		String package_name;
 		String name;
 		Bitmap image;
+		Image  headless_image; ///< *or* the image, when there is no display (see headless_rendering())
 	};
   protected:
 	vector<Item> items;
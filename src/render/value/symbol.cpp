@@ -12,6 +12,7 @@
 #include <render/symbol/filter.hpp>
 #include <data/symbol.hpp>
 #include <gui/util.hpp> // draw_checker
+#include <gfx/headless_dc.hpp>
 #include <util/error.hpp>
 
 using std::max;
@@ -28,7 +29,7 @@ void SymbolValueViewer::draw(RotatedDC& dc) {
 	double wh = min(dc.getWidth(), dc.getHeight());
 	// try to load symbol
 	LocalSymbolFileP symbol_file = dynamic_pointer_cast<LocalSymbolFile>(value().value);
-	if (symbols.empty() && symbol_file) {
+	if (symbols.empty() && headless_symbols.empty() && symbol_file) {
 		try {
 			// load symbol
 			SymbolP symbol = getLocalPackage().readFile<SymbolP>(symbol_file->filename);
@@ -40,7 +41,11 @@ void SymbolValueViewer::draw(RotatedDC& dc) {
 				Image img = render_symbol(symbol, *variation->filter, variation->border_radius, int(200 * ar), 200);
 				Image resampled(int(wh * ar), int(wh), false);
 				resample(img, resampled);
-				symbols.push_back(Bitmap(resampled));
+				if (headless_rendering()) {
+					headless_symbols.push_back(resampled);
+				} else {
+					symbols.push_back(Bitmap(resampled));
+				}
 			}
 		} catch (const Error& e) {
 			handle_error(e);
@@ -53,8 +58,13 @@ void SymbolValueViewer::draw(RotatedDC& dc) {
 		dc.DrawBitmap(symbols[i], RealPoint(x, 0));
 		x += symbols[i].GetWidth() + 2;
 	}
+	for (size_t i = 0 ; i < headless_symbols.size() ; ++i) {
+		dc.DrawImage(headless_symbols[i], RealPoint(x, 0));
+		x += headless_symbols[i].GetWidth() + 2;
+	}
 }
 
 void SymbolValueViewer::onValueChange() {
 	symbols.clear();
+	headless_symbols.clear();
 }
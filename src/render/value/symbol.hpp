@@ -25,6 +25,7 @@ class SymbolValueViewer : public ValueViewer {
 	
   protected:
 	vector<Bitmap> symbols;	///< Cached images
+	vector<Image>  headless_symbols; ///< *or* the cached images, when there is no display (see headless_rendering())
 };
 
 // ----------------------------------------------------------------------------- : EOF
@@ -12,6 +12,7 @@
 #include <script/profiler.hpp>
 #include <util/error.hpp>
 #include <iostream>
+#include <climits>
 
 using std::max;
 using std::min;
@@ -240,6 +241,30 @@ ScriptValueP Context::eval(const Script& script, bool useScope) {
 					stack.push_back(stack.at(stack.size() - i.data - 1));
 					break;
 				}
+				
+				// Superinstructions
+				case I_GET_VAR_MEMBER_C: {
+					Variable var = (Variable)i.dataLow(SUPER_VAR_BITS);
+					ScriptValueP value = variables[var].value;
+					if (!value) throw ScriptErrorNoVariable(variable_to_string(var));
+					stack.push_back(value->getMember(script.constants[i.dataHigh(SUPER_VAR_BITS)]->toString()));
+					break;
+				}
+				case I_BINARY_C: {
+					instrBinary((BinaryInstructionType)i.dataLow(SUPER_OP_BITS), stack.back(), script.constants[i.dataHigh(SUPER_OP_BITS)]);
+					break;
+				}
+				case I_JUMP_IF_NOT_BINARY: {
+					ScriptValueP  b = stack.back(); stack.pop_back();
+					ScriptValueP& a = stack.back();
+					instrBinary((BinaryInstructionType)i.dataLow(SUPER_OP_BITS), a, b);
+					bool condition = a->toBool();
+					stack.pop_back();
+					if (!condition) {
+						instr = &script.instructions[0] + i.dataHigh(SUPER_OP_BITS);
+					}
+					break;
+				}
 			}
 		}
 		
@@ -334,6 +359,15 @@ ScriptValueP Context::makeClosure(const ScriptValueP& fun) {
 	else        return closure;
 }
 
+void Context::getArguments(vector<std::pair<Variable,ScriptValueP> >& out) {
+	// as in makeClosure, the variables in the last level are at the end of shadowed
+	for (size_t i = shadowed.size() - 1 ; i + 1 > 0 ; --i) {
+		Variable var = shadowed[i].variable;
+		if (variables[var].level < level) break;
+		out.push_back(std::make_pair(var, variables[var].value));
+	}
+}
+
 
 size_t Context::openScope() {
 	level += 1;
@@ -360,6 +394,14 @@ void Context::closeScope(size_t scope) {
 	}
 }
 
+// ----------------------------------------------------------------------------- : Simple instructions : integers
+
+/// Result of integer arithmetic, integers that don't fit in an int become doubles
+inline ScriptValueP to_script_int(long long v) {
+	if (v < INT_MIN || v > INT_MAX) return to_script((double)v);
+	return to_script((int)v);
+}
+
 // ----------------------------------------------------------------------------- : Simple instructions : unary
 
 void instrUnary  (UnaryInstructionType   i, ScriptValueP& a) {
@@ -372,7 +414,7 @@ void instrUnary  (UnaryInstructionType   i, ScriptValueP& a) {
 			if (at == SCRIPT_DOUBLE) {
 				a = to_script(-a->toDouble());
 			} else {
-				a = to_script(-a->toInt());
+				a = to_script_int(-(long long)a->toInt());
 			}
 			break;
 		} case I_NOT:
@@ -445,6 +487,15 @@ class ScriptCompose : public ScriptValue {
 	} \
 	break
 
+// arithmetic on doubles or ints, ints that overflow become doubles
+#define OPERATOR_ARITH_DI(OP) \
+	if (at == SCRIPT_DOUBLE || bt == SCRIPT_DOUBLE) { \
+		a = to_script(a->toDouble()  OP  b->toDouble()); \
+	} else { \
+		a = to_script_int((long long)a->toInt()  OP  b->toInt()); \
+	} \
+	break
+
 // operator on doubles or ints, defined as a function
 #define OPERATOR_FUN_DI(OP) \
 	if (at == SCRIPT_DOUBLE || bt == SCRIPT_DOUBLE) { \
@@ -476,7 +527,7 @@ void instrBinary (BinaryInstructionType  i, ScriptValueP& a, const ScriptValueP&
 			} else if (at == SCRIPT_COLLECTION && bt == SCRIPT_COLLECTION) {
 				a = intrusive(new ScriptConcatCollection(a, b));
 			} else if (at == SCRIPT_INT && bt == SCRIPT_INT) {
-				a = to_script(a->toInt() + b->toInt());
+				a = to_script_int((long long)a->toInt() + b->toInt());
 			} else if ((at == SCRIPT_INT || at == SCRIPT_DOUBLE) &&
 			           (bt == SCRIPT_INT || bt == SCRIPT_DOUBLE)) {
 				a = to_script(a->toDouble() + b->toDouble());
@@ -484,8 +535,8 @@ void instrBinary (BinaryInstructionType  i, ScriptValueP& a, const ScriptValueP&
 				a = to_script(a->toString() + b->toString());
 			}
 			break;
-		case I_SUB:		OPERATOR_DI(-);
-		case I_MUL:		OPERATOR_DI(*);
+		case I_SUB:		OPERATOR_ARITH_DI(-);
+		case I_MUL:		OPERATOR_ARITH_DI(*);
 		case I_FDIV:
 			a = to_script(a->toDouble() / b->toDouble());
 			break;
@@ -514,11 +565,11 @@ void instrBinary (BinaryInstructionType  i, ScriptValueP& a, const ScriptValueP&
 					else if (bi == 3) a = to_script(aa * aa * aa);
 					else              a = to_script(pow(aa,bi));
 				} else {
-					int aa = a->toInt();
+					long long aa = a->toInt();
 					if      (bi == 0) a = to_script(1);
-					else if (bi == 1) a = to_script(aa);
-					else if (bi == 2) a = to_script(aa * aa);
-					else if (bi == 3) a = to_script(aa * aa * aa);
+					else if (bi == 1) a = to_script((int)aa);
+					else if (bi == 2) a = to_script_int(aa * aa);
+					else if (bi == 3 && aa * aa <= INT_MAX) a = to_script_int(aa * aa * aa);
 					else              a = to_script(pow((double)aa,bi));
 				}
 			} else {
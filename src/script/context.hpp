@@ -71,9 +71,13 @@ class Context {
 	 *  Returns -1 if the varible is not set
 	 */
 	int getVariableScope(Variable var);
+	/// Was the variable set outside all scopes, i.e. by the init scripts or by the owner of the context?
+	inline bool isGlobalVariable(Variable var) { return variables[var].value && variables[var].level == 0; }
 	
 	/// Make a closure of the function with the direct parameters of the current call
 	ScriptValueP makeClosure(const ScriptValueP& fun);
+	/// Get the direct parameters of the current call, i.e. the variables set in the current scope
+	void getArguments(vector<std::pair<Variable,ScriptValueP> >& out);
 	
   public:
 	
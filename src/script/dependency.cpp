@@ -91,6 +91,23 @@ class ScriptMissingVariable : public ScriptValue {
 	String name; ///< Name of the variable
 };
 
+// Dependency analysis of a binary instruction, store the result in a
+void dependencyBinary(BinaryInstructionType i, ScriptValueP& a, const ScriptValueP& b, const Dependency& dep) {
+	switch (i) {
+		case I_ITERATOR_R:
+			a = rangeIterator(0,0); // values don't matter
+			break;
+		case I_MEMBER: {
+			a = b->dependencyName(*a, dep); // dependency on member
+			break;
+		} case I_ADD:
+			unify(a, b); // may be function composition
+			break;
+		default:
+			a = dependency_dummy;
+	}
+}
+
 // ----------------------------------------------------------------------------- : Jump record
 
 // Utility class: a jump that has been postponed
@@ -324,19 +341,7 @@ ScriptValueP Context::dependencies(const Dependency& dep, const Script& script)
 				case I_BINARY: {
 					ScriptValueP  b = stack.back(); stack.pop_back();
 					ScriptValueP& a = stack.back();
-					switch (i.instr2) {
-						case I_ITERATOR_R:
-							a = rangeIterator(0,0); // values don't matter
-							break;
-						case I_MEMBER: {
-							a = b->dependencyName(*a, dep); // dependency on member
-							break;
-						} case I_ADD:
-							unify(a, b); // may be function composition
-							break;
-						default:
-							a = dependency_dummy;
-					}
+					dependencyBinary(i.instr2, a, b, dep);
 					break;
 				}
 				// Simple instruction: ternary
@@ -364,6 +369,36 @@ ScriptValueP Context::dependencies(const Dependency& dep, const Script& script)
 				// Pop value off stack
 				case I_POP: {
 					stack.pop_back();
+					break;
+				}
+				
+				// Superinstructions (same as the instructions they replace)
+				case I_GET_VAR_MEMBER_C: {
+					Variable var = (Variable)i.dataLow(SUPER_VAR_BITS);
+					ScriptValueP value = variables[var].value;
+					if (!value) {
+						value = intrusive(new ScriptMissingVariable(variable_to_string(var))); // no errors here
+					}
+					value->dependencyThis(dep);
+					String name = script.constants[i.dataHigh(SUPER_VAR_BITS)]->toString();
+					stack.push_back(value->dependencyMember(name, dep)); // dependency on member
+					break;
+				}
+				case I_BINARY_C: {
+					dependencyBinary((BinaryInstructionType)i.dataLow(SUPER_OP_BITS), stack.back(), script.constants[i.dataHigh(SUPER_OP_BITS)], dep);
+					break;
+				}
+				case I_JUMP_IF_NOT_BINARY: {
+					stack.pop_back(); // pop condition, it consists of two values
+					stack.pop_back();
+					// create jump record
+					Jump* jump = new Jump;
+					jump->target = &script.instructions[0] + i.dataHigh(SUPER_OP_BITS);
+					assert(jump->target >= instr); // jumps must be forward
+					jump->stack_top.assign(stack.begin() + stack_size, stack.end());
+					getBindings(scope, jump->bindings);
+					jumps.push(jump);
+					break;
 				}
 			}
 		}
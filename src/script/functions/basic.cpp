@@ -10,13 +10,19 @@
 #include <util/prec.hpp>
 #include <script/functions/functions.hpp>
 #include <script/functions/util.hpp>
+#include <script/profiler.hpp>
 #include <util/tagged_string.hpp>
 #include <util/spec_sort.hpp>
 #include <util/error.hpp>
 #include <data/set.hpp>
 #include <data/card.hpp>
 #include <data/game.hpp>
+#include <util/hash.hpp>
+#include <wx/thread.h>
+#include <unordered_map>
 
+using std::find;
+using std::find_if;
 using std::make_pair;
 using std::pair;
 using std::reverse;
@@ -478,11 +484,11 @@ int position_in_vector(const ScriptValueP& of, const ScriptValueP& in, const Scr
 	return -1; // TODO?
 }
 
-inline bool smart_less_first(const pair<String,ScriptValueP>& a, const pair<String,ScriptValueP>& b) {
-	return smart_less(a.first, b.first);
+inline bool less_first(const pair<CollationKey,ScriptValueP>& a, const pair<CollationKey,ScriptValueP>& b) {
+	return a.first < b.first;
 }
-inline bool smart_equal_first(const pair<String,ScriptValueP>& a, const pair<String,ScriptValueP>& b) {
-	return smart_equal(a.first, b.first);
+inline bool equal_first(const pair<CollationKey,ScriptValueP>& a, const pair<CollationKey,ScriptValueP>& b) {
+	return a.first == b.first;
 }
 
 // sort a script list
@@ -499,17 +505,17 @@ ScriptValueP sort_script(Context& ctx, const ScriptValueP& list, ScriptValue& or
 	} else {
 		// are we sorting a set?
 		ScriptObject<Set*>* set = dynamic_cast<ScriptObject<Set*>*>(list.get());
-		// sort a collection
-		vector<pair<String,ScriptValueP> > values;
+		// sort a collection, by the collation keys of the order_by values, which gives the same order as smart_less
+		vector<pair<CollationKey,ScriptValueP> > values;
 		ScriptValueP it = list->makeIterator();
 		while (ScriptValueP v = it->next()) {
 			ctx.setVariable(set ? _("card") : _("input"), v);
-			values.push_back(make_pair(order_by.eval(ctx)->toString(), v));
+			values.push_back(make_pair(collation_key(order_by.eval(ctx)->toString()), v));
 		}
-		sort(values.begin(), values.end(), smart_less_first);
+		sort(values.begin(), values.end(), less_first);
 		// unique
 		if (remove_duplicates) {
-			values.erase( unique(values.begin(), values.end(), smart_equal_first), values.end() );
+			values.erase( unique(values.begin(), values.end(), equal_first), values.end() );
 		}
 		// return collection
 		ScriptCustomCollectionP ret(new ScriptCustomCollection());
@@ -667,8 +673,13 @@ SCRIPT_FUNCTION_WITH_DEP(expand_keywords) {
 	}
 	SCRIPT_OPTIONAL_PARAM_C_(CardP, card);
 	WITH_DYNAMIC_ARG(keyword_usage_statistics, card ? &card->keyword_usage : nullptr);
+	// the scripts can look at the set, results remembered by the database depend on when it last changed
+	Age set_age;
+	for (const ValueP& v : set->data) {
+		if (set_age < v->last_modified) set_age = v->last_modified;
+	}
 	try {
-		SCRIPT_RETURN(db.expand(input, match_condition, default_expand, combine, ctx));
+		SCRIPT_RETURN(db.expand(input, match_condition, default_expand, combine, ctx, set_age));
 	} catch (const Error& e) {
 		throw ScriptError(_ERROR_2_("in function", e.what().c_str(), _("expand_keywords")));
 	}
@@ -717,6 +728,196 @@ SCRIPT_FUNCTION(rule) {
 	return intrusive(new ScriptRule(input));
 }
 
+// ----------------------------------------------------------------------------- : Memoization
+
+/// Maximum number of results remembered by a single memoized function
+const size_t MAX_MEMOIZED_RESULTS = 1000;
+
+/// Variables that change between cards or between calls
+/** Includes the built in functions that give different results each time,
+ *  and those that look at the card or stylesheet of the caller.
+ */
+const vector<Variable>& impure_variables() {
+	static const vector<Variable> vars = {
+		SCRIPT_VAR_set, SCRIPT_VAR_card, SCRIPT_VAR_card_style, SCRIPT_VAR_stylesheet, SCRIPT_VAR_styling,
+		SCRIPT_VAR_value,
+		string_to_variable(_("extra_card")),     string_to_variable(_("extra_card_style")),
+		string_to_variable(_("random_real")),    string_to_variable(_("random_int")),
+		string_to_variable(_("random_boolean")), string_to_variable(_("random_shuffle")),
+		string_to_variable(_("random_select")),  string_to_variable(_("random_select_many")),
+		string_to_variable(_("expand_keywords")), string_to_variable(_("keyword_usage")),
+		string_to_variable(_("combined_editor")), string_to_variable(_("symbol_variation")),
+		string_to_variable(_("check_spelling")),
+	};
+	return vars;
+}
+bool is_impure_variable(Variable var) {
+	const vector<Variable>& vars = impure_variables();
+	return find(vars.begin(), vars.end(), var) != vars.end();
+}
+
+/// Is a value a built in function whose result only depends on its arguments?
+bool is_pure_builtin(Context& ctx, const ScriptValueP& value) {
+	if (!dynamic_cast<const ScriptBuiltInFunction*>(value.get())) return false;
+	for (Variable var : impure_variables()) {
+		if (ctx.getVariableOpt(var) == value) return false;
+	}
+	return true;
+}
+
+/// Find the variables a function reads without setting them itself
+/** Returns false if the function reads variables that change between cards or between calls */
+bool find_free_variables(const ScriptValueP& fun, vector<Variable>& out) {
+	if (Script* script = dynamic_cast<Script*>(fun.get())) {
+		vector<Variable> locals, reads;
+		for (const Instruction& i : script->getInstructions()) {
+			if (i.instr == I_SET_VAR) {
+				locals.push_back((Variable)i.data);
+			} else if (i.instr == I_GET_VAR) {
+				reads.push_back((Variable)i.data);
+			} else if (i.instr == I_GET_VAR_MEMBER_C) {
+				reads.push_back((Variable)i.dataLow(SUPER_VAR_BITS));
+			}
+		}
+		// functions defined inside this one
+		for (const ScriptValueP& c : script->getConstants()) {
+			if (c->type() == SCRIPT_FUNCTION && !find_free_variables(c, reads)) return false;
+		}
+		for (Variable var : reads) {
+			if (is_impure_variable(var)) return false;
+			if (find(locals.begin(), locals.end(), var) == locals.end() && find(out.begin(), out.end(), var) == out.end()) {
+				out.push_back(var);
+			}
+		}
+	} else if (ScriptClosure* closure = dynamic_cast<ScriptClosure*>(fun.get())) {
+		vector<Variable> reads;
+		if (!find_free_variables(closure->fun, reads)) return false;
+		for (Variable var : reads) {
+			if (!closure->getBinding(var) && find(out.begin(), out.end(), var) == out.end()) {
+				out.push_back(var);
+			}
+		}
+	}
+	return true;
+}
+
+/// A function that remembers its results for the arguments it was called with
+/** Only calls where all arguments are nil, booleans, numbers, strings or colors are remembered;
+ *  calls with other arguments, or without arguments, always evaluate the function.
+ *  The results are forgotten when the function is used for another set, or when there are too many.
+ *
+ *  The function must be pure: its result may only depend on the arguments.
+ *  Calls are not remembered if the function reads other variables, unless they are pure built in functions
+ *  or the memoized function itself, and never if it reads variables that change all the time, such as card or random_int.
+ */
+class ScriptMemoize : public ScriptValue {
+  public:
+	ScriptMemoize(const ScriptValueP& fun, bool pure) : fun(fun), last_set(nullptr) {
+		this->pure = pure && find_free_variables(fun, free_variables);
+	}
+
+	virtual ScriptType type() const { return SCRIPT_FUNCTION; }
+	virtual String typeName() const { return fun->typeName() + _(" memoized"); }
+	virtual ScriptValueP dependencies(Context& ctx, const Dependency& dep) const {
+		return fun->dependencies(ctx, dep);
+	}
+
+  protected:
+	virtual ScriptValueP do_eval(Context& ctx, bool openScope) const {
+		// when called with openScope there are no arguments
+		String key;
+		if (openScope || !pure || !makeKey(ctx, key)) {
+			return fun->eval(ctx, openScope);
+		}
+		// look up the result
+		{
+			wxMutexLocker lock(mutex);
+			const ScriptValue* set = ctx.getVariableOpt(SCRIPT_VAR_set).get();
+			if (set != last_set) {
+				results.clear();
+				last_set = set;
+			}
+			auto it = results.find(key);
+			#if USE_SCRIPT_PROFILING
+				Profiler::countCacheAccess(it != results.end());
+			#endif
+			if (it != results.end()) return it->second;
+		}
+		ScriptValueP result = fun->eval(ctx, false);
+		wxMutexLocker lock(mutex);
+		if (results.size() >= MAX_MEMOIZED_RESULTS) results.clear();
+		results[key] = result;
+		return result;
+	}
+
+  private:
+	ScriptValueP fun;
+	bool             pure;           ///< Can the results be remembered at all?
+	vector<Variable> free_variables; ///< Variables read by the function, these must be arguments or pure built in functions
+	mutable wxMutex mutex;
+	mutable std::unordered_map<String, ScriptValueP, boost::hash<String>> results;
+	mutable const ScriptValue* last_set; ///< The set the results are for
+
+	/// Make a key for the arguments of the current call, returns false if they can not be remembered
+	bool makeKey(Context& ctx, String& key) const {
+		vector<pair<Variable,ScriptValueP> > args;
+		ctx.getArguments(args);
+		if (args.empty()) return false;
+		sort(args.begin(), args.end(), [](const pair<Variable,ScriptValueP>& a, const pair<Variable,ScriptValueP>& b) {
+			return a.first < b.first;
+		});
+		// other variables could come from the caller, and be different next time
+		for (Variable var : free_variables) {
+			auto arg = find_if(args.begin(), args.end(), [var](const pair<Variable,ScriptValueP>& a) { return a.first == var; });
+			if (arg != args.end()) continue;
+			// functions defined in scripts can be changed between calls, only recursive calls are fine
+			ScriptValueP value = ctx.getVariableOpt(var);
+			if (!value || (value.get() != this && !is_pure_builtin(ctx, value))) return false;
+		}
+		for(const auto& arg : args) {
+			const ScriptValue& v = *arg.second;
+			ScriptType t = v.type();
+			key += String::Format(_("%d:%d:"), (int)arg.first, (int)t);
+			switch (t) {
+				case SCRIPT_NIL:    break;
+				case SCRIPT_INT:    key += String::Format(_("%d"), v.toInt()); break;
+				case SCRIPT_BOOL:   key += v.toBool() ? _("1") : _("0"); break;
+				case SCRIPT_DOUBLE: {
+					double d = v.toDouble();
+					wxUint64 bits;
+					memcpy(&bits, &d, sizeof(d));
+					key += String::Format(_("%llx"), (unsigned long long)bits);
+					break;
+				}
+				case SCRIPT_STRING: {
+					String s = v.toString();
+					key += String::Format(_("%u:"), (unsigned)s.size()) + s;
+					break;
+				}
+				case SCRIPT_COLOR: {
+					AColor c = v.toColor();
+					key += String::Format(_("%d,%d,%d,%d"), c.Red(), c.Green(), c.Blue(), c.alpha);
+					break;
+				}
+				default: return false;
+			}
+			key += _(';');
+		}
+		return true;
+	}
+};
+
+/// Remember the results of a pure function
+SCRIPT_FUNCTION(memoize) {
+	SCRIPT_PARAM_C(ScriptValueP, input);
+	// built in functions that give different results each time
+	bool pure = true;
+	for (Variable var : impure_variables()) {
+		if (ctx.getVariableOpt(var) == input) pure = false;
+	}
+	return intrusive(new ScriptMemoize(input, pure));
+}
+
 // ----------------------------------------------------------------------------- : Init
 
 void init_script_basic_functions(Context& ctx) {
@@ -788,4 +989,6 @@ void init_script_basic_functions(Context& ctx) {
 	ctx.setVariable(_("expand_keywords"),      script_expand_keywords);
 	ctx.setVariable(_("expand_keywords_rule"), intrusive(new ScriptRule(script_expand_keywords))); // compatability
 	ctx.setVariable(_("keyword_usage"),        script_keyword_usage);
+	// function
+	ctx.setVariable(_("memoize"),              script_memoize);
 }
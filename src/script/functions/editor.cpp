@@ -18,6 +18,7 @@
 #include <data/field/choice.hpp>
 #include <data/field/multiple_choice.hpp>
 #include <data/action/value.hpp>
+#include <wx/thread.h>
 #include <boost/range/adaptor/reversed.hpp>
 #include <boost/range/combine.hpp>
 
@@ -90,7 +91,9 @@ SCRIPT_FUNCTION_WITH_DEP(combined_editor) {
 			if (changed) v->value = to_script(nv.first);
 			v->last_modified = new_value_update;
 			changed |= v->update(ctx);
-			if (changed) { // notify of change
+			if (changed && wxThread::IsMain()) { // notify of change, listeners are not thread safe
+				// other threads only update values in bulk (SetScriptManager::updateAllCardsParallel),
+				// nobody needs to be told about that
 				SCRIPT_OPTIONAL_PARAM_(CardP, card);
 				SCRIPT_PARAM(Set*, set);
 				ScriptValueEvent change(card.get(), v);
@@ -36,14 +36,14 @@ SCRIPT_FUNCTION(linear_blend) {
 	SCRIPT_PARAM(GeneratedImageP, image2);
 	SCRIPT_PARAM(double, x1); SCRIPT_PARAM(double, y1);
 	SCRIPT_PARAM(double, x2); SCRIPT_PARAM(double, y2);
-	return intrusive(new LinearBlendImage(image1, image2, x1,y1, x2,y2));
+	return intern_image(intrusive(new LinearBlendImage(image1, image2, x1,y1, x2,y2)));
 }
 
 SCRIPT_FUNCTION(masked_blend) {
 	SCRIPT_PARAM(GeneratedImageP, light);
 	SCRIPT_PARAM(GeneratedImageP, dark);
 	SCRIPT_PARAM(GeneratedImageP, mask);
-	return intrusive(new MaskedBlendImage(light, dark, mask));
+	return intern_image(intrusive(new MaskedBlendImage(light, dark, mask)));
 }
 
 SCRIPT_FUNCTION(combine_blend) {
@@ -52,19 +52,19 @@ SCRIPT_FUNCTION(combine_blend) {
 	SCRIPT_PARAM(GeneratedImageP, image2);
 	ImageCombine image_combine;
 	parse_enum(combine, image_combine);
-	return intrusive(new CombineBlendImage(image1, image2, image_combine));
+	return intern_image(intrusive(new CombineBlendImage(image1, image2, image_combine)));
 }
 
 SCRIPT_FUNCTION(set_mask) {
 	SCRIPT_PARAM(GeneratedImageP, image);
 	SCRIPT_PARAM(GeneratedImageP, mask);
-	return intrusive(new SetMaskImage(image, mask));
+	return intern_image(intrusive(new SetMaskImage(image, mask)));
 }
 
 SCRIPT_FUNCTION(set_alpha) {
 	SCRIPT_PARAM_C(GeneratedImageP, input);
 	SCRIPT_PARAM(double, alpha);
-	return intrusive(new SetAlphaImage(input, alpha));
+	return intern_image(intrusive(new SetAlphaImage(input, alpha)));
 }
 
 SCRIPT_FUNCTION(set_combine) {
@@ -72,18 +72,18 @@ SCRIPT_FUNCTION(set_combine) {
 	SCRIPT_PARAM_C(GeneratedImageP, input);
 	ImageCombine image_combine;
 	parse_enum(combine, image_combine);
-	return intrusive(new SetCombineImage(input, image_combine));
+	return intern_image(intrusive(new SetCombineImage(input, image_combine)));
 }
 
 SCRIPT_FUNCTION(saturate) {
 	SCRIPT_PARAM_C(GeneratedImageP, input);
 	SCRIPT_PARAM(double, amount);
-	return intrusive(new SaturateImage(input, amount));
+	return intern_image(intrusive(new SaturateImage(input, amount)));
 }
 
 SCRIPT_FUNCTION(invert_image) {
 	SCRIPT_PARAM_C(GeneratedImageP, input);
-	return intrusive(new InvertImage(input));
+	return intern_image(intrusive(new InvertImage(input)));
 }
 
 SCRIPT_FUNCTION(recolor_image) {
@@ -92,17 +92,17 @@ SCRIPT_FUNCTION(recolor_image) {
 		SCRIPT_PARAM(Color, green);
 		SCRIPT_PARAM(Color, blue);
 		SCRIPT_PARAM_DEFAULT(Color, white, *wxWHITE);
-		return intrusive(new RecolorImage2(input,red,green,blue,white));
+		return intern_image(intrusive(new RecolorImage2(input,red,green,blue,white)));
 	} else {
 		SCRIPT_PARAM(Color, color);
-		return intrusive(new RecolorImage(input,color));
+		return intern_image(intrusive(new RecolorImage(input,color)));
 	}
 }
 
 SCRIPT_FUNCTION(enlarge) {
 	SCRIPT_PARAM_C(GeneratedImageP, input);
 	SCRIPT_PARAM(double,border_size);
-	return intrusive(new EnlargeImage(input, border_size));
+	return intern_image(intrusive(new EnlargeImage(input, border_size)));
 }
 
 SCRIPT_FUNCTION(crop) {
@@ -111,23 +111,23 @@ SCRIPT_FUNCTION(crop) {
 	SCRIPT_PARAM(int, height);
 	SCRIPT_PARAM(double, offset_x);
 	SCRIPT_PARAM(double, offset_y);
-	return intrusive(new CropImage(input, width, height, offset_x, offset_y));
+	return intern_image(intrusive(new CropImage(input, width, height, offset_x, offset_y)));
 }
 
 SCRIPT_FUNCTION(flip_horizontal) {
 	SCRIPT_PARAM_C(GeneratedImageP, input);
-	return intrusive(new FlipImageHorizontal(input));
+	return intern_image(intrusive(new FlipImageHorizontal(input)));
 }
 
 SCRIPT_FUNCTION(flip_vertical) {
 	SCRIPT_PARAM_C(GeneratedImageP, input);
-	return intrusive(new FlipImageVertical(input));
+	return intern_image(intrusive(new FlipImageVertical(input)));
 }
 
 SCRIPT_FUNCTION(rotate) {
 	SCRIPT_PARAM_C(GeneratedImageP, input);
 	SCRIPT_PARAM(Degrees, angle);
-	return intrusive(new RotateImage(input,deg_to_rad(angle)));
+	return intern_image(intrusive(new RotateImage(input,deg_to_rad(angle))));
 }
 
 SCRIPT_FUNCTION(drop_shadow) {
@@ -137,7 +137,7 @@ SCRIPT_FUNCTION(drop_shadow) {
 	SCRIPT_OPTIONAL_PARAM_(double, alpha);
 	SCRIPT_OPTIONAL_PARAM_(double, blur_radius);
 	SCRIPT_OPTIONAL_PARAM_(Color,  color);
-	return intrusive(new DropShadowImage(input, offset_x, offset_y, alpha, blur_radius, color));
+	return intern_image(intrusive(new DropShadowImage(input, offset_x, offset_y, alpha, blur_radius, color)));
 }
 
 SCRIPT_FUNCTION(symbol_variation) {
@@ -168,7 +168,7 @@ SCRIPT_FUNCTION(symbol_variation) {
 		for(auto& v : style->variations) {
 			if (v->name == variation) {
 				// found it
-				return intrusive(new SymbolToImage(value, filename, v));
+				return intern_image(intrusive(new SymbolToImage(value, filename, v)));
 			}
 		}
 		throw ScriptError(_("Variation of symbol not found ('") + variation + _("')"));
@@ -202,13 +202,13 @@ SCRIPT_FUNCTION(symbol_variation) {
 		} else {
 			throw ScriptError(_("Unknown fill type for symbol_variation: ") + fill_type);
 		}
-		return intrusive(new SymbolToImage(value, filename, var));
+		return intern_image(intrusive(new SymbolToImage(value, filename, var)));
 	}
 }
 
 SCRIPT_FUNCTION(built_in_image) {
 	SCRIPT_PARAM_C(String, input);
-	return intrusive(new BuiltInImage(input));
+	return intern_image(intrusive(new BuiltInImage(input)));
 }
 
 // ----------------------------------------------------------------------------- : Init
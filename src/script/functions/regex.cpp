@@ -11,6 +11,10 @@
 #include <script/functions/util.hpp>
 #include <util/regex.hpp>
 #include <util/error.hpp>
+#include <util/hash.hpp>
+#include <wx/thread.h>
+#include <unordered_map>
+#include <list>
 
 DECLARE_POINTER_TYPE(ScriptRegex);
 
@@ -47,12 +51,56 @@ class ScriptRegex : public ScriptValue, public Regex {
 	using Regex::matches;
 };
 
+// ----------------------------------------------------------------------------- : Regex cache
+
+/// Maximum number of regular expressions in the ScriptRegexCache
+const size_t MAX_CACHED_REGEXES = 500;
+
+/// The most recently used regular expressions that were given as strings
+/** Scripts like  replace(input, match: "a|b", replace: "c")  would otherwise compile the expression for every call.
+ *  Can be used from multiple threads.
+ */
+class ScriptRegexCache {
+  public:
+	/// Get the compiled regular expression for the given code
+	ScriptRegexP get(const String& code) {
+		{
+			wxMutexLocker lock(mutex);
+			auto it = index.find(code);
+			if (it != index.end()) {
+				items.splice(items.begin(), items, it->second); // now most recently used
+				return it->second->second;
+			}
+		}
+		// compile outside the lock, this can throw
+		ScriptRegexP regex = intrusive(new ScriptRegex(code));
+		wxMutexLocker lock(mutex);
+		if (index.find(code) == index.end()) {
+			items.push_front(std::make_pair(code, regex));
+			index.insert(std::make_pair(code, items.begin()));
+			// forget the least recently used expression
+			if (items.size() > MAX_CACHED_REGEXES) {
+				index.erase(items.back().first);
+				items.pop_back();
+			}
+		}
+		return regex;
+	}
+
+  private:
+	typedef std::list<std::pair<String,ScriptRegexP> > Items;
+	wxMutex mutex;
+	Items   items; ///< Most recently used first
+	std::unordered_map<String, Items::iterator, boost::hash<String>> index;
+};
+
+ScriptRegexCache script_regex_cache;
+
 ScriptRegexP regex_from_script(const ScriptValueP& value) {
 	// is it a regex already?
 	ScriptRegexP regex = dynamic_pointer_cast<ScriptRegex>(value);
 	if (!regex) {
-		// TODO: introduce some kind of caching?
-		regex = intrusive(new ScriptRegex(value->toString()));
+		regex = script_regex_cache.get(value->toString());
 	}
 	return regex;
 }
@@ -13,9 +13,15 @@
 #include <util/spell_checker.hpp>
 #include <util/tagged_string.hpp>
 #include <data/stylesheet.hpp>
+#include <wx/thread.h>
 
 // ----------------------------------------------------------------------------- : Functions
 
+/// The spell checkers and the stylesheet settings can be used by one thread at a time
+/** Recursive, because extra_match can call check_spelling again */
+wxMutex spelling_mutex(wxMUTEX_RECURSIVE);
+
+
 inline size_t spelled_correctly(const String& input, size_t start, size_t end, SpellChecker** checkers, const ScriptValueP& extra_test, Context& ctx) {
 	// untag
 	String word = untag(input.substr(start,end-start));
@@ -94,6 +100,7 @@ SCRIPT_FUNCTION(check_spelling) {
 	SCRIPT_PARAM_C(String,language);
 	SCRIPT_PARAM_C(String,input);
 	assert_tagged(input);
+	wxMutexLocker lock(spelling_mutex);
 	if (!settings.stylesheetSettingsFor(*stylesheet).card_spellcheck_enabled)
 		SCRIPT_RETURN(input);
 	SCRIPT_OPTIONAL_PARAM_(String,extra_dictionary);
@@ -168,6 +175,7 @@ SCRIPT_FUNCTION(check_spelling_word) {
 		// no language -> spelling checking
 		SCRIPT_RETURN(true);
 	} else {
+		wxMutexLocker lock(spelling_mutex);
 		bool correct = SpellChecker::get(language).spell(input);
 		SCRIPT_RETURN(correct);
 	}
@@ -51,12 +51,16 @@
 #define SCRIPT_FUNCTION_SIMPLIFY_CLOSURE(name)							\
 		ScriptValueP ScriptBuiltIn_##name::simplifyClosure(ScriptClosure& closure) const
 
+/// Base class of the functions declared with SCRIPT_FUNCTION
+class ScriptBuiltInFunction : public ScriptValue {
+  public:
+	virtual ScriptType type() const { return SCRIPT_FUNCTION; }
+};
+
 // helper for SCRIPT_FUNCTION and SCRIPT_FUNCTION_DEP
 #define SCRIPT_FUNCTION_AUX(name,dep)									\
-		class ScriptBuiltIn_##name : public ScriptValue {				\
+		class ScriptBuiltIn_##name : public ScriptBuiltInFunction {		\
 			dep															\
-			virtual  ScriptType type() const							\
-				{ return SCRIPT_FUNCTION; }								\
 			virtual String typeName() const								\
 				{ return _("built-in function '") _(#name) _("'"); }	\
 			virtual ScriptValueP do_eval(Context&, bool) const;			\
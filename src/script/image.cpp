@@ -13,27 +13,27 @@
 #include <util/dynamic_arg.hpp>
 #include <util/io/package.hpp>
 #include <gfx/generated_image.hpp>
+#include <gfx/image_cache.hpp>
+#include <gfx/headless_dc.hpp>
 #include <data/field/image.hpp>
 
 // ----------------------------------------------------------------------------- : ScriptableImage
 
 Image ScriptableImage::generate(const GeneratedImage::Options& options) const {
 	// generate
-	Image image;
 	if (isReady()) {
 		// note: Don't catch exceptions here, we don't want to return an invalid image.
 		//       We could return a blank one, but the thumbnail code does want an invalid
 		//       image in case of errors.
 		//       This allows the caller to catch errors.
-		image = value->generate(options);
+		return generated_image_cache.generate(value, options);
 	} else {
 		// error, return blank image
 		Image i(1,1);
 		i.InitAlpha();
 		i.SetAlpha(0,0,0);
-		image = i;
+		return conform_image(i, options);
 	}
-	return conform_image(image, options);
 }
 
 ImageCombine ScriptableImage::combine() const {
@@ -44,7 +44,8 @@ ImageCombine ScriptableImage::combine() const {
 bool ScriptableImage::update(Context& ctx) {
 	if (!isScripted()) return false;
 	GeneratedImageP new_value = script.invoke(ctx)->toImage();
-	if (!new_value || !value || *new_value != *value) {
+	// note: interned images are often the same object, and different hashes mean different images
+	if (!new_value || !value || (new_value != value && (new_value->hash() != value->hash() || *new_value != *value))) {
 		value = new_value;
 		return true;
 	} else {
@@ -107,7 +108,8 @@ void CachedScriptableImage::generateCached(const GeneratedImage::Options& option
 	bool w_ok = cached_size.width  == options.width,
 	     h_ok = cached_size.height == options.height;
 	// image or bitmap?
-	if (*combine <= COMBINE_NORMAL) {
+	bool use_bitmap = *combine <= COMBINE_NORMAL && !headless_rendering();
+	if (use_bitmap) {
 		// bitmap
 		if (cached_b.Ok() && options.angle == cached_angle) {
 			if ((w_ok && h_ok) || (options.preserve_aspect == ASPECT_FIT && (w_ok || h_ok))) { // only one dimension has to fit when fitting
@@ -151,7 +153,7 @@ void CachedScriptableImage::generateCached(const GeneratedImage::Options& option
 		// hack(part2) do the actual rotation now
 		cached_i = rotate_image(cached_i, options.angle);
 	}
-	if (*combine <= COMBINE_NORMAL) {
+	if (use_bitmap) {
 		*bitmap = cached_b = Bitmap(cached_i);
 		cached_i = Image();
 	} else {
@@ -86,6 +86,7 @@ class CachedScriptableImage : public ScriptableImage {
 	 *  After this call, either:
 	 *     -    combine <= COMBINE_NORMAL && bitmap->Ok()
 	 *     - or combine >  COMBINE_NORMAL && image->Ok()
+	 *     - or headless_rendering() && image->Ok(), there are no bitmaps without a display
 	 *  Optionally, an alpha mask is applied to the image.
 	 */
 	void generateCached(const GeneratedImage::Options& img_options,
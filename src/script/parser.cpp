@@ -422,6 +422,7 @@ ScriptP parse(const String& s, Packaged* package, bool string_mode, vector<Scrip
 	if (type == EXPR_FAILED) {
 		return ScriptP();
 	} else {
+		script->optimize();
 		return script;
 	}
 }
@@ -462,6 +463,7 @@ ExprType parseExpr(TokenIterator& input, Script& script, Precedence minPrec) {
 			input.add_error(_("Warning: last statement of a function should be an expression, i.e. it should return a result in all cases."));
 		}
 		expectToken(input, _("}"), &token);
+		if (t != EXPR_FAILED) subScript->optimize();
 		script.addInstruction(I_PUSH_CONST, subScript);
 	} else if (token == _("[")) {
 		// [] = list or map literal
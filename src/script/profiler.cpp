@@ -64,8 +64,10 @@ void profile_aggregate(FunctionProfile& parent, int level, int max_level, size_t
 	if (!fpp) {
 		fpp = intrusive(new FunctionProfile(p.name));
 	}
-	fpp->time_ticks += p.time_ticks;
-	fpp->calls      += p.calls;
+	fpp->time_ticks   += p.time_ticks;
+	fpp->calls        += p.calls;
+	fpp->cache_hits   += p.cache_hits;
+	fpp->cache_misses += p.cache_misses;
 	// recurse
 	if (level == 0) {
 		profile_aggregate(parent, level, max_level, p);
@@ -141,5 +143,10 @@ Profiler::~Profiler() {
 	function = parent; // pop
 }
 
+void Profiler::countCacheAccess(bool hit) {
+	if (hit) function->cache_hits   += 1;
+	else     function->cache_misses += 1;
+}
+
 // ----------------------------------------------------------------------------- : EOF
 #endif
@@ -76,13 +76,15 @@ class Timer {
 class FunctionProfile : public IntrusivePtrBase<FunctionProfile> {
   public:
 	FunctionProfile(const String& name)
-		: name(name), time_ticks(0), time_ticks_max(0), calls(0)
+		: name(name), time_ticks(0), time_ticks_max(0), calls(0), cache_hits(0), cache_misses(0)
 	{}
 
 	String      name;
 	ProfileTime time_ticks;
 	ProfileTime time_ticks_max;
 	int         calls;
+	int         cache_hits;   ///< Calls answered from the results of a memoized function
+	int         cache_misses; ///< Calls to a memoized function that had to be evaluated
 	
 	/// for each id, called children
 	/** we (ab)use the fact that all pointers are even to store both pointers and ids */
@@ -119,6 +121,9 @@ class Profiler {
 	Profiler(Timer& timer, void* function_object, const String& function_name);
 	/// Log the fact that the function is left
 	~Profiler();
+
+	/// Count a lookup in the results of a memoized function, for the function we are in
+	static void countCacheAccess(bool hit);
   private:
 	Timer&                  timer;
 	static FunctionProfile* function; ///< function we are in
@@ -150,6 +150,163 @@ unsigned int Script::getLabel() const {
 }
 
 
+// ----------------------------------------------------------------------------- : Optimization
+
+// Perform a unary/binary simple instruction, store the result in a (see context.cpp)
+void instrUnary  (UnaryInstructionType   i, ScriptValueP& a);
+void instrBinary (BinaryInstructionType  i, ScriptValueP& a, const ScriptValueP& b);
+
+// Is the data of an instruction of this type an address?
+inline bool is_jump(InstructionType t) {
+	return t == I_JUMP || t == I_JUMP_IF_NOT || t == I_JUMP_SC_AND || t == I_JUMP_SC_OR
+	    || t == I_LOOP || t == I_LOOP_WITH_KEY;
+}
+// Is an instruction of this type followed by i.data argument names?
+inline bool has_arguments(InstructionType t) {
+	return t == I_CALL || t == I_CLOSURE || t == I_TAILCALL;
+}
+// Can a constant be folded? Operations on these types have no side effects.
+inline bool is_foldable(const ScriptValueP& value) {
+	ScriptType t = value->type();
+	return t == SCRIPT_NIL || t == SCRIPT_INT  || t == SCRIPT_BOOL || t == SCRIPT_DOUBLE
+	    || t == SCRIPT_STRING || t == SCRIPT_COLOR;
+}
+// Can a binary instruction be folded? (arithmetic, logic and comparison)
+inline bool is_foldable(BinaryInstructionType i) {
+	return i >= I_ADD && i <= I_MAX;
+}
+inline bool is_comparison(BinaryInstructionType i) {
+	return i >= I_EQ && i <= I_GE;
+}
+
+void Script::optimize() {
+	size_t n = instructions.size();
+	// which positions are jumped to?
+	vector<bool> is_target(n + 1, false);
+	for (size_t pos = 0 ; pos < n ; ++pos) {
+		const Instruction& i = instructions[pos];
+		if (is_jump(i.instr)) is_target[i.data] = true;
+		if (has_arguments(i.instr)) pos += i.data;
+	}
+	// rewrite the instructions, remember where they ended up
+	vector<Instruction>  out;
+	vector<bool>         out_target;
+	vector<unsigned int> new_pos(n + 1);
+	out.reserve(n);
+	for (size_t pos = 0 ; pos < n ; ++pos) {
+		const Instruction& i = instructions[pos];
+		new_pos[pos] = (unsigned int)out.size();
+		if (i.instr == I_JUMP && i.data == pos + 1) {
+			continue; // jump to the next instruction
+		}
+		out.push_back(i);
+		out_target.push_back(is_target[pos]);
+		if (has_arguments(i.instr)) {
+			// copy argument names as they are
+			for (unsigned int j = 0 ; j < i.data ; ++j) {
+				++pos;
+				new_pos[pos] = (unsigned int)out.size();
+				out.push_back(instructions[pos]);
+				out_target.push_back(false);
+			}
+		} else {
+			while (optimizeTail(out, out_target)) {}
+		}
+	}
+	new_pos[n] = (unsigned int)out.size();
+	// update addresses
+	for (auto& i : out) {
+		if (is_jump(i.instr)) {
+			i.data = new_pos[i.data];
+		} else if (i.instr == I_JUMP_IF_NOT_BINARY) {
+			i.data = i.dataLow(SUPER_OP_BITS) | (new_pos[i.dataHigh(SUPER_OP_BITS)] << SUPER_OP_BITS);
+		}
+	}
+	instructions.swap(out);
+}
+
+bool Script::optimizeTail(vector<Instruction>& out, vector<bool>& out_target) {
+	size_t n = out.size();
+	if (n < 2 || out_target[n-1]) return false; // can't combine with a jump target
+	Instruction& a = out[n-2];
+	Instruction& b = out[n-1];
+	// binary cmp; jnz x  -->  jnz_binary cmp x
+	if (b.instr == I_JUMP_IF_NOT && a.instr == I_BINARY && is_comparison(a.instr2)
+	    && b.data < (1u << (26 - SUPER_OP_BITS))) {
+		a.data  = a.instr2 | (b.data << SUPER_OP_BITS);
+		a.instr = I_JUMP_IF_NOT_BINARY;
+		out.resize(n-1);
+		out_target.resize(n-1);
+		return true;
+	}
+	// binary_c cmp y; jnz x  -->  push y; jnz_binary cmp x
+	// the comparison was already combined with its constant when the jump was not yet known,
+	// combining it with the jump saves pushing and testing a boolean, which happens more often (if x == 1 then ...)
+	if (b.instr == I_JUMP_IF_NOT && a.instr == I_BINARY_C && is_comparison((BinaryInstructionType)a.dataLow(SUPER_OP_BITS))
+	    && b.data < (1u << (26 - SUPER_OP_BITS))) {
+		unsigned int op = a.dataLow(SUPER_OP_BITS);
+		a.instr = I_PUSH_CONST;
+		a.data  = a.dataHigh(SUPER_OP_BITS);
+		b.data  = op | (b.data << SUPER_OP_BITS);
+		b.instr = I_JUMP_IF_NOT_BINARY;
+		return true;
+	}
+	// push x; push y; binary op  -->  push (x op y)
+	if (n >= 3 && b.instr == I_BINARY && is_foldable(b.instr2) && !out_target[n-2]
+	    && a.instr == I_PUSH_CONST && out[n-3].instr == I_PUSH_CONST
+	    && is_foldable(constants[out[n-3].data]) && is_foldable(constants[a.data])) {
+		ScriptValueP value = constants[out[n-3].data];
+		try {
+			if ((b.instr2 == I_DIV || b.instr2 == I_MOD) && constants[a.data]->toDouble() == 0) {
+				return false; // don't divide by zero while parsing
+			}
+			instrBinary(b.instr2, value, constants[a.data]);
+		} catch (const Error&) {
+			return false; // leave the error for when the script is run
+		}
+		if (value->type() == SCRIPT_ERROR) return false;
+		constants.push_back(value);
+		out[n-3].data = (unsigned int)constants.size() - 1;
+		out.resize(n-2);
+		out_target.resize(n-2);
+		return true;
+	}
+	// push x; unary op  -->  push (op x)
+	if (b.instr == I_UNARY && b.instr1 != I_ITERATOR_C && a.instr == I_PUSH_CONST && is_foldable(constants[a.data])) {
+		ScriptValueP value = constants[a.data];
+		try {
+			instrUnary(b.instr1, value);
+		} catch (const Error&) {
+			return false;
+		}
+		if (value->type() == SCRIPT_ERROR) return false;
+		constants.push_back(value);
+		a.data = (unsigned int)constants.size() - 1;
+		out.resize(n-1);
+		out_target.resize(n-1);
+		return true;
+	}
+	// push x; binary op  -->  binary_c op x
+	if (b.instr == I_BINARY && a.instr == I_PUSH_CONST && a.data < (1u << (26 - SUPER_OP_BITS))) {
+		a.instr = I_BINARY_C;
+		a.data  = b.instr2 | (a.data << SUPER_OP_BITS);
+		out.resize(n-1);
+		out_target.resize(n-1);
+		return true;
+	}
+	// get v; member_c x  -->  get_var_member_c v x
+	if (b.instr == I_MEMBER_C && a.instr == I_GET_VAR
+	    && a.data < (1u << SUPER_VAR_BITS) && b.data < (1u << (26 - SUPER_VAR_BITS))) {
+		a.instr = I_GET_VAR_MEMBER_C;
+		a.data  = a.data | (b.data << SUPER_VAR_BITS);
+		out.resize(n-1);
+		out_target.resize(n-1);
+		return true;
+	}
+	return false;
+}
+
+
 #ifdef _DEBUG // debugging
 
 String Script::dumpScript() const {
@@ -162,6 +319,34 @@ String Script::dumpScript() const {
 	return ret;
 }
 
+// name of a binary instruction
+String binaryName(BinaryInstructionType i) {
+	switch (i) {
+		case I_ITERATOR_R:	return _("iterator_r");
+		case I_MEMBER:		return _("member");
+		case I_ADD:			return _("+");
+		case I_SUB:			return _("-");
+		case I_MUL:			return _("*");
+		case I_FDIV:		return _("/");
+		case I_DIV:			return _("div");
+		case I_MOD:			return _("mod");
+		case I_POW:			return _("^");
+		case I_AND:			return _("and");
+		case I_OR:			return _("or");
+		case I_XOR:			return _("xor");
+		case I_EQ:			return _("==");
+		case I_NEQ:			return _("!=");
+		case I_LT:			return _("<");
+		case I_GT:			return _(">");
+		case I_LE:			return _("<=");
+		case I_GE:			return _(">=");
+		case I_MIN:			return _("min");
+		case I_MAX:			return _("max");
+		case I_OR_ELSE:		return _("or else");
+		default:			return String();
+	}
+}
+
 String Script::dumpInstr(unsigned int pos, Instruction i) const {
 	String ret = String::Format(_("%d:\t"),pos);
 	// instruction
@@ -187,27 +372,7 @@ String Script::dumpInstr(unsigned int pos, Instruction i) const {
 				case I_NOT:			ret += _("not");		break;
 			}
 			break;
-		case I_BINARY:		ret += _("binary\t");
-			switch (i.instr2) {
-				case I_ITERATOR_R:	ret += _("iterator_r");	break;
-				case I_MEMBER:		ret += _("member");		break;
-				case I_ADD:			ret += _("+");			break;
-				case I_SUB:			ret += _("-");			break;
-				case I_MUL:			ret += _("*");			break;
-				case I_DIV:			ret += _("/");			break;
-				case I_MOD:			ret += _("mod");		break;
-				case I_AND:			ret += _("and");		break;
-				case I_OR:			ret += _("or");			break;
-				case I_XOR:			ret += _("xor");		break;
-				case I_EQ:			ret += _("==");			break;
-				case I_NEQ:			ret += _("!=");			break;
-				case I_LT:			ret += _("<");			break;
-				case I_GT:			ret += _(">");			break;
-				case I_LE:			ret += _("<=");			break;
-				case I_GE:			ret += _(">=");			break;
-				case I_OR_ELSE:		ret += _("or else");	break;
-			}
-			break;
+		case I_BINARY:		ret += _("binary\t") + binaryName(i.instr2);	break;
 		case I_TERNARY:		ret += _("ternary\t");
 			switch (i.instr3) {
 				case I_RGB:			ret += _("rgb");		break;
@@ -221,6 +386,9 @@ String Script::dumpInstr(unsigned int pos, Instruction i) const {
 		case I_DUP:			ret += _("dup");				break;
 		case I_POP:			ret += _("pop");				break;
 		case I_TAILCALL:	ret += _("tailcall");			break;
+		case I_GET_VAR_MEMBER_C:	ret += _("get member_c");	break;
+		case I_BINARY_C:			ret += _("binary_c\t") + binaryName((BinaryInstructionType)i.dataLow(SUPER_OP_BITS));	break;
+		case I_JUMP_IF_NOT_BINARY:	ret += _("jnz binary\t") + binaryName((BinaryInstructionType)i.dataLow(SUPER_OP_BITS));	break;
 	}
 	// arg
 	switch (i.instr) {
@@ -236,6 +404,16 @@ String Script::dumpInstr(unsigned int pos, Instruction i) const {
 		case I_GET_VAR: case I_SET_VAR: case I_NOP:					// variable
 			ret += _("\t") + variable_to_string((Variable)i.data);
 			break;
+		case I_GET_VAR_MEMBER_C:									// variable, const
+			ret += _("\t") + variable_to_string((Variable)i.dataLow(SUPER_VAR_BITS))
+			     + _("\t") + constants[i.dataHigh(SUPER_VAR_BITS)]->typeName();
+			break;
+		case I_BINARY_C:											// op, const
+			ret += _("\t") + constants[i.dataHigh(SUPER_OP_BITS)]->typeName();
+			break;
+		case I_JUMP_IF_NOT_BINARY:									// op, int
+			ret += String::Format(_("\t%d"), i.dataHigh(SUPER_OP_BITS));
+			break;
 	}
 	return ret;
 }
@@ -258,7 +436,7 @@ const Instruction* Script::backtraceSkip(const Instruction* instr, int to_skip)
 		// skip an instruction
 		switch (instr->instr) {
 			case I_PUSH_CONST:
-			case I_GET_VAR: case I_DUP:
+			case I_GET_VAR: case I_GET_VAR_MEMBER_C: case I_DUP:
 				to_skip -= 1; break; // nett stack effect +1
 			case I_BINARY:
 				to_skip += 1; break; // nett stack effect 1-2 == -1
@@ -299,6 +477,10 @@ const Instruction* Script::backtraceSkip(const Instruction* instr, int to_skip)
 						// we need to skip two things (iterator+accumulator) instead of one
 						to_skip += 1;
 						break;
+					} else if (instr->instr == I_JUMP_IF_NOT_BINARY && instr->dataHigh(SUPER_OP_BITS) == after_jump) {
+						// same as below, but the condition consists of two items
+						to_skip += 2;
+						break;
 					} else if (instr->instr == I_JUMP_IF_NOT && instr->data == after_jump) {
 						// code looks like
 						//  1   (nettstack+1)
@@ -317,7 +499,7 @@ const Instruction* Script::backtraceSkip(const Instruction* instr, int to_skip)
 				++instr; // compensate for the -- in the outer loop
 				break;
 			}
-			case I_JUMP_IF_NOT: case I_LOOP: case I_LOOP_WITH_KEY:
+			case I_JUMP_IF_NOT: case I_JUMP_IF_NOT_BINARY: case I_LOOP: case I_LOOP_WITH_KEY:
 				return nullptr; // give up
 			case I_JUMP_SC_AND: case I_JUMP_SC_OR:
 				// assume the fallthrough case, in which case we compared and poped the top of the stack
@@ -333,6 +515,10 @@ String Script::instructionName(const Instruction* instr) const {
 	if (instr < &instructions[0] || instr >= &instructions[0] + instructions.size()) return _("??\?");
 	if (instr->instr == I_GET_VAR) {
 		return variable_to_string((Variable)instr->data);
+	} else if (instr->instr == I_GET_VAR_MEMBER_C) {
+		return variable_to_string((Variable)instr->dataLow(SUPER_VAR_BITS))
+		     + _(".")
+		     + constants[instr->dataHigh(SUPER_VAR_BITS)]->toString();
 	} else if (instr->instr == I_MEMBER_C) {
 		return instructionName(backtraceSkip(instr - 1, 0))
 		     + _(".")
@@ -341,6 +527,13 @@ String Script::instructionName(const Instruction* instr) const {
 		return _("??\?[...]");
 	} else if (instr->instr == I_BINARY && instr->instr2 == I_ADD) {
 		return _("??? + ???");
+	} else if (instr->instr == I_BINARY_C && instr->dataLow(SUPER_OP_BITS) == I_MEMBER) {
+		return instructionName(backtraceSkip(instr - 1, 0))
+		     + _("[")
+		     + constants[instr->dataHigh(SUPER_OP_BITS)]->toString()
+		     + _("]");
+	} else if (instr->instr == I_BINARY_C && instr->dataLow(SUPER_OP_BITS) == I_ADD) {
+		return _("??? + ???");
 	} else if (instr->instr == I_NOP) {
 		return _("??\?(...)");
 	} else if (instr->instr == I_CALL) {
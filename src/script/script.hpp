@@ -48,8 +48,17 @@ enum InstructionType
 ,	I_QUATERNARY	= 16 ///< arg = 4ary instr : pop 4 values, apply a function, push the result
 ,	I_DUP			= 17 ///< arg = int        : duplicate the k-from-top element of the stack
 ,	I_POP			= 18 ///< arg = *          : pop the top value off the stack.
+	// Superinstructions, only created by Script::optimize, the data contains two values (see SUPER_*_BITS)
+,	I_GET_VAR_MEMBER_C		= 21 ///< arg = var, const name  : I_GET_VAR followed by I_MEMBER_C
+,	I_BINARY_C				= 22 ///< arg = 2ary instr, const : I_PUSH_CONST followed by I_BINARY, the constant is the second argument
+,	I_JUMP_IF_NOT_BINARY	= 23 ///< arg = 2ary instr, address : I_BINARY followed by I_JUMP_IF_NOT
 };
 
+/// Number of bits for the variable in the data of I_GET_VAR_MEMBER_C, the rest is the constant
+const int SUPER_VAR_BITS = 13;
+/// Number of bits for the binary instruction in the data of I_BINARY_C and I_JUMP_IF_NOT_BINARY
+const int SUPER_OP_BITS  = 5;
+
 /// Types of unary instructions (taking one argument from the stack)
 enum UnaryInstructionType
 {	I_ITERATOR_C		///< Make an iterator for a collection
@@ -109,6 +118,11 @@ struct Instruction {
 		TernaryInstructionType		instr3 : 26;
 		QuaternaryInstructionType	instr4 : 26;
 	};
+	
+	/// The first value in the data of a superinstruction, stored in the lowest bits
+	inline unsigned int dataLow (int bits) const { return data & ((1u << bits) - 1); }
+	/// The second value in the data of a superinstruction
+	inline unsigned int dataHigh(int bits) const { return data >> bits; }
 };
 
 // ----------------------------------------------------------------------------- : Variables
@@ -187,6 +201,13 @@ class Script : public ScriptValue {
 	/// Get the current instruction position
 	unsigned int getLabel() const;
 	
+	/// Optimize the instructions of a complete script
+	/** Folds constant expressions, combines common instruction sequences into superinstructions,
+	 *  and removes jumps to the next instruction.
+	 *  No instructions should be added afterwards.
+	 */
+	void optimize();
+	
 	/// Get access to the vector of instructions
 	inline vector<Instruction>& getInstructions() { return instructions; }
 	/// Get access to the vector of constants
@@ -215,6 +236,10 @@ class Script : public ScriptValue {
 	/// Find the name of an instruction
 	String instructionName(const Instruction* instr) const;
 	
+	/// Try to optimize the last few instructions of out, returns true if something changed
+	/** out_target indicates which instructions are jump targets, those can not be combined with earlier ones. */
+	bool optimizeTail(vector<Instruction>& out, vector<bool>& out_target);
+	
 	friend class Context;
 };
 
@@ -0,0 +1,381 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) 2001 - 2012 Twan van Laarhoven and Sean Hunt             |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <script/script_cache.hpp>
+#include <script/script.hpp>
+#include <script/to_value.hpp>
+#include <util/io/package.hpp>
+#include <util/version.hpp>
+#include <util/error.hpp>
+#include <gfx/color.hpp>
+#include <wx/wfstream.h>
+#include <wx/datstrm.h>
+
+extern ScriptValueP script_warning;
+extern ScriptValueP script_warning_if_neq;
+String user_settings_dir();
+
+IMPLEMENT_DYNAMIC_ARG(PackageScriptCache*, package_script_cache, nullptr);
+
+// ----------------------------------------------------------------------------- : File format
+
+// A cache file contains:
+//   magic, format, app version, package filename, package modification time
+//   number of scripts, for each script: key, script
+//   number of scripts again, to detect truncated files
+// A script is:
+//   number of constants, for each constant: type, data
+//   number of instructions, for each instruction: type, data
+// Variables are stored by name, because the numbers are different each time the program runs.
+
+/// Start of each cache file
+const char   SCRIPT_CACHE_MAGIC[]    = "MSE script cache";
+const size_t SCRIPT_CACHE_MAGIC_SIZE = sizeof(SCRIPT_CACHE_MAGIC) - 1;
+/// Increase when the format of the cache files changes
+const wxUint32 SCRIPT_CACHE_FORMAT = 1;
+
+/// Types of constants that can be stored
+enum CachedConstant
+{	CONST_NONE = -1 ///< Can not be stored
+,	CONST_NIL
+,	CONST_TRUE
+,	CONST_FALSE
+,	CONST_INT
+,	CONST_DOUBLE
+,	CONST_STRING
+,	CONST_COLOR
+,	CONST_SCRIPT
+,	CONST_WARNING
+,	CONST_WARNING_IF_NEQ
+};
+
+bool can_cache(Script& script);
+
+/// How can a constant be stored?
+CachedConstant constant_type(const ScriptValueP& value) {
+	if (value == script_nil)            return CONST_NIL;
+	if (value == script_true)           return CONST_TRUE;
+	if (value == script_false)          return CONST_FALSE;
+	if (value == script_warning)        return CONST_WARNING;
+	if (value == script_warning_if_neq) return CONST_WARNING_IF_NEQ;
+	switch (value->type()) {
+		case SCRIPT_INT:    return CONST_INT;
+		case SCRIPT_DOUBLE: return CONST_DOUBLE;
+		case SCRIPT_STRING: return CONST_STRING;
+		case SCRIPT_COLOR:  return CONST_COLOR;
+		case SCRIPT_FUNCTION: {
+			Script* script = dynamic_cast<Script*>(value.get());
+			if (script && can_cache(*script)) return CONST_SCRIPT;
+			return CONST_NONE;
+		}
+		default:
+			return CONST_NONE;
+	}
+}
+
+/// Can all constants of a script be stored?
+bool can_cache(Script& script) {
+	for (auto const& c : script.getConstants()) {
+		if (constant_type(c) == CONST_NONE) return false;
+	}
+	return true;
+}
+
+/// Does the data of an instruction refer to a variable?
+inline bool has_variable_data(unsigned int instr) {
+	return instr == I_GET_VAR || instr == I_SET_VAR || instr == I_NOP;
+}
+
+// ----------------------------------------------------------------------------- : Writing
+
+/// Write a script to a cache file, the script must satisfy can_cache
+/** variable_names is used to remember the names of variables, since variable_to_string is slow */
+void write_script(wxDataOutputStream& out, Script& script, map<unsigned int,String>& variable_names) {
+	auto write_variable = [&](unsigned int var) {
+		String& name = variable_names[var];
+		if (name.empty()) name = variable_to_string((Variable)var);
+		out.WriteString(name);
+	};
+	// constants
+	vector<ScriptValueP>& constants = script.getConstants();
+	out.Write32((wxUint32)constants.size());
+	for (auto const& c : constants) {
+		CachedConstant type = constant_type(c);
+		out.Write8((wxUint8)type);
+		switch (type) {
+			case CONST_INT:
+				out.Write32((wxUint32)c->toInt());
+				break;
+			case CONST_DOUBLE: {
+				double d = c->toDouble();
+				wxUint64 bits;
+				memcpy(&bits, &d, sizeof(bits));
+				out.Write64(bits);
+				break;
+			}
+			case CONST_STRING:
+				out.WriteString(c->toString());
+				break;
+			case CONST_COLOR: {
+				AColor color = c->toColor();
+				out.Write8(color.Red());
+				out.Write8(color.Green());
+				out.Write8(color.Blue());
+				out.Write8(color.alpha);
+				break;
+			}
+			case CONST_SCRIPT:
+				write_script(out, static_cast<Script&>(*c), variable_names);
+				break;
+			default:
+				break; // no data
+		}
+	}
+	// instructions
+	vector<Instruction>& instructions = script.getInstructions();
+	out.Write32((wxUint32)instructions.size());
+	for (auto const& i : instructions) {
+		out.Write8((wxUint8)i.instr);
+		if (has_variable_data(i.instr)) {
+			write_variable(i.data);
+		} else if (i.instr == I_GET_VAR_MEMBER_C) {
+			write_variable(i.dataLow(SUPER_VAR_BITS));
+			out.Write32(i.dataHigh(SUPER_VAR_BITS));
+		} else {
+			out.Write32(i.data);
+		}
+	}
+}
+
+// ----------------------------------------------------------------------------- : Reading
+
+/// Do the jumps, constants and call arguments in a script refer to instructions and constants that exist?
+/** Scripts from the cache are not trusted, the file may be damaged or written by another version.
+ *  Constants that are scripts are checked separately.
+ */
+bool check_script(Script& script) {
+	vector<ScriptValueP>& constants    = script.getConstants();
+	vector<Instruction>&  instructions = script.getInstructions();
+	size_t size = instructions.size();
+	for (size_t j = 0 ; j < size ; ++j) {
+		const Instruction& i = instructions[j];
+		switch (i.instr) {
+			case I_JUMP: case I_JUMP_IF_NOT: case I_JUMP_SC_AND: case I_JUMP_SC_OR:
+			case I_LOOP: case I_LOOP_WITH_KEY:
+				if (i.data > size) return false; // jumping to the end is fine
+				break;
+			case I_JUMP_IF_NOT_BINARY:
+				if (i.dataLow(SUPER_OP_BITS) > I_OR_ELSE || i.dataHigh(SUPER_OP_BITS) > size) return false;
+				break;
+			case I_PUSH_CONST: case I_MEMBER_C:
+				if (i.data >= constants.size()) return false;
+				break;
+			case I_BINARY_C:
+				if (i.dataLow(SUPER_OP_BITS) > I_OR_ELSE || i.dataHigh(SUPER_OP_BITS) >= constants.size()) return false;
+				break;
+			case I_GET_VAR_MEMBER_C:
+				if (i.dataHigh(SUPER_VAR_BITS) >= constants.size()) return false;
+				break;
+			case I_CALL: case I_CLOSURE: case I_TAILCALL:
+				// followed by an I_NOP with the variable for each argument
+				if (i.data >= size - j) return false;
+				for (size_t k = j + 1 ; k <= j + i.data ; ++k) {
+					if (instructions[k].instr != I_NOP) return false;
+				}
+				break;
+			case I_UNARY:      if (i.data > I_NOT)     return false; break;
+			case I_BINARY:     if (i.data > I_OR_ELSE) return false; break;
+			case I_TERNARY:    if (i.data > I_RGB)     return false; break;
+			case I_QUATERNARY: if (i.data > I_RGBA)    return false; break;
+			default: break;
+		}
+	}
+	return true;
+}
+
+/// Read a script from a cache file
+/** Returns nullptr if the file is damaged, then the rest of the file can not be read either.
+ *  If the script can be read, but doesn't pass check_script (or neither does a script in its constants), valid is set to false.
+ */
+ScriptP read_script(wxDataInputStream& in, wxInputStream& stream, bool& valid) {
+	ScriptP script = intrusive(new Script());
+	// constants
+	vector<ScriptValueP>& constants = script->getConstants();
+	wxUint32 constant_count = in.Read32();
+	for (wxUint32 j = 0 ; j < constant_count && stream.IsOk() ; ++j) {
+		switch (in.Read8()) {
+			case CONST_NIL:            constants.push_back(script_nil);            break;
+			case CONST_TRUE:           constants.push_back(script_true);           break;
+			case CONST_FALSE:          constants.push_back(script_false);          break;
+			case CONST_WARNING:        constants.push_back(script_warning);        break;
+			case CONST_WARNING_IF_NEQ: constants.push_back(script_warning_if_neq); break;
+			case CONST_INT:
+				constants.push_back(to_script((int)in.Read32()));
+				break;
+			case CONST_DOUBLE: {
+				wxUint64 bits = in.Read64();
+				double d;
+				memcpy(&d, &bits, sizeof(d));
+				constants.push_back(to_script(d));
+				break;
+			}
+			case CONST_STRING:
+				constants.push_back(to_script(in.ReadString()));
+				break;
+			case CONST_COLOR: {
+				Byte r = in.Read8(), g = in.Read8(), b = in.Read8(), a = in.Read8();
+				constants.push_back(to_script(AColor(r,g,b,a)));
+				break;
+			}
+			case CONST_SCRIPT: {
+				ScriptP sub = read_script(in, stream, valid);
+				if (!sub) return ScriptP();
+				constants.push_back(sub);
+				break;
+			}
+			default:
+				return ScriptP();
+		}
+	}
+	if (!stream.IsOk()) return ScriptP();
+	// instructions
+	vector<Instruction>& instructions = script->getInstructions();
+	wxUint32 instruction_count = in.Read32();
+	for (wxUint32 j = 0 ; j < instruction_count && stream.IsOk() ; ++j) {
+		unsigned int type = in.Read8();
+		unsigned int data;
+		if (type > I_JUMP_IF_NOT_BINARY) return ScriptP();
+		if (has_variable_data(type)) {
+			data = string_to_variable(in.ReadString());
+		} else if (type == I_GET_VAR_MEMBER_C) {
+			data = string_to_variable(in.ReadString());
+			if (data >= (1u << SUPER_VAR_BITS)) valid = false; // doesn't fit anymore, parse the script again
+			data |= in.Read32() << SUPER_VAR_BITS;
+		} else {
+			data = in.Read32();
+		}
+		if (data >= (1u << 26)) valid = false; // doesn't fit in an instruction
+		Instruction i;
+		i.instr = (InstructionType)type;
+		i.data  = data;
+		instructions.push_back(i);
+	}
+	if (!stream.IsOk()) return ScriptP();
+	if (valid && !check_script(*script)) valid = false;
+	return script;
+}
+
+// ----------------------------------------------------------------------------- : PackageScriptCache
+
+PackageScriptCache::PackageScriptCache(const Package& package)
+	: package(package)
+	, loaded(false)
+	, changed(false)
+{}
+
+/// Key of a script in the cache
+inline String cache_key(const String& source, bool string_mode) {
+	return (string_mode ? _("s:") : _("c:")) + source;
+}
+
+ScriptP PackageScriptCache::find(const String& source, bool string_mode) {
+	if (!loaded) load();
+	auto it = scripts.find(cache_key(source, string_mode));
+	if (it == scripts.end()) return ScriptP();
+	// the caller may add instructions to the script, so it gets a copy
+	return intrusive(new Script(*it->second));
+}
+
+void PackageScriptCache::add(const String& source, bool string_mode, Script& script) {
+	if (!loaded) load();
+	if (source.find(_("include file:")) != String::npos) return; // depends on other files
+	if (!can_cache(script)) return;
+	scripts[cache_key(source, string_mode)] = intrusive(new Script(script));
+	changed = true;
+}
+
+String PackageScriptCache::filename() const {
+	String dir = user_settings_dir() + _("cache");
+	if (!wxDirExists(dir)) wxMkdir(dir);
+	dir += _("/scripts");
+	if (!wxDirExists(dir)) wxMkdir(dir);
+	size_t key = hash_value(package.absoluteFilename());
+	return dir + _("/") + wxULongLong((wxULongLong_t)key).ToString() + _(".bin");
+}
+
+void PackageScriptCache::load() {
+	loaded = true;
+	String file = filename();
+	if (!wxFileExists(file)) return;
+	wxLogNull noLog;
+	wxFileInputStream file_stream(file);
+	if (!file_stream.IsOk()) return;
+	wxBufferedInputStream stream(file_stream);
+	wxDataInputStream in(stream);
+	// header
+	char magic[SCRIPT_CACHE_MAGIC_SIZE];
+	stream.Read(magic, SCRIPT_CACHE_MAGIC_SIZE);
+	if (stream.LastRead() != SCRIPT_CACHE_MAGIC_SIZE || memcmp(magic, SCRIPT_CACHE_MAGIC, SCRIPT_CACHE_MAGIC_SIZE) != 0) return;
+	if (in.Read32() != SCRIPT_CACHE_FORMAT)   return;
+	if (in.Read32() != app_version.version)   return;
+	if (in.ReadString() != package.absoluteFilename()) return;
+	if (in.Read64() != (wxUint64)package.lastModified().GetTicks()) return;
+	// scripts
+	std::unordered_map<String, ScriptP, boost::hash<String>> cached;
+	wxUint32 count = in.Read32();
+	for (wxUint32 j = 0 ; j < count && stream.IsOk() ; ++j) {
+		String key = in.ReadString();
+		bool valid = true;
+		ScriptP script = read_script(in, stream, valid);
+		if (!script) return;
+		if (valid) {
+			cached[key] = script;
+		} else {
+			changed = true; // leave it out, it is parsed again when it is needed, and then the file is written again
+		}
+	}
+	if (!stream.IsOk() || in.Read32() != count) return;
+	scripts.swap(cached);
+}
+
+void PackageScriptCache::save() {
+	if (!changed) return;
+	changed = false;
+	String file = filename();
+	String temp_file = file + wxString::Format(_(".%lu"), wxGetProcessId()); // other processes may be writing the same file
+	wxLogNull noLog;
+	bool ok = false;
+	{
+		wxFileOutputStream file_stream(temp_file);
+		if (!file_stream.IsOk()) return;
+		wxBufferedOutputStream stream(file_stream);
+		wxDataOutputStream out(stream);
+		try {
+			stream.Write(SCRIPT_CACHE_MAGIC, SCRIPT_CACHE_MAGIC_SIZE);
+			out.Write32(SCRIPT_CACHE_FORMAT);
+			out.Write32(app_version.version);
+			out.WriteString(package.absoluteFilename());
+			out.Write64((wxUint64)package.lastModified().GetTicks());
+			map<unsigned int,String> variable_names;
+			out.Write32((wxUint32)scripts.size());
+			for (auto const& s : scripts) {
+				out.WriteString(s.first);
+				write_script(out, *s.second, variable_names);
+			}
+			out.Write32((wxUint32)scripts.size());
+			stream.Sync();
+			ok = stream.IsOk() && file_stream.IsOk();
+		} catch (const Error&) {
+			// a variable without a name, don't store this cache
+		}
+	}
+	if (!ok || !wxRenameFile(temp_file, file, true)) {
+		wxRemoveFile(temp_file);
+	}
+}
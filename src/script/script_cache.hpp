@@ -0,0 +1,59 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) 2001 - 2012 Twan van Laarhoven and Sean Hunt             |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+#ifndef HEADER_SCRIPT_SCRIPT_CACHE
+#define HEADER_SCRIPT_SCRIPT_CACHE
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <util/dynamic_arg.hpp>
+#include <util/hash.hpp>
+#include <unordered_map>
+
+DECLARE_POINTER_TYPE(Script);
+class Package;
+
+// ----------------------------------------------------------------------------- : PackageScriptCache
+
+/// Compiled scripts of a package, stored in the user's cache directory
+/** Parsing the scripts of a game or stylesheet is a large part of the time needed to open it.
+ *  The cache stores the compiled scripts keyed on their source code,
+ *  so they can be loaded without parsing the next time the package is opened.
+ *
+ *  The cache file of a package is only used if the package and the program have not changed since it was written.
+ *  Scripts that include files or that have parse errors are never cached.
+ *
+ *  The cache file is read when the first script is looked up, so the package must be opened by then.
+ */
+class PackageScriptCache {
+  public:
+	PackageScriptCache(const Package& package);
+
+	/// Find the compiled script for the given source code, returns a new script, or nullptr if it is not cached
+	ScriptP find(const String& source, bool string_mode);
+	/// Add a compiled script to the cache
+	void add(const String& source, bool string_mode, Script& script);
+	/// Write the cache file, if scripts were added
+	void save();
+
+  private:
+	const Package& package;
+	bool loaded;  ///< Has the cache file been read?
+	bool changed; ///< Have scripts been added since?
+	std::unordered_map<String, ScriptP, boost::hash<String>> scripts;
+
+	/// Read the cache file, if it is valid
+	void load();
+	/// Filename of the cache file
+	String filename() const;
+};
+
+/// The cache to use for scripts parsed while reading a package, or nullptr
+DECLARE_DYNAMIC_ARG(PackageScriptCache*, package_script_cache);
+
+// ----------------------------------------------------------------------------- : EOF
+#endif
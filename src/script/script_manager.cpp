@@ -20,10 +20,14 @@
 #include <data/action/value.hpp>
 #include <data/action/keyword.hpp>
 #include <util/error.hpp>
+#include <util/parallel.hpp>
+#include <atomic>
+#include <functional>
+#include <memory>
 
-using std::deque;
 using std::pair;
 using std::make_pair;
+using std::min;
 
 typedef map<const StyleSheet*,Context*> Contexts;
 
@@ -84,6 +88,64 @@ Context& SetScriptContext::getContext(const CardP& card) {
 	return ctx;
 }
 
+// ----------------------------------------------------------------------------- : SetScriptManager : update order
+
+// Call f for all set and card fields that are updated when a field with the given dependent scripts changes
+void for_each_dependent_field(const Game& game, const vector<Dependency>& deps, const std::function<void (Field&)>& f, int level = 0) {
+	if (level > 10) return; // copy dependencies should not be nested this deep, don't loop
+	for(const auto& d : deps) {
+		switch (d.type) {
+			case DEP_SET_FIELD:
+				f(*game.set_fields.at(d.index));
+				break;
+			case DEP_CARD_FIELD: case DEP_CARDS_FIELD:
+				f(*game.card_fields.at(d.index));
+				break;
+			case DEP_CARD_COPY_DEP:
+				for_each_dependent_field(game, game.card_fields.at(d.index)->dependent_scripts, f, level + 1);
+				break;
+			case DEP_SET_COPY_DEP:
+				for_each_dependent_field(game, game.set_fields.at(d.index)->dependent_scripts, f, level + 1);
+				break;
+			default:
+				break; // not a value
+		}
+	}
+}
+
+// Depth first search through the dependency graph, a field is finished after all fields that depend on it
+void visit_field(const Game& game, Field& field, set<const Field*>& visited, vector<Field*>& finished) {
+	if (!visited.insert(&field).second) return; // already visited, or a cycle
+	for_each_dependent_field(game, field.dependent_scripts, [&](Field& dependent) {
+		visit_field(game, dependent, visited, finished);
+	});
+	finished.push_back(&field);
+}
+
+/// Set Field::update_order of all fields of a game
+/** Fields get a higher update_order than the fields they depend on (a topological order).
+ *  Scripts can depend on each other in a cycle, in that case the order within the cycle is arbitrary.
+ */
+void order_fields(const Game& game) {
+	set<const Field*> visited;
+	vector<Field*> finished;
+	for(const auto& f : game.set_fields)  visit_field(game, *f, visited, finished);
+	for(const auto& f : game.card_fields) visit_field(game, *f, visited, finished);
+	int order = 0;
+	for (auto it = finished.rbegin() ; it != finished.rend() ; ++it) {
+		(*it)->update_order = order++;
+	}
+}
+
+struct SetScriptManager::ToUpdateOrder {
+	inline bool operator () (const ToUpdate& a, const ToUpdate& b) const {
+		int order_a = a.value->fieldP->update_order;
+		int order_b = b.value->fieldP->update_order;
+		if (order_a != order_b) return order_a < order_b;
+		return a.value < b.value;
+	}
+};
+
 // ----------------------------------------------------------------------------- : SetScriptManager : initialization
 
 SetScriptManager::SetScriptManager(Set& set)
@@ -121,6 +183,8 @@ void SetScriptManager::initDependencies(Context& ctx, Game& game) {
 	for(auto& f : game.set_fields) {
 		f->initDependencies(ctx, Dependency(DEP_SET_FIELD, f->index));
 	}
+	// in what order should values be updated?
+	order_fields(game);
 }
 
 
@@ -182,6 +246,7 @@ void SetScriptManager::onAction(const Action& action, bool undone) {
 			// update the added cards specificly
 			for(const auto& step : action.action.steps) {
 				const CardP& card = step.item;
+				set.cardChanged(card.get());
 				Context& ctx = getContext(card);
 				for(auto& v : card->data) {
 					v->update(ctx,&action);
@@ -191,6 +256,7 @@ void SetScriptManager::onAction(const Action& action, bool undone) {
 		// note: fallthrough
 	}
 	TYPE_CASE_(action, CardListAction) {
+		set.cardChanged(nullptr);
 		#ifdef LOG_UPDATES
 			wxLogDebug(_("Card dependencies"));
 		#endif
@@ -200,17 +266,21 @@ void SetScriptManager::onAction(const Action& action, bool undone) {
 		#endif
 	}
 	TYPE_CASE_(action, KeywordListAction) {
+		set.clearOrderCache();
 		updateAllDependend(set.game->dependent_scripts_keywords);
 		return;
 	}
 	TYPE_CASE_(action, ChangeKeywordModeAction) {
+		set.clearOrderCache();
 		updateAllDependend(set.game->dependent_scripts_keywords);
 		return;
 	}
 	TYPE_CASE(action, ChangeCardStyleAction) {
+		set.cardChanged(action.card.get());
 		updateAllDependend(set.game->dependent_scripts_stylesheet, action.card);
 	}
 	TYPE_CASE_(action, ChangeSetStyleAction) {
+		set.clearOrderCache();
 		updateAllDependend(set.game->dependent_scripts_stylesheet);
 		return;
 	}
@@ -259,10 +329,11 @@ void SetScriptManager::updateDelayed() {
 
 void SetScriptManager::updateValue(Value& value, const CardP& card, Action const* action) {
 	Age starting_age = Age::next(); // the start of the update process, use next(), so the modified value also gets a chance to be updated
-	deque<ToUpdate> to_update;
+	UpdateQueue to_update;
 	// execute script for initial changed value
 	value.last_modified = starting_age;
 	value.update(getContext(card), action);
+	valueChanged(card);
 	#ifdef LOG_UPDATES
 		wxLogDebug(_("Start:     %s"), value.fieldP->name);
 	#endif
@@ -274,6 +345,19 @@ void SetScriptManager::updateValue(Value& value, const CardP& card, Action const
 	#endif
 }
 
+// Update a single card value during updateAll
+void update_card_value(Context& ctx, Value& v) {
+	try {
+		#if USE_SCRIPT_PROFILING
+			Timer t;
+			Profiler prof(t, v.fieldP.get(), _("update card.") + v.fieldP->name);
+		#endif
+		v.update(ctx);
+	} catch (const ScriptError& e) {
+		handle_error(ScriptError(e.what() + _("\n  while updating card value '") + v.fieldP->name + _("'")));
+	}
+}
+
 void SetScriptManager::updateAll() {
 	#ifdef LOG_UPDATES
 		wxLogDebug(_("Update all"));
@@ -289,45 +373,150 @@ void SetScriptManager::updateAll() {
 			handle_error(ScriptError(e.what() + _("\n  while updating set value '") + v->fieldP->name + _("'")));
 		}
 	}
-	// update card data of all cards
+	// update card data of all cards, first the fields that can be done in parallel
+	vector<bool> updated_fields;
+	updateAllCardsParallel(updated_fields);
 	for(auto& card : set.cards) {
 		Context& ctx = getContext(card);
 		for(auto& v : card->data) {
-			try {
-				#if USE_SCRIPT_PROFILING
-					Timer t;
-					Profiler prof(t, v->fieldP.get(), _("update card.") + v->fieldP->name);
-				#endif
-				v->update(ctx);
-			} catch (const ScriptError& e) {
-				handle_error(ScriptError(e.what() + _("\n  while updating card value '") + v->fieldP->name + _("'")));
-			}
+			if (!updated_fields.empty() && updated_fields[v->fieldP->index]) continue;
+			update_card_value(ctx, *v);
 		}
 	}
 	// update things that depend on the card list
+	set.clearOrderCache(); // values were updated without telling the order cache
 	updateAllDependend(set.game->dependent_scripts_cards);
 	#ifdef LOG_UPDATES
 		wxLogDebug(_("-------------------------------\n"));
 	#endif
 }
 
+/// Minimum number of cards to give each thread in updateAllCardsParallel
+const int min_cards_per_thread = 32;
+
+void SetScriptManager::updateAllCardsParallel(vector<bool>& updated_fields) {
+	updated_fields.clear();
+	#if USE_SCRIPT_PROFILING
+		return; // the profiler is not thread safe
+	#endif
+	int threads = min(parallel_thread_count(), (int)set.cards.size() / min_cards_per_thread);
+	if (threads <= 1) return;
+	// make sure that the dependencies of all stylesheets are known
+	vector<StyleSheetP> stylesheets;
+	for(const auto& card : set.cards) {
+		StyleSheetP stylesheet = set.stylesheetForP(card);
+		if (find(stylesheets.begin(), stylesheets.end(), stylesheet) == stylesheets.end()) {
+			stylesheets.push_back(stylesheet);
+			getContext(stylesheet);
+		}
+	}
+	// which fields can be done in parallel?
+	findCardLocalFields(updated_fields);
+	if (find(updated_fields.begin(), updated_fields.end(), true) == updated_fields.end()) {
+		updated_fields.clear();
+		return;
+	}
+	// a context for each thread, initialized here, so the init scripts run in the main thread
+	vector<std::unique_ptr<SetScriptContext> > contexts;
+	for (int i = 0 ; i < threads ; ++i) {
+		contexts.push_back(std::unique_ptr<SetScriptContext>(new SetScriptContext(set)));
+		for(const auto& stylesheet : stylesheets) {
+			contexts.back()->getContext(stylesheet);
+		}
+	}
+	std::atomic<int> next_context(0);
+	parallel_for_ranges((int)set.cards.size(), min_cards_per_thread, [&](int begin, int end) {
+		SetScriptContext& script_context = *contexts.at(next_context++);
+		for (int i = begin ; i < end ; ++i) {
+			const CardP& card = set.cards[i];
+			Context& ctx = script_context.getContext(card);
+			for(auto& v : card->data) {
+				if (updated_fields[v->fieldP->index]) {
+					update_card_value(ctx, *v);
+				}
+			}
+		}
+	});
+}
+
+// Add the card fields whose scripts depend on a field with the given dependent scripts
+// the bool is true if the script uses the value of other cards
+void add_card_field_dependents(const Game& game, const vector<Dependency>& deps, vector<pair<size_t,bool> >& out, int level = 0) {
+	if (level > 10) return; // copy dependencies should not be nested this deep, don't loop
+	for(const auto& d : deps) {
+		switch (d.type) {
+			case DEP_CARD_FIELD:  out.push_back(make_pair((size_t)d.index, false)); break;
+			case DEP_CARDS_FIELD: out.push_back(make_pair((size_t)d.index, true));  break;
+			case DEP_CARD_COPY_DEP:
+				add_card_field_dependents(game, game.card_fields.at(d.index)->dependent_scripts, out, level + 1);
+				break;
+			case DEP_SET_COPY_DEP:
+				add_card_field_dependents(game, game.set_fields.at(d.index)->dependent_scripts, out, level + 1);
+				break;
+			default:
+				break; // not a card field
+		}
+	}
+}
+
+void SetScriptManager::findCardLocalFields(vector<bool>& local) {
+	const Game& game = *set.game;
+	size_t n = game.card_fields.size();
+	// dependents of each field
+	vector<vector<pair<size_t,bool> > > dependents(n);
+	for (size_t j = 0 ; j < n ; ++j) {
+		add_card_field_dependents(game, game.card_fields[j]->dependent_scripts, dependents[j]);
+	}
+	// fields that use other cards, the card list or the keyword database are done in order,
+	// as are the fields of other cards that they use
+	vector<bool> ordered(n, false);
+	vector<pair<size_t,bool> > global;
+	add_card_field_dependents(game, game.dependent_scripts_cards,    global);
+	add_card_field_dependents(game, game.dependent_scripts_keywords, global);
+	for(const auto& d : global) ordered.at(d.first) = true;
+	for (size_t j = 0 ; j < n ; ++j) {
+		for(const auto& d : dependents[j]) {
+			if (d.second) ordered.at(d.first) = ordered[j] = true;
+		}
+	}
+	// fields that use ordered fields must also be done in order,
+	// and ordered fields that use later fields of the same card must see their old values
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		for (size_t j = 0 ; j < n ; ++j) {
+			for(const auto& d : dependents[j]) {
+				size_t i = d.first; // i uses j
+				if (ordered[j] && !ordered.at(i)) {
+					ordered[i] = changed = true;
+				} else if (ordered.at(i) && !ordered[j] && j > i) {
+					ordered[j] = changed = true;
+				}
+			}
+		}
+	}
+	local.resize(n);
+	for (size_t i = 0 ; i < n ; ++i) local[i] = !ordered[i];
+}
+
 void SetScriptManager::updateAllDependend(const vector<Dependency>& dependent_scripts, const CardP& card) {
-	deque<ToUpdate> to_update;
+	UpdateQueue to_update;
 	Age starting_age = Age::next();
 	alsoUpdate(to_update, dependent_scripts, card);
 	updateRecursive(to_update, starting_age);
 }
 
-void SetScriptManager::updateRecursive(deque<ToUpdate>& to_update, Age starting_age) {
+void SetScriptManager::updateRecursive(UpdateQueue& to_update, Age starting_age) {
 	if (to_update.empty()) return;
-	set.clearOrderCache(); // clear caches before evaluating a round of scripts
 	while (!to_update.empty()) {
-		updateToUpdate(to_update.front(), to_update, starting_age);
-		to_update.pop_front();
+		// the first value in the update order; the values it depends on have already been updated
+		ToUpdate u = *to_update.begin();
+		to_update.erase(to_update.begin());
+		updateToUpdate(u, to_update, starting_age);
 	}
 }
 
-void SetScriptManager::updateToUpdate(const ToUpdate& u, deque<ToUpdate>& to_update, Age starting_age) {
+void SetScriptManager::updateToUpdate(const ToUpdate& u, UpdateQueue& to_update, Age starting_age) {
 	Age& age = u.value->last_modified;
 	if (starting_age <= age)  return; // this value was already updated
 	age = starting_age; // mark as updated
@@ -339,6 +528,7 @@ void SetScriptManager::updateToUpdate(const ToUpdate& u, deque<ToUpdate>& to_upd
 		handle_error(ScriptError(e.what() + _("\n  while updating value '") + u.value->fieldP->name + _("'")));
 	}
 	if (changes) {
+		valueChanged(u.card);
 		// changed, send event
 		ScriptValueEvent change(u.card.get(), u.value);
 		set.actions.tellListeners(change, false);
@@ -354,17 +544,25 @@ void SetScriptManager::updateToUpdate(const ToUpdate& u, deque<ToUpdate>& to_upd
 	#endif
 }
 
-void SetScriptManager::alsoUpdate(deque<ToUpdate>& to_update, const vector<Dependency>& deps, const CardP& card) {
+void SetScriptManager::valueChanged(const CardP& card) {
+	if (card) {
+		set.cardChanged(card.get());
+	} else {
+		set.clearOrderCache();
+	}
+}
+
+void SetScriptManager::alsoUpdate(UpdateQueue& to_update, const vector<Dependency>& deps, const CardP& card) {
 	for(const auto& d : deps) {
 		switch (d.type) {
 			case DEP_SET_FIELD: {
 				ValueP value = set.data.at(d.index);
-				to_update.push_back(ToUpdate(value.get(), CardP()));
+				to_update.insert(ToUpdate(value.get(), CardP()));
 				break;
 			} case DEP_CARD_FIELD: {
 				if (card) {
 					ValueP value = card->data.at(d.index);
-					to_update.push_back(ToUpdate(value.get(), card));
+					to_update.insert(ToUpdate(value.get(), card));
 					break;
 				} else {
 					// There is no card, so the update should affect all cards (fall through).
@@ -373,7 +571,7 @@ void SetScriptManager::alsoUpdate(deque<ToUpdate>& to_update, const vector<Depen
 				// something invalidates a card value for all cards, so all cards need updating
 				for(auto& card : set.cards) {
 					ValueP value = card->data.at(d.index);
-					to_update.push_back(ToUpdate(value.get(), card));
+					to_update.insert(ToUpdate(value.get(), card));
 				}
 				break;
 			} case DEP_CARD_STYLE: {
@@ -393,7 +591,7 @@ void SetScriptManager::alsoUpdate(deque<ToUpdate>& to_update, const vector<Depen
 					StyleSheet* stylesheet_card = &set.stylesheetFor(card);
 					if (stylesheet == stylesheet_card) {
 						ValueP value = card->extra_data.at(d.index);
-						to_update.push_back(ToUpdate(value.get(), card));
+						to_update.insert(ToUpdate(value.get(), card));
 					}
 				}*/
 				break;
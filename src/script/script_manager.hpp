@@ -78,6 +78,15 @@ class SetScriptManager : public SetScriptContext, public ActionListener {
 	void initDependencies(Context&, Game&);
 	void initDependencies(Context&, StyleSheet&);
 	
+	/// Update the values of all cards that don't depend on other cards, using multiple threads
+	/** Each thread uses its own SetScriptContext.
+	 *  Sets updated_fields[i] if card field i has been updated, or leaves it empty if nothing was done.
+	 *  The results are the same as when updating all cards in order.
+	 */
+	void updateAllCardsParallel(vector<bool>& updated_fields);
+	/// Find the card fields whose scripts only depend on the same card
+	void findCardLocalFields(vector<bool>& local);
+	
 	/// Update a map of styles
 	void updateStyles(Context& ctx, const IndexMap<FieldP,StyleP>& styles, bool only_content_dependent);
 	/// Updates scripts, starting at some value
@@ -94,13 +103,23 @@ class SetScriptManager : public SetScriptContext, public ActionListener {
 		Value* value;  ///< value to update
 		CardP  card;   ///< card the value is in, or CadP() if it is not a card field
 	};
+	/// Order in which values are updated: by Field::update_order
+	struct ToUpdateOrder;
+	/// Values that need to be updated, each value is in the queue at most once
+	typedef std::set<ToUpdate,ToUpdateOrder> UpdateQueue;
+	
 	/// Update all things in to_update, and things that depent on them, etc.
-	/** Only update things that are older than starting_age. */
-	void updateRecursive(std::deque<ToUpdate>& to_update, Age starting_age);
+	/** Only update things that are older than starting_age.
+	 *  Values are updated in order of their field's update_order, so a value is updated after
+	 *  the values it depends on, and each value is updated at most once.
+	 */
+	void updateRecursive(UpdateQueue& to_update, Age starting_age);
 	/// Update a value given by a ToUpdate object, and add things depending on it to to_update
-	void updateToUpdate(const ToUpdate& u, std::deque<ToUpdate>& to_update, Age starting_age);
+	void updateToUpdate(const ToUpdate& u, UpdateQueue& to_update, Age starting_age);
 	/// Schedule all things in deps to be updated by adding them to to_update
-	void alsoUpdate(std::deque<ToUpdate>& to_update, const vector<Dependency>& deps, const CardP& card);
+	void alsoUpdate(UpdateQueue& to_update, const vector<Dependency>& deps, const CardP& card);
+	/// Tell the order cache of the set that a value on a card (or of the set itself if card is null) has changed
+	void valueChanged(const CardP& card);
 	
 	/// Delayed update for (bitmask)...
 	enum Delay
@@ -11,6 +11,7 @@
 #include <script/context.hpp>
 #include <script/parser.hpp>
 #include <script/script.hpp>
+#include <script/script_cache.hpp>
 #include <script/value.hpp>
 #include <gfx/color.hpp>
 
@@ -71,9 +72,17 @@ void parse_errors_to_reader_warnings(Reader& reader, vector<ScriptParseError> co
 }
 
 void OptionalScript::parse(Reader& reader, bool string_mode) {
+	PackageScriptCache* cache = package_script_cache();
+	if (cache) {
+		script = cache->find(unparsed, string_mode);
+		if (script) return;
+	}
 	vector<ScriptParseError> errors;
 	script = ::parse(unparsed, reader.getPackage(), string_mode, errors);
 	parse_errors_to_reader_warnings(reader,errors);
+	if (cache && script && errors.empty()) {
+		cache->add(unparsed, string_mode, *script);
+	}
 }
 
 void OptionalScript::initDependencies(Context& ctx, const Dependency& dep) const {
@@ -173,7 +173,41 @@ class ScriptInt : public ScriptValue {
 	int value;
 };
 
+// Preallocated integer values, these are not allocated from the pool
+/* NOTE: the pool can be destroyed before these values, see the note on script_true below
+ */
+class ScriptSmallInt : public ScriptInt {
+  public:
+	ScriptSmallInt(int v) : ScriptInt(v) {}
+  protected:
+	virtual void destroy() {
+		delete this;
+	}
+};
+
+/// Range of integers that are preallocated, most integers in scripts are small (counters, indices, sizes)
+const int SMALL_INT_MIN = -128;
+const int SMALL_INT_MAX = 1023;
+
+/// The preallocated integers SMALL_INT_MIN..SMALL_INT_MAX
+/** This is a function, so it can be used during static initialization */
+static const ScriptValueP* small_ints() {
+	static vector<ScriptValueP> ints = [] {
+		vector<ScriptValueP> ints;
+		ints.reserve(SMALL_INT_MAX - SMALL_INT_MIN + 1);
+		for (int i = SMALL_INT_MIN ; i <= SMALL_INT_MAX ; ++i) {
+			ints.push_back(intrusive(new ScriptSmallInt(i)));
+		}
+		return ints;
+	}();
+	return &ints[0];
+}
+
 ScriptValueP to_script(int v) {
+	if (v >= SMALL_INT_MIN && v <= SMALL_INT_MAX) {
+		// no need to allocate
+		return small_ints()[v - SMALL_INT_MIN];
+	}
 #ifdef USE_POOL_ALLOCATOR
 	return intrusive(
 			new(boost::singleton_pool<ScriptValue, sizeof(ScriptInt)>::malloc())
@@ -217,12 +251,24 @@ class ScriptDouble : public ScriptValue {
 	virtual String toString() const { return String() << value; }
 	virtual double toDouble() const { return value; }
 	virtual int    toInt()    const { return (int)value; } // TODO: do we want this automatic conversion?
+  protected:
+#ifdef USE_POOL_ALLOCATOR
+	virtual void destroy() {
+		boost::singleton_pool<ScriptValue, sizeof(ScriptDouble)>::free(this);
+	}
+#endif
   private:
 	double value;
 };
 
 ScriptValueP to_script(double v) {
+#ifdef USE_POOL_ALLOCATOR
+	return intrusive(
+			new(boost::singleton_pool<ScriptValue, sizeof(ScriptDouble)>::malloc())
+				ScriptDouble(v));
+#else
 	return intrusive(new ScriptDouble(v));
+#endif
 }
 
 // ----------------------------------------------------------------------------- : String type
@@ -299,9 +345,9 @@ class ScriptString : public ScriptValue {
 	}
 	virtual GeneratedImageP toImage() const {
 		if (value.empty()) {
-			return intrusive(new BlankImage());
+			return intern_image(intrusive(new BlankImage()));
 		} else {
-			return intrusive(new PackagedImage(value));
+			return intern_image(intrusive(new PackagedImage(value)));
 		}
 	}
 	virtual int itemCount() const { return (int)value.size(); }
@@ -383,7 +429,7 @@ class ScriptNil : public ScriptValue {
 	virtual bool   toBool()   const { return false; }
 	virtual AColor toColor()  const { return AColor(0,0,0,0); }
 	virtual GeneratedImageP toImage() const {
-		return intrusive(new BlankImage());
+		return intern_image(intrusive(new BlankImage()));
 	}
 
   protected:
@@ -0,0 +1,44 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) 2001 - 2012 Twan van Laarhoven and Sean Hunt             |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+#ifndef HEADER_UTIL_HASH
+#define HEADER_UTIL_HASH
+
+/** @file util/hash.hpp
+ *
+ *  @brief Hash functions for use with boost::hash and boost::hash_combine
+ */
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <boost/functional/hash.hpp>
+
+using boost::hash_combine;
+
+// ----------------------------------------------------------------------------- : Hashing
+
+/// Hash of a string, found by boost::hash_combine through ADL
+inline size_t hash_value(const String& str) {
+	size_t seed = str.size();
+	for(Char c : str) {
+		hash_combine(seed, c);
+	}
+	return seed;
+}
+
+/// Hash of a color, including the alpha channel
+inline size_t hash_value(const Color& color) {
+	size_t seed = 0;
+	hash_combine(seed, color.Red());
+	hash_combine(seed, color.Green());
+	hash_combine(seed, color.Blue());
+	hash_combine(seed, color.Alpha());
+	return seed;
+}
+
+// ----------------------------------------------------------------------------- : EOF
+#endif
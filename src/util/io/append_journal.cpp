@@ -0,0 +1,146 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) 2001 - 2012 Twan van Laarhoven and Sean Hunt             |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <util/io/append_journal.hpp>
+#include <wx/file.h>
+#include <wx/filefn.h>
+#include <boost/crc.hpp>
+#ifdef __WXMSW__
+	#include <io.h>
+#else
+	#include <unistd.h>
+#endif
+
+// ----------------------------------------------------------------------------- : File contents
+
+bool truncate_file(wxFile& file, wxFileOffset size) {
+	#ifdef __WXMSW__
+		return _chsize_s(file.fd(), size) == 0;
+	#else
+		return ftruncate(file.fd(), size) == 0;
+	#endif
+}
+
+bool sync_file(wxFile& file) {
+	#ifdef __WXMSW__
+		return _commit(file.fd()) == 0;
+	#else
+		return fsync(file.fd()) == 0;
+	#endif
+}
+
+// ----------------------------------------------------------------------------- : Journal format
+
+// The journal consists of:
+//  - the signature "MSE append journal\n"
+//  - the old size of the file, 8 bytes, little endian
+//  - the offset of the saved tail, 8 bytes, little endian
+//  - the bytes from that offset to the old end of the file
+//  - the crc32 of everything before it, 4 bytes, little endian
+
+const char   JOURNAL_SIGNATURE[]   = "MSE append journal\n";
+const size_t JOURNAL_SIGNATURE_SIZE = sizeof(JOURNAL_SIGNATURE) - 1;
+const size_t JOURNAL_HEADER_SIZE    = JOURNAL_SIGNATURE_SIZE + 8 + 8;
+
+inline void put_uint64(std::string& out, unsigned long long x) {
+	for (int i = 0 ; i < 8 ; ++i) out += (char)((x >> (8 * i)) & 0xFF);
+}
+inline unsigned long long get_uint64(const Byte* data) {
+	unsigned long long x = 0;
+	for (int i = 7 ; i >= 0 ; --i) x = x << 8 | data[i];
+	return x;
+}
+
+String append_journal_name(const String& filename) {
+	return filename + _(".journal");
+}
+
+// ----------------------------------------------------------------------------- : Appending
+
+bool begin_append(const String& filename, wxFile& file, wxFileOffset size, wxFileOffset tail_offset) {
+	if (tail_offset < 0 || tail_offset > size) return false;
+	// the tail of the file
+	std::string journal(JOURNAL_SIGNATURE, JOURNAL_SIGNATURE_SIZE);
+	put_uint64(journal, size);
+	put_uint64(journal, tail_offset);
+	size_t tail_size = (size_t)(size - tail_offset);
+	journal.resize(JOURNAL_HEADER_SIZE + tail_size);
+	if (tail_size > 0) {
+		if (file.Seek(tail_offset) == wxInvalidOffset) return false;
+		if (file.Read(&journal[JOURNAL_HEADER_SIZE], tail_size) != (ssize_t)tail_size) return false;
+	}
+	boost::crc_32_type crc;
+	crc.process_bytes(journal.data(), journal.size());
+	UInt checksum = crc.checksum();
+	for (int i = 0 ; i < 4 ; ++i) journal += (char)((checksum >> (8 * i)) & 0xFF);
+	// write it
+	String journal_name = append_journal_name(filename);
+	wxFile out;
+	if (!out.Create(journal_name, true)) return false;
+	if (out.Write(journal.data(), journal.size()) != journal.size() || !sync_file(out)) {
+		out.Close();
+		wxRemoveFile(journal_name);
+		return false;
+	}
+	return true;
+}
+
+void end_append(const String& filename) {
+	wxRemoveFile(append_journal_name(filename));
+}
+
+bool recover_append(const String& filename) {
+	String journal_name = append_journal_name(filename);
+	if (!wxFileExists(journal_name)) return false;
+	wxLogNull noLog;
+	// read the journal
+	vector<Byte> journal;
+	{
+		wxFile in(journal_name);
+		if (!in.IsOpened()) return false;
+		wxFileOffset length = in.Length();
+		if (length < (wxFileOffset)(JOURNAL_HEADER_SIZE + 4) || length > 0x7FFFFFFF) {
+			in.Close();
+			end_append(filename); // not completely written
+			return false;
+		}
+		journal.resize((size_t)length);
+		if (in.Read(&journal[0], journal.size()) != (ssize_t)journal.size()) return false;
+	}
+	size_t data_size = journal.size() - 4;
+	boost::crc_32_type crc;
+	crc.process_bytes(&journal[0], data_size);
+	UInt checksum = journal[data_size] | journal[data_size+1] << 8 | journal[data_size+2] << 16 | (UInt)journal[data_size+3] << 24;
+	wxFileOffset size        = (wxFileOffset)get_uint64(&journal[JOURNAL_SIGNATURE_SIZE]);
+	wxFileOffset tail_offset = (wxFileOffset)get_uint64(&journal[JOURNAL_SIGNATURE_SIZE + 8]);
+	if (memcmp(&journal[0], JOURNAL_SIGNATURE, JOURNAL_SIGNATURE_SIZE) != 0 || crc.checksum() != checksum
+	 || tail_offset < 0 || tail_offset > size || (wxFileOffset)(data_size - JOURNAL_HEADER_SIZE) != size - tail_offset) {
+		// the journal was not completely written, so nothing was appended yet
+		end_append(filename);
+		return false;
+	}
+	// restore the file
+	wxFile file(filename, wxFile::read_write);
+	if (!file.IsOpened()) return false;
+	if (file.Length() < size) {
+		// this is not the file the journal was written for, leave it alone
+		file.Close();
+		end_append(filename);
+		return false;
+	}
+	size_t tail_size = data_size - JOURNAL_HEADER_SIZE;
+	if (tail_size > 0) {
+		if (file.Seek(tail_offset) == wxInvalidOffset) return false;
+		if (file.Write(&journal[JOURNAL_HEADER_SIZE], tail_size) != tail_size) return false;
+	}
+	if (!truncate_file(file, size) || !sync_file(file)) return false;
+	file.Close();
+	end_append(filename);
+	return true;
+}
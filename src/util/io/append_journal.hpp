@@ -0,0 +1,56 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) 2001 - 2012 Twan van Laarhoven and Sean Hunt             |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+#ifndef HEADER_UTIL_IO_APPEND_JOURNAL
+#define HEADER_UTIL_IO_APPEND_JOURNAL
+
+/** @file util/io/append_journal.hpp
+ *
+ *  @brief Undoing an interrupted append to a file.
+ *
+ *  Zip packages are saved by appending new entries and a new central directory to the end.
+ *  If the program stops halfway, the end of the file is not a valid zip end record,
+ *  and the old one may be too far from the end to be found.
+ *  Before appending, the old size of the file and its last bytes (the old central directory
+ *  and end record) are written to a small journal file next to it.
+ *  When the file is opened again and the journal is still there, the file is restored from it.
+ */
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+class wxFile;
+
+// ----------------------------------------------------------------------------- : File contents
+
+/// Change the size of an opened file, throwing away everything after the given size
+bool truncate_file(wxFile& file, wxFileOffset size);
+
+/// Make sure that everything written to an opened file is on the disk
+bool sync_file(wxFile& file);
+
+// ----------------------------------------------------------------------------- : Append journal
+
+/// Name of the journal file for appending to the given file
+String append_journal_name(const String& filename);
+
+/// Write a journal before appending to file
+/** file has the given size, the bytes from tail_offset to the end are saved in the journal.
+ *  The journal is on the disk when this returns true. If it returns false nothing should be appended.
+ */
+bool begin_append(const String& filename, wxFile& file, wxFileOffset size, wxFileOffset tail_offset);
+
+/// Appending is done (and synced), or was undone, remove the journal
+void end_append(const String& filename);
+
+/// If appending to a file was interrupted, restore the file to the state before appending
+/** Returns true if the file was restored.
+ *  A journal that was not completely written is removed, appending had not started yet in that case.
+ */
+bool recover_append(const String& filename);
+
+// ----------------------------------------------------------------------------- : EOF
+#endif
@@ -9,16 +9,22 @@
 #include <util/prec.hpp>
 #include <util/io/package.hpp>
 #include <util/io/package_manager.hpp>
+#include <util/io/append_journal.hpp>
 #include <util/error.hpp>
 #include <script/to_value.hpp> // for reflection
 #include <script/profiler.hpp> // for PROFILER
 #include <wx/wfstream.h>
 #include <wx/zipstrm.h>
+#include <wx/zstream.h>
+#include <wx/mstream.h>
+#include <wx/file.h>
 #include <wx/dir.h>
 #include <boost/scoped_ptr.hpp>
+#include <boost/crc.hpp>
 
 using std::make_pair;
 using std::max;
+using std::min;
 using std::pair;
 
 // ----------------------------------------------------------------------------- : Package : outside
@@ -29,11 +35,11 @@ IMPLEMENT_DYNAMIC_ARG(Package*, clipboard_package, nullptr);
 Package::Package()
 	: fileStream(nullptr)
 	, zipStream (nullptr)
+	, zipFile   (nullptr)
 {}
 
 Package::~Package() {
-	delete zipStream;
-	delete fileStream;
+	closeZipfile();
 	// remove any remaining temporary files
 	for(auto& f : files) {
 		if (f.second.wasWritten()) {
@@ -83,6 +89,7 @@ void Package::open(const String& n, bool fast) {
 	if (wxDirExists(filename)) {
 		openDirectory(fast);
 	} else if (wxFileExists(filename)) {
+		recover_append(filename); // undo an append that was interrupted
 		openZipfile();
 	} else {
 		throw PackageNotFoundError(_("Package not found: '") + filename + _("'"));
@@ -92,8 +99,7 @@ void Package::open(const String& n, bool fast) {
 void Package::reopen() {
 	if (wxDirExists(filename)) {
 		// make sure we have no zip open
-		delete zipStream;  zipStream  = nullptr;
-		delete fileStream; fileStream = nullptr;
+		closeZipfile();
 	} else {
 		// reopen only needed for zipfile
 		openZipfile();
@@ -110,6 +116,8 @@ void Package::saveAs(const String& name, bool remove_unused) {
 	// type of package
 	if (wxDirExists(name)) {
 		saveToDirectory(name, remove_unused, false);
+	} else if (name == filename && appendToZipfile(remove_unused)) {
+		// only the changes were written
 	} else {
 		saveToZipfile  (name, remove_unused, false);
 	}
@@ -198,6 +206,75 @@ class BufferedFileInputStream : private BufferedFileInputStream_aux, public wxBu
 	{}
 };
 
+class MemoryInputStream_aux {
+  protected:
+	vector<char> buffer;
+	inline MemoryInputStream_aux(vector<char>& data) {
+		buffer.swap(data);
+	}
+};
+/// A wxMemoryInputStream that owns its data
+class OwnedMemoryInputStream : private MemoryInputStream_aux, public wxMemoryInputStream {
+  public:
+	/// Takes the contents of data
+	inline OwnedMemoryInputStream(vector<char>& data)
+		: MemoryInputStream_aux(data)
+		, wxMemoryInputStream(buffer.empty() ? "" : &buffer[0], buffer.size())
+	{}
+};
+
+// Numbers in zip headers are little endian
+inline UInt zip_uint16(const Byte* data) { return data[0] | data[1] << 8; }
+inline UInt zip_uint32(const Byte* data) { return zip_uint16(data) | zip_uint16(data + 2) << 16; }
+
+const UInt   ZIP_LOCAL_HEADER_SIGNATURE = 0x04034b50;
+const size_t ZIP_LOCAL_HEADER_SIZE      = 30;
+
+InputStreamP Package::openZipEntry(const wxZipEntry& entry) {
+	wxFileOffset offset          = entry.GetOffset();
+	wxFileOffset compressed_size = entry.GetCompressedSize();
+	wxFileOffset size            = entry.GetSize();
+	int          method          = entry.GetMethod();
+	if (offset == wxInvalidOffset || compressed_size == wxInvalidOffset || size == wxInvalidOffset) {
+		return InputStreamP();
+	}
+	if (method != wxZIP_METHOD_STORE && method != wxZIP_METHOD_DEFLATE) {
+		return InputStreamP(); // let wx handle other compression methods
+	}
+	// read the compressed data
+	vector<char> data((size_t)compressed_size);
+	{
+		wxMutexLocker lock(zipFileMutex);
+		if (!zipFile) return InputStreamP();
+		// skip the local header, its name and extra field can differ from those in the central directory
+		Byte header[ZIP_LOCAL_HEADER_SIZE];
+		if (zipFile->Seek(offset) == wxInvalidOffset) return InputStreamP();
+		if (zipFile->Read(header, ZIP_LOCAL_HEADER_SIZE) != (ssize_t)ZIP_LOCAL_HEADER_SIZE) return InputStreamP();
+		if (zip_uint32(header) != ZIP_LOCAL_HEADER_SIGNATURE) return InputStreamP();
+		wxFileOffset data_offset = offset + ZIP_LOCAL_HEADER_SIZE + zip_uint16(header + 26) + zip_uint16(header + 28);
+		if (zipFile->Seek(data_offset) == wxInvalidOffset) return InputStreamP();
+		if (!data.empty() && zipFile->Read(&data[0], data.size()) != (ssize_t)data.size()) return InputStreamP();
+	}
+	if (method == wxZIP_METHOD_DEFLATE) {
+		// decompress, outside the lock
+		vector<char> inflated((size_t)size);
+		if (!inflated.empty()) {
+			wxMemoryInputStream compressed(data.empty() ? "" : &data[0], data.size());
+			wxZlibInputStream zlib(compressed, wxZLIB_NO_HEADER);
+			zlib.Read(&inflated[0], inflated.size());
+			if (zlib.LastRead() != inflated.size()) return InputStreamP();
+		}
+		data.swap(inflated);
+	} else if (data.size() != (size_t)size) {
+		return InputStreamP();
+	}
+	// check the crc, if it is wrong let wx report the error in the same way as when reading through wxZipInputStream
+	boost::crc_32_type crc;
+	crc.process_bytes(data.empty() ? nullptr : &data[0], data.size());
+	if (crc.checksum() != entry.GetCrc()) return InputStreamP();
+	return shared(new OwnedMemoryInputStream(data));
+}
+
 InputStreamP Package::openIn(const String& file) {
 	if (!file.empty() && file.GetChar(0) == _('/')) {
 		// absolute path, open file from another package
@@ -220,8 +297,11 @@ InputStreamP Package::openIn(const String& file) {
 		stream = shared(new BufferedFileInputStream(filename+_("/")+file));
 	} else if (wxFileExists(filename) && it != files.end() && it->second.zipEntry) {
 		// a file in a zip archive
-		// somebody in wx thought seeking was no longer needed, it now only works with the 'compatability constructor'
-		stream = shared(new wxZipInputStream(filename, it->second.zipEntry->GetInternalName()));
+		stream = openZipEntry(*it->second.zipEntry);
+		if (!stream) {
+			// somebody in wx thought seeking was no longer needed, it now only works with the 'compatability constructor'
+			stream = shared(new wxZipInputStream(filename, it->second.zipEntry->GetInternalName()));
+		}
 		//stream = static_pointer_cast<wxZipInputStream>(
 		//			shared(new ZipFileInputStream(filename, it->second.zipEntry)));
 	} else {
@@ -408,15 +488,27 @@ void Package::openSubdir(const String& name) {
 
 void Package::openZipfile() {
 	// close old streams
-	delete fileStream; fileStream = nullptr;
-	delete zipStream;  zipStream  = nullptr;
+	closeZipfile();
 	// open streams
 	fileStream = new wxFileInputStream(filename);
 	if (!fileStream->IsOk()) throw PackageError(_ERROR_1_("package not found", filename));
 	zipStream  = new wxZipInputStream(*fileStream);
 	if (!zipStream->IsOk())  throw PackageError(_ERROR_1_("package not found", filename));
-	// read zip entries
+	// read zip entries, the file is seekable, so this reads the central directory
 	loadZipStream();
+	// file for reading the entries
+	wxMutexLocker lock(zipFileMutex);
+	zipFile = new wxFile(filename);
+	if (!zipFile->IsOpened()) {
+		delete zipFile; zipFile = nullptr; // fall back to wxZipInputStream
+	}
+}
+
+void Package::closeZipfile() {
+	delete zipStream;  zipStream  = nullptr;
+	delete fileStream; fileStream = nullptr;
+	wxMutexLocker lock(zipFileMutex);
+	delete zipFile;    zipFile    = nullptr;
 }
 
 void Package::saveToDirectory(const String& saveAs, bool remove_unused, bool is_copy) {
@@ -480,8 +572,7 @@ void Package::saveToZipfile(const String& saveAs, bool remove_unused, bool is_co
 		}
 		// close the old file
 		if (!is_copy) {
-			delete zipStream;  zipStream  = nullptr;
-			delete fileStream; fileStream = nullptr;
+			closeZipfile();
 		}
 	} catch (Error e) {
 		// when things go wrong delete the temp file
@@ -497,6 +588,199 @@ void Package::saveToZipfile(const String& saveAs, bool remove_unused, bool is_co
 	wxRenameFile(tempFile, saveAs);
 }
 
+// ----------------------------------------------------------------------------- : Package : appending to zip files
+
+const UInt   ZIP_CENTRAL_HEADER_SIGNATURE = 0x02014b50;
+const size_t ZIP_CENTRAL_HEADER_SIZE      = 46;
+const UInt   ZIP_END_SIGNATURE            = 0x06054b50;
+const size_t ZIP_END_SIZE                 = 22;
+const size_t ZIP_MAX_COMMENT_SIZE         = 0xFFFF;
+const UInt   ZIP_VERSION                  = 20; // 2.0, for deflate
+const UInt   ZIP_FLAG_UTF8                = 0x0800;
+
+/// Zip files smaller than this are always written again completely, that doesn't take long
+const wxFileOffset ZIP_APPEND_MIN_SIZE = 4 * 1024 * 1024;
+/// The zip file is written again completely if more than 1/ZIP_APPEND_MAX_UNUSED of it would be unused after appending
+const int ZIP_APPEND_MAX_UNUSED = 4;
+
+inline void put_zip_uint16(std::string& out, UInt x) {
+	out += (char)(x & 0xFF);
+	out += (char)((x >> 8) & 0xFF);
+}
+inline void put_zip_uint32(std::string& out, UInt x) {
+	put_zip_uint16(out, x & 0xFFFF);
+	put_zip_uint16(out, x >> 16);
+}
+
+bool read_at(wxFile& file, wxFileOffset pos, void* data, size_t size) {
+	return file.Seek(pos) != wxInvalidOffset && file.Read(data, size) == (ssize_t)size;
+}
+
+bool Package::appendToZipfile(bool remove_unused) {
+	if (!zipStream) return false;
+	wxLogNull noLog;
+	wxFile file(filename, wxFile::read_write);
+	if (!file.IsOpened()) return false;
+	wxFileOffset file_size = file.Length();
+	if (file_size < ZIP_APPEND_MIN_SIZE || file_size > 0x7FFFFFFF) return false;
+	// find the end of central directory record, it can be followed by a comment
+	size_t tail_size = (size_t)min<wxFileOffset>(file_size, ZIP_END_SIZE + ZIP_MAX_COMMENT_SIZE);
+	vector<Byte> tail(tail_size);
+	if (!read_at(file, file_size - tail_size, &tail[0], tail_size)) return false;
+	size_t end_pos = String::npos;
+	for (size_t i = tail_size - ZIP_END_SIZE + 1 ; i-- > 0 ; ) {
+		if (zip_uint32(&tail[i]) == ZIP_END_SIGNATURE) {
+			end_pos = i;
+			break;
+		}
+	}
+	if (end_pos == String::npos) return false;
+	const Byte* end = &tail[end_pos];
+	UInt cd_entries = zip_uint16(end + 10);
+	UInt cd_size    = zip_uint32(end + 12);
+	UInt cd_offset  = zip_uint32(end + 16);
+	if (zip_uint16(end + 4) != 0 || zip_uint16(end + 6) != 0 || zip_uint16(end + 8) != cd_entries) return false; // multiple disks
+	if (cd_entries == 0xFFFF || cd_offset == 0xFFFFFFFF) return false; // zip64
+	if ((wxFileOffset)cd_offset + cd_size > file_size) return false;
+	// read the central directory, find the records by the offset of their local header
+	vector<Byte> cd(cd_size);
+	if (cd_size > 0 && !read_at(file, cd_offset, &cd[0], cd_size)) return false;
+	map<UInt, pair<size_t,size_t> > records; // local header offset -> position and size in cd
+	for (size_t pos = 0 ; pos < cd_size ; ) {
+		if (pos + ZIP_CENTRAL_HEADER_SIZE > cd_size || zip_uint32(&cd[pos]) != ZIP_CENTRAL_HEADER_SIGNATURE) return false;
+		size_t size = ZIP_CENTRAL_HEADER_SIZE + zip_uint16(&cd[pos + 28]) + zip_uint16(&cd[pos + 30]) + zip_uint16(&cd[pos + 32]);
+		if (pos + size > cd_size) return false;
+		records[zip_uint32(&cd[pos + 42])] = make_pair(pos, size);
+		pos += size;
+	}
+	// the central directory records of unchanged files are kept as they are
+	std::string new_cd;
+	UInt new_entries = 0;
+	wxFileOffset used_size = 0, new_size = 0;
+	vector<FileInfos::iterator> to_write;
+	for (FileInfos::iterator it = files.begin() ; it != files.end() ; ++it) {
+		FileInfo& f = it->second;
+		if (!f.keep && remove_unused) {
+			// removed file, its data becomes unused
+		} else if (f.wasWritten()) {
+			to_write.push_back(it);
+			new_size += wxFileName::GetSize(f.tempName).GetValue() + ZIP_LOCAL_HEADER_SIZE + ZIP_CENTRAL_HEADER_SIZE + 2 * it->first.size() + 1024;
+		} else if (f.zipEntry) {
+			map<UInt, pair<size_t,size_t> >::const_iterator rec = records.find((UInt)f.zipEntry->GetOffset());
+			if (rec == records.end()) return false;
+			const Byte* r = &cd[rec->second.first];
+			new_cd.append((const char*)r, rec->second.second);
+			new_entries++;
+			// the local header is usually the same size as the central one, without the comment
+			used_size += ZIP_LOCAL_HEADER_SIZE + zip_uint16(r + 28) + zip_uint16(r + 30) + zip_uint32(r + 20);
+		} else {
+			return false; // not in the old file, and no new contents either
+		}
+	}
+	if (new_entries + to_write.size() >= 0xFFFF) return false; // would need zip64
+	if (file_size + new_size + new_cd.size() >= 0xFFFFFFFF) return false;
+	if ((file_size - used_size) * ZIP_APPEND_MAX_UNUSED > file_size) return false; // better to write a new file
+	if (to_write.empty() && new_entries == cd_entries) return true; // nothing changed
+	// if the program crashes while appending, the file is restored from the journal when it is opened again
+	// only the old central directory and the old size are needed for that, not a copy of the whole file
+	if (!begin_append(filename, file, file_size, cd_offset)) return false;
+	// from here on the file is changed
+	// the old contents stay where they are, so the package can still be read from while appending
+	try {
+		appendZipEntries(file, file_size, to_write, new_cd, new_entries);
+	} catch (...) {
+		// undo the changes, the old end of central directory record is at the end of the file again
+		if (truncate_file(file, file_size) && sync_file(file)) end_append(filename);
+		throw;
+	}
+	end_append(filename);
+	// the zip entries of unchanged files are freed by removeTempFiles, and read again by reopen
+	return true;
+}
+
+void Package::appendZipEntries(wxFile& file, wxFileOffset file_size, const vector<FileInfos::iterator>& to_write, std::string& new_cd, UInt new_entries) {
+	if (file.Seek(file_size) == wxInvalidOffset) throw PackageError(_ERROR_("unable to store file"));
+	UInt offset = (UInt)file_size;
+	wxDateTime now = wxDateTime::Now();
+	UInt dos_time = now.GetSecond() / 2 | now.GetMinute() << 5 | now.GetHour() << 11;
+	UInt dos_date = now.GetDay() | (now.GetMonth() + 1) << 5 | max(0, now.GetYear() - 1980) << 9;
+	for (size_t i = 0 ; i < to_write.size() ; ++i) {
+		const String& name = to_write[i]->first;
+		// read the new contents
+		wxFile temp(to_write[i]->second.tempName);
+		if (!temp.IsOpened()) throw PackageError(_ERROR_("unable to store file"));
+		vector<char> data((size_t)temp.Length());
+		if (!data.empty() && temp.Read(&data[0], data.size()) != (ssize_t)data.size()) {
+			throw PackageError(_ERROR_("unable to store file"));
+		}
+		boost::crc_32_type crc;
+		crc.process_bytes(data.empty() ? nullptr : &data[0], data.size());
+		// compress, unless that doesn't help (images are usually compressed already)
+		vector<char> deflated;
+		if (!data.empty()) {
+			wxMemoryOutputStream mem;
+			{
+				wxZlibOutputStream zlib(mem, wxZ_DEFAULT_COMPRESSION, wxZLIB_NO_HEADER);
+				zlib.Write(&data[0], data.size());
+				zlib.Close();
+			}
+			deflated.resize(mem.GetLength());
+			if (!deflated.empty()) mem.CopyTo(&deflated[0], deflated.size());
+		}
+		bool store = deflated.empty() || deflated.size() >= data.size();
+		const vector<char>& contents = store ? data : deflated;
+		// headers
+		wxCharBuffer name_utf8 = name.ToUTF8();
+		size_t name_size = strlen(name_utf8.data());
+		UInt flags = name.IsAscii() ? 0 : ZIP_FLAG_UTF8;
+		std::string common; // the part that is the same in the local and central header
+		put_zip_uint16(common, ZIP_VERSION);
+		put_zip_uint16(common, flags);
+		put_zip_uint16(common, store ? wxZIP_METHOD_STORE : wxZIP_METHOD_DEFLATE);
+		put_zip_uint16(common, dos_time);
+		put_zip_uint16(common, dos_date);
+		put_zip_uint32(common, crc.checksum());
+		put_zip_uint32(common, (UInt)contents.size());
+		put_zip_uint32(common, (UInt)data.size());
+		put_zip_uint16(common, (UInt)name_size);
+		put_zip_uint16(common, 0); // extra field
+		std::string local;
+		put_zip_uint32(local, ZIP_LOCAL_HEADER_SIGNATURE);
+		local += common;
+		local.append(name_utf8.data(), name_size);
+		put_zip_uint32(new_cd, ZIP_CENTRAL_HEADER_SIGNATURE);
+		put_zip_uint16(new_cd, ZIP_VERSION); // made by
+		new_cd += common;
+		put_zip_uint16(new_cd, 0); // comment
+		put_zip_uint16(new_cd, 0); // disk
+		put_zip_uint16(new_cd, 0); // internal attributes
+		put_zip_uint32(new_cd, 0); // external attributes
+		put_zip_uint32(new_cd, offset);
+		new_cd.append(name_utf8.data(), name_size);
+		new_entries++;
+		// write
+		if (file.Write(local.data(), local.size()) != local.size()
+		 || (!contents.empty() && file.Write(&contents[0], contents.size()) != contents.size())) {
+			throw PackageError(_ERROR_("unable to store file"));
+		}
+		offset += (UInt)(local.size() + contents.size());
+	}
+	// the new central directory, readers look for the end record at the end of the file, so they will only see this one
+	std::string end_record;
+	put_zip_uint32(end_record, ZIP_END_SIGNATURE);
+	put_zip_uint16(end_record, 0); // disk
+	put_zip_uint16(end_record, 0); // disk of the central directory
+	put_zip_uint16(end_record, new_entries);
+	put_zip_uint16(end_record, new_entries);
+	put_zip_uint32(end_record, (UInt)new_cd.size());
+	put_zip_uint32(end_record, offset);
+	put_zip_uint16(end_record, 0); // comment
+	if (file.Write(new_cd.data(), new_cd.size()) != new_cd.size()
+	 || file.Write(end_record.data(), end_record.size()) != end_record.size()
+	 || !sync_file(file)) {
+		throw PackageError(_ERROR_("unable to store file"));
+	}
+}
 
 Package::FileInfos::iterator Package::addFile(const String& name) {
 	return files.insert(make_pair(normalize_internal_filename(name), FileInfo())).first;
@@ -14,8 +14,11 @@
 #include <util/error.hpp>
 #include <util/file_utils.hpp>
 #include <util/vcs.hpp>
+#include <util/hash.hpp>
+#include <wx/thread.h>
 
 class Package;
+class wxFile;
 class wxFileInputStream;
 class wxZipInputStream;
 class wxZipEntry;
@@ -56,6 +59,10 @@ class LocalFileName {
 	inline bool operator == (LocalFileName const& that) const {
 		return this->fn == that.fn;
 	}
+	/// Hash of the filename, for use with boost::hash
+	friend inline size_t hash_value(LocalFileName const& that) {
+		return hash_value(that.fn);
+	}
 	
   private:
 	LocalFileName(const wxString& fn) : fn(fn) {}
@@ -80,10 +87,15 @@ typedef LocalFileName FileName;
  *  Zip files are accessed using wxZip(Input|Output)Stream.
  *  The zip input stream appears to only allow one file at a time, since the stream itself maintains
  *  state about what file we are reading.
- *  There are multiple solutions:
- *    1. (currently used) Open a new ZipInputStream for each file
- *    2. (may be faster) First read the file into a memory buffer,
- *      return a stream based on that buffer (StringInputStream).
+ *  So to read a file, the entry is read directly from the archive into a memory buffer,
+ *  using the offset found in the central directory when the package was opened.
+ *  This can be done from multiple threads at once.
+ *  Only when that fails (unknown compression method) a new ZipInputStream is opened for the file.
+ *
+ *  When a large zip file is saved under the same name, the changed files and a new central directory
+ *  are appended to the end of the file, instead of writing a new file.
+ *  The space used by the old versions of the files is only reclaimed once it becomes a large part of the file,
+ *  then the whole file is written again.
  *
  *  TODO: maybe support sub packages (a package inside another package)?
  */
@@ -237,11 +249,28 @@ class Package : public IntrusivePtrVirtualBase {
 	wxFileInputStream* fileStream;
 	/// Filestream for reading zip files
 	wxZipInputStream*  zipStream;
+	/// File for reading entries from zip files directly, shared by all threads
+	wxFile*            zipFile;
+	/// Lock for zipFile, which has a single file position
+	wxMutex            zipFileMutex;
 
 	void loadZipStream();
 	void openDirectory(bool fast = false);
 	void openSubdir(const String&);
 	void openZipfile();
+	void closeZipfile();
+	/// Save the changes by appending them to the zip file
+	/** Returns false if that is not possible or not a good idea, nothing is changed in that case.
+	 *  If appending fails the file is truncated to its old size.
+ *  The old central directory is kept in a journal (see util/io/append_journal.hpp) until appending is done.
+	 */
+	bool appendToZipfile(bool remove_unused);
+	/// Append new entries and a new central directory to a zip file of the given size, throws on failure
+	/** new_cd contains the central directory records of the files that are kept */
+	void appendZipEntries(wxFile& file, wxFileOffset file_size, const vector<FileInfos::iterator>& to_write, std::string& new_cd, UInt new_entries);
+	/// Open a file in the zip archive by reading the entry directly from zipFile
+	/** Returns an empty pointer if the entry can not be read in that way, or if the data does not match its crc */
+	InputStreamP openZipEntry(const wxZipEntry& entry);
 	void reopen();
 	void removeTempFiles(bool remove_unused);
 	void clearKeepFlag();
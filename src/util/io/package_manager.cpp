@@ -17,6 +17,7 @@
 #include "data/locale.hpp"
 #include "data/export_template.hpp"
 #include "data/installer.hpp"
+#include "script/script_cache.hpp"
 #include <wx/wfstream.h>
 
 
@@ -73,9 +74,19 @@ PackagedP PackageManager::openAny(const String& name_, bool just_header) {
 		else {
 			throw PackageError(_("Unrecognized package type: '") + fn.GetExt() + _("'\nwhile trying to open: ") + name);
 		}
-		p->open(filename, just_header);
+		if (just_header) {
+			p->open(filename, true);
+		} else {
+			PackageScriptCache script_cache(*p);
+			WITH_DYNAMIC_ARG(package_script_cache, &script_cache);
+			p->open(filename, false);
+			script_cache.save();
+		}
 	} else if (!just_header) {
+		PackageScriptCache script_cache(*p);
+		WITH_DYNAMIC_ARG(package_script_cache, &script_cache);
 		p->loadFully();
+		script_cache.save();
 	}
 	return p;
 }
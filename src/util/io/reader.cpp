@@ -99,11 +99,11 @@ void Reader::moveNext() {
 	key.clear();
 	indent = -1; // if no line is read it never has the expected indentation
 	// repeat until we have a good line
-	while (key.empty() && !input.Eof()) {
+	while (key.empty() && !input.eof()) {
 		readLine();
 	}
 	// did we reach the end of the file?
-	if (key.empty() && input.Eof()) {
+	if (key.empty() && input.eof()) {
 		line_number += 1;
 		indent = -1;
 	}
@@ -213,11 +213,108 @@ String read_utf8_line(wxInputStream& input, bool eat_bom, bool until_eof) {
 	#endif
 }
 
+// ----------------------------------------------------------------------------- : LineReader
+
+#if USE_BUFFERED_LINE_READER
+	/// Size of the blocks read from the input
+	const size_t LINE_READER_BLOCK_SIZE = 64 * 1024;
+	
+	LineReader::LineReader(InputStream& input)
+		: input(input)
+		, buffer(LINE_READER_BLOCK_SIZE)
+		, pos(0), end(0)
+		, at_eof(false)
+	{}
+	
+	bool LineReader::eof() const {
+		return at_eof;
+	}
+	
+	bool LineReader::fill() {
+		pos = end = 0;
+		if (at_eof) return false;
+		input.Read(&buffer[0], buffer.size());
+		end = input.LastRead();
+		if (end == 0) at_eof = true; // like input.Eof() after reading one character too many
+		return end > 0;
+	}
+	
+	/// Decode a line of UTF-8
+	String decode_utf8_line(const char* data, size_t size, bool eat_bom) {
+		if (eat_bom && size >= 3 && (Byte)data[0] == 0xEF && (Byte)data[1] == 0xBB && (Byte)data[2] == 0xBF) {
+			data += 3;
+			size -= 3;
+		}
+		if (size == 0) return String();
+		// most lines are plain ASCII, those don't need decoding
+		Byte high = 0;
+		for (size_t i = 0 ; i < size ; ++i) {
+			high |= (Byte)data[i];
+		}
+		if (high < 0x80) {
+			return wxString::FromAscii(data, size);
+		}
+		String result = wxString::FromUTF8(data, size);
+		if (result.empty()) {
+			throw ParseError(_("Invalid UTF-8 sequence"));
+		}
+		return result;
+	}
+	
+	String LineReader::readLine(bool eat_bom) {
+		std::string partial; // the start of a line that crosses the end of the buffer
+		while (true) {
+			// find the line ending
+			const char* data = &buffer[0];
+			const char* nl   = (const char*)memchr(data + pos, '\n', end - pos);
+			const char* cr   = (const char*)memchr(data + pos, '\r', (nl ? nl - data : end) - pos);
+			const char* eol  = cr ? cr : nl;
+			if (eol) {
+				String line;
+				if (partial.empty()) {
+					line = decode_utf8_line(data + pos, eol - data - pos, eat_bom);
+				} else {
+					partial.append(data + pos, eol);
+					line = decode_utf8_line(partial.data(), partial.size(), eat_bom);
+				}
+				pos = eol - data + 1;
+				if (cr) {
+					// \r\n or just \r
+					if (pos < end || fill()) {
+						if (buffer[pos] == '\n') ++pos;
+					}
+				}
+				return line;
+			}
+			// no line ending, read more
+			partial.append(data + pos, data + end);
+			if (!fill()) {
+				// the last line
+				return decode_utf8_line(partial.data(), partial.size(), eat_bom);
+			}
+		}
+	}
+#else
+	LineReader::LineReader(InputStream& input)
+		: input(input)
+	{}
+	
+	bool LineReader::eof() const {
+		return input.Eof();
+	}
+	
+	String LineReader::readLine(bool eat_bom) {
+		return read_utf8_line(input, eat_bom);
+	}
+#endif
+
+// ----------------------------------------------------------------------------- : Reader : reading lines
+
 void Reader::readLine(bool in_string) {
 	line_number += 1;
 	// We have to do our own line reading, because wxTextInputStream is insane
 	try {
-		line = read_utf8_line(input, line_number == 1);
+		line = input.readLine(line_number == 1);
 	} catch (const ParseError& e) {
 		throw ParseError(e.what() + String(_(" on line ")) << line_number);
 	}
@@ -244,7 +341,8 @@ void Reader::readLine(bool in_string) {
 			indent += 1;
 		}
 	}
-	key   = canonical_name_form(trim(key));
+	key = trim(key);
+	if (key.find(_(' ')) != String::npos) key = canonical_name_form(key);
 	value = pos == String::npos ? _("") : trim_left(line.substr(pos+1));
 	if (key.empty() && pos!=String::npos) key = _(" "); // we don't want an empty key if there was a colon
 }
@@ -285,7 +383,7 @@ const String& Reader::getValue() {
 		// read all lines that are indented enough
 		readLine(true);
 		previous_line_number = line_number;
-		while (indent >= expected_indent && !input.Eof()) {
+		while (indent >= expected_indent && !input.eof()) {
 			previous_value.resize(previous_value.size() + pending_newlines, _('\n'));
 			pending_newlines = 0;
 			previous_value += line.substr(expected_indent); // strip expected indent
@@ -293,15 +391,15 @@ const String& Reader::getValue() {
 				readLine(true);
 				pending_newlines++;
 				// skip empty lines that are not indented enough
-			} while(trim(line).empty() && indent < expected_indent && !input.Eof());
+			} while(trim(line).empty() && indent < expected_indent && !input.eof());
 		}
 		// moveNext(), but without the initial readLine()
 		state = HANDLED;
-		while (key.empty() && !input.Eof()) {
+		while (key.empty() && !input.eof()) {
 			readLine();
 		}
 		// did we reach the end of the file?
-		if (key.empty() && input.Eof()) {
+		if (key.empty() && input.eof()) {
 			line_number += 1;
 			indent = -1;
 		}
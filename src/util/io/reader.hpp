@@ -27,6 +27,44 @@ typedef shared_ptr<wxInputStream> InputStreamP;
 // Overload to perform extra stuff after reading
 template <typename T> inline void after_reading(T&, Version) {}
 
+// ----------------------------------------------------------------------------- : LineReader
+
+#ifndef USE_BUFFERED_LINE_READER
+	/// Read lines in large blocks, set to 0 to use the old byte at a time read_utf8_line for comparison
+	#if defined(UNICODE) && wxVERSION_NUMBER >= 2900
+		#define USE_BUFFERED_LINE_READER 1
+	#else
+		#define USE_BUFFERED_LINE_READER 0
+	#endif
+#endif
+
+/// Reads UTF-8 encoded lines from an input stream
+/** The stream is read in large blocks, so nothing else should read from it at the same time.
+ */
+class LineReader {
+  public:
+	LineReader(InputStream& input);
+	
+	/// Read the next line, without the line ending
+	/** Throws a ParseError if the line is not valid UTF-8 */
+	String readLine(bool eat_bom);
+	/// Has the end of the input been reached?
+	/** This is only the case after reading a line that is ended by the end of the input */
+	bool eof() const;
+	
+  private:
+	InputStream& input;
+	#if USE_BUFFERED_LINE_READER
+		vector<char> buffer;
+		size_t       pos, end; ///< The part of the buffer that has not been used yet
+		bool         at_eof;
+		/// Replace the buffer with the next block from the input, return false if there is none
+		bool fill();
+	#endif
+};
+
+// ----------------------------------------------------------------------------- : Reader
+
 /// The Reader can be used for reading (deserializing) objects
 /** This class makes use of the reflection functionality, in effect
  *  an object tells the Reader what fields it would like to read.
@@ -146,7 +184,7 @@ class Reader {
 	/// Line number of the previous_line
 	int previous_line_number;
 	/// Input stream we are reading from
-	InputStream& input;
+	LineReader input;
 	/// Accumulated warning messages
 	String warnings;
 	
@@ -10,77 +10,130 @@
 // ----------------------------------------------------------------------------- : Includes
 
 #include <util/prec.hpp>
+#include <unordered_map>
+#include <unordered_set>
 
 // ----------------------------------------------------------------------------- : OrderCache
 
 /// Object that cashes an ordered version of a list of items, for finding the position of objects
-/** Can be used as a map "void* -> int" for finding the position of an object */
+/** Can be used as a map "void* -> int" for finding the position of an object.
+ *
+ *  Items are ordered by a string value (in the order of smart_less, using collation keys),
+ *  items with the same value are ordered by their index in the list of items, so the order does not depend on memory layout.
+ *  The cache is updated incrementally, changing the value of one item only moves that item,
+ *  so the owner only needs to recompute the values of items that have changed.
+ *  Each item has a stamp, that the owner can use to determine whether the value is still up to date.
+ */
 template <typename T>
 class OrderCache : public IntrusivePtrBase<OrderCache<T> > {
   public:
-	/// Initialize the order cache, ordering the keys by their string values from the other vector
-	/** Optionally filter the list using a vector of booleans of items to keep (note: vector<bool> is evil)
-	 *  @pre keys.size() == values.size()
-	 */
-	OrderCache(const vector<T>& keys, const vector<String>& values, vector<int>* keep = nullptr);
+	OrderCache() : checked(0) {}
+	
+	/// Is the key in the cache? If so, stores the stamp it was added with
+	bool contains(const T& key, UInt& stamp) const;
+	/// Add a key to the cache, or change its value
+	/** index is the position of the key in the list of items.
+	 *  If keep is false the key is not counted in the ordering, find will return -1 */
+	void insert(const T& key, const String& value, size_t index, bool keep, UInt stamp);
+	/// The list of items has changed, remove all keys that are not in the given list, and update the indices of the others
+	void reindex(const vector<T>& keys);
 	
 	/// Find the position of the given key in the cache, returns -1 if not found
 	int find(const T& key) const;
+	/// Number of keys in the cache
+	inline size_t size() const { return items.size(); }
+	/// Number of keys in the cache that are kept
+	inline int count() const { return (int)order.size(); }
+	
+	/// Stamp at which the owner last checked all keys, not used by the cache itself
+	UInt checked;
 	
   private:
-	struct CompareKeys;
+	struct Item {
+		CollationKey key;
+		size_t       index;
+		bool         keep;
+		UInt         stamp;
+	};
 	struct CompareValues;
-	typedef std::pair<void*,int> KV;
-	vector<KV> positions;
+	std::unordered_map<const void*, Item> items;
+	vector<const Item*> order; ///< Kept items, sorted by value and index
 };
 
 // ----------------------------------------------------------------------------- : Implementation
 
-template <typename T>
-struct OrderCache<T>::CompareKeys {
-	inline bool operator () (const KV& a, void*     b) { return a.first < b; }
-	inline bool operator () (const KV& a, const KV& b) { return a.first < b.first; }
-	inline bool operator () (void*     a, const KV& b) { return a       < b.first; }
-};
-
 template <typename T>
 struct OrderCache<T>::CompareValues {
-	const vector<String>& values;
-	CompareValues(const vector<String>& values) : values(values) {}
-	
-	inline bool operator () (const KV& a, const KV& b) {
-		return smart_less(values[a.second], values[b.second]);
+	inline bool operator () (const Item* a, const Item* b) const {
+		int cmp = a->key.compare(b->key);
+		return cmp < 0 || (cmp == 0 && a->index < b->index);
 	}
 };
 
 template <typename T>
-OrderCache<T>::OrderCache(const vector<T>& keys, const vector<String>& values, vector<int>* keep) {
-	assert(keys.size() == values.size());
-	assert(!keep || keep->size() == keys.size());
-	// initialize positions, use pos to point back to the values vector
-	positions.reserve(keys.size());
-	int i = 0;
-	for (typename vector<T>::const_iterator it = keys.begin() ; it != keys.end() ; ++it, ++i) {
-		if (!keep || (*keep)[i]) {
-			positions.push_back(KV(&**it, i));
+bool OrderCache<T>::contains(const T& key, UInt& stamp) const {
+	typename std::unordered_map<const void*, Item>::const_iterator it = items.find(&*key);
+	if (it == items.end()) return false;
+	stamp = it->second.stamp;
+	return true;
+}
+
+template <typename T>
+void OrderCache<T>::insert(const T& key, const String& value, size_t index, bool keep, UInt stamp) {
+	const void* k = &*key;
+	CollationKey ck = collation_key(value);
+	typename std::unordered_map<const void*, Item>::iterator it = items.find(k);
+	if (it == items.end()) {
+		Item item = { ck, index, false, stamp };
+		it = items.insert(make_pair(k, item)).first;
+	} else {
+		Item& item = it->second;
+		item.stamp = stamp;
+		if (item.keep == keep && item.index == index && item.key == ck) return; // position stays the same
+		if (item.keep) {
+			// take out of the order
+			typename vector<const Item*>::iterator pos = lower_bound(order.begin(), order.end(), &item, CompareValues());
+			assert(pos != order.end() && *pos == &item);
+			order.erase(pos);
 		}
+		item.key   = ck;
+		item.index = index;
+	}
+	// put back in the order at the right position
+	Item& item = it->second;
+	item.keep = keep;
+	if (keep) {
+		order.insert(lower_bound(order.begin(), order.end(), &item, CompareValues()), &item);
 	}
-	// sort the KVs by the values
-	sort(positions.begin(), positions.end(), CompareValues(values));
-	// update positions, to point to sorted list
-	i = 0;
-	for (typename vector<KV>::iterator it = positions.begin() ; it != positions.end() ; ++it, ++i) {
-		it->second = i;
+}
+
+template <typename T>
+void OrderCache<T>::reindex(const vector<T>& keys) {
+	std::unordered_map<const void*, size_t> indices;
+	for (size_t i = 0 ; i < keys.size() ; ++i) {
+		indices.insert(make_pair(&*keys[i], i));
+	}
+	order.clear();
+	for (typename std::unordered_map<const void*, Item>::iterator it = items.begin() ; it != items.end() ; ) {
+		std::unordered_map<const void*, size_t>::const_iterator idx = indices.find(it->first);
+		if (idx == indices.end()) {
+			it = items.erase(it);
+		} else {
+			it->second.index = idx->second;
+			if (it->second.keep) order.push_back(&it->second);
+			++it;
+		}
 	}
-	// sort the KVs by the keys
-	sort(positions.begin(), positions.end(), CompareKeys());
+	// the relative order of items with the same value can change, so sort again
+	sort(order.begin(), order.end(), CompareValues());
 }
 
 template <typename T>
 int OrderCache<T>::find(const T& key) const {
-	vector<KV>::const_iterator it = lower_bound(positions.begin(), positions.end(), &*key, CompareKeys());
-	if (it == positions.end() || it->first != &*key) return -1;
-	return it->second;
+	typename std::unordered_map<const void*, Item>::const_iterator it = items.find(&*key);
+	if (it == items.end() || !it->second.keep) return -1;
+	typename vector<const Item*>::const_iterator pos = lower_bound(order.begin(), order.end(), &it->second, CompareValues());
+	return (int)(pos - order.begin());
 }
 
 // ----------------------------------------------------------------------------- : EOF
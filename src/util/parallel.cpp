@@ -0,0 +1,186 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) 2001 - 2012 Twan van Laarhoven and Sean Hunt             |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <util/parallel.hpp>
+#include <wx/thread.h>
+#include <exception>
+#include <deque>
+#include <algorithm>
+
+using std::max;
+using std::min;
+
+// ----------------------------------------------------------------------------- : ParallelWorkers
+
+/// A call to parallel_for_ranges, the ranges are handled by whichever thread takes them first
+struct ParallelJob {
+	ParallelJob(const std::function<void (int,int)>& f, int n, int ranges, wxMutex& mutex)
+		: f(f), n(n), ranges(ranges), next(0), running(0), done(mutex)
+	{}
+	
+	const std::function<void (int,int)>& f;
+	int n, ranges;
+	int                next;    ///< The next range to start
+	int                running; ///< Number of ranges that have started but are not done yet
+	std::exception_ptr error;   ///< First exception thrown by f, if any
+	wxCondition        done;    ///< Signaled when the last range is done
+	
+	/// Start of range r, the ranges together cover [0,n)
+	inline int rangeBegin(int r) const {
+		return (int)((long long)n * r / ranges);
+	}
+};
+
+/// Threads that are kept around to handle the ranges of parallel_for_ranges
+/** Starting a thread for each call would take about as long as resampling a small image.
+ *  Threads are started when they are first needed, and stopped by parallel_stop_workers.
+ */
+class ParallelWorkers {
+  public:
+	ParallelWorkers();
+	
+	/// Split [0,n) into ranges, and call f for all of them
+	void run(const std::function<void (int,int)>& f, int n, int ranges);
+	/// Stop all worker threads, after they finish the range they are working on
+	void stopAll();
+	
+  private:
+	class Worker;
+	wxMutex                mutex;          ///< Lock for all members, and for the jobs
+	wxCondition            work_available; ///< Signaled when a job is added to the queue
+	std::deque<ParallelJob*> jobs;         ///< Jobs with ranges that have not been started
+	vector<Worker*>        workers;
+	bool                   stop;
+	
+	/// Start enough workers to handle the given number of ranges at the same time, the mutex must be locked
+	void startWorkers(int ranges);
+	/// Call f for the next range of a job, the mutex must be locked
+	/** It is unlocked while calling f. */
+	void runNext(ParallelJob& job);
+};
+
+class ParallelWorkers::Worker : public wxThread {
+  public:
+	Worker(ParallelWorkers& parent)
+		: wxThread(wxTHREAD_JOINABLE)
+		, parent(parent)
+	{}
+	
+	virtual ExitCode Entry() {
+		ParallelWorkers& p = parent;
+		wxMutexLocker lock(p.mutex);
+		while (true) {
+			// wait for a job
+			while (!p.stop && p.jobs.empty()) {
+				p.work_available.Wait();
+			}
+			if (p.stop) break;
+			p.runNext(*p.jobs.front());
+		}
+		return 0;
+	}
+	
+  private:
+	ParallelWorkers& parent;
+};
+
+ParallelWorkers parallel_workers;
+
+ParallelWorkers::ParallelWorkers()
+	: work_available(mutex)
+	, stop(false)
+{}
+
+void ParallelWorkers::run(const std::function<void (int,int)>& f, int n, int ranges) {
+	wxMutexLocker lock(mutex);
+	ParallelJob job(f, n, ranges, mutex);
+	jobs.push_back(&job);
+	startWorkers(ranges);
+	work_available.Broadcast();
+	// the calling thread also handles ranges, until all of them are started
+	// this also means that calls from inside f can't wait for ranges that no thread is going to start
+	while (job.next < job.ranges) {
+		runNext(job);
+	}
+	// wait for the ranges that other threads are working on
+	while (job.running > 0) {
+		job.done.Wait();
+	}
+	if (job.error) std::rethrow_exception(job.error);
+}
+
+void ParallelWorkers::runNext(ParallelJob& job) {
+	int r = job.next++;
+	if (job.next == job.ranges) {
+		// all ranges are started, other threads don't need this job anymore
+		jobs.erase(std::find(jobs.begin(), jobs.end(), &job));
+	}
+	job.running++;
+	mutex.Unlock();
+	std::exception_ptr error;
+	try {
+		job.f(job.rangeBegin(r), job.rangeBegin(r + 1));
+	} catch (...) {
+		error = std::current_exception();
+	}
+	mutex.Lock();
+	if (error && !job.error) job.error = error;
+	if (--job.running == 0 && job.next == job.ranges) {
+		job.done.Broadcast();
+	}
+}
+
+void ParallelWorkers::startWorkers(int ranges) {
+	// the calling thread is one of the threads handling ranges
+	int wanted = min(ranges, parallel_thread_count()) - 1;
+	while ((int)workers.size() < wanted) {
+		Worker* worker = new Worker(*this);
+		if (worker->Create() == wxTHREAD_NO_ERROR && worker->Run() == wxTHREAD_NO_ERROR) {
+			workers.push_back(worker);
+		} else {
+			// no thread for you, the calling thread will handle more ranges
+			delete worker;
+			break;
+		}
+	}
+}
+
+void ParallelWorkers::stopAll() {
+	{
+		wxMutexLocker lock(mutex);
+		stop = true;
+		work_available.Broadcast();
+	}
+	for (auto& w : workers) {
+		w->Wait();
+		delete w;
+	}
+	workers.clear();
+	stop = false;
+}
+
+// ----------------------------------------------------------------------------- : Parallel for
+
+int parallel_thread_count() {
+	static int count = max(1, min(8, wxThread::GetCPUCount()));
+	return count;
+}
+
+void parallel_for_ranges(int n, int min_size, const std::function<void (int,int)>& f) {
+	int ranges = min(parallel_thread_count(), n / max(1, min_size));
+	if (ranges <= 1) {
+		if (n > 0) f(0, n);
+		return;
+	}
+	parallel_workers.run(f, n, ranges);
+}
+
+void parallel_stop_workers() {
+	parallel_workers.stopAll();
+}
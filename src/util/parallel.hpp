@@ -0,0 +1,43 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) 2001 - 2012 Twan van Laarhoven and Sean Hunt             |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+#ifndef HEADER_UTIL_PARALLEL
+#define HEADER_UTIL_PARALLEL
+
+/** @file util/parallel.hpp
+ *
+ *  @brief Splitting work over multiple threads.
+ */
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <functional>
+
+// ----------------------------------------------------------------------------- : Parallel for
+
+/// Number of threads to use for work that can be split, at least 1
+int parallel_thread_count();
+
+/// Call f(begin,end) for consecutive ranges that together cover [0,n)
+/** The ranges are handled by a pool of worker threads and by the calling thread.
+ *  f may itself call parallel_for_ranges.
+ *  Only ranges of at least min_size items are given their own thread,
+ *  so for small n everything is done by the calling thread in a single call.
+ *
+ *  f must be safe to call from any thread, and the ranges must be independent.
+ *  If f throws an exception, it is rethrown in the calling thread after all threads are done.
+ */
+void parallel_for_ranges(int n, int min_size, const std::function<void (int begin, int end)>& f);
+
+/// Stop the worker threads used by parallel_for_ranges
+/** Should be called before exiting, when no other thread is using parallel_for_ranges.
+ *  If parallel_for_ranges is used again, new workers are started.
+ */
+void parallel_stop_workers();
+
+// ----------------------------------------------------------------------------- : EOF
+#endif
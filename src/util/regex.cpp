@@ -8,6 +8,7 @@
 
 #include <util/prec.hpp>
 #include <util/regex.hpp>
+#include <util/regex_automaton.hpp>
 #include <util/error.hpp>
 
 using std::insert_iterator;
@@ -24,9 +25,56 @@ void Regex::assign(const String& code) {
 		throw ScriptError(String::Format(_("Error while compiling regular expression: '%s'\nAt position: %d\n%s"),
 		                  code.c_str(), e.position(), String(e.what(), IF_UNICODE(wxConvUTF8,String::npos)).c_str()));
 	}
+	#if USE_REGEX_AUTOMATON
+		automaton.reset(RegexAutomaton::compile(code));
+	#endif
+}
+
+bool Regex::matches(const String& str) const {
+	#if USE_REGEX_AUTOMATON
+		if (automaton) return automaton->search(str.begin(), str.begin(), str.end(), false, nullptr);
+	#endif
+	return regex_search(str.begin(), str.end(), regex);
+}
+
+bool Regex::matches(Results& results, const String::const_iterator& begin, const String::const_iterator& end) const {
+	#if USE_REGEX_AUTOMATON
+		if (automaton) return search(results, begin, begin, end, false);
+	#endif
+	boost::match_results<String::const_iterator>& m = results.boost_results;
+	if (!regex_search(begin, end, m, regex)) return false;
+	results.reset(m.size(), begin, end);
+	for (size_t i = 0 ; i < m.size() ; ++i) {
+		Results::SubMatch& sub = results.subs[i];
+		sub.matched = m[i].matched;
+		if (sub.matched) {
+			sub.first  = m[i].first;
+			sub.second = m[i].second;
+		}
+	}
+	return true;
 }
 
 void Regex::replace_all(String* input, const String& format) {
+	#if USE_REGEX_AUTOMATON
+		if (automaton) {
+			// the same as regex_replace: after an empty match, the next match may not be empty at the same position
+			const String& in = *input;
+			String output;
+			Results results;
+			String::const_iterator start = in.begin(), last = in.begin();
+			bool after_empty = false;
+			while (search(results, in.begin(), start, in.end(), after_empty)) {
+				output.append(last, results[0].first);
+				output += results.format(format);
+				last = start = results[0].second;
+				after_empty  = results[0].first == results[0].second;
+			}
+			output.append(last, in.end());
+			*input = output;
+			return;
+		}
+	#endif
 	//std::basic_string<Char> fmt; format_string(format,fmt);
 	std::basic_string<Char> fmt(format.begin(),format.end());
 	String output;
@@ -35,6 +83,101 @@ void Regex::replace_all(String* input, const String& format) {
 	*input = output;
 }
 
+#if USE_REGEX_AUTOMATON
+bool Regex::search(Results& results, const String::const_iterator& text_begin, const String::const_iterator& start,
+                   const String::const_iterator& end, bool not_initial_null) const {
+	vector<ptrdiff_t> subs;
+	if (!automaton->search(text_begin, start, end, not_initial_null, &subs)) return false;
+	results.reset(automaton->subCount(), text_begin, end);
+	for (size_t i = 0 ; i < automaton->subCount() ; ++i) {
+		Results::SubMatch& sub = results.subs[i];
+		sub.matched = subs[2 * i] >= 0 && subs[2 * i + 1] >= 0;
+		if (sub.matched) {
+			sub.first  = text_begin + subs[2 * i];
+			sub.second = text_begin + subs[2 * i + 1];
+		}
+	}
+	return true;
+}
+#endif
+
+// ----------------------------------------------------------------------------- : Regex::Results : boost
+
+void Regex::Results::reset(size_t count, const String::const_iterator& begin, const String::const_iterator& end) {
+	SubMatch none = {end, end, false};
+	subs.assign(count, none);
+	unmatched = none;
+	base = begin;
+}
+
+/// Value of a hexadecimal digit, or -1
+static int hex_digit_value(Char c) {
+	if (c >= _('0') && c <= _('9')) return c - _('0');
+	if (c >= _('a') && c <= _('f')) return c - _('a') + 10;
+	if (c >= _('A') && c <= _('F')) return c - _('A') + 10;
+	return -1;
+}
+
+// The same as boost::match_results::format with format_sed
+String Regex::Results::format(const String& format) const {
+	String output;
+	for (size_t i = 0 ; i < format.size() ; ++i) {
+		Char c = format.GetChar(i);
+		if (c == _('&')) {
+			output.append((*this)[0].first, (*this)[0].second);
+			continue;
+		} else if (c != _('\\') || i + 1 >= format.size()) {
+			output += c;
+			continue;
+		}
+		c = format.GetChar(++i);
+		switch (c) {
+			case _('a'): output += _('\a'); break;
+			case _('f'): output += _('\f'); break;
+			case _('n'): output += _('\n'); break;
+			case _('r'): output += _('\r'); break;
+			case _('t'): output += _('\t'); break;
+			case _('v'): output += _('\v'); break;
+			case _('e'): output += (Char)27; break;
+			case _('c'):
+				// control character, \cX
+				if (i + 1 < format.size()) {
+					output += (Char)(format.GetChar(++i) % 32);
+				} else {
+					output += c;
+				}
+				break;
+			case _('x'): {
+				// hexadecimal character code, \xHH or \x{HHHH}
+				size_t j = i + 1;
+				bool braces = j < format.size() && format.GetChar(j) == _('{');
+				if (braces) ++j;
+				size_t digits_start = j;
+				int value = 0;
+				while (j < format.size() && (braces || j < digits_start + 2) && hex_digit_value(format.GetChar(j)) >= 0) {
+					value = value * 16 + hex_digit_value(format.GetChar(j++));
+				}
+				if (j == digits_start || (braces && (j >= format.size() || format.GetChar(j) != _('}')))) {
+					// not a valid escape, the characters after the x are output as is
+					output += c;
+				} else {
+					output += (Char)value;
+					i = braces ? j : j - 1;
+				}
+				break;
+			}
+			default:
+				if (c >= _('0') && c <= _('9')) {
+					// sub match
+					output += str(c - _('0'));
+				} else {
+					output += c;
+				}
+		}
+	}
+	return output;
+}
+
 #else // USE_BOOST_REGEX
 // ----------------------------------------------------------------------------- : Regex : wx
 
@@ -24,11 +24,23 @@
  */
 #define USE_BOOST_REGEX 1
 
+// Use our own automaton instead of boost::regex for the expressions it supports
+/* The automaton takes linear time, while boost::regex can take exponential time
+ * (or give up with an error) for expressions like  (a|aa)*b  on long strings.
+ * For the expressions used by the magic game both take about the same time.
+ * Only used together with boost::regex, which is still needed for the other expressions.
+ */
+#ifndef USE_REGEX_AUTOMATON
+#define USE_REGEX_AUTOMATON 1
+#endif
+
 #if USE_BOOST_REGEX
 	#include <boost/regex.hpp>
 	#include <boost/regex/pattern_except.hpp>
 #endif
 
+class RegexAutomaton;
+
 // ----------------------------------------------------------------------------- : Boost implementation
 
 #if USE_BOOST_REGEX
@@ -38,36 +50,62 @@
 	 */
 	class Regex {
 	  public:
-		struct Results : public boost::match_results<String::const_iterator> {
-			/// Get a sub match
-			inline String str(int sub = 0) const {
+		/// The result of a match, with an interface like boost::match_results
+		/** Filled in by both boost::regex and the automaton.
+		 *  Positions are relative to the start of the searched text.
+		 */
+		class Results {
+		  public:
+			/// A sub match, matched is false if the sub expression did not participate in the match
+			struct SubMatch {
+				String::const_iterator first, second;
+				bool matched;
+			};
+			typedef const SubMatch& const_reference;
+			
+			/// Number of submatches (+1 for the total match)
+			inline size_t size() const { return subs.size(); }
+			/// Get a submatch
+			inline const_reference operator [] (size_t sub) const {
+				return sub < subs.size() ? subs[sub] : unmatched;
+			}
+			/// Position of a submatch, or -1 if it did not participate
+			inline ptrdiff_t position(size_t sub = 0) const {
 				const_reference v = (*this)[sub];
-				return String(v.first, v.second);
+				return v.matched ? v.first - base : -1;
 			}
-			/// Format a replacement string
-			inline String format(const String& format) const {
-				std::basic_string<Char> fmt(format.begin(),format.end());
-				String output;
-				boost::match_results<String::const_iterator>::format(
-					std::insert_iterator<String>(output, output.end()),
-					fmt, boost::format_sed);
-				return output;
+			inline ptrdiff_t length(size_t sub = 0) const {
+				const_reference v = (*this)[sub];
+				return v.matched ? v.second - v.first : 0;
 			}
+			/// Get a sub match
+			inline String str(size_t sub = 0) const {
+				const_reference v = (*this)[sub];
+				return v.matched ? String(v.first, v.second) : String();
+			}
+			/// Format a replacement string, in the sed format: & is the whole match, \\n a sub match
+			String format(const String& format) const;
+			
+		  private:
+			vector<SubMatch>       subs;
+			SubMatch               unmatched;
+			String::const_iterator base;
+			boost::match_results<String::const_iterator> boost_results; ///< reused between boost::regex searches
+			
+			/// Start filling in the results of a search in [begin,end)
+			void reset(size_t count, const String::const_iterator& begin, const String::const_iterator& end);
+			friend class Regex;
 		};
 		
 		inline Regex() {}
 		inline Regex(const String& code) { assign(code); }
 		
 		void assign(const String& code);
-		inline bool matches(const String& str) const {
-			return regex_search(str.begin(), str.end(), regex);
-		}
+		bool matches(const String& str) const;
 		inline bool matches(Results& results, const String& str, size_t start = 0) const {
 			return matches(results, str.begin() + start, str.end());
 		}
-		inline bool matches(Results& results, const String::const_iterator& begin, const String::const_iterator& end) const {
-			return regex_search(begin, end, results, regex);
-		}
+		bool matches(Results& results, const String::const_iterator& begin, const String::const_iterator& end) const;
 		void replace_all(String* input, const String& format);
 		
 		inline bool empty() const {
@@ -76,6 +114,13 @@
 		
 	  private:
 		boost::basic_regex<Char> regex; ///< The regular expression
+		#if USE_REGEX_AUTOMATON
+			shared_ptr<const RegexAutomaton> automaton; ///< Used instead of regex, if the expression is supported
+			
+			/// Search using the automaton, text_begin is the start of the text for ^ and \b
+			bool search(Results& results, const String::const_iterator& text_begin, const String::const_iterator& start,
+			            const String::const_iterator& end, bool not_initial_null) const;
+		#endif
 	};
 
 // ----------------------------------------------------------------------------- : Wx implementation
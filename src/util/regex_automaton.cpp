@@ -0,0 +1,652 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) 2001 - 2012 Twan van Laarhoven and Sean Hunt             |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <util/regex_automaton.hpp>
+
+/// Maximum number of instructions of an automaton, larger expressions are left to boost::regex
+const size_t MAX_AUTOMATON_SIZE = 2000;
+/// Maximum number in a repetition {n,m}
+const UInt MAX_REPEAT_COUNT = 1000;
+const UInt REPEAT_INFINITE = (UInt)-1;
+
+/// Line separators, the same as for boost::regex
+inline bool is_line_separator(Char c) {
+	return c == _('\n') || c == _('\r') || c == _('\f')
+	    || (wxUint16)c == 0x2028u || (wxUint16)c == 0x2029u || (wxUint16)c == 0x85u;
+}
+
+/// Punctuation characters that stand for themselves when escaped with a backslash
+inline bool is_escapable_literal(Char c) {
+	for (const Char* l = _(".\\[](){}|*+?^$-/,:;\"!@#%&=~ ") ; *l ; ++l) {
+		if (*l == c) return true;
+	}
+	return false;
+}
+
+// ----------------------------------------------------------------------------- : RegexCompiler
+
+/// Parses a regular expression, and compiles it into a RegexAutomaton
+/** All functions return false if the expression uses features that are not supported.
+ */
+class RegexCompiler {
+  public:
+	RegexCompiler(const String& code, RegexAutomaton& automaton)
+		: code(code), pos(0), automaton(automaton), groups(0)
+	{}
+
+	bool compile() {
+		UInt root;
+		if (!parseAlternatives(root) || pos != code.size()) return false;
+		automaton.sub_count = groups + 1;
+		emit(RegexAutomaton::OP_SAVE, 0);
+		if (!emit(root)) return false;
+		emit(RegexAutomaton::OP_SAVE, 1);
+		emit(RegexAutomaton::OP_MATCH);
+		return automaton.program.size() <= MAX_AUTOMATON_SIZE;
+	}
+
+  private:
+	/// Syntax tree of an expression
+	struct Node {
+		enum Kind { CHAR, ANY, SET, ASSERTION, GROUP, SEQUENCE, ALTERNATIVES, REPEAT } kind;
+		Char         c;        ///< CHAR: the character
+		UInt         index;    ///< SET: index in sets, ASSERTION: the Op, GROUP: sub match or 0 if not capturing
+		UInt         min, max; ///< REPEAT: number of repetitions
+		bool         greedy;   ///< REPEAT: prefer more repetitions?
+		vector<UInt> children;
+	};
+
+	const String&   code;
+	size_t          pos;
+	RegexAutomaton& automaton;
+	vector<Node>    nodes;
+	UInt            groups;
+
+	UInt newNode(Node::Kind kind) {
+		Node n;
+		n.kind = kind;
+		n.c = 0;
+		n.index = 0;
+		n.min = n.max = 1;
+		n.greedy = true;
+		nodes.push_back(n);
+		return (UInt)nodes.size() - 1;
+	}
+	inline bool atEnd() const { return pos >= code.size(); }
+	inline Char peek(size_t ahead = 0) const { return pos + ahead < code.size() ? (Char)code[pos + ahead] : 0; }
+
+	// --------------------------------------------------- : Parsing
+
+	bool parseAlternatives(UInt& out) {
+		UInt first;
+		if (!parseSequence(first)) return false;
+		if (peek() != _('|')) {
+			out = first;
+			return true;
+		}
+		out = newNode(Node::ALTERNATIVES);
+		nodes[out].children.push_back(first);
+		while (peek() == _('|')) {
+			++pos;
+			UInt next;
+			if (!parseSequence(next)) return false;
+			nodes[out].children.push_back(next);
+		}
+		return true;
+	}
+
+	bool parseSequence(UInt& out) {
+		out = newNode(Node::SEQUENCE);
+		while (!atEnd() && peek() != _('|') && peek() != _(')')) {
+			UInt atom;
+			if (!parseAtom(atom)) return false;
+			if (!parseRepeat(atom)) return false;
+			nodes[out].children.push_back(atom);
+		}
+		return true;
+	}
+
+	bool parseAtom(UInt& out) {
+		Char c = peek();
+		++pos;
+		switch (c) {
+			case _('('): {
+				UInt group = newNode(Node::GROUP);
+				if (peek() == _('?')) {
+					if (peek(1) != _(':')) return false; // lookahead, modifiers, etc.
+					pos += 2;
+				} else {
+					nodes[group].index = ++groups;
+				}
+				UInt body;
+				if (!parseAlternatives(body) || peek() != _(')')) return false;
+				++pos;
+				out = group; // note: nodes may have been reallocated
+				nodes[out].children.push_back(body);
+				return true;
+			}
+			case _('['):
+				return parseSet(out);
+			case _('.'):
+				out = newNode(Node::ANY);
+				return true;
+			case _('^'):
+				out = newAssertion(RegexAutomaton::OP_LINE_START);
+				return true;
+			case _('$'):
+				out = newAssertion(RegexAutomaton::OP_LINE_END);
+				return true;
+			case _('\\'): {
+				Char e = peek();
+				++pos;
+				if (e == _('b')) {
+					out = newAssertion(RegexAutomaton::OP_WORD_BOUNDARY);
+					return true;
+				} else if (e == _('B')) {
+					out = newAssertion(RegexAutomaton::OP_NOT_WORD_BOUNDARY);
+					return true;
+				}
+				RegexAutomaton::CharSet set;
+				set.negated = false;
+				Char ch;
+				if (parseEscapeChar(e, ch)) {
+					out = newChar(ch);
+				} else if (parseEscapeClass(e, set)) {
+					out = newNode(Node::SET);
+					nodes[out].index = (UInt)automaton.sets.size();
+					automaton.sets.push_back(set);
+				} else {
+					return false;
+				}
+				return true;
+			}
+			case _(')'): case _(']'): case _('{'): case _('}'):
+			case _('*'): case _('+'): case _('?'):
+				return false; // stray or nothing to repeat
+			default:
+				out = newChar(c);
+				return true;
+		}
+	}
+
+	UInt newChar(Char c) {
+		UInt n = newNode(Node::CHAR);
+		nodes[n].c = c;
+		return n;
+	}
+	UInt newAssertion(RegexAutomaton::Op op) {
+		UInt n = newNode(Node::ASSERTION);
+		nodes[n].index = op;
+		return n;
+	}
+
+	/// Parse an escaped character, \\n, \\t, \\. etc.
+	bool parseEscapeChar(Char e, Char& out) {
+		switch (e) {
+			case _('n'): out = _('\n'); return true;
+			case _('t'): out = _('\t'); return true;
+			case _('r'): out = _('\r'); return true;
+			case _('f'): out = _('\f'); return true;
+			default:
+				out = e;
+				return is_escapable_literal(e);
+		}
+	}
+	/// Parse an escaped character class, \\d, \\w, \\s, or their negations
+	bool parseEscapeClass(Char e, RegexAutomaton::CharSet& set) {
+		Char lower = e;
+		switch (e) {
+			case _('d'): case _('w'): case _('s'):
+				break;
+			case _('D'): case _('W'): case _('S'):
+				lower = e - _('A') + _('a');
+				break;
+			default:
+				return false;
+		}
+		RegexAutomaton::CharClassMask mask = automaton.traits.lookup_classname(&lower, &lower + 1);
+		if (!mask) return false;
+		if (lower == e) set.classes.push_back(mask);
+		else            set.not_classes.push_back(mask);
+		return true;
+	}
+
+	/// Parse a set [...], after the [
+	bool parseSet(UInt& out) {
+		RegexAutomaton::CharSet set;
+		set.negated = peek() == _('^');
+		if (set.negated) ++pos;
+		if (peek() == _(']')) return false; // boost allows []...], not worth it
+		bool first = true;
+		while (true) {
+			if (atEnd()) return false;
+			Char c = peek();
+			++pos;
+			if (c == _(']')) break;
+			Char lo;
+			if (c == _('[')) {
+				// [:name:]
+				if (peek() != _(':')) return false;
+				size_t name_end = code.find(_(":]"), pos + 1);
+				if (name_end == String::npos) return false;
+				std::basic_string<Char> name(code.begin() + pos + 1, code.begin() + name_end);
+				if (name.empty() || name[0] == _('^')) return false;
+				RegexAutomaton::CharClassMask mask = automaton.traits.lookup_classname(name.data(), name.data() + name.size());
+				if (!mask) return false;
+				set.classes.push_back(mask);
+				pos = name_end + 2;
+				first = false;
+				continue;
+			} else if (c == _('\\')) {
+				Char e = peek();
+				++pos;
+				if (!parseEscapeChar(e, lo)) {
+					if (!parseEscapeClass(e, set)) return false;
+					if (peek() == _('-') && peek(1) != _(']')) return false; // range starting with a class
+					first = false;
+					continue;
+				}
+			} else if (c == _('-') && !first && peek() != _(']')) {
+				return false; // a '-' that is not part of a range
+			} else {
+				lo = c;
+			}
+			first = false;
+			// range?
+			Char hi = lo;
+			if (peek() == _('-') && peek(1) != _(']') && peek(1) != 0) {
+				++pos;
+				hi = peek();
+				++pos;
+				if (hi == _('[')) return false;
+				if (hi == _('\\')) {
+					Char e = peek();
+					++pos;
+					if (!parseEscapeChar(e, hi)) return false;
+				}
+				if (hi < lo) return false;
+			}
+			set.ranges.push_back(std::make_pair(lo, hi));
+		}
+		out = newNode(Node::SET);
+		nodes[out].index = (UInt)automaton.sets.size();
+		automaton.sets.push_back(set);
+		return true;
+	}
+
+	bool parseNumber(UInt& out) {
+		if (peek() < _('0') || peek() > _('9')) return false;
+		out = 0;
+		while (peek() >= _('0') && peek() <= _('9')) {
+			out = out * 10 + (peek() - _('0'));
+			if (out > MAX_REPEAT_COUNT) return false;
+			++pos;
+		}
+		return true;
+	}
+
+	/// Parse a repetition after an atom, if there is one
+	bool parseRepeat(UInt& atom) {
+		UInt min, max;
+		Char c = peek();
+		if (c == _('*')) {
+			min = 0; max = REPEAT_INFINITE; ++pos;
+		} else if (c == _('+')) {
+			min = 1; max = REPEAT_INFINITE; ++pos;
+		} else if (c == _('?')) {
+			min = 0; max = 1; ++pos;
+		} else if (c == _('{')) {
+			++pos;
+			if (!parseNumber(min)) return false;
+			max = min;
+			if (peek() == _(',')) {
+				++pos;
+				max = REPEAT_INFINITE;
+				if (peek() != _('}') && !parseNumber(max)) return false;
+			}
+			if (peek() != _('}') || max < min) return false;
+			++pos;
+		} else {
+			return true; // no repetition
+		}
+		bool greedy = true;
+		if (peek() == _('?')) {
+			greedy = false;
+			++pos;
+		}
+		c = peek();
+		if (c == _('*') || c == _('+') || c == _('?') || c == _('{')) return false; // possessive or double repetition
+		if (nodes[atom].kind == Node::ASSERTION) return false;
+		// backtracking and the automaton can differ in how they treat empty iterations
+		if (nullable(atom)) return false;
+		UInt repeat = newNode(Node::REPEAT);
+		nodes[repeat].min    = min;
+		nodes[repeat].max    = max;
+		nodes[repeat].greedy = greedy;
+		nodes[repeat].children.push_back(atom);
+		atom = repeat;
+		return true;
+	}
+
+	/// Can a node match the empty string?
+	bool nullable(UInt n) const {
+		const Node& node = nodes[n];
+		switch (node.kind) {
+			case Node::CHAR: case Node::ANY: case Node::SET:
+				return false;
+			case Node::ASSERTION:
+				return true;
+			case Node::ALTERNATIVES:
+				for (size_t i = 0 ; i < node.children.size() ; ++i) {
+					if (nullable(node.children[i])) return true;
+				}
+				return false;
+			case Node::REPEAT:
+				return node.min == 0 || nullable(node.children[0]);
+			default: // GROUP, SEQUENCE
+				for (size_t i = 0 ; i < node.children.size() ; ++i) {
+					if (!nullable(node.children[i])) return false;
+				}
+				return true;
+		}
+	}
+
+	// --------------------------------------------------- : Code generation
+
+	UInt emit(RegexAutomaton::Op op, UInt x = 0, UInt y = 0, Char c = 0) {
+		RegexAutomaton::Instruction i;
+		i.op = op;
+		i.c  = c;
+		i.x  = x;
+		i.y  = y;
+		automaton.program.push_back(i);
+		return (UInt)automaton.program.size() - 1;
+	}
+	inline UInt here() const { return (UInt)automaton.program.size(); }
+	/// Set the targets of a split, the first one is preferred if prefer_first
+	void patchSplit(UInt split, UInt first, UInt second, bool prefer_first) {
+		automaton.program[split].x = prefer_first ? first  : second;
+		automaton.program[split].y = prefer_first ? second : first;
+	}
+
+	bool emit(UInt n) {
+		if (automaton.program.size() > MAX_AUTOMATON_SIZE) return false;
+		const Node& node = nodes[n];
+		switch (node.kind) {
+			case Node::CHAR:      emit(RegexAutomaton::OP_CHAR, 0, 0, node.c); return true;
+			case Node::ANY:       emit(RegexAutomaton::OP_ANY); return true;
+			case Node::SET:       emit(RegexAutomaton::OP_SET, node.index); return true;
+			case Node::ASSERTION: emit((RegexAutomaton::Op)node.index); return true;
+			case Node::GROUP:
+				if (node.index) emit(RegexAutomaton::OP_SAVE, 2 * node.index);
+				if (!emit(node.children[0])) return false;
+				if (node.index) emit(RegexAutomaton::OP_SAVE, 2 * node.index + 1);
+				return true;
+			case Node::SEQUENCE:
+				for (size_t i = 0 ; i < node.children.size() ; ++i) {
+					if (!emit(node.children[i])) return false;
+				}
+				return true;
+			case Node::ALTERNATIVES: {
+				vector<UInt> jumps;
+				for (size_t i = 0 ; i + 1 < node.children.size() ; ++i) {
+					UInt split = emit(RegexAutomaton::OP_SPLIT);
+					if (!emit(node.children[i])) return false;
+					jumps.push_back(emit(RegexAutomaton::OP_JUMP));
+					patchSplit(split, split + 1, here(), true);
+				}
+				if (!emit(node.children.back())) return false;
+				for (size_t i = 0 ; i < jumps.size() ; ++i) {
+					automaton.program[jumps[i]].x = here();
+				}
+				return true;
+			}
+			case Node::REPEAT: {
+				UInt body = node.children[0];
+				if (node.max == REPEAT_INFINITE) {
+					if (node.min == 0) {
+						// loop: split body, end; body; jump loop
+						UInt loop = emit(RegexAutomaton::OP_SPLIT);
+						if (!emit(body)) return false;
+						emit(RegexAutomaton::OP_JUMP, loop);
+						patchSplit(loop, loop + 1, here(), node.greedy);
+					} else {
+						// body repeated min-1 times, then: loop: body; split loop, end
+						for (UInt i = 1 ; i < node.min ; ++i) {
+							if (!emit(body)) return false;
+						}
+						UInt loop = here();
+						if (!emit(body)) return false;
+						UInt split = emit(RegexAutomaton::OP_SPLIT);
+						patchSplit(split, loop, here(), node.greedy);
+					}
+				} else {
+					for (UInt i = 0 ; i < node.min ; ++i) {
+						if (!emit(body)) return false;
+					}
+					// optional repetitions, skipping one skips all of the following ones
+					vector<UInt> splits;
+					for (UInt i = node.min ; i < node.max ; ++i) {
+						splits.push_back(emit(RegexAutomaton::OP_SPLIT));
+						if (!emit(body)) return false;
+					}
+					for (size_t i = 0 ; i < splits.size() ; ++i) {
+						patchSplit(splits[i], splits[i] + 1, here(), node.greedy);
+					}
+				}
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+// ----------------------------------------------------------------------------- : RegexAutomaton
+
+RegexAutomaton* RegexAutomaton::compile(const String& code) {
+	scoped_ptr<RegexAutomaton> automaton(new RegexAutomaton);
+	Char w = _('w');
+	automaton->word_mask = automaton->traits.lookup_classname(&w, &w + 1);
+	RegexCompiler compiler(code, *automaton);
+	if (!compiler.compile()) return nullptr;
+	for (size_t i = 0 ; i < automaton->sets.size() ; ++i) {
+		RegexAutomaton::CharSet& set = automaton->sets[i];
+		for (size_t c = 0 ; c < 256 ; ++c) {
+			set.small.push_back(automaton->inSetUncached(set, (Char)c));
+		}
+	}
+	automaton->findStartChars();
+	return automaton.release();
+}
+
+void RegexAutomaton::findStartChars() {
+	start_chars.assign(256, 0);
+	start_other = false;
+	start_any   = false;
+	// instructions that can be reached from the start without consuming a character,
+	// assertions are assumed to be true
+	vector<bool> seen(program.size(), false);
+	vector<UInt> todo(1, 0);
+	while (!todo.empty() && !start_any) {
+		UInt pc = todo.back();
+		todo.pop_back();
+		if (seen[pc]) continue;
+		seen[pc] = true;
+		const Instruction& i = program[pc];
+		switch (i.op) {
+			case OP_CHAR:
+				if ((size_t)i.c < start_chars.size()) start_chars[i.c] = 1;
+				else                                  start_other = true;
+				break;
+			case OP_SET:
+				for (size_t c = 0 ; c < start_chars.size() ; ++c) {
+					if (inSet(sets[i.x], (Char)c)) start_chars[c] = 1;
+				}
+				start_other = true;
+				break;
+			case OP_ANY: case OP_MATCH:
+				start_any = true;
+				break;
+			case OP_JUMP:
+				todo.push_back(i.x);
+				break;
+			case OP_SPLIT:
+				todo.push_back(i.y);
+				todo.push_back(i.x);
+				break;
+			default: // saves and assertions
+				todo.push_back(pc + 1);
+		}
+	}
+}
+
+bool RegexAutomaton::canStartWith(Char c) const {
+	if (start_any) return true;
+	if ((size_t)c < start_chars.size()) return start_chars[c] != 0;
+	return start_other;
+}
+
+bool RegexAutomaton::inSetUncached(const CharSet& set, Char c) const {
+	bool in = false;
+	for (size_t i = 0 ; i < set.ranges.size() && !in ; ++i) {
+		in = set.ranges[i].first <= c && c <= set.ranges[i].second;
+	}
+	for (size_t i = 0 ; i < set.classes.size() && !in ; ++i) {
+		in = traits.isctype(c, set.classes[i]);
+	}
+	for (size_t i = 0 ; i < set.not_classes.size() && !in ; ++i) {
+		in = !traits.isctype(c, set.not_classes[i]);
+	}
+	return in != set.negated;
+}
+
+bool RegexAutomaton::isWord(Char c) const {
+	return traits.isctype(c, word_mask);
+}
+
+// ----------------------------------------------------------------------------- : RegexAutomaton : searching
+
+struct RegexAutomaton::ThreadList {
+	vector<UInt>      pcs;   ///< Instruction of each thread, in order of priority
+	vector<ptrdiff_t> slots; ///< Sub match positions of each thread
+
+	inline void clear() {
+		pcs.clear();
+		slots.clear();
+	}
+};
+
+struct RegexAutomaton::SearchState {
+	Iter           text_begin, end;
+	size_t         slot_count; ///< Number of sub match positions to keep track of
+	vector<size_t> marks;      ///< Generation in which each instruction was last added to a list
+	size_t         generation;
+};
+
+bool RegexAutomaton::assertion(UInt pc, const Iter& pos, const SearchState& s) const {
+	bool at_begin = pos == s.text_begin;
+	bool at_end   = pos == s.end;
+	switch (program[pc].op) {
+		case OP_LINE_START: {
+			if (at_begin) return true;
+			Char prev = *(pos - 1);
+			return is_line_separator(prev) && (at_end || !(prev == _('\r') && (Char)*pos == _('\n')));
+		}
+		case OP_LINE_END:
+			if (at_end) return true;
+			if (!is_line_separator(*pos)) return false;
+			return at_begin || !((Char)*(pos - 1) == _('\r') && (Char)*pos == _('\n'));
+		case OP_WORD_BOUNDARY:
+			return (!at_end && isWord(*pos)) != (!at_begin && isWord(*(pos - 1)));
+		case OP_NOT_WORD_BOUNDARY:
+			return !at_end && !at_begin && isWord(*pos) == isWord(*(pos - 1));
+		default:
+			return false;
+	}
+}
+
+void RegexAutomaton::addThread(ThreadList& list, SearchState& s, UInt pc, ptrdiff_t* slots, const Iter& pos) const {
+	if (s.marks[pc] == s.generation) return; // a thread with higher priority is already there
+	s.marks[pc] = s.generation;
+	const Instruction& i = program[pc];
+	switch (i.op) {
+		case OP_JUMP:
+			addThread(list, s, i.x, slots, pos);
+			break;
+		case OP_SPLIT:
+			addThread(list, s, i.x, slots, pos);
+			addThread(list, s, i.y, slots, pos);
+			break;
+		case OP_SAVE:
+			if (i.x < s.slot_count) {
+				ptrdiff_t old = slots[i.x];
+				slots[i.x] = pos - s.text_begin;
+				addThread(list, s, pc + 1, slots, pos);
+				slots[i.x] = old;
+			} else {
+				addThread(list, s, pc + 1, slots, pos);
+			}
+			break;
+		case OP_LINE_START: case OP_LINE_END: case OP_WORD_BOUNDARY: case OP_NOT_WORD_BOUNDARY:
+			if (assertion(pc, pos, s)) addThread(list, s, pc + 1, slots, pos);
+			break;
+		default:
+			list.pcs.push_back(pc);
+			list.slots.insert(list.slots.end(), slots, slots + s.slot_count);
+	}
+}
+
+bool RegexAutomaton::search(const Iter& text_begin, const Iter& start, const Iter& end, bool not_initial_null, vector<ptrdiff_t>* subs) const {
+	SearchState s;
+	s.text_begin = text_begin;
+	s.end        = end;
+	s.slot_count = subs ? 2 * sub_count : 0;
+	s.marks.assign(program.size(), (size_t)-1);
+	s.generation = 0;
+	vector<ptrdiff_t> no_match(s.slot_count + 1, -1); // +1 so there is always a first element
+	ThreadList current, next;
+	current.pcs.reserve(program.size());
+	next.pcs.reserve(program.size());
+	bool matched = false;
+	for (Iter pos = start ; ; ++pos) {
+		if (!matched && current.pcs.empty() && pos != end && !canStartWith(*pos)) {
+			// skip ahead to a character that can start a match
+			do {
+				++pos;
+			} while (pos != end && !canStartWith(*pos));
+			++s.generation; // marks are for another position
+		}
+		// start a new match here, with the lowest priority
+		if (!matched) addThread(current, s, 0, &no_match[0], pos);
+		// step all threads over the character at pos
+		++s.generation;
+		next.clear();
+		for (size_t t = 0 ; t < current.pcs.size() ; ++t) {
+			UInt pc = current.pcs[t];
+			const Instruction& i = program[pc];
+			ptrdiff_t* slots = s.slot_count ? &current.slots[t * s.slot_count] : &no_match[0];
+			if (i.op == OP_MATCH) {
+				if (not_initial_null && pos == start) continue;
+				if (!subs) return true;
+				matched = true;
+				subs->assign(slots, slots + s.slot_count);
+				break; // threads after this one have a lower priority
+			}
+			if (pos == end) continue;
+			Char c = *pos;
+			bool step = i.op == OP_ANY
+			         || (i.op == OP_CHAR && c == i.c)
+			         || (i.op == OP_SET  && inSet(sets[i.x], c));
+			if (step) addThread(next, s, pc + 1, slots, pos + 1);
+		}
+		std::swap(current, next);
+		if (pos == end || (matched && current.pcs.empty())) break;
+	}
+	return matched;
+}
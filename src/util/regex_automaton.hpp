@@ -0,0 +1,108 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) 2001 - 2012 Twan van Laarhoven and Sean Hunt             |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+#ifndef HEADER_UTIL_REGEX_AUTOMATON
+#define HEADER_UTIL_REGEX_AUTOMATON
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <boost/regex.hpp>
+
+// ----------------------------------------------------------------------------- : RegexAutomaton
+
+/// A regular expression compiled to an automaton, that finds matches in linear time
+/** boost::regex uses backtracking, which can take exponential time for some expressions.
+ *  The automaton is simulated in all its states at once (a 'Pike VM'), so every character of the input is only looked at once.
+ *  Alternatives and greedy/lazy repetitions are prioritized the same way as with backtracking,
+ *  so the matches and sub matches are the same as those found by boost::regex.
+ *
+ *  Only a subset of the syntax is supported: literals, '.', character sets, groups, alternatives, repetitions,
+ *  ^, $, \\b and \\B. Not supported are for instance backreferences, lookahead/lookbehind, modifiers such as (?i),
+ *  and the repetition of subexpressions that can match an empty string.
+ *  For such expressions compile() returns nullptr, and boost::regex should be used instead.
+ */
+class RegexAutomaton {
+  public:
+	typedef String::const_iterator Iter;
+
+	/// Compile a regular expression, returns nullptr if it is not supported
+	static RegexAutomaton* compile(const String& code);
+
+	/// Number of sub matches, including the whole match
+	inline size_t subCount() const { return sub_count; }
+
+	/// Find the first match that starts in [start,end)
+	/** The text between text_begin and start is only used by ^ and \\b.
+	 *  If not_initial_null is set, an empty match at start is not allowed.
+	 *  If subs is given it is filled with the begin and end positions (relative to text_begin) of all sub matches,
+	 *  or -1 for sub matches that did not participate.
+	 */
+	bool search(const Iter& text_begin, const Iter& start, const Iter& end, bool not_initial_null, vector<ptrdiff_t>* subs) const;
+
+  private:
+	typedef boost::regex_traits<Char>  Traits;
+	typedef Traits::char_class_type    CharClassMask;
+
+	enum Op
+	{	OP_CHAR                ///< match the character c
+	,	OP_ANY                 ///< match any character
+	,	OP_SET                 ///< match a character in sets[x]
+	,	OP_LINE_START          ///< ^
+	,	OP_LINE_END            ///< $
+	,	OP_WORD_BOUNDARY       ///< \b
+	,	OP_NOT_WORD_BOUNDARY   ///< \B
+	,	OP_SAVE                ///< store the position in sub match slot x
+	,	OP_SPLIT               ///< continue at x, with lower priority at y
+	,	OP_JUMP                ///< continue at x
+	,	OP_MATCH               ///< found a match
+	};
+	struct Instruction {
+		Op   op;
+		Char c;
+		UInt x, y;
+	};
+	/// A character set, [...]
+	struct CharSet {
+		bool                            negated;
+		vector<std::pair<Char,Char> >   ranges;      ///< inclusive ranges of characters in the set
+		vector<CharClassMask>           classes;     ///< character classes in the set
+		vector<CharClassMask>           not_classes; ///< the set contains all characters not in these classes
+		vector<Byte>                    small;       ///< is each character < 256 in the set? computed after compiling
+	};
+
+	vector<Instruction> program;
+	vector<CharSet>     sets;
+	size_t              sub_count;
+	Traits              traits;
+	CharClassMask       word_mask;
+	vector<Byte>        start_chars; ///< Characters < 256 that can be the first character of a match
+	bool                start_other; ///< Can other characters be the first character of a match?
+	bool                start_any;   ///< Can any character start a match, or can it be empty?
+
+	/// Threads of the automaton at a single position
+	struct ThreadList;
+	/// State of a single search
+	struct SearchState;
+
+	/// Determine the characters that can start a match
+	void findStartChars();
+	bool canStartWith(Char c) const;
+	inline bool inSet(const CharSet& set, Char c) const {
+		return (size_t)c < set.small.size() ? set.small[c] != 0 : inSetUncached(set, c);
+	}
+	bool inSetUncached(const CharSet& set, Char c) const;
+	bool isWord(Char c) const;
+	/// Is the assertion of instruction pc true at pos?
+	bool assertion(UInt pc, const Iter& pos, const SearchState& s) const;
+	/// Add a thread at pc to a list, following jumps, splits, assertions and saves
+	void addThread(ThreadList& list, SearchState& s, UInt pc, ptrdiff_t* slots, const Iter& pos) const;
+
+	friend class RegexCompiler;
+};
+
+// ----------------------------------------------------------------------------- : EOF
+#endif
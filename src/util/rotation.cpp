@@ -9,6 +9,7 @@
 #include <util/prec.hpp>
 #include <util/rotation.hpp>
 #include <gfx/gfx.hpp>
+#include <gfx/headless_dc.hpp>
 #include <data/font.hpp>
 
 // ----------------------------------------------------------------------------- : Rotation
@@ -376,6 +377,9 @@ void RotatedDC::DestroyClippingRegion() {
 
 Bitmap RotatedDC::GetBackground(const RealRect& r) {
 	wxRect wr = trRectToBB(r);
+	if (dynamic_cast<HeadlessDC*>(&dc)) {
+		return Bitmap(); // only editors use this, and there are no editors without a display
+	}
 	Bitmap background(wr.width, wr.height);
 	wxMemoryDC mdc;
 	mdc.SelectObject(background);
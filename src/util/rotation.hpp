@@ -208,6 +208,7 @@ class RotatedDC : public Rotation {
 	// --------------------------------------------------- : Other
 	
 	/// Get the current contents of the given ractangle, for later restoring
+	/** Only for the screen, on a HeadlessDC this returns an invalid bitmap */
 	Bitmap GetBackground(const RealRect& r);
 	
 	inline wxDC& getDC() { return dc; }
@@ -295,9 +295,9 @@ Char remove_accents(Char c) {
 			dec = latin_1[c - 0xC0];
 		} else if (c <= 0x17E) { // Latin extended A
 			dec = latin_A[c - 0x100];
-		} else if (c <= 0x180 && c <= 0x240) { // Latin extended B
+		} else if (c >= 0x180 && c <= 0x24F) { // Latin extended B
 			dec = latin_B[c - 0x180];
-		} else if (c <= 0x1E00 && c <= 0x1EFF) { // Latin additional
+		} else if (c >= 0x1E00 && c <= 0x1EFF) { // Latin additional
 			dec = latin_E[c - 0x1E00];
 		}
 	}
@@ -360,14 +360,15 @@ int smart_compare(const String& sa, const String& sb) {
 				if (la2 || lb2) {
 					if (la2) a = la2;
 					else {
-						if (++pa >= na) return 1;
+						if (++pa >= na) return -1; // a ends first, so it is shorter
 						a = sa.GetChar(pa);
 					}
 					if (lb2) b = lb2;
 					else {
-						if (++pb >= nb) return -1;
+						if (++pb >= nb) return 1;
 						b = sb.GetChar(pb);
 					}
+					in_num = false; // a and b were not digits
 					goto next; // don't move to the next character in both strings
 				}
 			} else {
@@ -403,6 +404,43 @@ bool smart_equal(const String& sa, const String& sb) {
 	return smart_compare(sa, sb) == 0;
 }
 
+/// Add a character (or other number) to a collation key, big endian so memcmp gives the right order
+inline void add_collation_unit(CollationKey& key, UInt c) {
+	key += (char)((c >> 16) & 0xFF);
+	key += (char)((c >> 8)  & 0xFF);
+	key += (char)( c        & 0xFF);
+}
+
+CollationKey collation_key(const String& s) {
+	CollationKey key;
+	key.reserve(3 * s.size());
+	size_t n = s.size();
+	for (size_t i = 0 ; i < n ; ) {
+		Char c = s.GetChar(i);
+		if (isDigit(c)) {
+			// numbers: longer numbers are larger, numbers of the same length are compared digit by digit
+			size_t end = i + 1;
+			while (end < n && isDigit(s.GetChar(end))) ++end;
+			add_collation_unit(key, _('0'));
+			add_collation_unit(key, (UInt)(end - i));
+			for ( ; i < end ; ++i) {
+				add_collation_unit(key, s.GetChar(i));
+			}
+		} else if (c < 0x20) {
+			// control characters are compared as they are
+			add_collation_unit(key, c);
+			++i;
+		} else {
+			add_collation_unit(key, remove_accents(c));
+			if (Char c2 = decompose_char2(c)) {
+				add_collation_unit(key, c2);
+			}
+			++i;
+		}
+	}
+	return key;
+}
+
 bool starts_with(const String& str, const String& start) {
 	return (str.size() >= start.size()) &&
 		   std::equal(start.begin(), start.end(), str.begin());
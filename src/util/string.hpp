@@ -186,6 +186,15 @@ bool smart_less(const String&, const String&);
 /// Compare two strings for equality
 bool smart_equal(const String&, const String&);
 
+/// A key for sorting strings, see collation_key
+typedef std::string CollationKey;
+
+/// Key for sorting a string
+/** Comparing the keys of two strings (with memcmp or CollationKey::compare) gives the same result as smart_compare,
+ *  so when strings are compared many times, e.g. for sorting, the work of smart_compare only has to be done once per string.
+ */
+CollationKey collation_key(const String&);
+
 /// Return whether str starts with start
 /** starts_with(a,b) == is_substr(a,0,b) */
 bool starts_with(const String& str, const String& start);
@@ -0,0 +1,51 @@
+#!/usr/bin/perl
+
+# Export card images without a display:
+# 1. Invoke magicseteditor --export-images with DISPLAY and WAYLAND_DISPLAY unset
+# 2. Ensure that there are no errors
+# 3. Ensure that there is a PNG file for each card
+
+use strict;
+use lib "../util/";
+use MseTestUtils;
+use TestFramework;
+
+# -----------------------------------------------------------------------------
+# The tests
+# -----------------------------------------------------------------------------
+
+# Does the file start with the PNG signature?
+sub is_png {
+	my $filename = shift;
+	open my $file, '<:raw', $filename or return 0;
+	read($file, my $header, 8);
+	close $file;
+	return $header eq "\x89PNG\r\n\x1a\n";
+}
+
+test_case("export-images/headless", sub{
+	# This test is about running without a display, which is only possible with GTK
+	if ($^O =~ /win/i || $^O eq 'darwin') {
+		print "skipped, only for GTK\n";
+		return;
+	}
+	
+	# The cards use the image, symbol and choice fields, symbol fonts and several stylesheets
+	my $set = "../script/simple-magic-2.0.0.mse-set";
+	my @cards = glob "$set/card *";
+	mkdir("out");
+	unlink(glob "out/*.png");
+	run_export_images_test($set, "out/{card.name}.png", headless => 1, cleanup => 1);
+	
+	my @images = glob "out/*.png";
+	print "cards: ", scalar(@cards), ", images: ", scalar(@images), "\n";
+	fail_current_test() if @images != @cards;
+	foreach (@images) {
+		if (!is_png($_) || -s $_ < 1000) {
+			print "Not a card image: $_\n";
+			fail_current_test();
+		}
+	}
+});
+
+1;
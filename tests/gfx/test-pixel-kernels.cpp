@@ -0,0 +1,181 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) 2001 - 2012 Twan van Laarhoven and Sean Hunt             |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// Compare the SIMD pixel kernels to the plain ones.
+// They must give exactly the same results, for all pairs of input bytes and for random pixels,
+// including the bytes at the end that don't fill a whole vector.
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <gfx/simd.hpp>
+#include <gfx/pixel_kernels.hpp>
+#include <stdio.h>
+#include <stdlib.h>
+
+// ----------------------------------------------------------------------------- : Test data
+
+struct NamedCombine {
+	const char* name;
+	PixelKernels::Combine PixelKernels::* kernel;
+};
+const NamedCombine combine_kernels[] = {
+	{"add",               &PixelKernels::add},
+	{"subtract",          &PixelKernels::subtract},
+	{"stamp",             &PixelKernels::stamp},
+	{"difference",        &PixelKernels::difference},
+	{"negation",          &PixelKernels::negation},
+	{"multiply",          &PixelKernels::multiply},
+	{"darken",            &PixelKernels::darken},
+	{"lighten",           &PixelKernels::lighten},
+	{"color dodge",       &PixelKernels::color_dodge},
+	{"color burn",        &PixelKernels::color_burn},
+	{"screen",            &PixelKernels::screen},
+	{"overlay",           &PixelKernels::overlay},
+	{"hard light",        &PixelKernels::hard_light},
+	{"soft light",        &PixelKernels::soft_light},
+	{"reflect",           &PixelKernels::reflect},
+	{"glow",              &PixelKernels::glow},
+	{"freeze",            &PixelKernels::freeze},
+	{"heat",              &PixelKernels::heat},
+	{"and",               &PixelKernels::bit_and},
+	{"or",                &PixelKernels::bit_or},
+	{"xor",               &PixelKernels::bit_xor},
+	{"shadow",            &PixelKernels::shadow},
+	{"symmetric overlay", &PixelKernels::symmetric_overlay},
+};
+
+/// Buffers with all pairs of bytes, followed by some random bytes, so the size is not a multiple of the vector size
+const size_t PAIRS = 256 * 256;
+const size_t SIZE  = PAIRS + 1000 + 13;
+
+void fill(vector<Byte>& a, vector<Byte>& b, vector<Byte>& c) {
+	a.resize(SIZE); b.resize(SIZE); c.resize(SIZE);
+	for (size_t i = 0 ; i < SIZE ; ++i) {
+		a[i] = i < PAIRS ? (Byte)(i >> 8)  : (Byte)rand();
+		b[i] = i < PAIRS ? (Byte)(i & 255) : (Byte)rand();
+		c[i] = (Byte)rand();
+	}
+}
+
+// ----------------------------------------------------------------------------- : Comparing
+
+int failures = 0;
+
+/// Compare the results of a kernel, offset is used to test unaligned data
+void compare(const char* level, const char* name, const vector<Byte>& expected, const vector<Byte>& actual, size_t offset) {
+	for (size_t i = offset ; i < expected.size() ; ++i) {
+		if (expected[i] != actual[i]) {
+			printf("%s %s: byte %u differs, expected %d, got %d\n", level, name, (unsigned)i, expected[i], actual[i]);
+			++failures;
+			return;
+		}
+	}
+}
+
+void test_kernels(const char* level, const PixelKernels& simd) {
+	const PixelKernels& plain = pixel_kernels_plain;
+	vector<Byte> a, b, c;
+	fill(a, b, c);
+	for (size_t offset = 0 ; offset < 2 ; ++offset) {
+		// combining
+		for (size_t k = 0 ; k < sizeof(combine_kernels) / sizeof(combine_kernels[0]) ; ++k) {
+			PixelKernels::Combine PixelKernels::* kernel = combine_kernels[k].kernel;
+			vector<Byte> expected = a, actual = a;
+			(plain.*kernel)(&expected[offset], &b[offset], SIZE - offset);
+			size_t done = (simd.*kernel)(&actual[offset], &b[offset], SIZE - offset);
+			(plain.*kernel)(&actual[offset + done], &b[offset + done], SIZE - offset - done);
+			compare(level, combine_kernels[k].name, expected, actual, offset);
+		}
+		// mask blend
+		{
+			vector<Byte> expected = a, actual = a;
+			plain.mask_blend(&expected[offset], &b[offset], &c[offset], SIZE - offset);
+			size_t done = simd.mask_blend(&actual[offset], &b[offset], &c[offset], SIZE - offset);
+			plain.mask_blend(&actual[offset + done], &b[offset + done], &c[offset + done], SIZE - offset - done);
+			compare(level, "mask_blend", expected, actual, offset);
+		}
+		// scale, with every factor
+		for (int factor = 0 ; factor < 256 ; ++factor) {
+			vector<Byte> expected = a, actual = a;
+			plain.scale(&expected[offset], (Byte)factor, SIZE - offset);
+			size_t done = simd.scale(&actual[offset], (Byte)factor, SIZE - offset);
+			plain.scale(&actual[offset + done], (Byte)factor, SIZE - offset - done);
+			compare(level, "scale", expected, actual, offset);
+		}
+		// invert
+		{
+			vector<Byte> expected = a, actual = a;
+			plain.invert(&expected[offset], SIZE - offset);
+			size_t done = simd.invert(&actual[offset], SIZE - offset);
+			plain.invert(&actual[offset + done], SIZE - offset - done);
+			compare(level, "invert", expected, actual, offset);
+		}
+		// lerp, with the extreme and middle factors, and random ones
+		const int lerp_factors[] = {0, 1, 255, 256, 32768, 65535, 65536, -1};
+		for (size_t f = 0 ; f < sizeof(lerp_factors) / sizeof(lerp_factors[0]) ; ++f) {
+			vector<int> t(SIZE);
+			for (size_t i = 0 ; i < SIZE ; ++i) {
+				t[i] = lerp_factors[f] >= 0 ? lerp_factors[f] : rand() % 65537;
+			}
+			vector<Byte> expected = a, actual = a;
+			plain.lerp(&expected[offset], &b[offset], &t[offset], SIZE - offset);
+			size_t done = simd.lerp(&actual[offset], &b[offset], &t[offset], SIZE - offset);
+			plain.lerp(&actual[offset + done], &b[offset + done], &t[offset + done], SIZE - offset - done);
+			compare(level, "lerp", expected, actual, offset);
+		}
+		// affine, with the parameters used by saturate()
+		for (int factor = -256 ; factor <= 256 ; ++factor) {
+			if (factor == 0) continue;
+			int mul, sum_mul, div;
+			if (factor == 256)   { mul = 765; sum_mul = -255; div = 1; }
+			else if (factor > 0) { mul = 768; sum_mul = -factor; div = 768 - 3 * factor; }
+			else                 { mul = 768 + 3 * factor; sum_mul = -factor; div = 768; }
+			vector<int> add(SIZE);
+			for (size_t i = 0 ; i < SIZE ; ++i) {
+				add[i] = sum_mul * (a[i] + b[i] + c[i]);
+			}
+			vector<Byte> expected = a, actual = a;
+			plain.affine(&expected[offset], mul, &add[offset], div, SIZE - offset);
+			size_t done = simd.affine(&actual[offset], mul, &add[offset], div, SIZE - offset);
+			plain.affine(&actual[offset + done], mul, &add[offset + done], div, SIZE - offset - done);
+			compare(level, "affine", expected, actual, offset);
+		}
+	}
+}
+
+// ----------------------------------------------------------------------------- : Main
+
+int main() {
+	srand(12345);
+	SimdLevel level = simd_level();
+	#if HAVE_X86_PIXEL_KERNELS
+		if (level >= SIMD_SSE2) test_kernels("sse2", pixel_kernels_sse2);
+		else printf("sse2 is not supported, skipped\n");
+		if (level >= SIMD_AVX2) test_kernels("avx2", pixel_kernels_avx2);
+		else printf("avx2 is not supported, skipped\n");
+	#else
+		printf("no SIMD kernels on this platform\n");
+	#endif
+	// the dispatcher gives the same results as the plain kernels
+	vector<Byte> a, b, c;
+	fill(a, b, c);
+	vector<Byte> expected = a, actual = a;
+	pixel_kernels_plain.multiply(&expected[0], &b[0], SIZE);
+	combine_bytes(&PixelKernels::multiply, &actual[0], &b[0], SIZE);
+	compare("dispatch", "multiply", expected, actual, 0);
+	limit_simd_level(SIMD_NONE);
+	if (simd_level() != SIMD_NONE || pixel_kernels_simd() != nullptr) {
+		printf("limit_simd_level(SIMD_NONE) doesn't disable the SIMD kernels\n");
+		++failures;
+	}
+	if (failures) {
+		printf("%d failures\n", failures);
+		return 1;
+	}
+	printf("all pixel kernels are bit-exact\n");
+	return 0;
+}
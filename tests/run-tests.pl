@@ -19,4 +19,5 @@ sub test_subdir {
 test_subdir('script');
 test_subdir('stylesheets');
 test_subdir('export-templates');
+test_subdir('export-images');
 
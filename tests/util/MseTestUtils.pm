@@ -8,7 +8,7 @@ package MseTestUtils;
 
 require Exporter;
 @ISA = qw(Exporter);
-@EXPORT = qw(run_script_test run_export_test file_set_contents write_dummy_set remove_dummy_set compare_files); 
+@EXPORT = qw(run_script_test run_export_test run_export_images_test file_set_contents write_dummy_set remove_dummy_set compare_files); 
 
 use strict;
 use File::Basename;
@@ -86,6 +86,36 @@ sub run_export_test {
 	}
 }
 
+# Export the card images of a set
+# With headless => 1 there is no display, so the images are drawn without the GUI toolkit
+sub run_export_images_test {
+	my $set      = shift;
+	my $image    = shift;
+	my %opts     = @_;
+	my $ignore_locale_errors = $opts{ignore_locale_errors} // 1;
+	my $cleanup  = $opts{cleanup} // 0;
+	my $errfile  = basename($set,".mse-set") . ".err";
+	my $command  = "$MAGICSETEDITOR --export-images \"$set\" \"$image\" 2> \"$errfile\"";
+	print "$command\n";
+	local %ENV = %ENV;
+	if ($opts{headless}) {
+		delete $ENV{DISPLAY};
+		delete $ENV{WAYLAND_DISPLAY};
+	}
+	my $errcode = system($command);
+	if ($errcode != 0) {
+		print "Invoking Magic Set Editor failed\n";
+		fail_current_test();
+	}
+	
+	# Check for errors / warnings
+	check_for_errors($errfile, $ignore_locale_errors);
+	
+	if ($cleanup) {
+		unlink($errfile);
+	}
+}
+
 sub check_for_errors {
 	my $errfile = shift;
 	my $ignore_locale_errors = shift;
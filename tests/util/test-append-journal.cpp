@@ -0,0 +1,147 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) 2001 - 2012 Twan van Laarhoven and Sean Hunt             |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// Interrupt appending to a zip file, and check that the journal makes it readable again.
+// The garbage at the end is large enough that the old end of central directory record can't be found.
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <util/io/append_journal.hpp>
+#include <wx/init.h>
+#include <wx/file.h>
+#include <wx/filename.h>
+#include <wx/wfstream.h>
+#include <wx/zipstrm.h>
+#include <stdio.h>
+
+// ----------------------------------------------------------------------------- : Zip files
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+	if (!ok) {
+		printf("FAILED: %s\n", what);
+		++failures;
+	}
+}
+
+const char* const entry_names[]    = {"set", "image1", "image2"};
+const char* const entry_contents[] = {"mse version: 2.0.0\ngame: magic\n", "not really an image", ""};
+const int ENTRY_COUNT = 3;
+
+void write_zip(const String& filename) {
+	wxFileOutputStream out(filename);
+	wxZipOutputStream zip(out);
+	for (int i = 0 ; i < ENTRY_COUNT ; ++i) {
+		zip.PutNextEntry(String(entry_names[i], wxConvUTF8));
+		zip.Write(entry_contents[i], strlen(entry_contents[i]));
+	}
+}
+
+/// Can all entries of the zip file be read, with the right contents?
+bool read_zip(const String& filename) {
+	wxLogNull noLog;
+	wxFileInputStream in(filename);
+	wxZipInputStream zip(in);
+	if (zip.GetTotalEntries() != ENTRY_COUNT) return false;
+	for (int i = 0 ; i < ENTRY_COUNT ; ++i) {
+		wxZipEntry* entry = zip.GetNextEntry();
+		if (!entry) return false;
+		bool same_name = entry->GetName() == String(entry_names[i], wxConvUTF8);
+		delete entry;
+		if (!same_name) return false;
+		std::string data;
+		char buffer[256];
+		while (zip.Read(buffer, sizeof(buffer)).LastRead() > 0) {
+			data.append(buffer, zip.LastRead());
+		}
+		if (data != entry_contents[i]) return false;
+	}
+	return true;
+}
+
+/// Offset of the central directory, from the end of central directory record at the end of the file
+wxFileOffset central_directory_offset(wxFile& file) {
+	Byte end[22];
+	file.Seek(file.Length() - sizeof(end));
+	file.Read(end, sizeof(end));
+	return end[16] | end[17] << 8 | end[18] << 16 | (wxFileOffset)end[19] << 24;
+}
+
+/// Start appending, and stop halfway through as if the program crashed
+void interrupted_append(const String& filename, size_t garbage_size, bool journal) {
+	wxFile file(filename, wxFile::read_write);
+	wxFileOffset size = file.Length();
+	if (journal) check(begin_append(filename, file, size, central_directory_offset(file)), "begin_append");
+	// a local file header, and then the program stops
+	if (garbage_size < 4) return;
+	std::string garbage(garbage_size, 'x');
+	garbage.replace(0, 4, "PK\x03\x04", 4);
+	file.Seek(size);
+	file.Write(garbage.data(), garbage.size());
+}
+
+// ----------------------------------------------------------------------------- : Main
+
+int main() {
+	wxInitializer init;
+	String filename = wxFileName::CreateTempFileName(_("mse-test"));
+	String journal  = append_journal_name(filename);
+	write_zip(filename);
+	check(read_zip(filename), "the new zip file is readable");
+	wxFileOffset size = wxFileName::GetSize(filename).GetValue();
+	
+	// interrupted append, restored from the journal
+	interrupted_append(filename, 200 * 1024, true);
+	check(wxFileExists(journal), "the journal exists while appending");
+	check(!read_zip(filename), "an interrupted append can't be read without the journal");
+	check(recover_append(filename), "recover_append restores the file");
+	check(!wxFileExists(journal), "recover_append removes the journal");
+	check(wxFileName::GetSize(filename).GetValue() == size, "the file has its old size");
+	check(read_zip(filename), "the restored zip file is readable");
+	
+	// nothing to recover
+	check(!recover_append(filename), "recover_append without a journal does nothing");
+	check(read_zip(filename), "the zip file is still readable");
+	
+	// a journal that was only partly written is ignored
+	interrupted_append(filename, 0, true);
+	{
+		wxFile file(journal, wxFile::read_write);
+		check(truncate_file(file, file.Length() - 10), "truncate the journal");
+	}
+	check(!recover_append(filename), "a broken journal is not used");
+	check(!wxFileExists(journal), "a broken journal is removed");
+	check(read_zip(filename), "the file is left alone");
+	
+	// a journal for a larger file is not used
+	interrupted_append(filename, 0, true);
+	{
+		wxFile file(filename, wxFile::read_write);
+		check(truncate_file(file, size - 1), "truncate the zip file");
+	}
+	check(!recover_append(filename), "a journal for another file is not used");
+	check(!wxFileExists(journal), "that journal is removed");
+	
+	// a finished append
+	write_zip(filename);
+	{
+		wxFile file(filename, wxFile::read_write);
+		check(begin_append(filename, file, size, central_directory_offset(file)), "begin_append");
+	}
+	end_append(filename);
+	check(!wxFileExists(journal), "end_append removes the journal");
+	check(read_zip(filename), "the zip file is readable");
+	
+	wxRemoveFile(filename);
+	if (failures) {
+		printf("%d failures\n", failures);
+		return 1;
+	}
+	printf("interrupted appends are recovered\n");
+	return 0;
+}
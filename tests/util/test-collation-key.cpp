@@ -0,0 +1,83 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) 2001 - 2012 Twan van Laarhoven and Sean Hunt             |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// Comparing collation keys must give the same order as smart_compare, for every pair of strings.
+// The strings have numbers with leading zeros, mixed case, punctuation and non-ASCII characters.
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <util/string.hpp>
+#include <stdio.h>
+
+// ----------------------------------------------------------------------------- : Test data
+
+const Char* const strings[] = {
+	_(""),
+	// numbers and leading zeros
+	_("0"), _("00"), _("000"), _("1"), _("01"), _("001"), _("7"), _("07"), _("007"),
+	_("9"), _("10"), _("010"), _("99"), _("100"), _("0100"), _("1000000000000000000000"),
+	_("card 9"), _("card 09"), _("card 10"), _("card 010"), _("card 9a"), _("card 9 b"),
+	_("a1b2"), _("a01b2"), _("a1b02"), _("a10b1"), _("1a"), _("12"), _("2a"), _("13a"),
+	// mixed case
+	_("apple"), _("Apple"), _("APPLE"), _("aPPle"), _("apples"), _("Apple2"), _("apple10"),
+	_("B"), _("b"), _("Ba"), _("bA"), _("z"), _("Z"),
+	// punctuation and spaces
+	_("a b"), _("a  b"), _("a-b"), _("a_b"), _("a.b"), _("a,b"), _("a!"), _("(a)"), _("[a]"),
+	_("a/1"), _("a:1"), _("a9:"), _("a 1"), _("a-1"), _("~"), _("'quoted'"), _("\"quoted\""),
+	// control characters
+	_("a\tb"), _("a\x01"), _("\x1F"), _("\n"), _("1\x05"),
+	// non-ASCII: accents, ligatures, the ends of the Latin tables, other scripts, and superscript digits
+	_("\u00E9"), _("e"), _("\u00C9"), _("E"), _("caf\u00E9"), _("cafe"), _("Caf\u00C9 2"),
+	_("na\u00EFve"), _("naive"), _("\u00E6"), _("ae"), _("a"), _("\u00C6r\u00F8"), _("aero"), _("\u00E61"), _("a5"),
+	_("\u0152uvre"), _("oeuvre"), _("stra\u00DFe"), _("strasse"), _("\u0132"), _("ij"), _("\u01C6"), _("dz"),
+	_("\u0101"), _("\u017F"), _("\u0180"), _("\u01FC"), _("\u024F"), _("\u1E00"), _("\u1EFF"),
+	_("\u0414\u043E\u043C"), _("\u0434\u043E\u043C"), _("\u03A9mega"), _("\u03C9mega"), _("\u65E5\u672C"),
+	_("\u00BD"), _("\u00B2"), _("x\u00B2"), _("x2"),
+};
+const size_t STRING_COUNT = sizeof(strings) / sizeof(strings[0]);
+
+// ----------------------------------------------------------------------------- : Comparing
+
+int failures = 0;
+
+int sign(int x) {
+	return x < 0 ? -1 : x > 0 ? 1 : 0;
+}
+
+void check_order(const String& a, const String& b, int expected) {
+	int actual = sign(collation_key(a).compare(collation_key(b)));
+	if (actual != expected) {
+		printf("FAILED: \"%s\" and \"%s\": expected %d, the collation keys give %d\n",
+		       (const char*)a.utf8_str(), (const char*)b.utf8_str(), expected, actual);
+		++failures;
+	}
+}
+
+// ----------------------------------------------------------------------------- : Main
+
+int main() {
+	// the same order as smart_compare
+	for (size_t i = 0 ; i < STRING_COUNT ; ++i) {
+		for (size_t j = 0 ; j < STRING_COUNT ; ++j) {
+			check_order(strings[i], strings[j], sign(smart_compare(strings[i], strings[j])));
+		}
+	}
+	// and that order is the one people expect
+	check_order(_("card 9"),          _("card 10"), -1);
+	check_order(_("007"),             _("7"),        1);
+	check_order(_("Apple"),           _("apple"),    0);
+	check_order(_("apple"),           _("Banana"),  -1);
+	check_order(_("\u00E9t\u00E9"),   _("ete"),      0);
+	check_order(_("\u00E6"),          _("ae"),       0);
+	check_order(_("a b"),             _("ab"),      -1);
+	if (failures) {
+		printf("%d failures\n", failures);
+		return 1;
+	}
+	printf("collation keys give the same order as smart_compare\n");
+	return 0;
+}